@@ -134,3 +134,106 @@ type Hyper struct {
 	HyperName string          `json:"hyperName"`
 	Data      json.RawMessage `json:"data,omitempty"`
 }
+
+// The Stats payload asks the proxy for counters about the I/O it relays and
+// the hyperstart commands it forwards. Those can be used to tell proxy
+// bottlenecks apart from slowness inside the VM. containerId is optional and
+// restricts the result to a single VM.
+//
+// The result of a stats operation is encoded as a StatsResult.
+//
+//  {
+//    "id": "stats",
+//    "data": {
+//      "containerId": "756535dc6e9ab9b560f84c8..."
+//    }
+//  }
+type Stats struct {
+	ContainerID string `json:"containerId,omitempty"`
+}
+
+// IoCounters accounts for data relayed in one direction. Bytes include the
+// 12 bytes header of each message on the hyperstart I/O channel.
+type IoCounters struct {
+	Bytes    uint64 `json:"bytes"`
+	Messages uint64 `json:"messages"`
+}
+
+// LatencyHistogram is a histogram of durations. Counts[i] is the number of
+// samples lower or equal to BoundsUs[i] microseconds (and greater than
+// BoundsUs[i-1]). The last element of Counts has no upper bound.
+type LatencyHistogram struct {
+	BoundsUs []uint64 `json:"boundsUs"`
+	Counts   []uint64 `json:"counts"`
+	Count    uint64   `json:"count"`
+	SumUs    uint64   `json:"sumUs"`
+}
+
+// SessionStats holds the counters of an I/O session, as created by
+// allocateIO. ToClient is data from the process inside the VM (stdout,
+// stderr), FromClient is data to the process (stdin). QueueDepth is the
+// number of messages waiting to be written to the client, out of
+// QueueLength, and Dropped the number of messages dropped because the queue
+// was full.
+type SessionStats struct {
+	IoBase      uint64     `json:"ioBase"`
+	NStreams    int        `json:"nStreams"`
+	ClientID    uint64     `json:"clientId"`
+	ToClient    IoCounters `json:"toClient"`
+	FromClient  IoCounters `json:"fromClient"`
+	Dropped     uint64     `json:"dropped"`
+	QueueDepth  int        `json:"queueDepth"`
+	QueueLength int        `json:"queueLength"`
+}
+
+// VMStats holds the counters of a VM. Unroutable is the number of messages
+// received from hyperstart for a sequence number without session.
+// CtlLatency is the round-trip time of the hyperstart commands forwarded
+// with the hyper payload.
+type VMStats struct {
+	ContainerID string           `json:"containerId"`
+	ToClients   IoCounters       `json:"toClients"`
+	FromClients IoCounters       `json:"fromClients"`
+	Unroutable  uint64           `json:"unroutable"`
+	CtlLatency  LatencyHistogram `json:"ctlLatency"`
+	Sessions    []SessionStats   `json:"sessions"`
+}
+
+// StatsResult is the result from a successful stats operation.
+//
+//  {
+//    "success": true,
+//    "data": {
+//      "goroutines": 12,
+//      "vms": [
+//        {
+//          "containerId": "756535dc6e9ab9b560f84c8...",
+//          "toClients": { "bytes": 4096, "messages": 10 },
+//          "fromClients": { "bytes": 64, "messages": 2 },
+//          "unroutable": 0,
+//          "ctlLatency": {
+//            "boundsUs": [ 50, 100, ... ],
+//            "counts": [ 0, 3, ... ],
+//            "count": 3,
+//            "sumUs": 240
+//          },
+//          "sessions": [
+//            {
+//              "ioBase": 1,
+//              "nStreams": 2,
+//              "clientId": 3,
+//              "toClient": { "bytes": 4096, "messages": 10 },
+//              "fromClient": { "bytes": 64, "messages": 2 },
+//              "dropped": 0,
+//              "queueDepth": 0,
+//              "queueLength": 128
+//            }
+//          ]
+//        }
+//      ]
+//    }
+//  }
+type StatsResult struct {
+	Goroutines int       `json:"goroutines"`
+	VMs        []VMStats `json:"vms"`
+}
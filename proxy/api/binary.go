@@ -0,0 +1,164 @@
+// Copyright (c) 2016 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package api
+
+import (
+	"encoding/binary"
+	"errors"
+	"fmt"
+	"syscall"
+)
+
+// Flags of the message header.
+const (
+	// FlagBinary is set on messages whose payload uses the binary
+	// encoding described below rather than JSON.
+	FlagBinary uint32 = 1 << 0
+
+	// FlagBinarySupported is set by the proxy on all its responses when it
+	// accepts binary requests. A client may only send FlagBinary requests
+	// once it has seen a response with this flag.
+	FlagBinarySupported uint32 = 1 << 1
+)
+
+// The binary encoding is an alternative to JSON for a few high frequency
+// requests. All integers are big endian.
+//
+// A binary request starts with a one byte operation, followed by the
+// operation arguments:
+//
+//  BinaryAllocateIo:    | op | nStreams (4) |
+//  BinaryWinsize:       | op | seq (8) | row (2) | column (2) |
+//  BinaryKillContainer: | op | signal (4) | containerId (rest) |
+//
+// A binary response starts with a one byte status. On success, the operation
+// results follow; on error, the error message:
+//
+//  BinaryAllocateIo:    | 0 | ioBase (8) |    (I/O fd sent right after)
+//  BinaryWinsize:       | 0 |
+//  BinaryKillContainer: | 0 |
+//  error:               | 1 | error message (rest) |
+//
+// BinaryWinsize and BinaryKillContainer are equivalent to the "winsize" and
+// "killcontainer" hyper commands.
+const (
+	BinaryAllocateIo    uint8 = 1
+	BinaryWinsize       uint8 = 2
+	BinaryKillContainer uint8 = 3
+)
+
+// Status byte of binary responses
+const (
+	binarySuccess uint8 = 0
+	binaryError   uint8 = 1
+)
+
+var errBinaryTooShort = errors.New("binary payload too short")
+
+// MarshalAllocateIo encodes a BinaryAllocateIo request
+func MarshalAllocateIo(nStreams int) []byte {
+	buf := make([]byte, 5)
+	buf[0] = BinaryAllocateIo
+	binary.BigEndian.PutUint32(buf[1:], uint32(nStreams))
+	return buf
+}
+
+// UnmarshalAllocateIo decodes the arguments of a BinaryAllocateIo request,
+// data doesn't include the operation byte
+func UnmarshalAllocateIo(data []byte) (nStreams int, err error) {
+	if len(data) != 4 {
+		return 0, errBinaryTooShort
+	}
+	return int(binary.BigEndian.Uint32(data)), nil
+}
+
+// MarshalWinsize encodes a BinaryWinsize request
+func MarshalWinsize(seq uint64, row, column uint16) []byte {
+	buf := make([]byte, 13)
+	buf[0] = BinaryWinsize
+	binary.BigEndian.PutUint64(buf[1:], seq)
+	binary.BigEndian.PutUint16(buf[9:], row)
+	binary.BigEndian.PutUint16(buf[11:], column)
+	return buf
+}
+
+// UnmarshalWinsize decodes the arguments of a BinaryWinsize request, data
+// doesn't include the operation byte
+func UnmarshalWinsize(data []byte) (seq uint64, row, column uint16, err error) {
+	if len(data) != 12 {
+		return 0, 0, 0, errBinaryTooShort
+	}
+	seq = binary.BigEndian.Uint64(data)
+	row = binary.BigEndian.Uint16(data[8:])
+	column = binary.BigEndian.Uint16(data[10:])
+	return
+}
+
+// MarshalKillContainer encodes a BinaryKillContainer request
+func MarshalKillContainer(containerID string, signal syscall.Signal) []byte {
+	buf := make([]byte, 5+len(containerID))
+	buf[0] = BinaryKillContainer
+	binary.BigEndian.PutUint32(buf[1:], uint32(signal))
+	copy(buf[5:], containerID)
+	return buf
+}
+
+// UnmarshalKillContainer decodes the arguments of a BinaryKillContainer
+// request, data doesn't include the operation byte
+func UnmarshalKillContainer(data []byte) (containerID string, signal syscall.Signal, err error) {
+	if len(data) < 5 {
+		return "", 0, errBinaryTooShort
+	}
+	signal = syscall.Signal(binary.BigEndian.Uint32(data))
+	containerID = string(data[4:])
+	return
+}
+
+// MarshalBinaryResponse encodes a binary response. results is only used on
+// success and err == nil means success.
+func MarshalBinaryResponse(results []byte, err error) []byte {
+	if err != nil {
+		msg := err.Error()
+		buf := make([]byte, 1+len(msg))
+		buf[0] = binaryError
+		copy(buf[1:], msg)
+		return buf
+	}
+
+	buf := make([]byte, 1+len(results))
+	buf[0] = binarySuccess
+	copy(buf[1:], results)
+	return buf
+}
+
+// UnmarshalBinaryResponse decodes a binary response, returning the operation
+// results on success
+func UnmarshalBinaryResponse(data []byte) (results []byte, err error) {
+	if len(data) < 1 {
+		return nil, errBinaryTooShort
+	}
+
+	switch data[0] {
+	case binarySuccess:
+		return data[1:], nil
+	case binaryError:
+		if len(data) == 1 {
+			return nil, errors.New("unknown error")
+		}
+		return nil, errors.New(string(data[1:]))
+	default:
+		return nil, fmt.Errorf("unknown binary response status %d", data[0])
+	}
+}
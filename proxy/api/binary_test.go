@@ -0,0 +1,92 @@
+// Copyright (c) 2016 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package api
+
+import (
+	"bytes"
+	"errors"
+	"syscall"
+	"testing"
+
+	"github.com/stretchr/testify/assert"
+)
+
+func TestBinaryRequests(t *testing.T) {
+	data := MarshalAllocateIo(2)
+	assert.Equal(t, BinaryAllocateIo, data[0])
+	nStreams, err := UnmarshalAllocateIo(data[1:])
+	assert.Nil(t, err)
+	assert.Equal(t, 2, nStreams)
+
+	data = MarshalWinsize(1<<40+3, 24, 80)
+	assert.Equal(t, BinaryWinsize, data[0])
+	seq, row, column, err := UnmarshalWinsize(data[1:])
+	assert.Nil(t, err)
+	assert.Equal(t, uint64(1<<40+3), seq)
+	assert.Equal(t, uint16(24), row)
+	assert.Equal(t, uint16(80), column)
+
+	data = MarshalKillContainer("foo", syscall.SIGTERM)
+	assert.Equal(t, BinaryKillContainer, data[0])
+	containerID, signal, err := UnmarshalKillContainer(data[1:])
+	assert.Nil(t, err)
+	assert.Equal(t, "foo", containerID)
+	assert.Equal(t, syscall.SIGTERM, signal)
+
+	// Truncated arguments
+	_, err = UnmarshalAllocateIo([]byte{0, 0})
+	assert.NotNil(t, err)
+	_, _, _, err = UnmarshalWinsize(make([]byte, 11))
+	assert.NotNil(t, err)
+	_, _, err = UnmarshalKillContainer(make([]byte, 4))
+	assert.NotNil(t, err)
+}
+
+func TestBinaryResponses(t *testing.T) {
+	results, err := UnmarshalBinaryResponse(MarshalBinaryResponse([]byte{1, 2}, nil))
+	assert.Nil(t, err)
+	assert.Equal(t, []byte{1, 2}, results)
+
+	_, err = UnmarshalBinaryResponse(MarshalBinaryResponse([]byte{1, 2}, errors.New("boom")))
+	assert.Equal(t, errors.New("boom"), err)
+
+	_, err = UnmarshalBinaryResponse([]byte{})
+	assert.NotNil(t, err)
+	_, err = UnmarshalBinaryResponse([]byte{42})
+	assert.NotNil(t, err)
+}
+
+func TestRawMessage(t *testing.T) {
+	var b bytes.Buffer
+
+	payload := MarshalWinsize(1, 2, 3)
+	err := WriteRawMessage(&b, FlagBinary, payload)
+	assert.Nil(t, err)
+	assert.Equal(t, headerLength+len(payload), b.Len())
+
+	// Reads into the given buffer when it's large enough
+	buf := make([]byte, 64)
+	flags, data, err := ReadRawMessage(&b, buf)
+	assert.Nil(t, err)
+	assert.Equal(t, FlagBinary, flags)
+	assert.Equal(t, payload, data)
+	assert.Equal(t, &buf[0], &data[0])
+
+	// JSON messages can't be read as binary ones and vice versa
+	err = WriteRawMessage(&b, FlagBinary, payload)
+	assert.Nil(t, err)
+	err = ReadMessage(&b, &Response{})
+	assert.NotNil(t, err)
+}
@@ -15,16 +15,23 @@
 package api
 
 import (
+	"encoding/binary"
 	"encoding/json"
 	"errors"
 	"net"
 	"os"
+	"syscall"
+
+	hyper "github.com/hyperhq/runv/hyperstart/api/json"
 )
 
 // The Client struct can be used to issue proxy API calls with a convenient
 // high level API.
 type Client struct {
 	conn *net.UnixConn
+
+	// The proxy has advertised support for the binary encoding
+	binary bool
 }
 
 // NewClient creates a new client object to communicate with the proxy using
@@ -56,14 +63,42 @@ func (client *Client) sendPayload(id string, payload interface{}) (*Response, er
 		return nil, err
 	}
 
+	flags, data, err := ReadRawMessage(client.conn, nil)
+	if err != nil {
+		return nil, err
+	}
+
+	if flags&FlagBinarySupported != 0 {
+		client.binary = true
+	}
+
 	resp := Response{}
-	if err := ReadMessage(client.conn, &resp); err != nil {
+	if err := json.Unmarshal(data, &resp); err != nil {
 		return nil, err
 	}
 
 	return &resp, nil
 }
 
+// sendBinary sends a binary request and returns the results of its response.
+// It's only valid to call sendBinary once client.binary is true.
+func (client *Client) sendBinary(req []byte) ([]byte, error) {
+	if err := WriteRawMessage(client.conn, FlagBinary, req); err != nil {
+		return nil, err
+	}
+
+	flags, data, err := ReadRawMessage(client.conn, nil)
+	if err != nil {
+		return nil, err
+	}
+
+	if flags&FlagBinary == 0 {
+		return nil, errors.New("expected a binary response")
+	}
+
+	return UnmarshalBinaryResponse(data)
+}
+
 func errorFromResponse(resp *Response) error {
 	// We should always have an error with the response, but better safe
 	// than sorry.
@@ -109,37 +144,61 @@ func (client *Client) Attach(containerID string) error {
 }
 
 // AllocateIo wraps the AllocateIo payload (see payload description for more details)
+// The binary encoding is used when the proxy supports it.
 func (client *Client) AllocateIo(nStreams int) (ioBase uint64, ioFile *os.File, err error) {
+	if client.binary {
+		ioBase, err = client.allocateIoBinary(nStreams)
+	} else {
+		ioBase, err = client.allocateIoJSON(nStreams)
+	}
+	if err != nil {
+		return
+	}
+
+	// I/O fd
+	newFd, err := ReadFd(client.conn)
+	if err != nil {
+		return 0, nil, errors.New("allocateio: couldn't read fd")
+	}
+
+	ioFile = os.NewFile(uintptr(newFd), "")
+
+	return
+}
+
+func (client *Client) allocateIoJSON(nStreams int) (uint64, error) {
 	allocate := AllocateIo{
 		NStreams: nStreams,
 	}
 
 	resp, err := client.sendPayload("allocateIO", &allocate)
 	if err != nil {
-		return
+		return 0, err
 	}
 
-	err = errorFromResponse(resp)
-	if err != nil {
-		return
+	if err = errorFromResponse(resp); err != nil {
+		return 0, err
 	}
 
 	val, ok := resp.Data["ioBase"]
 	if !ok {
-		return 0, nil, errors.New("allocateio: no ioBase in response")
+		return 0, errors.New("allocateio: no ioBase in response")
 	}
 
-	ioBase = (uint64)(val.(float64))
+	return (uint64)(val.(float64)), nil
+}
 
-	// I/O fd
-	newFd, err := ReadFd(client.conn)
+func (client *Client) allocateIoBinary(nStreams int) (uint64, error) {
+	results, err := client.sendBinary(MarshalAllocateIo(nStreams))
 	if err != nil {
-		return 0, nil, errors.New("allocateio: couldn't read fd")
+		return 0, err
 	}
 
-	ioFile = os.NewFile(uintptr(newFd), "")
+	if len(results) != 8 {
+		return 0, errors.New("allocateio: no ioBase in response")
+	}
 
-	return
+	return binary.BigEndian.Uint64(results), nil
 }
 
 // Hyper wraps the Hyper payload (see payload description for more details)
@@ -168,6 +227,36 @@ func (client *Client) Hyper(hyperName string, hyperMessage interface{}) error {
 	return errorFromResponse(resp)
 }
 
+// Winsize sends the "winsize" hyper command, resizing the terminal of the
+// process with the I/O stream seq. The binary encoding is used when the proxy
+// supports it.
+func (client *Client) Winsize(seq uint64, row, column uint16) error {
+	if !client.binary {
+		return client.Hyper("winsize", &hyper.WindowSizeMessage{
+			Seq:    seq,
+			Row:    row,
+			Column: column,
+		})
+	}
+
+	_, err := client.sendBinary(MarshalWinsize(seq, row, column))
+	return err
+}
+
+// KillContainer sends the "killcontainer" hyper command. The binary encoding
+// is used when the proxy supports it.
+func (client *Client) KillContainer(containerID string, signal syscall.Signal) error {
+	if !client.binary {
+		return client.Hyper("killcontainer", &hyper.KillCommand{
+			Container: containerID,
+			Signal:    signal,
+		})
+	}
+
+	_, err := client.sendBinary(MarshalKillContainer(containerID, signal))
+	return err
+}
+
 // Bye wraps the Bye payload (see payload description for more details)
 func (client *Client) Bye(containerID string) error {
 	bye := Bye{
@@ -181,3 +270,34 @@ func (client *Client) Bye(containerID string) error {
 
 	return errorFromResponse(resp)
 }
+
+// Stats wraps the Stats payload (see payload description for more details).
+// An empty containerID returns the stats of all VMs.
+func (client *Client) Stats(containerID string) (*StatsResult, error) {
+	stats := Stats{
+		ContainerID: containerID,
+	}
+
+	resp, err := client.sendPayload("stats", &stats)
+	if err != nil {
+		return nil, err
+	}
+
+	if err = errorFromResponse(resp); err != nil {
+		return nil, err
+	}
+
+	// Response.Data is a generic map, go through JSON again to get a
+	// typed result
+	data, err := json.Marshal(resp.Data)
+	if err != nil {
+		return nil, err
+	}
+
+	result := &StatsResult{}
+	if err = json.Unmarshal(data, result); err != nil {
+		return nil, err
+	}
+
+	return result, nil
+}
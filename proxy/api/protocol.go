@@ -19,10 +19,43 @@ import (
 	"encoding/json"
 	"errors"
 	"io"
+	"net"
+	"sync"
 )
 
 const headerLength = 8 // in bytes
 
+// Buffers larger than this aren't returned to bufferPool so a single large
+// message doesn't pin memory for the lifetime of the process
+const maxPooledBufferLength = 64 * 1024
+
+// bufferPool holds *[]byte buffers used to read messages. Pointers are
+// stored to avoid an allocation when putting a slice back into the pool.
+var bufferPool = sync.Pool{
+	New: func() interface{} {
+		buf := make([]byte, 512)
+		return &buf
+	},
+}
+
+// getBuffer returns a pooled buffer of at least size bytes
+func getBuffer(size int) *[]byte {
+	buf := bufferPool.Get().(*[]byte)
+	if cap(*buf) < size {
+		*buf = make([]byte, size)
+	}
+	*buf = (*buf)[:size]
+	return buf
+}
+
+// putBuffer gives a buffer obtained with getBuffer back to the pool
+func putBuffer(buf *[]byte) {
+	if cap(*buf) > maxPooledBufferLength {
+		return
+	}
+	bufferPool.Put(buf)
+}
+
 type header struct {
 	length uint32
 	flags  uint32
@@ -52,68 +85,79 @@ type Response struct {
 	Data    map[string]interface{} `json:"data,omitempty"`
 }
 
-// ReadMessage reads a message from reader. A message is either a Request or a
-// Response
-func ReadMessage(reader io.Reader, msg interface{}) error {
-	buf := make([]byte, headerLength)
-	n, err := reader.Read(buf)
-	if err != nil {
-		return err
-	}
-	if n != headerLength {
-		return errors.New("couldn't read the full header")
+// ReadRawMessage reads a message from reader and returns its header flags
+// and still encoded payload. The payload is read into buf when it's large
+// enough, a new slice is allocated otherwise.
+func ReadRawMessage(reader io.Reader, buf []byte) (flags uint32, data []byte, err error) {
+	hdr := getBuffer(headerLength)
+	defer putBuffer(hdr)
+
+	if _, err = io.ReadFull(reader, *hdr); err != nil {
+		return
 	}
 
 	header := header{
-		length: binary.BigEndian.Uint32(buf[0:4]),
-		flags:  binary.BigEndian.Uint32(buf[4:8]),
+		length: binary.BigEndian.Uint32((*hdr)[0:4]),
+		flags:  binary.BigEndian.Uint32((*hdr)[4:8]),
 	}
 
-	received := 0
-	need := int(header.length)
-	data := make([]byte, need)
-	for received < need {
-		n, err := reader.Read(data[received:need])
-		if err != nil {
-			return err
-		}
-
-		received += n
+	if int(header.length) <= cap(buf) {
+		data = buf[:header.length]
+	} else {
+		data = make([]byte, header.length)
 	}
 
-	err = json.Unmarshal(data, msg)
-	if err != nil {
-		return err
+	if _, err = io.ReadFull(reader, data); err != nil {
+		return
 	}
 
-	return nil
+	return header.flags, data, nil
 }
 
-// WriteMessage writes a message into writer. A message is either a Request for
-// a Response
-func WriteMessage(writer io.Writer, msg interface{}) error {
-	data, err := json.Marshal(msg)
-	if err != nil {
-		return err
-	}
+// ReadMessage reads a JSON message from reader. A message is either a Request
+// or a Response
+func ReadMessage(reader io.Reader, msg interface{}) error {
+	buf := getBuffer(0)
+	defer putBuffer(buf)
 
-	buf := make([]byte, headerLength)
-	binary.BigEndian.PutUint32(buf[0:4], uint32(len(data)))
-	n, err := writer.Write(buf)
+	flags, data, err := ReadRawMessage(reader, (*buf)[:cap(*buf)])
 	if err != nil {
 		return err
 	}
-	if n != headerLength {
-		return errors.New("couldn't write the full header")
+
+	if flags&FlagBinary != 0 {
+		return errors.New("unexpected binary message")
 	}
 
-	n, err = writer.Write(data)
+	// json.Unmarshal copies what it keeps (including json.RawMessage), so
+	// the buffer can be reused once we return.
+	return json.Unmarshal(data, msg)
+}
+
+// WriteRawMessage writes a message with an already encoded payload and the
+// given header flags into writer
+func WriteRawMessage(writer io.Writer, flags uint32, data []byte) error {
+	hdr := getBuffer(headerLength)
+	defer putBuffer(hdr)
+
+	binary.BigEndian.PutUint32((*hdr)[0:4], uint32(len(data)))
+	binary.BigEndian.PutUint32((*hdr)[4:8], flags)
+
+	// Header and payload are written with a single writev() when writer
+	// supports it.
+	bufs := net.Buffers{*hdr, data}
+	_, err := bufs.WriteTo(writer)
+
+	return err
+}
+
+// WriteMessage writes a JSON message into writer. A message is either a
+// Request for a Response
+func WriteMessage(writer io.Writer, msg interface{}) error {
+	data, err := json.Marshal(msg)
 	if err != nil {
 		return err
 	}
-	if n != len(data) {
-		return errors.New("couldn't write the full data")
-	}
 
-	return nil
+	return WriteRawMessage(writer, 0, data)
 }
@@ -0,0 +1,457 @@
+// Copyright (c) 2016 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package main
+
+// Load-generation benchmarks for the proxy I/O relay.
+//
+// Each VM is backed by a fakeHyperstart speaking the ctl and tty framing the
+// proxy expects on local AF_UNIX sockets. The proxy runs in process and every
+// VM gets its own client connection doing hello and allocateIO. One benchmark
+// op is one message relayed from hyperstart to a client.
+//
+//  $ go test -run XXX -bench Relay ./proxy -args -proxy.bench-vms=1,10,100,1000
+//
+// Generators write as fast as the proxy accepts data, so latencies include
+// the time spent queued behind earlier messages of the same VM. Besides the usual ns/op, MB/s and allocs/op, per-message latency
+// percentiles and CPU time are logged. Allocations and CPU time include the
+// fake hyperstart and the clients, which run in the same process.
+
+import (
+	"encoding/binary"
+	"flag"
+	"fmt"
+	"io"
+	"io/ioutil"
+	"net"
+	"os"
+	"path/filepath"
+	"sort"
+	"strconv"
+	"strings"
+	"sync"
+	"syscall"
+	"testing"
+	"time"
+
+	"github.com/01org/cc-oci-runtime/proxy/api"
+	hyper "github.com/hyperhq/runv/hyperstart/api/json"
+)
+
+var (
+	benchVMs = flag.String("proxy.bench-vms", "1,10,100,1000",
+		"comma separated list of VM counts to benchmark")
+	benchSessions = flag.Int("proxy.bench-sessions", 4,
+		"number of I/O sessions per VM")
+	benchPayload = flag.Int("proxy.bench-payload", 128,
+		"size in bytes of the messages relayed")
+)
+
+// Size of the send timestamp embedded at the start of each payload
+const benchTimestampLength = 8
+
+// fakeHyperstart is a minimal hyperstart: it sends READY, acks every control
+// command and lets the benchmark push output on the tty channel. Unlike the
+// mock package, it doesn't log or keep the messages it sees, so it can be
+// used at scale.
+type fakeHyperstart struct {
+	ctlPath, ioPath         string
+	ctlListener, ioListener *net.UnixListener
+
+	ctl, io net.Conn
+
+	// closed once the proxy has connected both channels
+	connected chan struct{}
+
+	wg sync.WaitGroup
+}
+
+func newFakeHyperstart(dir string, id int) (*fakeHyperstart, error) {
+	h := &fakeHyperstart{
+		ctlPath:   filepath.Join(dir, fmt.Sprintf("ctl%d.sock", id)),
+		ioPath:    filepath.Join(dir, fmt.Sprintf("io%d.sock", id)),
+		connected: make(chan struct{}),
+	}
+
+	var err error
+
+	h.ctlListener, err = net.ListenUnix("unix", &net.UnixAddr{Name: h.ctlPath, Net: "unix"})
+	if err != nil {
+		return nil, err
+	}
+
+	h.ioListener, err = net.ListenUnix("unix", &net.UnixAddr{Name: h.ioPath, Net: "unix"})
+	if err != nil {
+		h.ctlListener.Close()
+		return nil, err
+	}
+
+	h.wg.Add(1)
+	go h.serve()
+
+	return h, nil
+}
+
+func writeCtlMessage(w io.Writer, code uint32, data []byte) error {
+	msg := make([]byte, 8+len(data))
+	binary.BigEndian.PutUint32(msg[0:], code)
+	binary.BigEndian.PutUint32(msg[4:], uint32(len(msg)))
+	copy(msg[8:], data)
+	_, err := w.Write(msg)
+	return err
+}
+
+func (h *fakeHyperstart) serve() {
+	defer h.wg.Done()
+
+	// The proxy connects ctl first, then io
+	ctl, err := h.ctlListener.Accept()
+	if err != nil {
+		return
+	}
+	h.ctl = ctl
+
+	ioConn, err := h.ioListener.Accept()
+	if err != nil {
+		return
+	}
+	h.io = ioConn
+
+	if err := writeCtlMessage(ctl, hyper.INIT_READY, nil); err != nil {
+		return
+	}
+
+	close(h.connected)
+
+	// Drain stdin so the proxy never blocks on us
+	h.wg.Add(1)
+	go func() {
+		defer h.wg.Done()
+		io.Copy(ioutil.Discard, ioConn)
+	}()
+
+	// Ack every control command
+	header := make([]byte, 8)
+	for {
+		if _, err := io.ReadFull(ctl, header); err != nil {
+			return
+		}
+		length := int(binary.BigEndian.Uint32(header[4:]))
+		if length > 8 {
+			if _, err := io.ReadFull(ctl, make([]byte, length-8)); err != nil {
+				return
+			}
+		}
+		if err := writeCtlMessage(ctl, hyper.INIT_ACK, nil); err != nil {
+			return
+		}
+	}
+}
+
+func (h *fakeHyperstart) Close() {
+	h.ctlListener.Close()
+	h.ioListener.Close()
+	if h.ctl != nil {
+		h.ctl.Close()
+	}
+	if h.io != nil {
+		h.io.Close()
+	}
+	h.wg.Wait()
+}
+
+// A VM under load: its fake hyperstart, the proxy client that registered it
+// and the client side of its I/O sessions.
+type benchVM struct {
+	id         string
+	hyperstart *fakeHyperstart
+	client     *api.Client
+	ioBases    []uint64
+	ioFiles    []*os.File
+}
+
+type benchEnv struct {
+	dir   string
+	proxy *proxy
+	proto *protocol
+	vms   []*benchVM
+	wg    sync.WaitGroup
+}
+
+func raiseFdLimit() uint64 {
+	var rlim syscall.Rlimit
+
+	if err := syscall.Getrlimit(syscall.RLIMIT_NOFILE, &rlim); err != nil {
+		return 0
+	}
+
+	rlim.Cur = rlim.Max
+	syscall.Setrlimit(syscall.RLIMIT_NOFILE, &rlim)
+	syscall.Getrlimit(syscall.RLIMIT_NOFILE, &rlim)
+
+	return rlim.Cur
+}
+
+func newBenchEnv(b *testing.B, nVMs, nSessions int) *benchEnv {
+	dir, err := ioutil.TempDir("", "cc-proxy-bench")
+	if err != nil {
+		b.Fatal(err)
+	}
+
+	env := &benchEnv{
+		dir:   dir,
+		proxy: newProxy(),
+		proto: newProtocol(),
+	}
+
+	env.proto.Handle("hello", helloHandler)
+	env.proto.Handle("bye", byeHandler)
+	env.proto.Handle("allocateIO", allocateIoHandler)
+
+	for i := 0; i < nVMs; i++ {
+		vm := &benchVM{
+			id: fmt.Sprintf("bench-%d", i),
+		}
+		env.vms = append(env.vms, vm)
+
+		vm.hyperstart, err = newFakeHyperstart(dir, i)
+		if err != nil {
+			env.Close()
+			b.Fatal(err)
+		}
+
+		clientConn, proxyConn, err := Socketpair()
+		if err != nil {
+			env.Close()
+			b.Fatal(err)
+		}
+
+		env.wg.Add(1)
+		go func() {
+			env.proxy.serveNewClient(env.proto, proxyConn)
+			env.wg.Done()
+		}()
+
+		vm.client = api.NewClient(clientConn)
+
+		err = vm.client.Hello(vm.id, vm.hyperstart.ctlPath, vm.hyperstart.ioPath)
+		if err != nil {
+			env.Close()
+			b.Fatal(err)
+		}
+		<-vm.hyperstart.connected
+
+		for j := 0; j < nSessions; j++ {
+			ioBase, ioFile, err := vm.client.AllocateIo(1)
+			if err != nil {
+				env.Close()
+				b.Fatal(err)
+			}
+			vm.ioBases = append(vm.ioBases, ioBase)
+			vm.ioFiles = append(vm.ioFiles, ioFile)
+		}
+	}
+
+	return env
+}
+
+func (env *benchEnv) Close() {
+	for _, vm := range env.vms {
+		if vm.client != nil {
+			vm.client.Bye(vm.id)
+			vm.client.Close()
+		}
+		for _, f := range vm.ioFiles {
+			f.Close()
+		}
+		if vm.hyperstart != nil {
+			vm.hyperstart.Close()
+		}
+	}
+	env.wg.Wait()
+	os.RemoveAll(env.dir)
+}
+
+// generate sends n messages from vm's hyperstart, round-robin over its
+// sessions, each stamped with its send time.
+func (vm *benchVM) generate(b *testing.B, n int, payload int) {
+	msg := make([]byte, ioHeaderLength+payload)
+	binary.BigEndian.PutUint32(msg[8:], uint32(len(msg)))
+
+	for i := 0; i < n; i++ {
+		seq := vm.ioBases[i%len(vm.ioBases)]
+		binary.BigEndian.PutUint64(msg[0:], seq)
+		binary.BigEndian.PutUint64(msg[ioHeaderLength:],
+			uint64(time.Now().UnixNano()))
+
+		if _, err := vm.hyperstart.io.Write(msg); err != nil {
+			b.Error(err)
+			return
+		}
+	}
+}
+
+// consume reads n messages from a session, recording their latencies
+func consume(b *testing.B, r io.Reader, n int, latencies []time.Duration) {
+	buf := make([]byte, maxIoMessageLength)
+
+	for i := 0; i < n; i++ {
+		_, data, err := readIoMessage(r, buf)
+		if err != nil {
+			b.Error(err)
+			return
+		}
+
+		sent := int64(binary.BigEndian.Uint64(data[ioHeaderLength:]))
+		latencies[i] = time.Duration(time.Now().UnixNano() - sent)
+	}
+}
+
+func cpuTime() time.Duration {
+	var ru syscall.Rusage
+
+	if err := syscall.Getrusage(syscall.RUSAGE_SELF, &ru); err != nil {
+		return 0
+	}
+
+	return time.Duration(ru.Utime.Nano() + ru.Stime.Nano())
+}
+
+func percentile(sorted []time.Duration, p float64) time.Duration {
+	if len(sorted) == 0 {
+		return 0
+	}
+	i := int(float64(len(sorted)-1) * p)
+	return sorted[i]
+}
+
+func (env *benchEnv) run(b *testing.B, payload int) {
+	nVMs := len(env.vms)
+	nSessions := len(env.vms[0].ioBases)
+
+	// Split b.N messages between VMs, then round-robin between sessions
+	perVM := make([]int, nVMs)
+	for i := range perVM {
+		perVM[i] = b.N / nVMs
+		if i < b.N%nVMs {
+			perVM[i]++
+		}
+	}
+
+	latencies := make([]time.Duration, b.N)
+	var consumers, generators sync.WaitGroup
+
+	b.SetBytes(int64(ioHeaderLength + payload))
+	b.ReportAllocs()
+	b.ResetTimer()
+	cpuStart := cpuTime()
+
+	offset := 0
+	for i, vm := range env.vms {
+		for j, f := range vm.ioFiles {
+			n := perVM[i] / nSessions
+			if j < perVM[i]%nSessions {
+				n++
+			}
+
+			consumers.Add(1)
+			go func(f *os.File, n int, l []time.Duration) {
+				consume(b, f, n, l)
+				consumers.Done()
+			}(f, n, latencies[offset:offset+n])
+			offset += n
+		}
+
+		generators.Add(1)
+		go func(vm *benchVM, n int) {
+			vm.generate(b, n, payload)
+			generators.Done()
+		}(vm, perVM[i])
+	}
+
+	generators.Wait()
+	consumers.Wait()
+
+	b.StopTimer()
+	cpu := cpuTime() - cpuStart
+
+	sort.Sort(durations(latencies))
+	b.Logf("%d msgs: latency p50 %v p90 %v p99 %v p99.9 %v max %v, cpu %v/msg",
+		b.N,
+		percentile(latencies, 0.50),
+		percentile(latencies, 0.90),
+		percentile(latencies, 0.99),
+		percentile(latencies, 0.999),
+		percentile(latencies, 1),
+		cpu/time.Duration(b.N))
+}
+
+type durations []time.Duration
+
+func (d durations) Len() int           { return len(d) }
+func (d durations) Less(i, j int) bool { return d[i] < d[j] }
+func (d durations) Swap(i, j int)      { d[i], d[j] = d[j], d[i] }
+
+func parseBenchVMs(b *testing.B) []int {
+	var counts []int
+
+	for _, s := range strings.Split(*benchVMs, ",") {
+		n, err := strconv.Atoi(strings.TrimSpace(s))
+		if err != nil || n < 1 {
+			b.Fatalf("invalid VM count '%s'", s)
+		}
+		counts = append(counts, n)
+	}
+
+	return counts
+}
+
+// BenchmarkRelay measures relaying output from N VMs with M sessions each to
+// their clients.
+func BenchmarkRelay(b *testing.B) {
+	nSessions := *benchSessions
+	payload := *benchPayload
+
+	if nSessions < 1 {
+		b.Fatal("proxy.bench-sessions must be at least 1")
+	}
+	if payload < benchTimestampLength ||
+		payload > maxIoMessageLength-ioHeaderLength {
+		b.Fatalf("proxy.bench-payload must be between %d and %d",
+			benchTimestampLength, maxIoMessageLength-ioHeaderLength)
+	}
+
+	fdLimit := raiseFdLimit()
+
+	for _, nVMs := range parseBenchVMs(b) {
+		name := fmt.Sprintf("vms=%d/sessions=%d", nVMs, nSessions)
+
+		// Per VM: 2 fake hyperstart listeners and both ends of their 2
+		// connections, the client socketpair and 3 fds per session.
+		needed := uint64(nVMs*(6+2+3*nSessions) + 64)
+		if needed > fdLimit {
+			b.Run(name, func(b *testing.B) {
+				b.Skipf("needs ~%d file descriptors, limit is %d",
+					needed, fdLimit)
+			})
+			continue
+		}
+
+		env := newBenchEnv(b, nVMs, nSessions)
+		b.Run(name, func(b *testing.B) {
+			env.run(b, payload)
+		})
+		env.Close()
+	}
+}
@@ -15,6 +15,7 @@
 package main
 
 import (
+	"encoding/json"
 	"errors"
 	"fmt"
 	"net"
@@ -31,6 +32,9 @@ type handlerResponse struct {
 	err     error
 	results map[string]interface{}
 	file    *os.File
+
+	// results of binary requests, already encoded
+	binaryResults []byte
 }
 
 func (r *handlerResponse) SetError(err error) {
@@ -56,13 +60,19 @@ func (r *handlerResponse) SetFile(f *os.File) {
 	r.file = f
 }
 
+func (r *handlerResponse) SetBinaryResults(data []byte) {
+	r.binaryResults = data
+}
+
 type protocol struct {
-	handlers map[string]protocolHandler
+	handlers       map[string]protocolHandler
+	binaryHandlers map[uint8]protocolHandler
 }
 
 func newProtocol() *protocol {
 	return &protocol{
-		handlers: make(map[string]protocolHandler),
+		handlers:       make(map[string]protocolHandler),
+		binaryHandlers: make(map[uint8]protocolHandler),
 	}
 }
 
@@ -70,6 +80,13 @@ func (proto *protocol) Handle(cmd string, handler protocolHandler) {
 	proto.handlers[cmd] = handler
 }
 
+// HandleBinary registers the handler of a binary encoded operation. The
+// handler is given the operation arguments and reports its results with
+// SetBinaryResults.
+func (proto *protocol) HandleBinary(op uint8, handler protocolHandler) {
+	proto.binaryHandlers[op] = handler
+}
+
 type clientCtx struct {
 	conn net.Conn
 
@@ -107,29 +124,73 @@ func (proto *protocol) handleRequest(ctx *clientCtx, req *api.Request, hr *handl
 	}
 }
 
+func (proto *protocol) handleBinaryRequest(ctx *clientCtx, data []byte, hr *handlerResponse) []byte {
+	if len(data) < 1 {
+		return api.MarshalBinaryResponse(nil, errors.New("empty binary request"))
+	}
+
+	handler, ok := proto.binaryHandlers[data[0]]
+	if !ok {
+		return api.MarshalBinaryResponse(nil,
+			fmt.Errorf("no binary operation %d", data[0]))
+	}
+
+	handler(data[1:], ctx.userData, hr)
+
+	return api.MarshalBinaryResponse(hr.binaryResults, hr.err)
+}
+
 func (proto *protocol) Serve(conn net.Conn, userData interface{}) error {
 	ctx := &clientCtx{
 		conn:     conn,
 		userData: userData,
 	}
 
+	// Requests are read into buf, handlers must not keep references to
+	// the data they're given.
+	buf := make([]byte, 512)
+
 	for {
-		// Parse a request.
-		req := api.Request{}
+		var (
+			data  []byte
+			flags uint32
+			err   error
+		)
+
 		hr := handlerResponse{}
 
-		err := api.ReadMessage(conn, &req)
+		flags, data, err = api.ReadRawMessage(conn, buf)
 		if err != nil {
-			// EOF or the client isn't even sending proper JSON,
-			// just kill the connection
+			// EOF, just kill the connection
 			return err
 		}
 
-		// Execute the corresponding handler
-		resp := proto.handleRequest(ctx, &req, &hr)
+		if flags&api.FlagBinary != 0 {
+			// Execute the corresponding binary handler
+			data = proto.handleBinaryRequest(ctx, data, &hr)
+			flags = api.FlagBinary
+		} else {
+			// Parse a request.
+			req := api.Request{}
+			if err = json.Unmarshal(data, &req); err != nil {
+				// The client isn't even sending proper JSON,
+				// just kill the connection
+				return err
+			}
+
+			// Execute the corresponding handler
+			resp := proto.handleRequest(ctx, &req, &hr)
+			if data, err = json.Marshal(resp); err != nil {
+				return err
+			}
+			flags = 0
+		}
 
 		// Send the response back to the client.
-		if err = api.WriteMessage(conn, resp); err != nil {
+		if len(proto.binaryHandlers) > 0 {
+			flags |= api.FlagBinarySupported
+		}
+		if err = api.WriteRawMessage(conn, flags, data); err != nil {
 			// Something made us unable to write the response back
 			// to the client (could be a disconnection, ...).
 			return err
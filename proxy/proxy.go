@@ -15,31 +15,86 @@
 package main
 
 import (
+	"encoding/binary"
 	"encoding/json"
 	"flag"
 	"fmt"
 	"io"
 	"net"
 	"os"
+	"strconv"
 	"sync"
 	"sync/atomic"
 
 	"github.com/01org/cc-oci-runtime/proxy/api"
 
 	"github.com/golang/glog"
+	hyperapi "github.com/hyperhq/runv/hyperstart/api/json"
 )
 
 // Main struct holding the proxy state
 type proxy struct {
-	// Protect concurrent accesses from separate client goroutines to this
-	// structure fields
+	// Serializes updates to vms from separate client goroutines. Lookups
+	// don't take it.
 	sync.Mutex
 
 	// proxy socket
 	listener net.Listener
 
-	// vms are hashed by their containerID
-	vms map[string]*vm
+	// vms holds an immutable map[string]*vm, hashed by containerID.
+	// Updates copy the map and atomically swap the new one in, so lookups
+	// never block, even while another container is being registered or
+	// torn down.
+	vms atomic.Value
+}
+
+// findVM returns the vm registered for containerID, or nil
+func (proxy *proxy) findVM(containerID string) *vm {
+	return proxy.vms.Load().(map[string]*vm)[containerID]
+}
+
+// addVM registers newVM. It returns false if a vm with the same containerID
+// is already registered.
+func (proxy *proxy) addVM(newVM *vm) bool {
+	proxy.Lock()
+	defer proxy.Unlock()
+
+	vms := proxy.vms.Load().(map[string]*vm)
+	if _, ok := vms[newVM.containerID]; ok {
+		return false
+	}
+
+	newVms := make(map[string]*vm, len(vms)+1)
+	for id, v := range vms {
+		newVms[id] = v
+	}
+	newVms[newVM.containerID] = newVM
+	proxy.vms.Store(newVms)
+
+	return true
+}
+
+// removeVM unregisters and returns the vm registered for containerID, or nil
+// if there's none. Only one of concurrent callers gets the vm.
+func (proxy *proxy) removeVM(containerID string) *vm {
+	proxy.Lock()
+	defer proxy.Unlock()
+
+	vms := proxy.vms.Load().(map[string]*vm)
+	removed, ok := vms[containerID]
+	if !ok {
+		return nil
+	}
+
+	newVms := make(map[string]*vm, len(vms))
+	for id, v := range vms {
+		if id != containerID {
+			newVms[id] = v
+		}
+	}
+	proxy.vms.Store(newVms)
+
+	return removed
 }
 
 // Represents a client, either a cc-oci-runtime or cc-shim process having
@@ -84,10 +139,8 @@ func helloHandler(data []byte, userData interface{}, response *handlerResponse)
 	}
 
 	proxy := client.proxy
-	proxy.Lock()
-	if _, ok := proxy.vms[hello.ContainerID]; ok {
-
-		proxy.Unlock()
+	vm := newVM(hello.ContainerID, hello.CtlSerial, hello.IoSerial)
+	if !proxy.addVM(vm) {
 		response.SetErrorf("%s: container already registered",
 			hello.ContainerID)
 		return
@@ -96,14 +149,8 @@ func helloHandler(data []byte, userData interface{}, response *handlerResponse)
 	client.infof(1, "hello(containerId=%s,ctlSerial=%s,ioSerial=%s", hello.ContainerID,
 		hello.CtlSerial, hello.IoSerial)
 
-	vm := newVM(hello.ContainerID, hello.CtlSerial, hello.IoSerial)
-	proxy.vms[hello.ContainerID] = vm
-	proxy.Unlock()
-
 	if err := vm.Connect(); err != nil {
-		proxy.Lock()
-		delete(proxy.vms, hello.ContainerID)
-		proxy.Unlock()
+		proxy.removeVM(hello.ContainerID)
 		response.SetError(err)
 		return
 	}
@@ -122,10 +169,7 @@ func attachHandler(data []byte, userData interface{}, response *handlerResponse)
 		return
 	}
 
-	proxy.Lock()
-	vm := proxy.vms[attach.ContainerID]
-	proxy.Unlock()
-
+	vm := proxy.findVM(attach.ContainerID)
 	if vm == nil {
 		response.SetErrorf("unknown containerID: %s", attach.ContainerID)
 		return
@@ -147,10 +191,7 @@ func byeHandler(data []byte, userData interface{}, response *handlerResponse) {
 		return
 	}
 
-	proxy.Lock()
-	vm := proxy.vms[bye.ContainerID]
-	proxy.Unlock()
-
+	vm := proxy.removeVM(bye.ContainerID)
 	if vm == nil {
 		response.SetErrorf("unknown containerID: %s", bye.ContainerID)
 		return
@@ -158,60 +199,89 @@ func byeHandler(data []byte, userData interface{}, response *handlerResponse) {
 
 	client.info(1, "bye()")
 
-	proxy.Lock()
-	delete(proxy.vms, vm.containerID)
-	proxy.Unlock()
-
 	client.vm = nil
 	vm.Close()
 }
 
-// "allocateIO"
-func allocateIoHandler(data []byte, userData interface{}, response *handlerResponse) {
-	client := userData.(*client)
+// allocateIo is the common part of the JSON and binary allocateIO handlers
+func allocateIo(client *client, nStreams int, response *handlerResponse) uint64 {
 	vm := client.vm
 
-	allocateIo := api.AllocateIo{}
-	if err := json.Unmarshal(data, &allocateIo); err != nil {
-		response.SetError(err)
-		return
-	}
-
-	if allocateIo.NStreams < 1 || allocateIo.NStreams > 2 {
+	if nStreams < 1 || nStreams > 2 {
 		response.SetErrorf("asking for unexpected number of streams (%d)",
-			allocateIo.NStreams)
+			nStreams)
+		return 0
 	}
 
 	if vm == nil {
 		response.SetErrorMsg("client not attached to a vm")
-		return
+		return 0
 	}
 
-	client.infof(1, "allocateIo(nStreams=%d)", allocateIo.NStreams)
+	client.infof(1, "allocateIo(nStreams=%d)", nStreams)
 
 	// We'll send c0 to the client, keep c1
 	c0, c1, err := Socketpair()
 	if err != nil {
 		response.SetError(err)
-		return
+		return 0
 	}
 
 	f0, err := c0.File()
 	if err != nil {
 		response.SetError(err)
-		return
+		return 0
 	}
 
-	ioBase := vm.AllocateIo(allocateIo.NStreams, client.id, c1)
+	ioBase := vm.AllocateIo(nStreams, client.id, c1)
 
-	client.infof(1, "-> %d streams allocated, ioBase=%d", allocateIo.NStreams, ioBase)
+	client.infof(1, "-> %d streams allocated, ioBase=%d", nStreams, ioBase)
 
-	response.AddResult("ioBase", ioBase)
 	response.SetFile(f0)
 
 	// File() dups the underlying fd, so it's safe to close c0 here (will
 	// keep the c0 <-> c1 connection alive).
 	c0.Close()
+
+	return ioBase
+}
+
+// "allocateIO"
+func allocateIoHandler(data []byte, userData interface{}, response *handlerResponse) {
+	client := userData.(*client)
+
+	req := api.AllocateIo{}
+	if err := json.Unmarshal(data, &req); err != nil {
+		response.SetError(err)
+		return
+	}
+
+	ioBase := allocateIo(client, req.NStreams, response)
+	if response.err != nil {
+		return
+	}
+
+	response.AddResult("ioBase", ioBase)
+}
+
+// api.BinaryAllocateIo
+func allocateIoBinaryHandler(data []byte, userData interface{}, response *handlerResponse) {
+	client := userData.(*client)
+
+	nStreams, err := api.UnmarshalAllocateIo(data)
+	if err != nil {
+		response.SetError(err)
+		return
+	}
+
+	ioBase := allocateIo(client, nStreams, response)
+	if response.err != nil {
+		return
+	}
+
+	results := make([]byte, 8)
+	binary.BigEndian.PutUint64(results, ioBase)
+	response.SetBinaryResults(results)
 }
 
 // "hyper"
@@ -236,10 +306,73 @@ func hyperHandler(data []byte, userData interface{}, response *handlerResponse)
 	response.SetError(err)
 }
 
-func newProxy() *proxy {
-	return &proxy{
-		vms: make(map[string]*vm),
+// api.BinaryWinsize
+func winsizeBinaryHandler(data []byte, userData interface{}, response *handlerResponse) {
+	client := userData.(*client)
+	vm := client.vm
+
+	seq, row, column, err := api.UnmarshalWinsize(data)
+	if err != nil {
+		response.SetError(err)
+		return
+	}
+
+	if vm == nil {
+		response.SetErrorMsg("client not attached to a vm")
+		return
 	}
+
+	client.infof(1, "winsize(seq=%d,row=%d,column=%d)", seq, row, column)
+
+	// hyperstart only speaks JSON, but building this one by hand is a lot
+	// cheaper than going through json.Marshal
+	msg := make([]byte, 0, 64)
+	msg = append(msg, `{"seq":`...)
+	msg = strconv.AppendUint(msg, seq, 10)
+	msg = append(msg, `,"row":`...)
+	msg = strconv.AppendUint(msg, uint64(row), 10)
+	msg = append(msg, `,"column":`...)
+	msg = strconv.AppendUint(msg, uint64(column), 10)
+	msg = append(msg, '}')
+
+	response.SetError(vm.SendMessage("winsize", msg))
+}
+
+// api.BinaryKillContainer
+func killContainerBinaryHandler(data []byte, userData interface{}, response *handlerResponse) {
+	client := userData.(*client)
+	vm := client.vm
+
+	containerID, signal, err := api.UnmarshalKillContainer(data)
+	if err != nil {
+		response.SetError(err)
+		return
+	}
+
+	if vm == nil {
+		response.SetErrorMsg("client not attached to a vm")
+		return
+	}
+
+	client.infof(1, "killcontainer(containerId=%s,signal=%d)", containerID,
+		signal)
+
+	msg, err := json.Marshal(&hyperapi.KillCommand{
+		Container: containerID,
+		Signal:    signal,
+	})
+	if err != nil {
+		response.SetError(err)
+		return
+	}
+
+	response.SetError(vm.SendMessage("killcontainer", msg))
+}
+
+func newProxy() *proxy {
+	proxy := &proxy{}
+	proxy.vms.Store(make(map[string]*vm))
+	return proxy
 }
 
 // This variable is populated at link time with the value of:
@@ -311,6 +444,10 @@ func (proxy *proxy) serve() {
 	proto.Handle("bye", byeHandler)
 	proto.Handle("allocateIO", allocateIoHandler)
 	proto.Handle("hyper", hyperHandler)
+	proto.Handle("stats", statsHandler)
+	proto.HandleBinary(api.BinaryAllocateIo, allocateIoBinaryHandler)
+	proto.HandleBinary(api.BinaryWinsize, winsizeBinaryHandler)
+	proto.HandleBinary(api.BinaryKillContainer, killContainerBinaryHandler)
 
 	glog.V(1).Info("proxy started")
 
@@ -348,7 +485,16 @@ func initLogging() {
 func main() {
 	initLogging()
 
+	flag.IntVar(&ioQueueLength, "io-queue-length", ioQueueLength,
+		"number of output messages queued per I/O session")
+	flag.Var(&ioOverflow, "io-overflow",
+		"what to do when an I/O session queue is full: block or drop")
 	flag.Parse()
+
+	if ioQueueLength < 1 {
+		fmt.Fprintln(os.Stderr, "io-queue-length must be at least 1")
+		os.Exit(1)
+	}
 	defer glog.Flush()
 
 	proxyMain()
@@ -15,6 +15,7 @@
 package main
 
 import (
+	"bytes"
 	"encoding/binary"
 	"encoding/json"
 	"flag"
@@ -24,6 +25,7 @@ import (
 	"os"
 	"os/exec"
 	"sync"
+	"sync/atomic"
 	"syscall"
 	"testing"
 	"time"
@@ -195,10 +197,7 @@ func TestHello(t *testing.T) {
 	assert.NotNil(t, err)
 
 	// Hello should register a new vm object
-	proxy := rig.proxy
-	proxy.Lock()
-	vm := proxy.vms[testContainerID]
-	proxy.Unlock()
+	vm := rig.proxy.findVM(testContainerID)
 
 	assert.NotNil(t, vm)
 	assert.Equal(t, testContainerID, vm.containerID)
@@ -236,10 +235,7 @@ func TestBye(t *testing.T) {
 	assert.NotNil(t, err)
 
 	// Bye should unregister the vm object
-	proxy := rig.proxy
-	proxy.Lock()
-	vm := proxy.vms[testContainerID]
-	proxy.Unlock()
+	vm := rig.proxy.findVM(testContainerID)
 	assert.Nil(t, vm)
 
 	// This test shouldn't send anything to hyperstart
@@ -346,9 +342,6 @@ func TestHyperStartpod(t *testing.T) {
 	rig.Stop()
 }
 
-// header for hyperstart's I/O channel packets is 12 bytes
-const ioHeaderLength = 12
-
 // write a chunk of data to an I/O fd
 func writeIo(t *testing.T, writer io.Writer, seq uint64, data []byte) {
 	length := ioHeaderLength + len(data)
@@ -391,6 +384,130 @@ func readIo(t *testing.T, reader io.Reader) (seq uint64, data []byte) {
 	return
 }
 
+func TestVMRegistry(t *testing.T) {
+	proxy := newProxy()
+
+	vm := newVM(testContainerID, "ctl", "io")
+	assert.True(t, proxy.addVM(vm))
+	assert.False(t, proxy.addVM(newVM(testContainerID, "ctl", "io")))
+	assert.Equal(t, vm, proxy.findVM(testContainerID))
+	assert.Nil(t, proxy.findVM("foo"))
+
+	// Registering a VM doesn't disturb the others, and only one of
+	// concurrent removers gets the vm
+	var wg sync.WaitGroup
+	var removed int32
+	for i := 0; i < 8; i++ {
+		wg.Add(1)
+		go func(i int) {
+			defer wg.Done()
+			id := fmt.Sprintf("vm-%d", i)
+			proxy.addVM(newVM(id, "ctl", "io"))
+			assert.NotNil(t, proxy.findVM(id))
+			if proxy.removeVM(testContainerID) != nil {
+				atomic.AddInt32(&removed, 1)
+			}
+		}(i)
+	}
+	wg.Wait()
+
+	assert.Equal(t, int32(1), removed)
+	assert.Nil(t, proxy.findVM(testContainerID))
+	assert.NotNil(t, proxy.findVM("vm-7"))
+}
+
+func TestIoSessionQueue(t *testing.T) {
+	savedLength, savedOverflow := ioQueueLength, ioOverflow
+	defer func() {
+		ioQueueLength, ioOverflow = savedLength, savedOverflow
+	}()
+
+	ioQueueLength = 1
+
+	// drop: a full queue drops and accounts for the message
+	ioOverflow = ioOverflowDrop
+	session := newIoSession(1, 1, 1, nil)
+	assert.True(t, session.queue(1, []byte("foo")))
+	assert.False(t, session.queue(1, []byte("bar")))
+	assert.Equal(t, uint64(1), atomic.LoadUint64(&session.dropped))
+
+	msg := <-session.output
+	assert.Equal(t, []byte("foo"), msg.data)
+	assert.True(t, session.queue(1, []byte("baz")))
+
+	// block: a full queue waits until there's room or the session is
+	// shut down
+	ioOverflow = ioOverflowBlock
+	session = newIoSession(1, 1, 1, nil)
+	assert.True(t, session.queue(1, []byte("foo")))
+
+	queued := make(chan bool)
+	go func() {
+		queued <- session.queue(1, []byte("bar"))
+	}()
+
+	select {
+	case <-queued:
+		t.Fatal("queue() didn't block on a full queue")
+	case <-time.After(50 * time.Millisecond):
+	}
+
+	<-session.output
+	assert.True(t, <-queued)
+
+	go func() {
+		queued <- session.queue(1, []byte("baz"))
+	}()
+	session.shutdown()
+	assert.False(t, <-queued)
+	assert.Equal(t, uint64(0), atomic.LoadUint64(&session.dropped))
+
+	// policies are parsed from the command line
+	var policy ioOverflowPolicy
+	assert.Nil(t, policy.Set("drop"))
+	assert.Equal(t, ioOverflowDrop, policy)
+	assert.Equal(t, "drop", policy.String())
+	assert.Nil(t, policy.Set("block"))
+	assert.Equal(t, ioOverflowBlock, policy)
+	assert.NotNil(t, policy.Set("foo"))
+}
+
+func TestReadIoMessage(t *testing.T) {
+	var stream bytes.Buffer
+	buf := make([]byte, maxIoMessageLength)
+
+	writeIo(t, &stream, 42, []byte("foo"))
+	writeIo(t, &stream, 43, []byte{})
+
+	seq, data, err := readIoMessage(&stream, buf)
+	assert.Nil(t, err)
+	assert.Equal(t, uint64(42), seq)
+	assert.Equal(t, ioHeaderLength+3, len(data))
+	assert.Equal(t, []byte("foo"), data[ioHeaderLength:])
+
+	seq, data, err = readIoMessage(&stream, buf)
+	assert.Nil(t, err)
+	assert.Equal(t, uint64(43), seq)
+	assert.Equal(t, ioHeaderLength, len(data))
+
+	// truncated message
+	writeIo(t, &stream, 44, []byte("foo"))
+	stream.Truncate(stream.Len() - 1)
+	_, _, err = readIoMessage(&stream, buf)
+	assert.NotNil(t, err)
+
+	// invalid lengths
+	for _, length := range []uint32{0, maxIoMessageLength + 1} {
+		header := make([]byte, ioHeaderLength)
+		binary.BigEndian.PutUint64(header[:], 45)
+		binary.BigEndian.PutUint32(header[8:], length)
+		stream.Reset()
+		stream.Write(header)
+		_, _, err = readIoMessage(&stream, buf)
+		assert.NotNil(t, err)
+	}
+}
+
 func TestAllocateIo(t *testing.T) {
 	proto := newProtocol()
 	proto.Handle("hello", helloHandler)
@@ -460,5 +577,144 @@ func TestAllocateIo(t *testing.T) {
 	assert.Equal(t, 1, len(data))
 	assert.Equal(t, uint8(17), data[0])
 
+	// the session is closed once the exit status has been written
+	_, err = ioFile.Read(buf)
+	assert.Equal(t, io.EOF, err)
+
+	rig.Stop()
+}
+
+func TestBinaryEncoding(t *testing.T) {
+	proto := newProtocol()
+	proto.Handle("hello", helloHandler)
+	proto.HandleBinary(api.BinaryAllocateIo, allocateIoBinaryHandler)
+	proto.HandleBinary(api.BinaryWinsize, winsizeBinaryHandler)
+	proto.HandleBinary(api.BinaryKillContainer, killContainerBinaryHandler)
+
+	rig := newTestRig(t, proto)
+	rig.Start()
+
+	// hello is always JSON, the proxy advertises binary support in its
+	// response so the client switches to the binary encoding for the
+	// following requests. No JSON handler for those is registered.
+	ctlSocketPath, ioSocketPath := rig.Hyperstart.GetSocketPaths()
+	err := rig.Client.Hello(testContainerID, ctlSocketPath, ioSocketPath)
+	assert.Nil(t, err)
+
+	ioBase, ioFile, err := rig.Client.AllocateIo(1)
+	assert.Nil(t, err)
+	assert.Equal(t, uint64(1), ioBase)
+
+	rig.Hyperstart.SendIoString(ioBase, "stdout\n")
+	seq, data := readIo(t, ioFile)
+	assert.Equal(t, ioBase, seq)
+	assert.Equal(t, "stdout\n", string(data))
+
+	// Errors are reported too
+	_, _, err = rig.Client.AllocateIo(3)
+	assert.NotNil(t, err)
+
+	// The hyper commands reach hyperstart as JSON
+	err = rig.Client.Winsize(ioBase, 24, 80)
+	assert.Nil(t, err)
+	err = rig.Client.KillContainer(testContainerID, syscall.SIGTERM)
+	assert.Nil(t, err)
+
+	msgs := rig.Hyperstart.GetLastMessages()
+	assert.Equal(t, 2, len(msgs))
+
+	assert.Equal(t, hyper.INIT_WINSIZE, int(msgs[0].Code))
+	winsize := hyper.WindowSizeMessage{}
+	err = json.Unmarshal(msgs[0].Message, &winsize)
+	assert.Nil(t, err)
+	assert.Equal(t, hyper.WindowSizeMessage{Seq: ioBase, Row: 24, Column: 80}, winsize)
+
+	assert.Equal(t, hyper.INIT_KILLCONTAINER, int(msgs[1].Code))
+	kill := hyper.KillCommand{}
+	err = json.Unmarshal(msgs[1].Message, &kill)
+	assert.Nil(t, err)
+	assert.Equal(t, hyper.KillCommand{Container: testContainerID, Signal: syscall.SIGTERM}, kill)
+
+	ioFile.Close()
+	rig.Stop()
+}
+
+func TestStats(t *testing.T) {
+	proto := newProtocol()
+	proto.Handle("hello", helloHandler)
+	proto.Handle("allocateIO", allocateIoHandler)
+	proto.Handle("hyper", hyperHandler)
+	proto.Handle("stats", statsHandler)
+
+	rig := newTestRig(t, proto)
+	rig.Start()
+
+	// No VM yet
+	stats, err := rig.Client.Stats("")
+	assert.Nil(t, err)
+	assert.True(t, stats.Goroutines > 0)
+	assert.Equal(t, 0, len(stats.VMs))
+
+	_, err = rig.Client.Stats(testContainerID)
+	assert.NotNil(t, err)
+
+	ctlSocketPath, ioSocketPath := rig.Hyperstart.GetSocketPaths()
+	err = rig.Client.Hello(testContainerID, ctlSocketPath, ioSocketPath)
+	assert.Nil(t, err)
+
+	err = rig.Client.Hyper("ping", nil)
+	assert.Nil(t, err)
+
+	ioBase, ioFile, err := rig.Client.AllocateIo(2)
+	assert.Nil(t, err)
+
+	// one message each way
+	rig.Hyperstart.SendIoString(ioBase, "stdout\n")
+	buf := make([]byte, 32)
+	_, err = ioFile.Read(buf)
+	assert.Nil(t, err)
+
+	writeIo(t, ioFile, ioBase, []byte("stdin\n"))
+	rig.Hyperstart.ReadIo(buf)
+
+	stats, err = rig.Client.Stats(testContainerID)
+	assert.Nil(t, err)
+	assert.Equal(t, 1, len(stats.VMs))
+
+	vm := stats.VMs[0]
+	assert.Equal(t, testContainerID, vm.ContainerID)
+	assert.Equal(t, uint64(1), vm.ToClients.Messages)
+	assert.Equal(t, uint64(ioHeaderLength+len("stdout\n")), vm.ToClients.Bytes)
+	assert.Equal(t, uint64(1), vm.FromClients.Messages)
+	assert.Equal(t, uint64(ioHeaderLength+len("stdin\n")), vm.FromClients.Bytes)
+	assert.Equal(t, uint64(1), vm.CtlLatency.Count)
+	assert.Equal(t, len(vm.CtlLatency.BoundsUs)+1, len(vm.CtlLatency.Counts))
+
+	assert.Equal(t, 1, len(vm.Sessions))
+	session := vm.Sessions[0]
+	assert.Equal(t, ioBase, session.IoBase)
+	assert.Equal(t, 2, session.NStreams)
+	assert.Equal(t, vm.ToClients, session.ToClient)
+	assert.Equal(t, vm.FromClients, session.FromClient)
+	assert.Equal(t, uint64(0), session.Dropped)
+	assert.Equal(t, ioQueueLength, session.QueueLength)
+
 	rig.Stop()
 }
+
+func TestLatencyHistogram(t *testing.T) {
+	var h latencyHistogram
+
+	h.observe(10 * time.Microsecond)
+	h.observe(100 * time.Microsecond)
+	h.observe(101 * time.Microsecond)
+	h.observe(time.Hour)
+
+	s := h.snapshot()
+	assert.Equal(t, uint64(4), s.Count)
+	assert.Equal(t, uint64(1), s.Counts[0])
+	assert.Equal(t, uint64(1), s.Counts[1])
+	assert.Equal(t, uint64(1), s.Counts[2])
+	assert.Equal(t, uint64(1), s.Counts[len(s.Counts)-1])
+	assert.Equal(t, len(latencyBounds)+1, len(s.Counts))
+}
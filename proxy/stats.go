@@ -0,0 +1,158 @@
+// Copyright (c) 2016 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package main
+
+import (
+	"encoding/json"
+	"runtime"
+	"sync/atomic"
+	"time"
+
+	"github.com/01org/cc-oci-runtime/proxy/api"
+)
+
+// ioCounters accounts for data relayed in one direction. Fields are updated
+// with atomic operations only so the I/O path never waits on stats
+// collection.
+type ioCounters struct {
+	bytes    uint64
+	messages uint64
+}
+
+func (c *ioCounters) add(n int) {
+	atomic.AddUint64(&c.bytes, uint64(n))
+	atomic.AddUint64(&c.messages, 1)
+}
+
+func (c *ioCounters) snapshot() api.IoCounters {
+	return api.IoCounters{
+		Bytes:    atomic.LoadUint64(&c.bytes),
+		Messages: atomic.LoadUint64(&c.messages),
+	}
+}
+
+// Upper bounds, in microseconds, of the latencyHistogram buckets. A last
+// bucket catches everything above the largest bound.
+var latencyBounds = []uint64{
+	50, 100, 250, 500,
+	1000, 2500, 5000,
+	10000, 25000, 50000,
+	100000, 250000, 500000,
+	1000000,
+}
+
+// latencyHistogram is a fixed-bucket histogram of durations, updated with
+// atomic operations only.
+type latencyHistogram struct {
+	count  uint64
+	sumUs  uint64
+	counts [15]uint64 // len(latencyBounds) + 1
+}
+
+func (h *latencyHistogram) observe(d time.Duration) {
+	us := uint64(d / time.Microsecond)
+
+	i := 0
+	for i < len(latencyBounds) && us > latencyBounds[i] {
+		i++
+	}
+
+	atomic.AddUint64(&h.counts[i], 1)
+	atomic.AddUint64(&h.sumUs, us)
+	atomic.AddUint64(&h.count, 1)
+}
+
+func (h *latencyHistogram) snapshot() api.LatencyHistogram {
+	s := api.LatencyHistogram{
+		BoundsUs: latencyBounds,
+		Counts:   make([]uint64, len(h.counts)),
+		Count:    atomic.LoadUint64(&h.count),
+		SumUs:    atomic.LoadUint64(&h.sumUs),
+	}
+
+	for i := range h.counts {
+		s.Counts[i] = atomic.LoadUint64(&h.counts[i])
+	}
+
+	return s
+}
+
+func (session *ioSession) stats() api.SessionStats {
+	return api.SessionStats{
+		IoBase:      session.ioBase,
+		NStreams:    session.nStreams,
+		ClientID:    session.clientID,
+		ToClient:    session.toClient.snapshot(),
+		FromClient:  session.fromClient.snapshot(),
+		Dropped:     atomic.LoadUint64(&session.dropped),
+		QueueDepth:  len(session.output),
+		QueueLength: cap(session.output),
+	}
+}
+
+func (vm *vm) stats() api.VMStats {
+	s := api.VMStats{
+		ContainerID: vm.containerID,
+		ToClients:   vm.toClients.snapshot(),
+		FromClients: vm.fromClients.snapshot(),
+		Unroutable:  atomic.LoadUint64(&vm.unroutable),
+		CtlLatency:  vm.ctlLatency.snapshot(),
+		Sessions:    []api.SessionStats{},
+	}
+
+	// Sessions with 2 streams appear twice in the map
+	for seq, session := range vm.sessions() {
+		if seq != session.ioBase {
+			continue
+		}
+		s.Sessions = append(s.Sessions, session.stats())
+	}
+
+	return s
+}
+
+// "stats"
+func statsHandler(data []byte, userData interface{}, response *handlerResponse) {
+	client := userData.(*client)
+	proxy := client.proxy
+
+	stats := api.Stats{}
+	if len(data) > 0 {
+		if err := json.Unmarshal(data, &stats); err != nil {
+			response.SetError(err)
+			return
+		}
+	}
+
+	vms := []api.VMStats{}
+
+	if stats.ContainerID != "" {
+		vm := proxy.findVM(stats.ContainerID)
+		if vm == nil {
+			response.SetErrorf("unknown containerID: %s", stats.ContainerID)
+			return
+		}
+		vms = append(vms, vm.stats())
+	} else {
+		for _, vm := range proxy.vms.Load().(map[string]*vm) {
+			vms = append(vms, vm.stats())
+		}
+	}
+
+	client.infof(1, "stats(containerId=%s)", stats.ContainerID)
+
+	response.AddResult("goroutines", runtime.NumGoroutine())
+	response.AddResult("vms", vms)
+}
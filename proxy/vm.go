@@ -18,9 +18,12 @@ import (
 	"encoding/binary"
 	"encoding/hex"
 	"fmt"
+	"io"
 	"net"
 	"os"
 	"sync"
+	"sync/atomic"
+	"time"
 
 	"github.com/golang/glog"
 	"github.com/sameo/virtcontainers/hyperstart"
@@ -28,6 +31,14 @@ import (
 
 // Represents a single qemu/hyperstart instance on the system
 type vm struct {
+	// Stats, updated atomically. Kept first for 64-bit alignment.
+	toClients   ioCounters
+	fromClients ioCounters
+	unroutable  uint64
+	ctlLatency  latencyHistogram
+
+	// Serializes updates to ioSessions and nextIoBase. The I/O path
+	// doesn't take it.
 	sync.Mutex
 
 	containerID string
@@ -37,17 +48,73 @@ type vm struct {
 	// Used to allocate globally unique IO sequence numbers
 	nextIoBase uint64
 
-	// ios are hashed by their sequence numbers. If 2 sequence numbers are
-	// allocated for one process (stdin/stdout and stderr) both sequence
-	// numbers appear in this map.
-	ioSessions map[uint64]*ioSession
+	// ioSessions holds an immutable map[uint64]*ioSession. ios are hashed
+	// by their sequence numbers. If 2 sequence numbers are allocated for
+	// one process (stdin/stdout and stderr) both sequence numbers appear
+	// in this map. Updates copy the map and atomically swap the new one
+	// in so the per-message lookup in ioHyperToClients() is lock-free.
+	ioSessions atomic.Value
 
 	// Used to wait for all VM-global goroutines to finish on Close()
 	wg sync.WaitGroup
 }
 
+// What to do with output for a session whose queue is full
+type ioOverflowPolicy int
+
+const (
+	// Wait until the session's queue has room. The hyperstart tty channel
+	// has no per-stream flow control, so this stops reading output for
+	// the whole VM, but only once the slow client has fallen a full queue
+	// behind. No data is lost.
+	ioOverflowBlock ioOverflowPolicy = iota
+
+	// Drop the message and account for it in ioSession.dropped. Other
+	// sessions of the VM are never held up.
+	ioOverflowDrop
+)
+
+func (p *ioOverflowPolicy) String() string {
+	if *p == ioOverflowDrop {
+		return "drop"
+	}
+	return "block"
+}
+
+// Set implements flag.Value
+func (p *ioOverflowPolicy) Set(value string) error {
+	switch value {
+	case "block":
+		*p = ioOverflowBlock
+	case "drop":
+		*p = ioOverflowDrop
+	default:
+		return fmt.Errorf("unknown I/O overflow policy '%s'", value)
+	}
+	return nil
+}
+
+// Per-session output queue configuration, set from the command line
+var (
+	ioQueueLength = 128
+	ioOverflow    = ioOverflowBlock
+)
+
+// A chunk of output waiting to be written to a client
+type ioOutput struct {
+	seq  uint64
+	data []byte
+}
+
 // A set of I/O streams between a client and a process running inside the VM
 type ioSession struct {
+	// Stats, updated atomically. Kept first for 64-bit alignment.
+	toClient   ioCounters
+	fromClient ioCounters
+
+	// Number of output messages dropped because the queue was full.
+	dropped uint64
+
 	nStreams int
 	ioBase   uint64
 
@@ -57,20 +124,84 @@ type ioSession struct {
 	// socket connected to the fd sent over to the client
 	client net.Conn
 
-	// Used to wait for per-ioSession goroutines. Currently there's only
-	// one such goroutine, the one reading stdin data from client socket.
+	// Bounded queue of output for this client, drained by
+	// ioSessionToClient(), and what to do when it's full
+	output   chan ioOutput
+	overflow ioOverflowPolicy
+
+	// Set once hyperstart has closed the stdout stream, after which the
+	// next message on ioBase carries the exit status. Only accessed by
+	// ioHyperToClients().
+	stdoutClosed bool
+
+	// Closed when the session is shutting down, and by ioSessionToClient()
+	// once it has written out what was left in the queue.
+	done      chan struct{}
+	flushed   chan struct{}
+	closeOnce sync.Once
+
+	// Used to wait for per-ioSession goroutines: the one reading stdin
+	// data from the client socket and the one writing output to it.
 	wg sync.WaitGroup
 }
 
+func newIoSession(n int, ioBase, clientID uint64, c net.Conn) *ioSession {
+	return &ioSession{
+		nStreams: n,
+		ioBase:   ioBase,
+		clientID: clientID,
+		client:   c,
+		output:   make(chan ioOutput, ioQueueLength),
+		overflow: ioOverflow,
+		done:     make(chan struct{}),
+		flushed:  make(chan struct{}),
+	}
+}
+
+// queue hands data over to the session's writer. It returns false if the
+// data was dropped, either because of the overflow policy or because the
+// session is shutting down.
+func (session *ioSession) queue(seq uint64, data []byte) bool {
+	msg := ioOutput{seq: seq, data: data}
+
+	if session.overflow == ioOverflowDrop {
+		select {
+		case session.output <- msg:
+			return true
+		case <-session.done:
+			return false
+		default:
+			atomic.AddUint64(&session.dropped, 1)
+			return false
+		}
+	}
+
+	select {
+	case session.output <- msg:
+		return true
+	case <-session.done:
+		return false
+	}
+}
+
+// shutdown stops the session's writer and unblocks anyone queuing data
+func (session *ioSession) shutdown() {
+	session.closeOnce.Do(func() {
+		close(session.done)
+	})
+}
+
 func newVM(id, ctlSerial, ioSerial string) *vm {
 	h := hyperstart.NewHyperstart(ctlSerial, ioSerial, "unix")
 
-	return &vm{
+	vm := &vm{
 		containerID:  id,
 		hyperHandler: h,
 		nextIoBase:   1,
-		ioSessions:   make(map[uint64]*ioSession),
 	}
+	vm.ioSessions.Store(make(map[uint64]*ioSession))
+
+	return vm
 }
 
 func (vm *vm) shortName() string {
@@ -106,49 +237,73 @@ func (vm *vm) dump(lvl glog.Level, data []byte) {
 	glog.Infof("\n%s", hex.Dump(data))
 }
 
-// Returns one chunk of data belonging to the seq stream
-func readIoMessage(conn net.Conn) (seq uint64, data []byte, err error) {
-	needRead := 12
-	length := 0
-	read := 0
-	buf := make([]byte, 512)
-	res := []byte{}
-	for read < needRead {
-		want := needRead - read
-		if want > 512 {
-			want = 512
-		}
-		nr, err := conn.Read(buf[:want])
-		if err != nil {
-			return 0, nil, err
-		}
+// Values related to the communication on the tty channel
+const (
+	ioHeaderLength = 12
+	// How long a session being closed may take to write its queued output
+	// to the client
+	ioFlushTimeout = 5 * time.Second
+	// Largest message hyperstart accepts, header included. That limit is
+	// from hyperstart src/init.c, hyper_channel_ops, rbuf_size.
+	maxIoMessageLength = 10240
+)
 
-		res = append(res, buf[:nr]...)
-		read = read + nr
+// ioBufferPool holds *[]byte buffers large enough for any I/O message.
+// Pointers are stored to avoid an allocation when putting a slice back into
+// the pool.
+var ioBufferPool = sync.Pool{
+	New: func() interface{} {
+		buf := make([]byte, maxIoMessageLength)
+		return &buf
+	},
+}
 
-		if length == 0 && read >= 12 {
-			length = int(binary.BigEndian.Uint32(res[8:12]))
-			if length > 12 {
-				needRead = length
-			}
-		}
+// Returns one chunk of data belonging to the seq stream. The message, header
+// included, is read into buf which must be able to hold maxIoMessageLength
+// bytes. The returned data is a slice of buf.
+func readIoMessage(conn io.Reader, buf []byte) (seq uint64, data []byte, err error) {
+	if _, err = io.ReadFull(conn, buf[:ioHeaderLength]); err != nil {
+		return 0, nil, err
+	}
+
+	length := int(binary.BigEndian.Uint32(buf[8:ioHeaderLength]))
+	if length < ioHeaderLength || length > len(buf) {
+		return 0, nil, fmt.Errorf("invalid I/O message length %d", length)
 	}
 
-	seq = binary.BigEndian.Uint64(res[:8])
-	return seq, res, nil
+	if _, err = io.ReadFull(conn, buf[ioHeaderLength:length]); err != nil {
+		return 0, nil, err
+	}
+
+	seq = binary.BigEndian.Uint64(buf[:8])
+	return seq, buf[:length], nil
+}
 
+func (vm *vm) sessions() map[uint64]*ioSession {
+	return vm.ioSessions.Load().(map[uint64]*ioSession)
 }
 
 func (vm *vm) findSession(seq uint64) *ioSession {
-	vm.Lock()
-	defer vm.Unlock()
+	return vm.sessions()[seq]
+}
 
-	return vm.ioSessions[seq]
+// updateSessions replaces the ioSessions map by a copy modified by update.
+// Must be called with the vm lock held.
+func (vm *vm) updateSessions(update func(sessions map[uint64]*ioSession)) {
+	old := vm.sessions()
+	sessions := make(map[uint64]*ioSession, len(old)+2)
+	for seq, session := range old {
+		sessions[seq] = session
+	}
+	update(sessions)
+	vm.ioSessions.Store(sessions)
 }
 
 // This function runs in a goroutine, reading data from the io channel and
 // dispatching it to the right client (the one with matching seq number)
-// There's only one instance of this goroutine per-VM
+// There's only one instance of this goroutine per-VM. Writing to clients is
+// left to per-session goroutines so a client that stops reading can't stall
+// the others.
 func (vm *vm) ioHyperToClients() {
 	for {
 		ttyMsg, err := vm.hyperHandler.ReadIoMessage()
@@ -156,35 +311,118 @@ func (vm *vm) ioHyperToClients() {
 			// VM process is gone
 			break
 		}
-		length := len(ttyMsg.Message) + 12
-		data := make([]byte, length)
-		binary.BigEndian.PutUint64(data[:], uint64(ttyMsg.Session))
-		binary.BigEndian.PutUint32(data[8:], uint32(length))
-		copy(data[12:], ttyMsg.Message)
 
 		session := vm.findSession(ttyMsg.Session)
 		if session == nil {
+			atomic.AddUint64(&vm.unroutable, 1)
 			fmt.Fprintf(os.Stderr,
 				"couldn't find client with seq number %d\n", ttyMsg.Session)
 			continue
 		}
 
-		vm.infof(1, "io", "<- writing %d bytes to client #%d", len(data), session.clientID)
-		vm.dump(2, data)
+		vm.infof(1, "io", "<- queuing %d bytes for client #%d",
+			len(ttyMsg.Message)+ioHeaderLength, session.clientID)
 
-		n, err := session.client.Write(data)
-		if err != nil || n != len(data) {
-			fmt.Fprintf(os.Stderr,
-				"error writing I/O data to client: %v (%d bytes written)\n", err, n)
+		if !session.queue(ttyMsg.Session, ttyMsg.Message) {
+			vm.infof(1, "io", "<- dropped %d bytes for client #%d",
+				len(ttyMsg.Message)+ioHeaderLength, session.clientID)
+		}
 
-			break
+		if ttyMsg.Session != session.ioBase {
+			continue
+		}
 
+		// hyperstart closes stdout with an empty message and then sends
+		// the exit status. That's the last message of the session.
+		if !session.stdoutClosed {
+			session.stdoutClosed = len(ttyMsg.Message) == 0
+			continue
 		}
+
+		vm.infof(1, "io", "<- process of client #%d exited", session.clientID)
+		vm.wg.Add(1)
+		go func(ioBase uint64) {
+			vm.CloseIo(ioBase)
+			vm.wg.Done()
+		}(session.ioBase)
 	}
 
 	vm.wg.Done()
 }
 
+// Writes one chunk of queued output to the session's client. header and vecs
+// are scratch space owned by the calling goroutine.
+func (vm *vm) writeToClient(session *ioSession, msg ioOutput,
+	header []byte, vecs net.Buffers) error {
+	length := len(msg.data) + ioHeaderLength
+	binary.BigEndian.PutUint64(header, msg.seq)
+	binary.BigEndian.PutUint32(header[8:], uint32(length))
+
+	vm.infof(1, "io", "<- writing %d bytes to client #%d", length, session.clientID)
+	vm.dump(2, header)
+	vm.dump(2, msg.data)
+
+	// Write header and payload with a single writev(), without
+	// copying the payload. WriteTo consumes the slice it's given,
+	// so hand it a fresh view of vecs each time.
+	session.toClient.add(length)
+	vm.toClients.add(length)
+
+	bufs := vecs[:2]
+	bufs[0] = header
+	bufs[1] = msg.data
+	n, err := bufs.WriteTo(session.client)
+	if err == nil && n != int64(length) {
+		err = io.ErrShortWrite
+	}
+	if err != nil {
+		fmt.Fprintf(os.Stderr,
+			"error writing I/O data to client #%d: %v (%d bytes written)\n",
+			session.clientID, err, n)
+	}
+	return err
+}
+
+// This function runs in a goroutine, writing the output queued for a session
+// to its client. There's one instance of this goroutine per client having
+// done an allocateIO.
+func (vm *vm) ioSessionToClient(session *ioSession) {
+	var header [ioHeaderLength]byte
+	vecs := make(net.Buffers, 2)
+
+	defer session.wg.Done()
+	defer close(session.flushed)
+
+	for {
+		select {
+		case msg := <-session.output:
+			if vm.writeToClient(session, msg, header[:], vecs) != nil {
+				// Only this session is affected
+				session.shutdown()
+				session.client.Close()
+				return
+			}
+			continue
+		case <-session.done:
+		}
+
+		// Shutting down: what's still queued, the exit status in
+		// particular, is written out first. Don't let a client that
+		// stopped reading hold up the close forever.
+		session.client.SetWriteDeadline(time.Now().Add(ioFlushTimeout))
+		for {
+			select {
+			case msg := <-session.output:
+				if vm.writeToClient(session, msg, header[:], vecs) != nil {
+					return
+				}
+			default:
+				return
+			}
+		}
+	}
+}
+
 func (vm *vm) Connect() error {
 	if err := vm.hyperHandler.OpenSockets(); err != nil {
 		return err
@@ -202,7 +440,9 @@ func (vm *vm) Connect() error {
 }
 
 func (vm *vm) SendMessage(cmd string, data []byte) error {
+	start := time.Now()
 	_, err := vm.hyperHandler.SendCtlMessage(cmd, data)
+	vm.ctlLatency.observe(time.Since(start))
 	return err
 }
 
@@ -210,8 +450,11 @@ func (vm *vm) SendMessage(cmd string, data []byte) error {
 // writing data to the hyperstart I/O chanel.
 // There's one instance of this goroutine per client having done an allocateIO.
 func (vm *vm) ioClientToHyper(session *ioSession) {
+	buf := ioBufferPool.Get().(*[]byte)
+	defer ioBufferPool.Put(buf)
+
 	for {
-		seq, data, err := readIoMessage(session.client)
+		seq, data, err := readIoMessage(session.client, *buf)
 		if err != nil {
 			// client process is gone
 			break
@@ -226,6 +469,9 @@ func (vm *vm) ioClientToHyper(session *ioSession) {
 		vm.infof(1, "io", "-> writing %d bytes to hyper from #%d", len(data), session.clientID)
 		vm.dump(2, data)
 
+		session.fromClient.add(len(data))
+		vm.fromClients.add(len(data))
+
 		err = vm.hyperHandler.SendIoMessage(seq, data[12:])
 		if err != nil {
 			fmt.Fprintf(os.Stderr,
@@ -243,40 +489,45 @@ func (vm *vm) AllocateIo(n int, clientID uint64, c net.Conn) uint64 {
 	ioBase := vm.nextIoBase
 	vm.nextIoBase += uint64(n)
 
-	session := &ioSession{
-		nStreams: n,
-		ioBase:   ioBase,
-		clientID: clientID,
-		client:   c,
-	}
+	session := newIoSession(n, ioBase, clientID, c)
 
-	for i := 0; i < n; i++ {
-		vm.ioSessions[ioBase+uint64(i)] = session
-	}
+	vm.updateSessions(func(sessions map[uint64]*ioSession) {
+		for i := 0; i < n; i++ {
+			sessions[ioBase+uint64(i)] = session
+		}
+	})
 	vm.Unlock()
 
-	// Starts stdin forwarding between client and hyper
-	session.wg.Add(1)
+	// Starts stdin forwarding between client and hyper, and output
+	// forwarding from hyper to client
+	session.wg.Add(2)
 	go vm.ioClientToHyper(session)
+	go vm.ioSessionToClient(session)
 
 	return ioBase
 }
 
+// Close shuts the session down once its queued output has been written to the
+// client, then disconnects the client.
 func (session *ioSession) Close() {
+	session.shutdown()
+	<-session.flushed
 	session.client.Close()
 	session.wg.Wait()
 }
 
 func (vm *vm) CloseIo(seq uint64) {
 	vm.Lock()
-	session := vm.ioSessions[seq]
+	session := vm.findSession(seq)
 	if session == nil {
 		vm.Unlock()
 		return
 	}
-	for i := 0; i < session.nStreams; i++ {
-		delete(vm.ioSessions, seq+uint64(i))
-	}
+	vm.updateSessions(func(sessions map[uint64]*ioSession) {
+		for i := 0; i < session.nStreams; i++ {
+			delete(sessions, seq+uint64(i))
+		}
+	})
 	vm.Unlock()
 
 	session.Close()
@@ -285,17 +536,20 @@ func (vm *vm) CloseIo(seq uint64) {
 func (vm *vm) Close() {
 	vm.hyperHandler.CloseSockets()
 
-	// Wait for per-client goroutines
+	// Unregister all sessions, then wait for per-client goroutines without
+	// holding the vm lock
 	vm.Lock()
-	for seq, session := range vm.ioSessions {
-		delete(vm.ioSessions, seq)
+	sessions := vm.sessions()
+	vm.ioSessions.Store(make(map[uint64]*ioSession))
+	vm.Unlock()
+
+	for seq, session := range sessions {
 		if seq != session.ioBase {
 			continue
 		}
 
 		session.Close()
 	}
-	vm.Unlock()
 
 	// Wait for VM global goroutines
 	vm.wg.Wait()
@@ -165,6 +165,31 @@ get_proxy_ctl_msg(const char *json, size_t *len) {
 	return proxy_ctl_msg;
  }
 
+/*!
+ * Write a complete proxy ctl message to the proxy
+ *
+ * \param fd File descriptor to send the message to(should be proxy ctl socket fd)
+ * \param msg Message, header included
+ * \param len Length of the message
+ */
+static void
+write_proxy_ctl_msg(int fd, const char *msg, size_t len) {
+	size_t     offset = 0;
+	ssize_t    ret;
+
+	while (offset < len) {
+		ret = write(fd, msg + offset, len-offset);
+		if (ret == -1 && errno == EINTR) {
+			continue;
+		}
+		if (ret <= 0 ) {
+			shim_error("Error writing to proxy: %s\n", strerror(errno));
+			return;
+		}
+		offset += (size_t)ret;
+	}
+}
+
 /*!
  * Send "hyper" payload to cc-proxy. This will be forwarded to hyperstart.
  *
@@ -177,7 +202,7 @@ send_proxy_hyper_message(int fd, const char *hyper_cmd, const char *json) {
 	char      *proxy_payload = NULL;
 	char      *proxy_command_id = "hyper";
 	char      *proxy_ctl_msg = NULL;
-	size_t     len = 0, offset = 0;
+	size_t     len = 0;
 	ssize_t    ret;
 
 	/* cc-proxy has the following format for "hyper" payload:
@@ -206,21 +231,107 @@ send_proxy_hyper_message(int fd, const char *hyper_cmd, const char *json) {
 	proxy_ctl_msg = get_proxy_ctl_msg(proxy_payload, &len);
 	free(proxy_payload);
 
-	while (offset < len) {
-		ret = write(fd, proxy_ctl_msg + offset, len-offset);
-		if (ret == EINTR) {
-			continue;
-		}
-		if (ret <= 0 ) {
-			free(proxy_ctl_msg);
-			shim_error("Error writing to proxy: %s\n", strerror(errno));
-			return;
-		}
-		offset += (size_t)ret;
+	write_proxy_ctl_msg(fd, proxy_ctl_msg, len);
+	free(proxy_ctl_msg);
+}
+
+/*!
+ * Send a binary encoded request to cc-proxy. Only valid once the proxy
+ * has advertised \ref PROXY_FLAG_BINARY_SUPPORTED.
+ *
+ * \param fd File descriptor to send the message to(should be proxy ctl socket fd)
+ * \param payload Binary request, starting with the operation byte
+ * \param payload_len Length of \p payload
+ */
+void
+send_proxy_binary_message(int fd, const uint8_t *payload, size_t payload_len) {
+	char      *proxy_ctl_msg = NULL;
+	size_t     len;
+
+	if ( !payload || fd < 0) {
+		return;
+	}
+
+	len = payload_len + PROXY_CTL_HEADER_SIZE;
+	proxy_ctl_msg = calloc(len, sizeof(char));
+	if (! proxy_ctl_msg) {
+		abort();
 	}
+
+	set_big_endian_32((uint8_t*)proxy_ctl_msg + PROXY_CTL_HEADER_LENGTH_OFFSET,
+				(uint32_t)payload_len);
+	set_big_endian_32((uint8_t*)proxy_ctl_msg + PROXY_CTL_HEADER_FLAGS_OFFSET,
+				PROXY_FLAG_BINARY);
+	memcpy(proxy_ctl_msg + PROXY_CTL_HEADER_SIZE, payload, payload_len);
+
+	write_proxy_ctl_msg(fd, proxy_ctl_msg, len);
 	free(proxy_ctl_msg);
 }
 
+/*!
+ * Send the "winsize" command for the container process to cc-proxy
+ *
+ * \param shim \ref cc_shim
+ * \param ws Window size
+ */
+static void
+send_proxy_winsize(struct cc_shim *shim, const struct winsize *ws) {
+	uint8_t    payload[PROXY_BINARY_WINSIZE_SIZE];
+	char      *buf;
+
+	if (shim->proxy_binary) {
+		payload[0] = PROXY_BINARY_WINSIZE;
+		set_big_endian_64(payload + 1, shim->io_seq_no);
+		set_big_endian_16(payload + 9, ws->ws_row);
+		set_big_endian_16(payload + 11, ws->ws_col);
+		send_proxy_binary_message(shim->proxy_sock_fd, payload,
+				sizeof(payload));
+		return;
+	}
+
+	if (asprintf(&buf, "{\"seq\":%"PRIu64", \"row\":%d, \"column\":%d}",
+			shim->io_seq_no, ws->ws_row, ws->ws_col) == -1) {
+		abort();
+	}
+	send_proxy_hyper_message(shim->proxy_sock_fd, "winsize", buf);
+	free(buf);
+}
+
+/*!
+ * Send the "killcontainer" command for the container to cc-proxy
+ *
+ * \param shim \ref cc_shim
+ * \param sig Signal to send
+ */
+static void
+send_proxy_killcontainer(struct cc_shim *shim, int sig) {
+	uint8_t   *payload;
+	size_t     id_len;
+	char      *buf;
+
+	if (shim->proxy_binary) {
+		id_len = strlen(shim->container_id);
+		payload = calloc(5 + id_len, sizeof(uint8_t));
+		if (! payload) {
+			abort();
+		}
+		payload[0] = PROXY_BINARY_KILLCONTAINER;
+		set_big_endian_32(payload + 1, (uint32_t)sig);
+		memcpy(payload + 5, shim->container_id, id_len);
+		send_proxy_binary_message(shim->proxy_sock_fd, payload,
+				5 + id_len);
+		free(payload);
+		return;
+	}
+
+	if (asprintf(&buf, "{\"container\":\"%s\", \"signal\":%d}",
+			shim->container_id, sig) == -1) {
+		abort();
+	}
+	send_proxy_hyper_message(shim->proxy_sock_fd, "killcontainer", buf);
+	free(buf);
+}
+
 /*!
  * Read signals received and send message in the hyperstart protocol
  * format to the proxy ctl socket.
@@ -230,11 +341,7 @@ send_proxy_hyper_message(int fd, const char *hyper_cmd, const char *json) {
 void
 handle_signals(struct cc_shim *shim) {
 	int                sig;
-	char              *buf;
-	int                ret;
-	char              *cmd = NULL;
 	struct winsize     ws;
-	static char*       cmds[] = { "winsize", "killcontainer"};
 
 	if ( !(shim && shim->container_id) || shim->proxy_sock_fd < 0) {
 		return;
@@ -243,29 +350,19 @@ handle_signals(struct cc_shim *shim) {
 	while (read(signal_pipe_fd[0], &sig, sizeof(sig)) != -1) {
 		shim_debug("Handling signal : %d on fd %d\n", sig, signal_pipe_fd[0]);
 		if (sig == SIGWINCH ) {
-			cmd = cmds[0];
 			if (ioctl(STDIN_FILENO, TIOCGWINSZ, &ws) == -1) {
 				shim_warning("Error getting the current window size: %s\n",
 					strerror(errno));
 				continue;
 			}
-			ret = asprintf(&buf, "{\"seq\":%"PRIu64", \"row\":%d, \"col\":%d}",
-					shim->io_seq_no, ws.ws_row, ws.ws_col);
+			send_proxy_winsize(shim, &ws);
 			shim_debug("handled SIGWINCH for container %s (row=%d, col=%d)\n",
 				shim->container_id, ws.ws_row, ws.ws_col);
 
 		} else {
-			cmd = cmds[1];
-			ret = asprintf(&buf, "{\"container\":\"%s\", \"signal\":%d}",
-                                                        shim->container_id, sig);
+			send_proxy_killcontainer(shim, sig);
 			shim_debug("Killed container %s with signal %d\n", shim->container_id, sig);
 		}
-		if (ret == -1) {
-			abort();
-		}
-
-		send_proxy_hyper_message(shim->proxy_sock_fd, cmd, buf);
-		free(buf);
         }
 }
 
@@ -491,6 +588,7 @@ handle_proxy_ctl(struct cc_shim *shim)
 {
 	char buf[LINE_MAX] = { 0 };
 	ssize_t ret;
+	uint32_t flags;
 
 	if (! shim) {
 		return;
@@ -505,6 +603,27 @@ handle_proxy_ctl(struct cc_shim *shim)
 		exit(EXIT_FAILURE);
 	}
 
+	if (ret < PROXY_CTL_HEADER_SIZE) {
+		shim_warning("Short read on the proxy ctl socket\n");
+		return;
+	}
+
+	flags = get_big_endian_32((uint8_t*)buf + PROXY_CTL_HEADER_FLAGS_OFFSET);
+	if ((flags & PROXY_FLAG_BINARY_SUPPORTED) && ! shim->proxy_binary) {
+		shim_debug("Proxy supports binary requests\n");
+		shim->proxy_binary = true;
+	}
+
+	if (flags & PROXY_FLAG_BINARY) {
+		/* status byte: 0 on success, 1 followed by an error message */
+		if (ret > PROXY_CTL_HEADER_SIZE && buf[PROXY_CTL_HEADER_SIZE] != 0) {
+			shim_warning("Proxy error: %s\n", buf + PROXY_CTL_HEADER_SIZE + 1);
+		} else {
+			shim_debug("Proxy response: success\n");
+		}
+		return;
+	}
+
 	//TODO: Parse the json and log error responses explicitly
 	shim_debug("Proxy response:%s\n", buf + PROXY_CTL_HEADER_SIZE);
 }
@@ -556,6 +675,7 @@ main(int argc, char **argv)
 		.io_seq_no      =  0,
 		.err_seq_no     =  0,
 		.exiting        =  false,
+		.proxy_binary   =  false,
 	};
 	struct pollfd      poll_fds[MAX_POLL_FDS] = {{-1}};
 	nfds_t             nfds = 0;
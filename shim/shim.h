@@ -27,6 +27,7 @@ struct cc_shim {
 	uint64_t    io_seq_no;
 	uint64_t    err_seq_no;
 	bool        exiting;
+	bool        proxy_binary;	/* proxy accepts binary requests */
 };
 
 /*
@@ -47,8 +48,29 @@ struct cc_shim {
 #define STREAM_HEADER_SIZE              12
 #define STREAM_HEADER_LENGTH_OFFSET     8
 
+/*
+ * proxy ctl message format
+ * | length  | flags   | payload (length)        |
+ * | . . . . | . . . . | . . . . . . . . . . . . |
+ * 0         4         8                         length + 8
+ */
 #define PROXY_CTL_HEADER_SIZE           8
 #define PROXY_CTL_HEADER_LENGTH_OFFSET  0
+#define PROXY_CTL_HEADER_FLAGS_OFFSET   4
+
+/* Payload uses the binary encoding rather than JSON */
+#define PROXY_FLAG_BINARY               (1U << 0)
+/* Set by the proxy on its responses when it accepts binary requests */
+#define PROXY_FLAG_BINARY_SUPPORTED     (1U << 1)
+
+/*
+ * binary requests (first payload byte), see proxy/api/binary.go
+ * | op | seq (8) | row (2) | column (2) |
+ * | op | signal (4) | container id      |
+ */
+#define PROXY_BINARY_WINSIZE            2
+#define PROXY_BINARY_WINSIZE_SIZE       13
+#define PROXY_BINARY_KILLCONTAINER      3
 
 /*
  * Hyperstart is limited to sending this number of bytes to
@@ -96,6 +96,19 @@ set_fd_nonblocking(int fd)
 	return true;
 }
 
+/*!
+ * Store 16 bit value as big endian in buffer
+ *
+ * \param buf Buffer to store the value in
+ * \param val 16 bit value to be converted to big endian
+ */
+void
+set_big_endian_16(uint8_t *buf, uint16_t val)
+{
+        buf[0] = (uint8_t)(val >> 8);
+        buf[1] = (uint8_t)val;
+}
+
 /*!
  * Store integer as big endian in buffer
  *
@@ -19,6 +19,7 @@
 extern int shim_signal_table[];
 
 bool set_fd_nonblocking(int fd);
+void set_big_endian_16(uint8_t *buf, uint16_t val);
 void set_big_endian_32(uint8_t *buf, uint32_t val);
 uint32_t get_big_endian_32(const uint8_t *buf);
 void set_big_endian_64(uint8_t *buf, uint64_t val);
@@ -77,3 +77,30 @@ cc_oci_annotations_to_json (const struct cc_oci_config *config)
         return obj;
 }
 
+/*!
+ * Find the value of an annotation.
+ *
+ * \param annotations List of \ref oci_cfg_annotation.
+ * \param key Annotation to look for.
+ *
+ * \return Value of the annotation, or \c NULL if not found.
+ */
+const gchar *
+cc_oci_annotation_get (GSList *annotations, const gchar *key)
+{
+	GSList *l;
+
+	if (! key) {
+		return NULL;
+	}
+
+	for (l = annotations; l; l = g_slist_next (l)) {
+		struct oci_cfg_annotation *a = l->data;
+
+		if (a && ! g_strcmp0 (a->key, key)) {
+			return a->value;
+		}
+	}
+
+	return NULL;
+}
@@ -32,5 +32,6 @@
 
 void cc_oci_annotations_free_all (GSList *annotations);
 JsonObject *cc_oci_annotations_to_json (const struct cc_oci_config *config);
+const gchar *cc_oci_annotation_get (GSList *annotations, const gchar *key);
 
 #endif /* _CC_OCI_ANNOTATION_H */
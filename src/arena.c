@@ -0,0 +1,214 @@
+/*
+ * This file is part of cc-oci-runtime.
+ *
+ * Copyright (C) 2016 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/**
+ * \file
+ *
+ * Arena allocation.
+ *
+ * Objects built from many small allocations that all share the same
+ * lifetime (such as the tree of a parsed JSON document) are allocated
+ * from an arena, so that building them is a pointer bump and freeing
+ * them a handful of \c g_free() calls.
+ */
+
+#include <string.h>
+
+#include <glib.h>
+
+#include "arena.h"
+
+/** Alignment of the memory returned by cc_oci_arena_alloc(). */
+#define CC_OCI_ARENA_ALIGN (2 * sizeof (gpointer))
+
+/** Block of memory allocations are carved from. */
+struct cc_oci_arena_block {
+	/** Previously allocated block. */
+	struct cc_oci_arena_block *next;
+
+	/** Bytes available in \ref data. */
+	gsize size;
+
+	/** Bytes of \ref data already allocated. */
+	gsize used;
+
+	/** Memory handed out (aligned to \ref CC_OCI_ARENA_ALIGN). */
+	guint8 data[] __attribute__ ((aligned (16)));
+};
+
+/*!
+ * Create an arena.
+ *
+ * \param block_size Size of the blocks to allocate from
+ *   (\c 0 for \ref CC_OCI_ARENA_BLOCK_SIZE).
+ *
+ * \return Newly-allocated arena.
+ */
+struct cc_oci_arena *
+cc_oci_arena_new (gsize block_size)
+{
+	struct cc_oci_arena *arena;
+
+	arena = g_new0 (struct cc_oci_arena, 1);
+	arena->block_size = block_size ? block_size
+		: CC_OCI_ARENA_BLOCK_SIZE;
+
+	return arena;
+}
+
+/*!
+ * Add a block to an arena.
+ *
+ * \param arena \ref cc_oci_arena.
+ * \param size Minimum size of the block.
+ *
+ * \return The new block.
+ */
+static struct cc_oci_arena_block *
+cc_oci_arena_block_new (struct cc_oci_arena *arena, gsize size)
+{
+	struct cc_oci_arena_block *block;
+
+	block = g_malloc (sizeof (struct cc_oci_arena_block) + size);
+	block->size = size;
+	block->used = 0;
+
+	if (arena->blocks && size > arena->block_size) {
+		/* Oversized allocations get a block of their own,
+		 * so keep allocating from the current block.
+		 */
+		block->next = arena->blocks->next;
+		arena->blocks->next = block;
+	} else {
+		block->next = arena->blocks;
+		arena->blocks = block;
+	}
+
+	return block;
+}
+
+/*!
+ * Allocate memory from an arena.
+ *
+ * The memory is valid until \p arena is freed.
+ *
+ * \param arena \ref cc_oci_arena.
+ * \param size Number of bytes to allocate.
+ *
+ * \return Uninitialised memory, or \c NULL if \p arena is \c NULL.
+ */
+gpointer
+cc_oci_arena_alloc (struct cc_oci_arena *arena, gsize size)
+{
+	struct cc_oci_arena_block *block;
+	gpointer                   mem;
+
+	if (! arena) {
+		return NULL;
+	}
+
+	size = (size + CC_OCI_ARENA_ALIGN - 1) & ~(CC_OCI_ARENA_ALIGN - 1);
+	if (! size) {
+		size = CC_OCI_ARENA_ALIGN;
+	}
+
+	block = arena->blocks;
+	if (! block || block->size - block->used < size) {
+		block = cc_oci_arena_block_new (arena,
+				MAX (size, arena->block_size));
+	}
+
+	mem = block->data + block->used;
+	block->used += size;
+
+	return mem;
+}
+
+/*!
+ * Allocate zeroed memory from an arena.
+ *
+ * \param arena \ref cc_oci_arena.
+ * \param size Number of bytes to allocate.
+ *
+ * \return Zeroed memory, or \c NULL if \p arena is \c NULL.
+ */
+gpointer
+cc_oci_arena_alloc0 (struct cc_oci_arena *arena, gsize size)
+{
+	gpointer mem;
+
+	mem = cc_oci_arena_alloc (arena, size);
+	if (mem) {
+		memset (mem, 0, size);
+	}
+
+	return mem;
+}
+
+/*!
+ * Duplicate a string into an arena.
+ *
+ * \param arena \ref cc_oci_arena.
+ * \param str String to copy.
+ *
+ * \return Copy of \p str, or \c NULL if \p str or \p arena is \c NULL.
+ */
+gchar *
+cc_oci_arena_strdup (struct cc_oci_arena *arena, const gchar *str)
+{
+	gchar  *copy;
+	gsize   len;
+
+	if (! str) {
+		return NULL;
+	}
+
+	len = strlen (str) + 1;
+
+	copy = cc_oci_arena_alloc (arena, len);
+	if (copy) {
+		memcpy (copy, str, len);
+	}
+
+	return copy;
+}
+
+/*!
+ * Free an arena and all the memory allocated from it.
+ *
+ * \param arena \ref cc_oci_arena.
+ */
+void
+cc_oci_arena_free (struct cc_oci_arena *arena)
+{
+	struct cc_oci_arena_block *block;
+
+	if (! arena) {
+		return;
+	}
+
+	while (arena->blocks) {
+		block = arena->blocks;
+		arena->blocks = block->next;
+		g_free (block);
+	}
+
+	g_free (arena);
+}
@@ -0,0 +1,49 @@
+/*
+ * This file is part of cc-oci-runtime.
+ *
+ * Copyright (C) 2016 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef _CC_OCI_ARENA_H
+#define _CC_OCI_ARENA_H
+
+#include <glib.h>
+
+/** Default size of the blocks an arena allocates from. */
+#define CC_OCI_ARENA_BLOCK_SIZE 8192
+
+struct cc_oci_arena_block;
+
+/**
+ * Bump allocator: memory is handed out from large blocks and only
+ * released, all at once, by cc_oci_arena_free().
+ */
+struct cc_oci_arena {
+	/** Block currently allocated from (most recent first). */
+	struct cc_oci_arena_block *blocks;
+
+	/** Size of the blocks allocated. */
+	gsize block_size;
+};
+
+struct cc_oci_arena *cc_oci_arena_new (gsize block_size);
+gpointer cc_oci_arena_alloc (struct cc_oci_arena *arena, gsize size);
+gpointer cc_oci_arena_alloc0 (struct cc_oci_arena *arena, gsize size);
+gchar *cc_oci_arena_strdup (struct cc_oci_arena *arena, const gchar *str);
+void cc_oci_arena_free (struct cc_oci_arena *arena);
+
+#endif /* _CC_OCI_ARENA_H */
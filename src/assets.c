@@ -0,0 +1,410 @@
+/*
+ * This file is part of cc-oci-runtime.
+ *
+ * Copyright (C) 2016 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/**
+ * \file
+ *
+ * Host asset registry.
+ *
+ * The first VMs launched after the host boots (or after the page cache
+ * has been dropped) fault the hypervisor, kernel and image in from
+ * disk. To avoid this, the "prewarm" command reads the assets into
+ * the page cache, ahead of the first launch, and records them in \ref
+ * CC_OCI_ASSETS_FILE. Since that file lives on a tmpfs, it is empty
+ * again after a reboot. Later runs skip the assets found in the
+ * registry, unless they have changed or some of their pages have been
+ * evicted from the page cache since.
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <glib.h>
+#include <json-glib/json-glib.h>
+
+#include "common.h"
+#include "oci.h"
+#include "util.h"
+#include "assets.h"
+
+/** Size of the buffer assets are read into. */
+#define CC_OCI_ASSET_READ_CHUNK (1024 * 1024)
+
+/*!
+ * Determine the identity of an asset.
+ *
+ * \param path Full path to the asset.
+ * \param[out] asset \ref cc_oci_asset.
+ *
+ * \return \c true on success, else \c false.
+ */
+gboolean
+cc_oci_asset_get (const gchar *path, struct cc_oci_asset *asset)
+{
+	struct stat st;
+
+	if (! (path && *path && asset)) {
+		return false;
+	}
+
+	if (stat (path, &st) < 0) {
+		return false;
+	}
+
+	asset->path = path;
+	asset->dev = (guint64)st.st_dev;
+	asset->ino = (guint64)st.st_ino;
+	asset->size = (guint64)st.st_size;
+	asset->mtime = (gint64)st.st_mtim.tv_sec * G_GINT64_CONSTANT (1000000000)
+		+ st.st_mtim.tv_nsec;
+
+	return true;
+}
+
+/*!
+ * Load an asset into the page cache.
+ *
+ * The asset is read in full (the data is discarded), so it is in the
+ * page cache on return. Read-ahead requests would only be hints the
+ * kernel is free to drop.
+ *
+ * \param asset \ref cc_oci_asset.
+ *
+ * \return \c true on success, else \c false.
+ */
+gboolean
+cc_oci_asset_prewarm (const struct cc_oci_asset *asset)
+{
+	gboolean  ret = false;
+	guint8   *buf = NULL;
+	ssize_t   bytes;
+	int       fd;
+
+	if (! (asset && asset->path)) {
+		return false;
+	}
+
+	fd = open (asset->path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		g_debug ("failed to open %s: %s",
+				asset->path, strerror (errno));
+		return false;
+	}
+
+	/* allow the kernel to read ahead more aggressively */
+	(void)posix_fadvise (fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+	buf = g_malloc (CC_OCI_ASSET_READ_CHUNK);
+
+	do {
+		bytes = read (fd, buf, CC_OCI_ASSET_READ_CHUNK);
+	} while (bytes > 0 || (bytes < 0 && errno == EINTR));
+
+	if (bytes < 0) {
+		g_debug ("failed to read %s: %s",
+				asset->path, strerror (errno));
+		goto out;
+	}
+
+	ret = true;
+
+out:
+	g_free (buf);
+	close (fd);
+
+	return ret;
+}
+
+/*!
+ * Determine if an asset is fully in the page cache.
+ *
+ * \param asset \ref cc_oci_asset.
+ *
+ * \return \c true if all pages of the asset are resident, else
+ * \c false.
+ */
+gboolean
+cc_oci_asset_resident (const struct cc_oci_asset *asset)
+{
+	gboolean        ret = false;
+	unsigned char  *vec = NULL;
+	void           *addr = MAP_FAILED;
+	size_t          pages;
+	long            page_size;
+	int             fd;
+
+	if (! (asset && asset->path)) {
+		return false;
+	}
+
+	if (! asset->size) {
+		return true;
+	}
+
+	page_size = sysconf (_SC_PAGESIZE);
+	if (page_size <= 0) {
+		return false;
+	}
+
+	fd = open (asset->path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		return false;
+	}
+
+	/* mapping the file doesn't fault any of its pages in */
+	addr = mmap (NULL, (size_t)asset->size, PROT_READ, MAP_SHARED, fd, 0);
+	if (addr == MAP_FAILED) {
+		g_debug ("failed to map %s: %s",
+				asset->path, strerror (errno));
+		goto out;
+	}
+
+	pages = (size_t)((asset->size + (guint64)page_size - 1)
+			/ (guint64)page_size);
+	vec = g_malloc (pages);
+
+	if (mincore (addr, (size_t)asset->size, vec) < 0) {
+		g_debug ("failed to query residency of %s: %s",
+				asset->path, strerror (errno));
+		goto out;
+	}
+
+	for (size_t i = 0; i < pages; i++) {
+		if (! (vec[i] & 1)) {
+			goto out;
+		}
+	}
+
+	ret = true;
+
+out:
+	g_free (vec);
+	if (addr != MAP_FAILED) {
+		(void)munmap (addr, (size_t)asset->size);
+	}
+	close (fd);
+
+	return ret;
+}
+
+/*!
+ * Determine the path of \ref CC_OCI_ASSETS_FILE.
+ *
+ * \param config \ref cc_oci_config.
+ *
+ * \return Newly-allocated string on success, else \c NULL.
+ */
+gchar *
+cc_oci_assets_file_path (const struct cc_oci_config *config)
+{
+	if (! config) {
+		return NULL;
+	}
+
+	return g_build_path ("/",
+			config->root_dir ? config->root_dir
+			: CC_OCI_RUNTIME_DIR_PREFIX,
+			CC_OCI_ASSETS_FILE, NULL);
+}
+
+/*!
+ * Determine if an asset matches its registry entry.
+ *
+ * \param registry Registry object (may be \c NULL).
+ * \param asset \ref cc_oci_asset.
+ *
+ * \return \c true if the asset is unchanged since it was recorded,
+ * else \c false.
+ */
+private gboolean
+cc_oci_asset_registered (JsonObject *registry,
+		const struct cc_oci_asset *asset)
+{
+	const gchar *members[] = { "dev", "ino", "size", "mtime", NULL };
+	JsonObject  *entry;
+	JsonNode    *node;
+
+	if (! (registry && json_object_has_member (registry, asset->path))) {
+		return false;
+	}
+
+	node = json_object_get_member (registry, asset->path);
+	if (! JSON_NODE_HOLDS_OBJECT (node)) {
+		return false;
+	}
+
+	entry = json_node_get_object (node);
+
+	for (const gchar **p = members; *p; p++) {
+		if (! json_object_has_member (entry, *p)) {
+			return false;
+		}
+	}
+
+	return (guint64)json_object_get_int_member (entry, "dev") == asset->dev
+		&& (guint64)json_object_get_int_member (entry, "ino") == asset->ino
+		&& (guint64)json_object_get_int_member (entry, "size") == asset->size
+		&& json_object_get_int_member (entry, "mtime") == asset->mtime;
+}
+
+/*!
+ * Record an asset in the registry.
+ *
+ * \param registry Registry object.
+ * \param asset \ref cc_oci_asset.
+ */
+private void
+cc_oci_asset_register (JsonObject *registry,
+		const struct cc_oci_asset *asset)
+{
+	JsonObject *entry = json_object_new ();
+
+	json_object_set_int_member (entry, "dev", (gint64)asset->dev);
+	json_object_set_int_member (entry, "ino", (gint64)asset->ino);
+	json_object_set_int_member (entry, "size", (gint64)asset->size);
+	json_object_set_int_member (entry, "mtime", asset->mtime);
+
+	json_object_set_object_member (registry, asset->path, entry);
+}
+
+/*!
+ * Load \ref CC_OCI_ASSETS_FILE.
+ *
+ * \param path Full path to the registry.
+ *
+ * \return Registry object (empty if the file doesn't exist or isn't
+ * valid).
+ */
+private JsonObject *
+cc_oci_assets_load (const gchar *path)
+{
+	JsonParser  *parser;
+	JsonNode    *root;
+	JsonObject  *registry = NULL;
+
+	parser = json_parser_new ();
+
+	if (json_parser_load_from_file (parser, path, NULL)) {
+		root = json_parser_get_root (parser);
+		if (root && JSON_NODE_HOLDS_OBJECT (root)) {
+			registry = json_object_ref (json_node_get_object (root));
+		}
+	}
+
+	g_object_unref (parser);
+
+	return registry ? registry : json_object_new ();
+}
+
+/*!
+ * Prewarm the hypervisor, kernel and image of a VM.
+ *
+ * Assets that are in \ref CC_OCI_ASSETS_FILE, unchanged since they
+ * were recorded and still fully in the page cache are skipped, unless
+ * \p force is set.
+ *
+ * \param config \ref cc_oci_config.
+ * \param force If \c true, read all assets.
+ *
+ * \return \c true on success, else \c false.
+ */
+gboolean
+cc_oci_assets_prewarm (const struct cc_oci_config *config, gboolean force)
+{
+	struct cc_oci_asset  asset;
+	JsonObject          *registry = NULL;
+	g_autofree gchar    *path = NULL;
+	g_autofree gchar    *data = NULL;
+	gsize                len;
+	gboolean             changed = false;
+	gboolean             ret = false;
+
+	if (! (config && config->vm)) {
+		return false;
+	}
+
+	const struct {
+		const gchar *name;
+		const gchar *path;
+	} assets[] = {
+		{ "hypervisor", config->vm->hypervisor_path },
+		{ "kernel", config->vm->kernel_path },
+		{ "image", config->vm->image_path },
+	};
+
+	path = cc_oci_assets_file_path (config);
+	if (! path) {
+		return false;
+	}
+
+	registry = cc_oci_assets_load (path);
+
+	for (gsize i = 0; i < G_N_ELEMENTS (assets); i++) {
+		if (! assets[i].path) {
+			g_warning ("no VM %s configured", assets[i].name);
+			goto out;
+		}
+
+		if (! cc_oci_asset_get (assets[i].path, &asset)) {
+			g_warning ("failed to stat %s %s: %s",
+					assets[i].name, assets[i].path,
+					strerror (errno));
+			goto out;
+		}
+
+		if (! force && cc_oci_asset_registered (registry, &asset)
+				&& cc_oci_asset_resident (&asset)) {
+			continue;
+		}
+
+		g_debug ("prewarming %s %s", assets[i].name, asset.path);
+
+		if (! cc_oci_asset_prewarm (&asset)) {
+			goto out;
+		}
+
+		if (! cc_oci_asset_registered (registry, &asset)) {
+			cc_oci_asset_register (registry, &asset);
+			changed = true;
+		}
+	}
+
+	if (changed) {
+		data = cc_oci_json_obj_to_string (registry, false, &len);
+		if (! (data && cc_oci_file_write_atomic (path, data, len,
+						false, false))) {
+			goto out;
+		}
+	}
+
+	ret = true;
+
+out:
+	json_object_unref (registry);
+
+	return ret;
+}
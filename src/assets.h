@@ -0,0 +1,53 @@
+/*
+ * This file is part of cc-oci-runtime.
+ *
+ * Copyright (C) 2016 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef _CC_OCI_ASSETS_H
+#define _CC_OCI_ASSETS_H
+
+#include <glib.h>
+
+#include "oci.h"
+
+/** File below \ref CC_OCI_RUNTIME_DIR_PREFIX recording the assets
+ * already validated and prewarmed since the host booted.
+ */
+#define CC_OCI_ASSETS_FILE "assets.json"
+
+/** Identity of a host asset (hypervisor, kernel or image). */
+struct cc_oci_asset {
+	/** Full path to the asset. */
+	const gchar *path;
+
+	guint64      dev;
+	guint64      ino;
+	guint64      size;
+
+	/** Modification time in nanoseconds. */
+	gint64       mtime;
+};
+
+gboolean cc_oci_asset_get (const gchar *path, struct cc_oci_asset *asset);
+gboolean cc_oci_asset_prewarm (const struct cc_oci_asset *asset);
+gboolean cc_oci_asset_resident (const struct cc_oci_asset *asset);
+gchar *cc_oci_assets_file_path (const struct cc_oci_config *config);
+gboolean cc_oci_assets_prewarm (const struct cc_oci_config *config,
+		gboolean force);
+
+#endif /* _CC_OCI_ASSETS_H */
@@ -0,0 +1,395 @@
+/*
+ * This file is part of cc-oci-runtime.
+ *
+ * Copyright (C) 2016 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include <glib.h>
+
+#include "batch.h"
+#include "common.h"
+#include "oci.h"
+#include "state.h"
+#include "util.h"
+
+/*!
+ * Determine if a container has the specified annotation.
+ *
+ * \param annotations List of \ref oci_cfg_annotation.
+ * \param spec "key" or "key=value".
+ *
+ * \return \c true if an annotation with the key (and value if
+ * specified) exists, else \c false.
+ */
+private gboolean
+cc_oci_batch_annotation_match (GSList *annotations, const gchar *spec)
+{
+	const gchar  *value;
+	gsize         key_len;
+	GSList       *l;
+
+	g_assert (spec);
+
+	value = strchr (spec, '=');
+	key_len = value ? (gsize)(value - spec) : strlen (spec);
+	if (value) {
+		value++;
+	}
+
+	for (l = annotations; l; l = g_slist_next (l)) {
+		struct oci_cfg_annotation *a = l->data;
+
+		if (! (a && a->key)) {
+			continue;
+		}
+
+		if (strlen (a->key) != key_len ||
+				strncmp (a->key, spec, key_len)) {
+			continue;
+		}
+
+		if (! value || ! g_strcmp0 (a->value, value)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/*!
+ * Determine if a container id matches the selector.
+ *
+ * This only needs the name of the container directory, so allows
+ * containers to be skipped without reading their state file.
+ *
+ * \param id Container id.
+ * \param selector \ref cc_oci_batch_selector.
+ *
+ * \return \c true if the container may be selected, else \c false.
+ */
+gboolean
+cc_oci_batch_id_match (const gchar *id,
+		const struct cc_oci_batch_selector *selector)
+{
+	g_assert (id);
+	g_assert (selector);
+
+	if (selector->id_prefix && ! g_str_has_prefix (id,
+				selector->id_prefix)) {
+		return false;
+	}
+
+	return true;
+}
+
+/*!
+ * Determine if a directory in the runtime root holds a container
+ * without reading its state.
+ *
+ * \param dirname Runtime root directory.
+ * \param name Name of the directory.
+ *
+ * \return \c true if \p name has a \ref CC_OCI_STATE_FILE,
+ * else \c false.
+ */
+gboolean
+cc_oci_batch_state_exists (const gchar *dirname, const gchar *name)
+{
+	g_autofree gchar *path = NULL;
+
+	g_assert (dirname);
+	g_assert (name);
+
+	path = g_build_path ("/", dirname, name, CC_OCI_STATE_FILE, NULL);
+
+	return g_file_test (path, G_FILE_TEST_EXISTS);
+}
+
+/*!
+ * Determine if the selector needs the state of containers.
+ *
+ * \param selector \ref cc_oci_batch_selector.
+ *
+ * \return \c true if \ref cc_oci_batch_state_match must be called
+ * to select a container, else \c false.
+ */
+gboolean
+cc_oci_batch_selector_needs_state
+	(const struct cc_oci_batch_selector *selector)
+{
+	g_assert (selector);
+
+	return selector->status != OCI_STATUS_INVALID ||
+		(selector->annotations && *selector->annotations);
+}
+
+/*!
+ * Determine if a container matches the selector.
+ *
+ * As for \ref cc_oci_list, a VM that has exited is matched as
+ * \ref OCI_STATUS_STOPPED, whatever status its state file records.
+ *
+ * \param state \ref oci_state of the container.
+ * \param selector \ref cc_oci_batch_selector.
+ *
+ * \return \c true if the container should be selected, else \c false.
+ */
+gboolean
+cc_oci_batch_state_match (const struct oci_state *state,
+		const struct cc_oci_batch_selector *selector)
+{
+	enum oci_status   status;
+	gchar           **spec;
+
+	g_assert (state);
+	g_assert (selector);
+
+	if (selector->status != OCI_STATUS_INVALID) {
+		status = cc_oci_vm_running (state) ? state->status
+			: OCI_STATUS_STOPPED;
+
+		if (status != selector->status) {
+			return false;
+		}
+	}
+
+	for (spec = selector->annotations; spec && *spec; spec++) {
+		if (! cc_oci_batch_annotation_match (state->annotations,
+					*spec)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*!
+ * Find the containers matching the selector.
+ *
+ * Containers may disappear as this function runs so, as for
+ * \ref cc_oci_list, unreadable state files are silently skipped.
+ * State files are only read if the selector filters on status or
+ * annotations.
+ *
+ * \param root_dir Runtime root directory (or \c NULL for the default).
+ * \param selector \ref cc_oci_batch_selector.
+ *
+ * \return Sorted list of container IDs (to be freed with
+ * \c g_slist_free_full(ids, g_free)), or \c NULL if no container
+ * matches.
+ */
+GSList *
+cc_oci_batch_select (const gchar *root_dir,
+		const struct cc_oci_batch_selector *selector)
+{
+	GDir              *dir;
+	const gchar       *dirname;
+	const gchar       *name;
+	GSList            *ids = NULL;
+	struct oci_state  *state;
+	gboolean           need_state;
+
+	if (! selector) {
+		return NULL;
+	}
+
+	need_state = cc_oci_batch_selector_needs_state (selector);
+
+	dirname = root_dir ? root_dir : CC_OCI_RUNTIME_DIR_PREFIX;
+
+	dir = g_dir_open (dirname, 0x0, NULL);
+	if (! dir) {
+		/* No containers yet, so not an error */
+		return NULL;
+	}
+
+	while ((name = g_dir_read_name (dir)) != NULL) {
+		gchar *path;
+		gboolean ret;
+
+		if (! cc_oci_batch_id_match (name, selector)) {
+			continue;
+		}
+
+		if (! need_state) {
+			if (cc_oci_batch_state_exists (dirname, name)) {
+				ids = g_slist_insert_sorted (ids,
+						g_strdup (name),
+						(GCompareFunc)g_strcmp0);
+			}
+			continue;
+		}
+
+		path = g_build_path ("/", dirname, name, NULL);
+		ret = g_file_test (path, G_FILE_TEST_IS_DIR);
+		g_free (path);
+
+		if (! ret) {
+			continue;
+		}
+
+		state = cc_oci_vm_get_state (name, dirname);
+		if (! state) {
+			continue;
+		}
+
+		if (cc_oci_batch_state_match (state, selector)) {
+			ids = g_slist_insert_sorted (ids, g_strdup (name),
+					(GCompareFunc)g_strcmp0);
+		}
+
+		cc_oci_state_free (state);
+	}
+
+	g_dir_close (dir);
+
+	return ids;
+}
+
+/*!
+ * Wait for a batch worker to finish.
+ *
+ * \param[out] failed Incremented if the worker failed.
+ *
+ * \return \c true if a worker was reaped, else \c false.
+ */
+private gboolean
+cc_oci_batch_reap (guint *failed)
+{
+	pid_t  pid;
+	int    status;
+
+	g_assert (failed);
+
+	do {
+		pid = waitpid (-1, &status, 0);
+	} while (pid < 0 && errno == EINTR);
+
+	if (pid < 0) {
+		g_critical ("failed to wait for batch worker: %s",
+				strerror (errno));
+		return false;
+	}
+
+	if (! (WIFEXITED (status) && WEXITSTATUS (status) == 0)) {
+		(*failed)++;
+	}
+
+	return true;
+}
+
+/*!
+ * Run an operation on several containers, at most \p jobs at a time.
+ *
+ * Each container is handled by a forked worker: the runtime's main
+ * loop, hook and QMP handling aren't thread-safe, but forking still
+ * saves the exec, argument parsing and logging setup of a runtime
+ * invocation per container.
+ *
+ * \param config \ref cc_oci_config of the runtime invocation.
+ * \param ids List of container IDs.
+ * \param jobs Maximum number of concurrent workers
+ *   (\c 0 for \ref CC_OCI_BATCH_DEFAULT_JOBS).
+ * \param func Operation to run on each container.
+ * \param user_data Data to pass to \p func.
+ *
+ * \return \c true if \p func succeeded for all containers,
+ * else \c false.
+ */
+gboolean
+cc_oci_batch_run (const struct cc_oci_config *config,
+		GSList *ids, guint jobs,
+		cc_oci_batch_func func, gpointer user_data)
+{
+	GSList  *l;
+	guint    running = 0;
+	guint    failed = 0;
+	guint    total = 0;
+
+	if (! (config && func)) {
+		return false;
+	}
+
+	if (! jobs) {
+		jobs = CC_OCI_BATCH_DEFAULT_JOBS;
+	}
+
+	for (l = ids; l; l = g_slist_next (l)) {
+		pid_t pid;
+
+		total++;
+
+		if (running == jobs) {
+			if (! cc_oci_batch_reap (&failed)) {
+				return false;
+			}
+			running--;
+		}
+
+		/* don't let workers duplicate pending output */
+		fflush (NULL);
+
+		pid = fork ();
+		if (pid < 0) {
+			g_critical ("failed to fork batch worker "
+					"for container %s: %s",
+					(const gchar *)l->data,
+					strerror (errno));
+			failed++;
+			continue;
+		}
+
+		if (! pid) {
+			struct cc_oci_config  worker_config = { { 0 } };
+			gboolean              ret;
+
+			worker_config.root_dir = g_strdup (config->root_dir);
+			worker_config.state.sync = config->state.sync;
+			worker_config.optarg_container_id = l->data;
+
+			ret = func (&worker_config, user_data);
+
+			fflush (NULL);
+			_exit (ret ? EXIT_SUCCESS : EXIT_FAILURE);
+		}
+
+		running++;
+	}
+
+	while (running) {
+		if (! cc_oci_batch_reap (&failed)) {
+			return false;
+		}
+		running--;
+	}
+
+	if (failed) {
+		g_critical ("failed to handle %u of %u containers",
+				failed, total);
+		return false;
+	}
+
+	return true;
+}
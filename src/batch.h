@@ -0,0 +1,78 @@
+/*
+ * This file is part of cc-oci-runtime.
+ *
+ * Copyright (C) 2016 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef _CC_OCI_BATCH_H
+#define _CC_OCI_BATCH_H
+
+#include <glib.h>
+
+#include "oci.h"
+
+/** Default maximum number of containers a batch handles concurrently. */
+#define CC_OCI_BATCH_DEFAULT_JOBS	8
+
+/** Criteria used to select the containers a batch operates on. */
+struct cc_oci_batch_selector {
+	/** If \c true, select all containers. */
+	gboolean          all;
+
+	/** Only select containers in this state
+	 * (\ref OCI_STATUS_INVALID for any state).
+	 */
+	enum oci_status   status;
+
+	/** \c NULL-terminated array of "key" or "key=value"
+	 * annotations selected containers must all have (or \c NULL).
+	 */
+	gchar           **annotations;
+
+	/** Only select containers whose id starts with this
+	 * string (or \c NULL).
+	 */
+	gchar            *id_prefix;
+};
+
+/*!
+ * Operation a batch runs for each container.
+ *
+ * \param config \ref cc_oci_config for the container, with only
+ *   \c root_dir, \c state.sync and \c optarg_container_id set.
+ * \param user_data Data passed to \ref cc_oci_batch_run.
+ *
+ * \return \c true on success, else \c false.
+ */
+typedef gboolean (*cc_oci_batch_func) (struct cc_oci_config *config,
+		gpointer user_data);
+
+gboolean cc_oci_batch_state_exists (const gchar *dirname,
+		const gchar *name);
+gboolean cc_oci_batch_id_match (const gchar *id,
+		const struct cc_oci_batch_selector *selector);
+gboolean cc_oci_batch_state_match (const struct oci_state *state,
+		const struct cc_oci_batch_selector *selector);
+gboolean cc_oci_batch_selector_needs_state
+		(const struct cc_oci_batch_selector *selector);
+GSList *cc_oci_batch_select (const gchar *root_dir,
+		const struct cc_oci_batch_selector *selector);
+gboolean cc_oci_batch_run (const struct cc_oci_config *config,
+		GSList *ids, guint jobs,
+		cc_oci_batch_func func, gpointer user_data);
+
+#endif /* _CC_OCI_BATCH_H */
@@ -24,16 +24,51 @@
 #include "config.h"
 #include "state.h"
 #include "oci-config.h"
+#include "batch.h"
 
 #include <glib/gstdio.h>
 
 extern struct start_data start_data;
 
+struct batch_data batch_data;
+
+/** Options of sub-commands able to operate on several containers. */
+GOptionEntry options_batch[] =
+{
+	{
+		"all-containers", 0, G_OPTION_FLAG_NONE,
+		G_OPTION_ARG_NONE, &batch_data.all,
+		"operate on all containers", NULL
+	},
+	{
+		"status", 0, G_OPTION_FLAG_NONE,
+		G_OPTION_ARG_STRING, &batch_data.status,
+		"operate on all containers in the specified state",
+		"STATUS"
+	},
+	{
+		"annotation", 0, G_OPTION_FLAG_NONE,
+		G_OPTION_ARG_STRING_ARRAY, &batch_data.annotations,
+		"operate on all containers with the specified annotation "
+		"(may be repeated)",
+		"KEY[=VALUE]"
+	},
+	{
+		"jobs", 'j', G_OPTION_FLAG_NONE,
+		G_OPTION_ARG_INT, &batch_data.jobs,
+		"maximum number of containers to handle concurrently",
+		"N"
+	},
+
+	{NULL}
+};
+
 struct subcommand *subcommands[] =
 {
 	&command_attach,
 	&command_checkpoint,
 	&command_create,
+	&command_daemon,
 	&command_delete,
 	&command_events,
 	&command_exec,
@@ -41,6 +76,7 @@ struct subcommand *subcommands[] =
 	&command_kill,
 	&command_list,
 	&command_pause,
+	&command_prewarm,
 	&command_ps,
 	&command_restore,
 	&command_resume,
@@ -56,50 +92,143 @@ struct subcommand *subcommands[] =
 };
 
 /**
- * List of spec handlers used to process config on stop
+ * Spec handlers used to process config on stop
  */
-static struct spec_handler *stop_spec_handlers[] = {
-	&hooks_spec_handler,
-
-	/* terminator */
-	NULL
+static struct spec_handler *stop_spec_handlers[SPEC_SECTIONS] = {
+	[SPEC_HOOKS] = &hooks_spec_handler,
 };
 
 /*!
- * Handle commands to toggle the state of the Hypervisor
- * (between paused and running).
+ * Determine if containers are to be selected with \ref options_batch
+ * rather than by container id.
+ *
+ * \return \c true if a selector option was specified, else \c false.
+ */
+gboolean
+handle_batch_selector_set (void)
+{
+	return batch_data.all || batch_data.status || batch_data.annotations;
+}
+
+/*!
+ * Handle sub-commands able to operate on several containers.
+ *
+ * A single container id is handled in-process, exactly like
+ * sub-commands operating on a single container. Several container ids,
+ * or the containers matching the \ref options_batch selector options,
+ * are handled by \ref cc_oci_batch_run.
  *
  * \param sub \ref subcommand.
  * \param config \ref cc_oci_config.
- * \param argc Argument count.
- * \param argv Argument vector.
- * \param pause If \c true, pause the VM, else resume it.
+ * \param argc Argument count (container ids only).
+ * \param argv Argument vector (container ids only).
+ * \param extra See \ref handle_default_usage.
+ * \param func Operation to run on each container.
+ * \param user_data Data to pass to \p func.
  *
  * \return \c true on success, else \c false.
  */
 gboolean
-handle_command_toggle (const struct subcommand *sub,
+handle_command_batch (const struct subcommand *sub,
 		struct cc_oci_config *config,
-		int argc, char *argv[], gboolean pause)
+		int argc, char *argv[], const char *extra,
+		cc_oci_batch_func func, gpointer user_data)
+{
+	struct cc_oci_batch_selector  selector = { 0 };
+	GSList                       *ids = NULL;
+	gboolean                      ret = false;
+
+	g_assert (sub);
+	g_assert (config);
+	g_assert (func);
+
+	selector.status = OCI_STATUS_INVALID;
+
+	if (batch_data.jobs < 0) {
+		g_critical ("invalid number of jobs: %d", batch_data.jobs);
+		goto out;
+	}
+
+	if (! handle_batch_selector_set ()) {
+		if (handle_default_usage (argc, argv, sub->name,
+					&ret, 1, extra)) {
+			goto out;
+		}
+
+		if (argc == 1) {
+			/* Used to allow us to find the state file */
+			config->optarg_container_id = argv[0];
+
+			ret = func (config, user_data);
+			goto out;
+		}
+
+		for (int i = argc - 1; i >= 0; i--) {
+			ids = g_slist_prepend (ids, g_strdup (argv[i]));
+		}
+	} else {
+		if (argc) {
+			g_critical ("container ids cannot be specified "
+					"with --all-containers, --status "
+					"or --annotation");
+			goto out;
+		}
+
+		if (batch_data.status) {
+			selector.status = cc_oci_str_to_status (batch_data.status);
+			if (selector.status == OCI_STATUS_INVALID) {
+				g_critical ("invalid status: %s",
+						batch_data.status);
+				goto out;
+			}
+		}
+
+		selector.all = batch_data.all;
+		selector.annotations = batch_data.annotations;
+
+		ids = cc_oci_batch_select (config->root_dir, &selector);
+		if (! ids) {
+			g_message ("no containers selected");
+			ret = true;
+			goto out;
+		}
+	}
+
+	ret = cc_oci_batch_run (config, ids, (guint)batch_data.jobs,
+			func, user_data);
+
+out:
+	g_slist_free_full (ids, g_free);
+	g_free_if_set (batch_data.status);
+	g_strfreev (batch_data.annotations);
+	batch_data.status = NULL;
+	batch_data.annotations = NULL;
+
+	return ret;
+}
+
+/*!
+ * Toggle the state of the Hypervisor of a single container
+ * (\ref cc_oci_batch_func).
+ *
+ * \param config \ref cc_oci_config.
+ * \param user_data If non-zero, pause the VM, else resume it.
+ *
+ * \return \c true on success, else \c false.
+ */
+static gboolean
+toggle_container (struct cc_oci_config *config, gpointer user_data)
 {
 	struct oci_state      *state = NULL;
 	gchar                 *config_file = NULL;
 	gboolean               ret;
+	gboolean               pause = GPOINTER_TO_INT (user_data);
 	const gchar           *action;
 
-	g_assert (sub);
 	g_assert (config);
 
 	action = pause ? "pause" : "resume";
 
-	if (handle_default_usage (argc, argv, sub->name,
-				&ret, 1, NULL)) {
-		return ret;
-	}
-
-	/* Used to allow us to find the state file */
-	config->optarg_container_id = argv[0];
-
 	ret = cc_oci_get_config_and_state (&config_file, config, &state);
 	if (! ret) {
 		goto out;
@@ -135,35 +264,50 @@ out:
 }
 
 /*!
- * Handle commands to stop the Hypervisor cleanly.
+ * Handle commands to toggle the state of the Hypervisor
+ * (between paused and running).
  *
  * \param sub \ref subcommand.
  * \param config \ref cc_oci_config.
  * \param argc Argument count.
  * \param argv Argument vector.
+ * \param pause If \c true, pause the VM, else resume it.
  *
  * \return \c true on success, else \c false.
  */
 gboolean
-handle_command_stop (const struct subcommand *sub,
+handle_command_toggle (const struct subcommand *sub,
 		struct cc_oci_config *config,
-		int argc, char *argv[])
+		int argc, char *argv[], gboolean pause)
+{
+	g_assert (sub);
+	g_assert (config);
+
+	return handle_command_batch (sub, config, argc, argv, NULL,
+			toggle_container, GINT_TO_POINTER (pause));
+}
+
+/*!
+ * Stop the Hypervisor of a single container cleanly
+ * (\ref cc_oci_batch_func).
+ *
+ * \param config \ref cc_oci_config.
+ * \param user_data Unused.
+ *
+ * \return \c true on success, else \c false.
+ */
+static gboolean
+stop_container (struct cc_oci_config *config,
+		gpointer user_data)
 {
 	struct oci_state  *state = NULL;
 	gchar             *config_file = NULL;
 	gboolean           ret;
 	GNode*             root = NULL;
 
-	g_assert (sub);
 	g_assert (config);
 
-	if (handle_default_usage (argc, argv, sub->name,
-				&ret, 1, NULL)) {
-		return ret;
-	}
-
-	/* Used to allow us to find the state file */
-	config->optarg_container_id = argv[0];
+	(void)user_data;
 
 	/* FIXME: deal with containerd calling "delete" twice */
 	if (! cc_oci_state_file_exists (config)) {
@@ -222,6 +366,28 @@ out:
 	return ret;
 }
 
+/*!
+ * Handle commands to stop the Hypervisor cleanly.
+ *
+ * \param sub \ref subcommand.
+ * \param config \ref cc_oci_config.
+ * \param argc Argument count.
+ * \param argv Argument vector.
+ *
+ * \return \c true on success, else \c false.
+ */
+gboolean
+handle_command_stop (const struct subcommand *sub,
+		struct cc_oci_config *config,
+		int argc, char *argv[])
+{
+	g_assert (sub);
+	g_assert (config);
+
+	return handle_command_batch (sub, config, argc, argv, NULL,
+			stop_container, NULL);
+}
+
 /*!
  * Handle commands to setup the environment as a precursor to
  * creating the state file.
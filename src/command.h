@@ -27,6 +27,7 @@
 
 #include "oci.h"
 #include "util.h"
+#include "batch.h"
 
 /*! A sub-command is a command provided to the application to control
  * its behaviour (think "git").
@@ -61,6 +62,14 @@ struct subcommand
 
 	/*! sub-command description help(required). */
 	char *description;
+
+	/*! If \c true, the sub-command is forwarded to a running
+	 * \ref command_daemon when there is one (optional).
+	 *
+	 * Sub-commands creating processes that must outlive the
+	 * runtime as children of its caller must not set this.
+	 */
+	gboolean daemon;
 };
 
 /*!
@@ -78,6 +87,27 @@ struct start_data {
 	gboolean dry_run_mode;
 };
 
+/*!
+ * Data used to select the containers a sub-command operates on.
+ *
+ * This structure is used by the sub-commands accepting several
+ * container ids (delete, kill, pause, resume) to parse
+ * \ref options_batch.
+ */
+struct batch_data {
+	gboolean   all;
+	gchar     *status;
+	gchar    **annotations;
+	gint       jobs;
+};
+
+extern GOptionEntry options_batch[];
+
+gboolean handle_batch_selector_set (void);
+gboolean handle_command_batch (const struct subcommand *sub,
+		struct cc_oci_config *config,
+		int argc, char *argv[], const char *extra,
+		cc_oci_batch_func func, gpointer user_data);
 gboolean handle_command_toggle (const struct subcommand *sub,
 		struct cc_oci_config *config,
 		int argc, char *argv[], gboolean pause);
@@ -96,6 +126,7 @@ gboolean handle_option_console (const gchar *option_name,
 extern struct subcommand command_attach;
 extern struct subcommand command_checkpoint;
 extern struct subcommand command_create;
+extern struct subcommand command_daemon;
 extern struct subcommand command_delete;
 extern struct subcommand command_events;
 extern struct subcommand command_exec;
@@ -103,6 +134,7 @@ extern struct subcommand command_help;
 extern struct subcommand command_kill;
 extern struct subcommand command_list;
 extern struct subcommand command_pause;
+extern struct subcommand command_prewarm;
 extern struct subcommand command_ps;
 extern struct subcommand command_restore;
 extern struct subcommand command_resume;
@@ -40,6 +40,12 @@ static GOptionEntry options_create[] =
 		"set pty console that will be used in the container",
 		NULL
 	},
+	{
+		"dry-run", 0, G_OPTION_FLAG_NONE,
+		G_OPTION_ARG_NONE, &start_data.dry_run_mode,
+		"run a placeholder rather than the hypervisor",
+	       	NULL
+	},
 	{
 		"no-pivot", 0, G_OPTION_FLAG_NONE,
 		G_OPTION_ARG_NONE, NULL,
@@ -23,8 +23,10 @@
 struct subcommand command_delete =
 {
 	.name        = "delete",
+	.options     = options_batch,
 
 	/* delete is what the OCI spec calls stop */
 	.handler     = handle_command_stop,
 	.description = "delete resources held by a container",
+	.daemon      = true,
 };
@@ -23,6 +23,7 @@
 #define DEFAULT_INTERVAL 5
 
 static gboolean run_once;
+static gboolean show_all;
 static gint interval = DEFAULT_INTERVAL;
 
 
@@ -38,6 +39,11 @@ static GOptionEntry options_events[] =
 		G_OPTION_ARG_INT, &interval,
 		"set the interval to refresh stats", NULL
 	},
+	{
+		"all", 'a', G_OPTION_FLAG_NONE,
+		G_OPTION_ARG_NONE, &show_all,
+		"show the state changes of all containers", NULL
+	},
 	{NULL}
 };
 
@@ -55,6 +61,17 @@ handler_events (const struct subcommand *sub,
 		goto out;
 	}
 
+	if (show_all) {
+		if (argc) {
+			g_critical ("container id cannot be specified "
+					"with --all");
+			goto out;
+		}
+
+		ret = show_all_container_events (config);
+		goto out;
+	}
+
 	if (handle_default_usage (argc, argv, sub->name,
 				&ret, -1, NULL)) {
 		goto out;
@@ -91,5 +108,6 @@ struct subcommand command_events =
 	.name    = "events",
 	.options = options_events,
 	.handler = handler_events,
-	.description = "shows container resource usage statistics"
+	.description = "shows container resource usage statistics or events",
+	.daemon      = true,
 };
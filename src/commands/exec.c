@@ -19,6 +19,17 @@
  */
 
 #include "command.h"
+#include "spec_handler.h"
+#include "json.h"
+#include "oci-config.h"
+
+/**
+ * Spec handlers used to process config on exec: the command runs
+ * with the environment, working directory and user of the workload.
+ */
+static struct spec_handler *exec_spec_handlers[SPEC_SECTIONS] = {
+	[SPEC_PROCESS] = &process_spec_handler,
+};
 
 static gboolean
 handler_exec (const struct subcommand *sub,
@@ -27,6 +38,7 @@ handler_exec (const struct subcommand *sub,
 {
 	struct oci_state  *state = NULL;
 	gchar             *config_file = NULL;
+	GNode             *root = NULL;
 	gboolean           ret;
 
 	g_assert (sub);
@@ -48,6 +60,18 @@ handler_exec (const struct subcommand *sub,
 		goto out;
 	}
 
+	/* convert json file to GNode */
+	ret = cc_oci_json_parse (&root, config_file);
+	if (! ret) {
+		goto out;
+	}
+
+	ret = cc_oci_process_config (root, config, exec_spec_handlers);
+	if (! ret) {
+		g_critical ("failed to process config");
+		goto out;
+	}
+
 	ret = cc_oci_exec (config, state, argc, argv);
 	if (! ret) {
 		goto out;
@@ -56,6 +80,7 @@ handler_exec (const struct subcommand *sub,
 	ret = true;
 
 out:
+	g_free_node (root);
 	g_free_if_set (config_file);
 	cc_oci_state_free (state);
 
@@ -20,51 +20,63 @@
 
 #include <stdlib.h>
 #include <signal.h>
+#include <errno.h>
 
 #include "command.h"
 
-static gboolean
-handler_kill (const struct subcommand *sub,
-		struct cc_oci_config *config,
-		int argc, char *argv[])
+/*!
+ * Convert a signal argument to a signal number.
+ *
+ * \param signame Symbolic ("SIGKILL"/"KILL") or numeric ("9") signal.
+ *
+ * \return Signal number, or a negative value if \p signame isn't a
+ * signal.
+ */
+static int
+kill_get_signum (const gchar *signame)
 {
-	struct oci_state      *state = NULL;
-	gchar                 *config_file = NULL;
-	gboolean               ret = false;
-	const gchar           *signame = NULL;
-	int                    signum = SIGTERM;
+	gchar  *end = NULL;
+	long    signum;
 
-	g_assert (sub);
-	g_assert (config);
+	if (! signame || ! *signame) {
+		return -1;
+	}
 
+	/* first, try to convert the string argument to a number */
+	errno = 0;
+	signum = strtol (signame, &end, 10);
 
-	if (handle_default_usage (argc, argv, sub->name,
-				&ret, 1, "[<signal>]")) {
-		return ret;
+	if (end == signame) {
+		/* not a number, so try to convert the signame
+		 * name to a number.
+		 */
+		return cc_oci_get_signum (signame);
 	}
 
-	/* Used to allow us to find the state file */
-	config->optarg_container_id = argv[0];
-
-	if (argc == 2) {
-		signame = argv[1];
+	if (errno || *end || signum <= 0 || signum >= NSIG) {
+		return -1;
+	}
 
-		/* first, try to convert the string argument to a number */
-		signum = atoi (signame);
+	return (int)signum;
+}
 
-		if (signum <= 0) {
-			/* not a number, so try to convert the signame
-			 * name to a number.
-			 */
-			signum = cc_oci_get_signum (signame);
-		}
+/*!
+ * Send a signal to a single container (\ref cc_oci_batch_func).
+ *
+ * \param config \ref cc_oci_config.
+ * \param user_data Signal number.
+ *
+ * \return \c true on success, else \c false.
+ */
+static gboolean
+kill_container (struct cc_oci_config *config, gpointer user_data)
+{
+	struct oci_state      *state = NULL;
+	gchar                 *config_file = NULL;
+	gboolean               ret = false;
+	int                    signum = GPOINTER_TO_INT (user_data);
 
-		if (signum < 0) {
-			g_critical ("invalid signal specified: %s",
-					signame);
-			return false;
-		}
-	}
+	g_assert (config);
 
 	ret = cc_oci_get_config_and_state (&config_file, config, &state);
 	if (! ret) {
@@ -84,11 +96,56 @@ out:
 	return ret;
 }
 
+static gboolean
+handler_kill (const struct subcommand *sub,
+		struct cc_oci_config *config,
+		int argc, char *argv[])
+{
+	const gchar           *signame = NULL;
+	const gchar           *usage;
+	gboolean               selector;
+	int                    signum = SIGTERM;
+
+	g_assert (sub);
+	g_assert (config);
+
+	/* The signal is an optional positional argument:
+	 * "<container-id> [<signal>]" or, when containers are
+	 * selected with options, just "[<signal>]". Anything else
+	 * is a usage error: a second container id must never be
+	 * mistaken for a signal.
+	 */
+	selector = handle_batch_selector_set ();
+	usage = selector ? "[<signal>]" : "<container-id> [<signal>]";
+
+	if (argc > (selector ? 1 : 2)) {
+		g_critical ("Usage: %s %s", sub->name, usage);
+		return false;
+	}
+
+	if (argc == (selector ? 1 : 2)) {
+		signame = argv[--argc];
+
+		signum = kill_get_signum (signame);
+		if (signum <= 0) {
+			g_critical ("invalid signal specified: %s "
+					"(Usage: %s %s)",
+					signame, sub->name, usage);
+			return false;
+		}
+	}
+
+	return handle_command_batch (sub, config, argc, argv, "[<signal>]",
+			kill_container, GINT_TO_POINTER (signum));
+}
+
 struct subcommand command_kill =
 {
 	.name        = "kill",
+	.options     = options_batch,
 	.handler     = handler_kill,
 	.description = "send a signal to the container "
 		       "(signal may be symbolic (\"SIGKILL\"/\"KILL\") "
-		       "or numeric (\"9\"))"
+		       "or numeric (\"9\"))",
+	.daemon      = true,
 };
@@ -19,9 +19,14 @@
  */
 
 #include "command.h"
+#include "batch.h"
 
 static char *format;
 static gboolean show_all;
+static gboolean quiet;
+static gchar *status;
+static gchar **annotations;
+static gchar *id_prefix;
 
 static GOptionEntry options_list[] =
 {
@@ -35,6 +40,30 @@ static GOptionEntry options_list[] =
 		G_OPTION_ARG_STRING, &format,
 		"change output format", NULL
 	},
+	{
+		"quiet", 'q', G_OPTION_FLAG_NONE,
+		G_OPTION_ARG_NONE, &quiet,
+		"only display container ids", NULL
+	},
+	{
+		"status", 0, G_OPTION_FLAG_NONE,
+		G_OPTION_ARG_STRING, &status,
+		"only list containers in the specified state",
+		"STATUS"
+	},
+	{
+		"annotation", 0, G_OPTION_FLAG_NONE,
+		G_OPTION_ARG_STRING_ARRAY, &annotations,
+		"only list containers with the specified annotation "
+		"(may be repeated)",
+		"KEY[=VALUE]"
+	},
+	{
+		"id-prefix", 0, G_OPTION_FLAG_NONE,
+		G_OPTION_ARG_STRING, &id_prefix,
+		"only list containers whose id starts with PREFIX",
+		"PREFIX"
+	},
 
 	{NULL}
 };
@@ -44,14 +73,33 @@ handler_list (const struct subcommand *sub,
 		struct cc_oci_config *config,
 		int argc, char *argv[])
 {
-	gboolean ret;
+	struct cc_oci_batch_selector  selector = { 0 };
+	gboolean                      ret = false;
 
 	g_assert (sub);
 	g_assert (config);
 
-	ret = cc_oci_list (config, format ? format : "table", show_all);
+	selector.status = OCI_STATUS_INVALID;
+
+	if (status) {
+		selector.status = cc_oci_str_to_status (status);
+		if (selector.status == OCI_STATUS_INVALID) {
+			g_critical ("invalid status: %s", status);
+			goto out;
+		}
+	}
+
+	selector.annotations = annotations;
+	selector.id_prefix = id_prefix;
+
+	ret = cc_oci_list (config, format ? format : "table", show_all,
+			&selector, quiet);
 
+out:
 	g_free_if_set (format);
+	g_free_if_set (status);
+	g_free_if_set (id_prefix);
+	g_strfreev (annotations);
 
 	return ret;
 }
@@ -62,4 +110,5 @@ struct subcommand command_list =
 	.options     = options_list,
 	.handler     = handler_list,
 	.description = "list all container details",
+	.daemon      = true,
 };
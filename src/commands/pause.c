@@ -34,6 +34,8 @@ handler_pause (const struct subcommand *sub,
 struct subcommand command_pause =
 {
 	.name        = "pause",
+	.options     = options_batch,
 	.handler     = handler_pause,
 	.description = "pause all the tasks inside a container",
+	.daemon      = true,
 };
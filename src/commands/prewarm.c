@@ -0,0 +1,72 @@
+/*
+ * This file is part of cc-oci-runtime.
+ * 
+ * Copyright (C) 2016 Intel Corporation
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "command.h"
+#include "spec_handler.h"
+#include "assets.h"
+
+static gboolean force;
+
+static GOptionEntry options_prewarm[] =
+{
+	{
+		"force", 'f', G_OPTION_FLAG_NONE,
+		G_OPTION_ARG_NONE, &force,
+		"read all assets, including those already prewarmed", NULL
+	},
+
+	{NULL}
+};
+
+static gboolean
+handler_prewarm (const struct subcommand *sub,
+		struct cc_oci_config *config,
+		int argc, char *argv[])
+{
+	g_assert (sub);
+	g_assert (config);
+
+	(void)argv;
+
+	if (argc) {
+		g_print ("Usage: %s [--force]\n", sub->name);
+		return false;
+	}
+
+	if (! get_spec_vm_from_cfg_file (config)) {
+		g_critical ("failed to find any sources of VM configuration");
+		return false;
+	}
+
+	if (! cc_oci_assets_prewarm (config, force)) {
+		g_critical ("failed to prewarm VM assets");
+		return false;
+	}
+
+	return true;
+}
+
+struct subcommand command_prewarm =
+{
+	.name        = "prewarm",
+	.handler     = handler_prewarm,
+	.options     = options_prewarm,
+	.description = "load the hypervisor, kernel and image into the page cache",
+};
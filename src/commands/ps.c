@@ -21,38 +21,66 @@
 #include "command.h"
 #include "state.h"
 
+static gchar *format;
+
+static GOptionEntry options_ps[] =
+{
+	{
+		"format", 'f', G_OPTION_FLAG_NONE,
+		G_OPTION_ARG_STRING, &format,
+		"select one of: table or json", NULL
+	},
+
+	{NULL}
+};
 
 static gboolean
 handler_ps (const struct subcommand *sub,
 		struct cc_oci_config *config,
 		int argc, char *argv[])
 {
-	gboolean   ret;
+	struct oci_state  *state = NULL;
+	gchar             *config_file = NULL;
+	gboolean           ret;
 
 	g_assert (sub);
 	g_assert (config);
 
 	if (handle_default_usage (argc, argv, sub->name,
-				&ret, 1, "<ps options>")) {
-		return ret;
+				&ret, 1, "[-- <ps options>]")) {
+		goto out;
 	}
 
 	config->optarg_container_id = argv[0];
 
-	if (! cc_oci_state_file_exists(config)) {
-		g_warning ("state file does not exist for container %s",
-				config->optarg_container_id);
-		return false;
+	/* Jump over the container name */
+	argv++; argc--;
+
+	if (argc && ! g_strcmp0 (argv[0], "--")) {
+		argv++; argc--;
+	}
+
+	ret = cc_oci_get_config_and_state (&config_file, config, &state);
+	if (! ret) {
+		goto out;
 	}
 
-	//FIXME: implement ps, run ps inside the VM ?
+	ret = cc_oci_ps (config, state, format ? format : "table",
+			argc, argv);
+
+out:
+	g_free_if_set (format);
+	g_free_if_set (config_file);
+	cc_oci_state_free (state);
 
-	return true;
+	return ret;
 }
 
 struct subcommand command_ps =
 {
 	.name        = "ps",
+	.options     = options_ps,
 	.handler     = handler_ps,
 	.description = "display the processes running inside a container",
+	.daemon      = true,
 };
@@ -34,6 +34,8 @@ handler_resume (const struct subcommand *sub,
 struct subcommand command_resume =
 {
 	.name        = "resume",
+	.options     = options_batch,
 	.handler     = handler_resume,
 	.description = "resume a previously paused container",
+	.daemon      = true,
 };
@@ -57,7 +57,7 @@ static GOptionEntry options_run[] =
 	{
 		"dry-run", 0, G_OPTION_FLAG_NONE,
 		G_OPTION_ARG_NONE, &start_data.dry_run_mode,
-		"do not create the container",
+		"run a placeholder rather than the hypervisor",
 	       	NULL
 	},
 	{
@@ -29,6 +29,8 @@ handler_state (const struct subcommand *sub,
 {
 	gchar* contents;
 	gsize length;
+	gchar* formatted;
+	gsize formatted_len;
 	GError* error = NULL;
 	gboolean ret;
 
@@ -66,9 +68,17 @@ handler_state (const struct subcommand *sub,
 		return false;
 	}
 
-	g_print("%s\n", contents);
+	formatted = cc_oci_state_file_format (contents, length,
+			&formatted_len);
 	g_free (contents);
 
+	if (! formatted) {
+		return false;
+	}
+
+	g_print("%s\n", formatted);
+	g_free (formatted);
+
 	return true;
 }
 
@@ -77,4 +87,5 @@ struct subcommand command_state =
 	.name        = "state",
 	.handler     = handler_state,
 	.description = "shows the state of a container",
+	.daemon      = true,
 };
@@ -23,6 +23,8 @@
 struct subcommand command_stop =
 {
 	.name        = "stop",
+	.options     = options_batch,
 	.handler     = handle_command_stop,
 	.description = "destroy a container",
+	.daemon      = true,
 };
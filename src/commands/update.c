@@ -18,39 +18,201 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
  */
 
+#include <unistd.h>
+
 #include "command.h"
 #include "state.h"
+#include "json.h"
+#include "spec_handler.h"
+
+static gchar *resources_file;
+static gchar *memory;
+static gchar *cpuset_cpus;
+static gint64 cpu_quota;
+static gint64 cpu_period;
+
+static GOptionEntry options_update[] =
+{
+	{
+		"resources", 'r', G_OPTION_FLAG_NONE,
+		G_OPTION_ARG_STRING, &resources_file,
+		"path to file containing resources to update "
+		"(\"-\" to read from stdin)", NULL
+	},
+	{
+		"memory", 0, G_OPTION_FLAG_NONE,
+		G_OPTION_ARG_STRING, &memory,
+		"memory limit (in bytes, or with a K, M, G or T suffix)", NULL
+	},
+	{
+		"cpu-quota", 0, G_OPTION_FLAG_NONE,
+		G_OPTION_ARG_INT64, &cpu_quota,
+		"CPU CFS hardcap limit (in usecs)", NULL
+	},
+	{
+		"cpu-period", 0, G_OPTION_FLAG_NONE,
+		G_OPTION_ARG_INT64, &cpu_period,
+		"CPU CFS period (in usecs)", NULL
+	},
+	{
+		"cpuset-cpus", 0, G_OPTION_FLAG_NONE,
+		G_OPTION_ARG_STRING, &cpuset_cpus,
+		"CPUs to use", NULL
+	},
+
+	{NULL}
+};
+
+/*!
+ * Read the OCI resources JSON specified by the "--resources" option.
+ *
+ * \param file Path to file, or "-" to read from stdin.
+ * \param[out] resources \ref oci_cfg_resources.
+ *
+ * \return \c true on success, else \c false.
+ */
+static gboolean
+update_read_resources (const gchar *file,
+		struct oci_cfg_resources *resources)
+{
+	GIOChannel  *channel = NULL;
+	GError      *error = NULL;
+	GNode       *node = NULL;
+	gchar       *data = NULL;
+	gsize        len = 0;
+	gboolean     ret = false;
+
+	if (! g_strcmp0 (file, "-")) {
+		channel = g_io_channel_unix_new (STDIN_FILENO);
+
+		if (g_io_channel_read_to_end (channel, &data, &len,
+					&error) != G_IO_STATUS_NORMAL) {
+			g_critical ("failed to read resources from stdin: %s",
+					error ? error->message : "");
+			goto out;
+		}
+	} else if (! g_file_get_contents (file, &data, &len, &error)) {
+		g_critical ("failed to read resources file %s: %s",
+				file, error->message);
+		goto out;
+	}
+
+	if (! cc_oci_json_parse_data (&node, data, (gssize)len)) {
+		g_critical ("failed to parse resources");
+		goto out;
+	}
+
+	ret = cc_oci_resources_parse (node, resources);
+
+out:
+	if (error) {
+		g_error_free (error);
+	}
+	if (channel) {
+		g_io_channel_unref (channel);
+	}
+	if (node) {
+		g_free_node (node);
+	}
+	g_free_if_set (data);
+
+	return ret;
+}
 
 static gboolean
 handler_update (const struct subcommand *sub,
 		struct cc_oci_config *config,
 		int argc, char *argv[])
 {
-	gboolean  ret = true;
+	struct oci_state         *state = NULL;
+	struct oci_cfg_resources  resources = { 0 };
+	gchar                    *config_file = NULL;
+	guint64                   bytes;
+	gboolean                  ret = true;
 
 	g_assert (sub);
 	g_assert (config);
 
 	if (handle_default_usage (argc, argv, sub->name,
 				&ret, 1, NULL)) {
-		return ret;
+		goto out;
 	}
 
 	/* Used to allow us to find the state file */
 	config->optarg_container_id = argv[0];
 
-	if (! cc_oci_state_file_exists(config)) {
-		g_warning ("state file does not exist for container %s",
-				config->optarg_container_id);
-		ret = false;
+	ret = false;
+
+	if (resources_file) {
+		if (! update_read_resources (resources_file, &resources)) {
+			goto out;
+		}
 	}
 
+	/* options override the values specified in the resources file */
+	if (memory) {
+		if (! cc_oci_str_to_bytes (memory, 1, &bytes)) {
+			g_critical ("invalid memory value: %s", memory);
+			goto out;
+		}
+
+		resources.memory_limit = (gint64)bytes;
+	}
+
+	if (cpu_quota) {
+		resources.cpu_quota = cpu_quota;
+	}
+
+	if (cpu_period) {
+		if (cpu_period < 0) {
+			g_critical ("invalid cpu period: %" G_GINT64_FORMAT,
+					cpu_period);
+			goto out;
+		}
+
+		resources.cpu_period = (guint64)cpu_period;
+	}
+
+	if (cpuset_cpus) {
+		if (! cc_oci_cpuset_count (cpuset_cpus)) {
+			g_critical ("invalid cpuset: %s", cpuset_cpus);
+			goto out;
+		}
+
+		g_free_if_set (resources.cpu_cpus);
+		resources.cpu_cpus = g_strdup (cpuset_cpus);
+	}
+
+	ret = cc_oci_get_config_and_state (&config_file, config, &state);
+	if (! ret) {
+		goto out;
+	}
+
+	/* Transfer certain state elements to config to allow the state *
+	 * file to be rewritten with full details.
+	 */
+	ret = cc_oci_config_update (config, state);
+	if (! ret) {
+		goto out;
+	}
+
+	ret = cc_oci_update (config, state, &resources);
+
+out:
+	g_free_if_set (config_file);
+	g_free_if_set (resources.cpu_cpus);
+	g_free_if_set (resources_file);
+	g_free_if_set (memory);
+	g_free_if_set (cpuset_cpus);
+	cc_oci_state_free (state);
+
 	return ret;
 }
 
 struct subcommand command_update =
 {
-	.name    = "update",
-	.handler = handler_update,
+	.name        = "update",
+	.options     = options_update,
+	.handler     = handler_update,
 	.description = "update container resource constraints",
 };
@@ -0,0 +1,1156 @@
+/*
+ * This file is part of cc-oci-runtime.
+ *
+ * Copyright (C) 2016 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/*
+ * Architecture:
+ *
+ * - "cc-oci-runtime daemon" listens on \ref CC_OCI_DAEMON_SOCKET.
+ * - clients send their arguments, working directory, environment and
+ *   stdio file descriptors, then wait for an exit status.
+ * - each connection is handed to a worker forked from the daemon,
+ *   which reads the request, so a slow client never holds up the
+ *   daemon.
+ * - "state" requests are answered by the worker from the daemon's
+ *   in-memory copy of the formatted state file, revalidated with
+ *   stat(2). The worker sends the path of the file to the daemon so
+ *   that it can refresh its copy for later workers.
+ * - other requests are run by the worker as the client would have.
+ *
+ * Wire format (integers are big endian):
+ *
+ *   request: | length (4) | argc (4) | cwd\0 | argv...\0 | environ...\0 |
+ *   reply:   | exit status (4) |
+ *
+ * length covers everything that follows it. The client's stdin, stdout
+ * and stderr are passed with the first byte of the request.
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#include <glib.h>
+
+#include "common.h"
+#include "daemon.h"
+#include "oci.h"
+#include "state.h"
+#include "util.h"
+
+extern char **environ;
+
+/** Function workers run, set by the runtime entry point. */
+cc_oci_daemon_func cc_oci_daemon_handler;
+
+/** Decoded client request. */
+struct cc_oci_daemon_request {
+	/** Working directory of the client. */
+	gchar   *cwd;
+
+	/** Argument count. */
+	gint     argc;
+
+	/** \c NULL-terminated argument vector. */
+	gchar  **argv;
+
+	/** \c NULL-terminated environment of the client. */
+	gchar  **envp;
+
+	/** Client's stdin, stdout and stderr (or -1). */
+	int      fds[3];
+};
+
+/** Cached copy of a state file. */
+struct cc_oci_daemon_state {
+	/** stat(2) details of the file \c contents was read from. */
+	struct stat   st;
+
+	/** File contents, formatted by \ref cc_oci_state_file_format. */
+	gchar        *contents;
+
+	/** Length of \c contents. */
+	gsize         length;
+};
+
+/*!
+ * Encode a request.
+ *
+ * \param argc Argument count.
+ * \param argv Argument vector.
+ * \param cwd Working directory.
+ * \param envp \c NULL-terminated environment.
+ *
+ * \return Newly-allocated request, including its length.
+ */
+private GByteArray *
+cc_oci_daemon_request_encode (int argc, char **argv,
+		const gchar *cwd, char **envp)
+{
+	GByteArray  *request;
+	guint32      value;
+	char       **p;
+	int          i;
+
+	g_assert (argc > 0);
+	g_assert (argv);
+	g_assert (cwd);
+
+	request = g_byte_array_new ();
+
+	/* length, set below */
+	value = 0;
+	g_byte_array_append (request, (const guint8 *)&value, sizeof (value));
+
+	value = htonl ((guint32)argc);
+	g_byte_array_append (request, (const guint8 *)&value, sizeof (value));
+
+	g_byte_array_append (request, (const guint8 *)cwd,
+			(guint)strlen (cwd) + 1);
+
+	for (i = 0; i < argc; i++) {
+		g_byte_array_append (request, (const guint8 *)argv[i],
+				(guint)strlen (argv[i]) + 1);
+	}
+
+	for (p = envp; p && *p; p++) {
+		g_byte_array_append (request, (const guint8 *)*p,
+				(guint)strlen (*p) + 1);
+	}
+
+	value = htonl ((guint32)(request->len - sizeof (value)));
+	memcpy (request->data, &value, sizeof (value));
+
+	return request;
+}
+
+/*!
+ * Decode a request.
+ *
+ * \param data Request, following its length.
+ * \param len Length of \p data.
+ * \param[out] request Decoded request (file descriptors are not set).
+ *
+ * \return \c true on success, else \c false.
+ */
+private gboolean
+cc_oci_daemon_request_decode (const guint8 *data, gsize len,
+		struct cc_oci_daemon_request *request)
+{
+	GPtrArray    *strings = NULL;
+	const gchar  *p;
+	const gchar  *end;
+	guint32       argc;
+	guint         i;
+
+	g_assert (data);
+	g_assert (request);
+
+	if (len < sizeof (argc) || data[len-1] != '\0') {
+		return false;
+	}
+
+	memcpy (&argc, data, sizeof (argc));
+	argc = ntohl (argc);
+
+	strings = g_ptr_array_new ();
+
+	p = (const gchar *)data + sizeof (argc);
+	end = (const gchar *)data + len;
+	while (p < end) {
+		g_ptr_array_add (strings, (gpointer)p);
+		p += strlen (p) + 1;
+	}
+
+	/* cwd and at least the program name are required */
+	if (argc < 1 || strings->len < argc + 1) {
+		g_ptr_array_free (strings, true);
+		return false;
+	}
+
+	request->cwd = g_strdup (strings->pdata[0]);
+
+	request->argc = (gint)argc;
+	request->argv = g_new0 (gchar *, argc + 1);
+	for (i = 0; i < argc; i++) {
+		request->argv[i] = g_strdup (strings->pdata[i+1]);
+	}
+
+	request->envp = g_new0 (gchar *, strings->len - argc);
+	for (i = argc + 1; i < strings->len; i++) {
+		request->envp[i-argc-1] = g_strdup (strings->pdata[i]);
+	}
+
+	g_ptr_array_free (strings, true);
+
+	return true;
+}
+
+/*!
+ * Free the resources of a request, closing its file descriptors.
+ *
+ * \param request \ref cc_oci_daemon_request.
+ */
+private void
+cc_oci_daemon_request_free (struct cc_oci_daemon_request *request)
+{
+	guint i;
+
+	if (! request) {
+		return;
+	}
+
+	g_free_if_set (request->cwd);
+	g_strfreev (request->argv);
+	g_strfreev (request->envp);
+
+	for (i = 0; i < G_N_ELEMENTS (request->fds); i++) {
+		if (request->fds[i] >= 0) {
+			close (request->fds[i]);
+		}
+	}
+
+	memset (request, 0, sizeof (*request));
+}
+
+/*!
+ * Determine if a request is a plain "state" query the daemon can
+ * answer itself.
+ *
+ * Only "[--root DIR] state ID" is recognised; anything else is left to
+ * a worker, which handles errors and options like the runtime does.
+ *
+ * \param argc Argument count.
+ * \param argv Argument vector.
+ * \param[out] root_dir Root directory (or \c NULL for the default).
+ * \param[out] container_id Container id.
+ *
+ * \return \c true if the request is a state query, else \c false.
+ */
+private gboolean
+cc_oci_daemon_state_args (int argc, char **argv,
+		const gchar **root_dir, const gchar **container_id)
+{
+	const gchar  *id;
+	int           i = 1;
+
+	g_assert (argv);
+	g_assert (root_dir);
+	g_assert (container_id);
+
+	*root_dir = NULL;
+
+	if (i < argc && g_str_has_prefix (argv[i], "--root=")) {
+		*root_dir = argv[i] + strlen ("--root=");
+		i++;
+	} else if (i + 1 < argc && ! g_strcmp0 (argv[i], "--root")) {
+		*root_dir = argv[i+1];
+		i += 2;
+	}
+
+	if (argc - i != 2 || g_strcmp0 (argv[i], "state")) {
+		return false;
+	}
+
+	if (*root_dir && ! **root_dir) {
+		return false;
+	}
+
+	id = argv[i+1];
+	if (! *id || *id == '-' || strchr (id, '/')
+			|| ! g_strcmp0 (id, ".") || ! g_strcmp0 (id, "..")) {
+		return false;
+	}
+
+	*container_id = id;
+
+	return true;
+}
+
+/*!
+ * Free a \ref cc_oci_daemon_state.
+ *
+ * \param p \ref cc_oci_daemon_state.
+ */
+private void
+cc_oci_daemon_state_free (gpointer p)
+{
+	struct cc_oci_daemon_state *state = p;
+
+	if (! state) {
+		return;
+	}
+
+	g_free_if_set (state->contents);
+	g_free (state);
+}
+
+/*!
+ * Get the contents of a state file, from the cache if the file hasn't
+ * changed since it was last read.
+ *
+ * \param states Cache of state files (path to \ref cc_oci_daemon_state).
+ * \param path Path of the state file.
+ * \param[out] length Length of the contents.
+ *
+ * \return Contents owned by \p states on success, else \c NULL.
+ */
+private const gchar *
+cc_oci_daemon_state_get (GHashTable *states, const gchar *path,
+		gsize *length)
+{
+	struct cc_oci_daemon_state  *state;
+	struct stat                  st;
+	gchar                       *contents;
+	gsize                        len;
+
+	g_assert (states);
+	g_assert (path);
+	g_assert (length);
+
+	if (stat (path, &st) < 0) {
+		g_hash_table_remove (states, path);
+		return NULL;
+	}
+
+	state = g_hash_table_lookup (states, path);
+	if (state
+			&& state->st.st_dev == st.st_dev
+			&& state->st.st_ino == st.st_ino
+			&& state->st.st_size == st.st_size
+			&& state->st.st_mtim.tv_sec == st.st_mtim.tv_sec
+			&& state->st.st_mtim.tv_nsec == st.st_mtim.tv_nsec
+			&& state->st.st_ctim.tv_sec == st.st_ctim.tv_sec
+			&& state->st.st_ctim.tv_nsec == st.st_ctim.tv_nsec) {
+		*length = state->length;
+		return state->contents;
+	}
+
+	/* The file may change while it is read, in which case the next
+	 * stat(2) won't match and it is read again.
+	 */
+	if (! g_file_get_contents (path, &contents, &len, NULL)) {
+		g_hash_table_remove (states, path);
+		return NULL;
+	}
+
+	state = g_new0 (struct cc_oci_daemon_state, 1);
+	state->st = st;
+
+	/* keep the contents as "state" shows them */
+	state->contents = cc_oci_state_file_format (contents, len,
+			&state->length);
+	g_free (contents);
+
+	if (! state->contents) {
+		cc_oci_daemon_state_free (state);
+		g_hash_table_remove (states, path);
+		return NULL;
+	}
+
+	g_hash_table_replace (states, g_strdup (path), state);
+
+	*length = state->length;
+	return state->contents;
+}
+
+/*!
+ * Write all of a buffer to a file descriptor.
+ *
+ * \param fd File descriptor.
+ * \param buf Buffer.
+ * \param len Length of \p buf.
+ *
+ * \return \c true on success, else \c false.
+ */
+static gboolean
+cc_oci_daemon_write_full (int fd, const void *buf, gsize len)
+{
+	const guint8  *p = buf;
+	ssize_t        n;
+
+	while (len) {
+		n = send (fd, p, len, MSG_NOSIGNAL);
+		if (n < 0 && errno == ENOTSOCK) {
+			n = write (fd, p, len);
+		}
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return false;
+		}
+		p += n;
+		len -= (gsize)n;
+	}
+
+	return true;
+}
+
+/*!
+ * Read exactly \p len bytes from a file descriptor.
+ *
+ * \param fd File descriptor.
+ * \param buf Buffer.
+ * \param len Number of bytes to read.
+ *
+ * \return \c true on success, else \c false.
+ */
+static gboolean
+cc_oci_daemon_read_full (int fd, void *buf, gsize len)
+{
+	guint8   *p = buf;
+	ssize_t   n;
+
+	while (len) {
+		n = read (fd, p, len);
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n <= 0) {
+			return false;
+		}
+		p += n;
+		len -= (gsize)n;
+	}
+
+	return true;
+}
+
+/*!
+ * Send a request, along with the caller's stdio file descriptors.
+ *
+ * \param fd Socket connected to the daemon.
+ * \param request Encoded request.
+ *
+ * \return \c true on success, else \c false.
+ */
+static gboolean
+cc_oci_daemon_send_request (int fd, const GByteArray *request)
+{
+	int             fds[3] = { STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO };
+	char            control[CMSG_SPACE (sizeof (fds))];
+	struct msghdr   msg = { 0 };
+	struct cmsghdr *cmsg;
+	struct iovec    iov;
+	ssize_t         n;
+
+	g_assert (request);
+
+	memset (control, 0, sizeof (control));
+
+	iov.iov_base = request->data;
+	iov.iov_len = request->len;
+
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control;
+	msg.msg_controllen = sizeof (control);
+
+	cmsg = CMSG_FIRSTHDR (&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN (sizeof (fds));
+	memcpy (CMSG_DATA (cmsg), fds, sizeof (fds));
+
+	do {
+		n = sendmsg (fd, &msg, MSG_NOSIGNAL);
+	} while (n < 0 && errno == EINTR);
+
+	if (n <= 0) {
+		return false;
+	}
+
+	return cc_oci_daemon_write_full (fd, request->data + n,
+			request->len - (gsize)n);
+}
+
+/*!
+ * Receive a request and the client's stdio file descriptors.
+ *
+ * \param fd Connection to the client.
+ * \param[out] request \ref cc_oci_daemon_request.
+ *
+ * \return \c true on success, else \c false.
+ */
+static gboolean
+cc_oci_daemon_read_request (int fd, struct cc_oci_daemon_request *request)
+{
+	char            control[CMSG_SPACE (sizeof (request->fds))];
+	struct msghdr   msg = { 0 };
+	struct cmsghdr *cmsg;
+	struct iovec    iov;
+	guint32         len;
+	guint8         *data = NULL;
+	gboolean        ret = false;
+	ssize_t         n;
+
+	g_assert (request);
+
+	iov.iov_base = &len;
+	iov.iov_len = sizeof (len);
+
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control;
+	msg.msg_controllen = sizeof (control);
+
+	do {
+		n = recvmsg (fd, &msg, MSG_CMSG_CLOEXEC);
+	} while (n < 0 && errno == EINTR);
+
+	if (n <= 0) {
+		goto out;
+	}
+
+	for (cmsg = CMSG_FIRSTHDR (&msg); cmsg;
+			cmsg = CMSG_NXTHDR (&msg, cmsg)) {
+		if (cmsg->cmsg_level == SOL_SOCKET
+				&& cmsg->cmsg_type == SCM_RIGHTS
+				&& cmsg->cmsg_len == CMSG_LEN (sizeof (request->fds))) {
+			memcpy (request->fds, CMSG_DATA (cmsg),
+					sizeof (request->fds));
+		}
+	}
+
+	if (request->fds[0] < 0 || request->fds[1] < 0
+			|| request->fds[2] < 0) {
+		g_warning ("request without stdio file descriptors");
+		goto out;
+	}
+
+	if (! cc_oci_daemon_read_full (fd, (guint8 *)&len + n,
+				sizeof (len) - (gsize)n)) {
+		goto out;
+	}
+
+	len = ntohl (len);
+	if (len > CC_OCI_DAEMON_MAX_REQUEST) {
+		g_warning ("request too large (%u bytes)", len);
+		goto out;
+	}
+
+	data = g_malloc (len);
+	if (! cc_oci_daemon_read_full (fd, data, len)) {
+		goto out;
+	}
+
+	if (! cc_oci_daemon_request_decode (data, len, request)) {
+		g_warning ("invalid request");
+		goto out;
+	}
+
+	ret = true;
+
+out:
+	g_free (data);
+
+	return ret;
+}
+
+/*!
+ * Send an exit status to a client.
+ *
+ * \param fd Connection to the client.
+ * \param status Exit status.
+ */
+static void
+cc_oci_daemon_reply (int fd, int status)
+{
+	guint32 value = htonl ((guint32)status);
+
+	if (! cc_oci_daemon_write_full (fd, &value, sizeof (value))) {
+		g_debug ("failed to reply to client: %s", strerror (errno));
+	}
+}
+
+/*!
+ * Answer a "state" request from the cache.
+ *
+ * \param states Cache of state files.
+ * \param cache_fd Socket to send the path of the state file on.
+ * \param request \ref cc_oci_daemon_request.
+ * \param[out] status Exit status for the client.
+ *
+ * \return \c true if the request has been answered, \c false if it
+ * must be run as a command.
+ */
+static gboolean
+cc_oci_daemon_serve_state (GHashTable *states, int cache_fd,
+		const struct cc_oci_daemon_request *request,
+		int *status)
+{
+	const gchar  *root_dir;
+	const gchar  *container_id;
+	const gchar  *contents;
+	gchar        *path;
+	gsize         length;
+
+	if (! cc_oci_daemon_state_args (request->argc, request->argv,
+				&root_dir, &container_id)) {
+		return false;
+	}
+
+	if (! root_dir) {
+		path = g_build_filename (CC_OCI_RUNTIME_DIR_PREFIX,
+				container_id, CC_OCI_STATE_FILE, NULL);
+	} else if (g_path_is_absolute (root_dir)) {
+		path = g_build_filename (root_dir,
+				container_id, CC_OCI_STATE_FILE, NULL);
+	} else {
+		path = g_build_filename (request->cwd, root_dir,
+				container_id, CC_OCI_STATE_FILE, NULL);
+	}
+
+	contents = cc_oci_daemon_state_get (states, path, &length);
+	if (contents) {
+		/* let the daemon refresh its copy (best effort) */
+		(void)send (cache_fd, path, strlen (path),
+				MSG_DONTWAIT | MSG_NOSIGNAL);
+	}
+
+	g_free (path);
+
+	if (! contents) {
+		/* let the command report the error */
+		return false;
+	}
+
+	*status = (cc_oci_daemon_write_full (request->fds[1],
+				contents, length)
+			&& cc_oci_daemon_write_full (request->fds[1], "\n", 1))
+		? EXIT_SUCCESS : EXIT_FAILURE;
+
+	return true;
+}
+
+/*!
+ * Read a request from a client and run it. Runs in a forked worker and
+ * does not return.
+ *
+ * \param fd Connection to the client.
+ * \param states Cache of state files, as of the fork.
+ * \param cache_fd Socket to send the path of served state files on.
+ * \param mask Signal mask to restore.
+ * \param func \ref cc_oci_daemon_func.
+ */
+static void
+cc_oci_daemon_worker (int fd, GHashTable *states, int cache_fd,
+		const sigset_t *mask, cc_oci_daemon_func func)
+{
+	struct cc_oci_daemon_request  request = { 0 };
+	struct timeval                timeout = { 5, 0 };
+	gchar                       **p;
+	int                           status;
+	int                           i;
+
+	request.fds[0] = request.fds[1] = request.fds[2] = -1;
+
+	(void)sigprocmask (SIG_SETMASK, mask, NULL);
+
+	/* Don't let a stuck client hold up the worker forever */
+	(void)setsockopt (fd, SOL_SOCKET, SO_RCVTIMEO,
+			&timeout, sizeof (timeout));
+
+	if (! cc_oci_daemon_read_request (fd, &request)) {
+		_exit (EXIT_FAILURE);
+	}
+
+	close (fd);
+
+	if (cc_oci_daemon_serve_state (states, cache_fd,
+				&request, &status)) {
+		_exit (status);
+	}
+
+	close (cache_fd);
+
+	for (i = 0; i < 3; i++) {
+		if (dup2 (request.fds[i], i) < 0) {
+			_exit (EXIT_FAILURE);
+		}
+	}
+
+	if (chdir (request.cwd) < 0) {
+		g_critical ("failed to change directory to %s: %s",
+				request.cwd, strerror (errno));
+		_exit (EXIT_FAILURE);
+	}
+
+	(void)clearenv ();
+	for (p = request.envp; p && *p; p++) {
+		(void)putenv (*p);
+	}
+
+	i = func (request.argc, request.argv);
+
+	fflush (NULL);
+	_exit (i);
+}
+
+/*!
+ * Accept a connection and hand it to a worker.
+ *
+ * \param listen_fd Listening socket.
+ * \param signal_fd signalfd(2) of the daemon.
+ * \param cache_fds Sockets workers report served state files on
+ *   (daemon end, worker end).
+ * \param mask Signal mask workers should run with.
+ * \param workers Running workers (pid to client connection).
+ * \param states Cache of state files.
+ * \param func \ref cc_oci_daemon_func.
+ */
+static void
+cc_oci_daemon_accept (int listen_fd, int signal_fd,
+		const int cache_fds[2], const sigset_t *mask,
+		GHashTable *workers, GHashTable *states,
+		cc_oci_daemon_func func)
+{
+	struct ucred  cred = { 0 };
+	socklen_t     len = sizeof (cred);
+	int           fd;
+	pid_t         pid;
+
+	fd = accept4 (listen_fd, NULL, NULL, SOCK_CLOEXEC);
+	if (fd < 0) {
+		return;
+	}
+
+	/* Workers run with the daemon's credentials */
+	if (getsockopt (fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) < 0
+			|| cred.uid != geteuid ()) {
+		g_warning ("rejecting connection from uid %d",
+				(int)cred.uid);
+		close (fd);
+		return;
+	}
+
+	fflush (NULL);
+
+	pid = fork ();
+	if (pid < 0) {
+		g_critical ("failed to fork worker: %s", strerror (errno));
+		cc_oci_daemon_reply (fd, EXIT_FAILURE);
+		close (fd);
+		return;
+	}
+
+	if (pid == 0) {
+		close (listen_fd);
+		close (signal_fd);
+		close (cache_fds[0]);
+		cc_oci_daemon_worker (fd, states, cache_fds[1], mask, func);
+	}
+
+	g_debug ("worker %d handling connection", (int)pid);
+
+	g_hash_table_insert (workers, GINT_TO_POINTER (pid),
+			GINT_TO_POINTER (fd));
+}
+
+/*!
+ * Refresh the cached copies of the state files workers have served.
+ *
+ * \param cache_fd Socket workers send the paths on.
+ * \param states Cache of state files.
+ */
+static void
+cc_oci_daemon_refresh (int cache_fd, GHashTable *states)
+{
+	gchar    path[PATH_MAX];
+	gsize    length;
+	ssize_t  n;
+
+	for (;;) {
+		n = recv (cache_fd, path, sizeof (path) - 1, MSG_DONTWAIT);
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n <= 0) {
+			return;
+		}
+
+		path[n] = '\0';
+		(void)cc_oci_daemon_state_get (states, path, &length);
+	}
+}
+
+/*!
+ * Fail the request of a worker that can't be waited for.
+ *
+ * \param key Worker pid.
+ * \param value Connection to the client.
+ * \param user_data Unused.
+ */
+static void
+cc_oci_daemon_abandon (gpointer key, gpointer value, gpointer user_data)
+{
+	int fd = GPOINTER_TO_INT (value);
+
+	(void)key;
+	(void)user_data;
+
+	cc_oci_daemon_reply (fd, EXIT_FAILURE);
+	close (fd);
+}
+
+/*!
+ * Reap workers and send their exit status to their clients.
+ *
+ * \param workers Running workers (pid to client connection).
+ * \param block If \c true, wait for a worker to exit.
+ */
+static void
+cc_oci_daemon_reap (GHashTable *workers, gboolean block)
+{
+	gpointer  value;
+	pid_t     pid;
+	int       status;
+	int       fd;
+
+	for (;;) {
+		pid = waitpid (-1, &status, block ? 0 : WNOHANG);
+		if (pid < 0 && errno == EINTR) {
+			continue;
+		}
+		if (pid < 0 && errno == ECHILD) {
+			/* should not happen, but never wait forever */
+			g_hash_table_foreach (workers,
+					cc_oci_daemon_abandon, NULL);
+			g_hash_table_remove_all (workers);
+			return;
+		}
+		if (pid <= 0) {
+			return;
+		}
+
+		if (! g_hash_table_lookup_extended (workers,
+					GINT_TO_POINTER (pid), NULL, &value)) {
+			continue;
+		}
+
+		g_hash_table_remove (workers, GINT_TO_POINTER (pid));
+
+		fd = GPOINTER_TO_INT (value);
+		cc_oci_daemon_reply (fd, WIFEXITED (status)
+				? WEXITSTATUS (status)
+				: 128 + WTERMSIG (status));
+		close (fd);
+
+		if (block) {
+			return;
+		}
+	}
+}
+
+/*!
+ * Create the listening socket.
+ *
+ * \param socket_path Path of the socket.
+ *
+ * \return Socket on success, else -1.
+ */
+static int
+cc_oci_daemon_listen (const gchar *socket_path)
+{
+	struct sockaddr_un  addr = { 0 };
+	struct stat         st;
+	gchar              *dir;
+	int                 fd;
+
+	if (strlen (socket_path) >= sizeof (addr.sun_path)) {
+		g_critical ("socket path too long: %s", socket_path);
+		return -1;
+	}
+
+	dir = g_path_get_dirname (socket_path);
+	if (g_mkdir_with_parents (dir, CC_OCI_DIR_MODE) < 0) {
+		g_critical ("failed to create directory %s: %s",
+				dir, strerror (errno));
+		g_free (dir);
+		return -1;
+	}
+	g_free (dir);
+
+	/* Remove a stale socket, but nothing else */
+	if (lstat (socket_path, &st) == 0 && S_ISSOCK (st.st_mode)) {
+		(void)unlink (socket_path);
+	}
+
+	fd = socket (AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd < 0) {
+		g_critical ("failed to create socket: %s", strerror (errno));
+		return -1;
+	}
+
+	addr.sun_family = AF_UNIX;
+	g_strlcpy (addr.sun_path, socket_path, sizeof (addr.sun_path));
+
+	if (bind (fd, (struct sockaddr *)&addr, sizeof (addr)) < 0) {
+		g_critical ("failed to bind %s: %s",
+				socket_path, strerror (errno));
+		goto err;
+	}
+
+	if (chmod (socket_path, S_IRUSR | S_IWUSR) < 0
+			|| listen (fd, SOMAXCONN) < 0) {
+		g_critical ("failed to listen on %s: %s",
+				socket_path, strerror (errno));
+		(void)unlink (socket_path);
+		goto err;
+	}
+
+	return fd;
+
+err:
+	close (fd);
+	return -1;
+}
+
+/*!
+ * Forward a command to a running daemon.
+ *
+ * \param argc Argument count, as given to the runtime.
+ * \param argv Argument vector, as given to the runtime.
+ * \param[out] result Result of the command, only set if \c true is
+ *   returned.
+ *
+ * \return \c true if the daemon handled the command, \c false if no
+ * daemon is available and the command should run in process.
+ */
+gboolean
+cc_oci_daemon_forward (int argc, char **argv, gboolean *result)
+{
+	struct sockaddr_un  addr = { 0 };
+	struct stat         st;
+	const gchar        *path;
+	GByteArray         *request = NULL;
+	gchar              *cwd = NULL;
+	gboolean            ret = false;
+	guint32             status;
+	int                 fd = -1;
+
+	g_assert (argv);
+	g_assert (result);
+
+	path = g_getenv (CC_OCI_DAEMON_SOCKET_ENV);
+	if (! path) {
+		path = CC_OCI_DAEMON_SOCKET;
+	}
+
+	if (! *path || strlen (path) >= sizeof (addr.sun_path)) {
+		return false;
+	}
+
+	/* Only talk to a daemon running with our credentials */
+	if (stat (path, &st) < 0 || ! S_ISSOCK (st.st_mode)
+			|| st.st_uid != geteuid ()) {
+		return false;
+	}
+
+	fd = socket (AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd < 0) {
+		return false;
+	}
+
+	addr.sun_family = AF_UNIX;
+	g_strlcpy (addr.sun_path, path, sizeof (addr.sun_path));
+
+	if (connect (fd, (struct sockaddr *)&addr, sizeof (addr)) < 0) {
+		goto out;
+	}
+
+	cwd = g_get_current_dir ();
+	request = cc_oci_daemon_request_encode (argc, argv, cwd, environ);
+
+	if (! cc_oci_daemon_send_request (fd, request)) {
+		/* The daemon can't have run an incomplete request */
+		goto out;
+	}
+
+	/* From here on, the command may have run: never fall back */
+	ret = true;
+
+	if (! cc_oci_daemon_read_full (fd, &status, sizeof (status))) {
+		g_critical ("lost connection to daemon %s", path);
+		*result = false;
+		goto out;
+	}
+
+	*result = ntohl (status) == EXIT_SUCCESS;
+
+out:
+	if (request) {
+		g_byte_array_free (request, true);
+	}
+	g_free_if_set (cwd);
+	close (fd);
+
+	return ret;
+}
+
+/*!
+ * Run the daemon until it receives \c SIGTERM, \c SIGINT or \c SIGHUP.
+ *
+ * Running workers are waited for before returning.
+ *
+ * \param socket_path Path of the socket to listen on.
+ * \param func Function workers run.
+ *
+ * \return \c true on success, else \c false.
+ */
+gboolean
+cc_oci_daemon_run (const gchar *socket_path, cc_oci_daemon_func func)
+{
+	struct signalfd_siginfo   info;
+	struct pollfd             fds[3];
+	GHashTable               *workers = NULL;
+	GHashTable               *states = NULL;
+	gboolean                  done = false;
+	gboolean                  ret = false;
+	sigset_t                  mask;
+	sigset_t                  old_mask;
+	int                       listen_fd = -1;
+	int                       signal_fd = -1;
+	int                       cache_fds[2] = { -1, -1 };
+
+	g_assert (socket_path);
+	g_assert (func);
+
+	/* Signals are handled with a signalfd rather than GLib, whose
+	 * child watches and signal sources rely on a helper thread
+	 * forked workers wouldn't have.
+	 */
+	sigemptyset (&mask);
+	sigaddset (&mask, SIGCHLD);
+	sigaddset (&mask, SIGTERM);
+	sigaddset (&mask, SIGINT);
+	sigaddset (&mask, SIGHUP);
+
+	if (sigprocmask (SIG_BLOCK, &mask, &old_mask) < 0) {
+		g_critical ("failed to block signals: %s", strerror (errno));
+		return false;
+	}
+
+	signal_fd = signalfd (-1, &mask, SFD_CLOEXEC);
+	if (signal_fd < 0) {
+		g_critical ("failed to create signalfd: %s",
+				strerror (errno));
+		goto out;
+	}
+
+	if (socketpair (AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK,
+				0, cache_fds) < 0) {
+		g_critical ("failed to create socket pair: %s",
+				strerror (errno));
+		goto out;
+	}
+
+	listen_fd = cc_oci_daemon_listen (socket_path);
+	if (listen_fd < 0) {
+		goto out;
+	}
+
+	workers = g_hash_table_new (g_direct_hash, g_direct_equal);
+	states = g_hash_table_new_full (g_str_hash, g_str_equal,
+			g_free, cc_oci_daemon_state_free);
+
+	g_debug ("daemon listening on %s", socket_path);
+
+	while (! done) {
+		fds[0].fd = listen_fd;
+		fds[0].events = POLLIN;
+		fds[1].fd = signal_fd;
+		fds[1].events = POLLIN;
+		fds[2].fd = cache_fds[0];
+		fds[2].events = POLLIN;
+
+		if (poll (fds, G_N_ELEMENTS (fds), -1) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			g_critical ("poll failed: %s", strerror (errno));
+			break;
+		}
+
+		if ((fds[1].revents & POLLIN)
+				&& read (signal_fd, &info, sizeof (info))
+				== sizeof (info)) {
+			if (info.ssi_signo == SIGCHLD) {
+				cc_oci_daemon_reap (workers, false);
+			} else {
+				g_debug ("daemon exiting on signal %u",
+						info.ssi_signo);
+				done = true;
+			}
+		}
+
+		if (fds[2].revents & POLLIN) {
+			cc_oci_daemon_refresh (cache_fds[0], states);
+		}
+
+		if (! done && (fds[0].revents & POLLIN)) {
+			cc_oci_daemon_accept (listen_fd, signal_fd, cache_fds,
+					&old_mask, workers, states, func);
+		}
+	}
+
+	ret = done;
+
+	while (g_hash_table_size (workers)) {
+		cc_oci_daemon_reap (workers, true);
+	}
+
+out:
+	if (listen_fd >= 0) {
+		close (listen_fd);
+		(void)unlink (socket_path);
+	}
+	if (signal_fd >= 0) {
+		close (signal_fd);
+	}
+	if (cache_fds[0] >= 0) {
+		close (cache_fds[0]);
+		close (cache_fds[1]);
+	}
+	if (workers) {
+		g_hash_table_destroy (workers);
+	}
+	if (states) {
+		g_hash_table_destroy (states);
+	}
+
+	(void)sigprocmask (SIG_SETMASK, &old_mask, NULL);
+
+	return ret;
+}
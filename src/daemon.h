@@ -0,0 +1,61 @@
+/*
+ * This file is part of cc-oci-runtime.
+ *
+ * Copyright (C) 2016 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef _CC_OCI_DAEMON_H
+#define _CC_OCI_DAEMON_H
+
+#include <glib.h>
+
+#include "oci.h"
+
+/** Default path of the socket \ref command_daemon listens on. */
+#define CC_OCI_DAEMON_SOCKET	CC_OCI_RUNTIME_DIR_PREFIX "/daemon.sock"
+
+/** Environment variable overriding \ref CC_OCI_DAEMON_SOCKET for
+ * clients. If set to the empty string, the runtime never forwards
+ * commands to a daemon.
+ */
+#define CC_OCI_DAEMON_SOCKET_ENV	"CC_OCI_DAEMON_SOCKET"
+
+/** Maximum size of a request (arguments, cwd and environment). */
+#define CC_OCI_DAEMON_MAX_REQUEST	(1024 * 1024)
+
+/*!
+ * Function a daemon worker runs to handle a request.
+ *
+ * It is called in a forked child of the daemon, with the client's
+ * stdio, working directory and environment, and its return value is
+ * the client's exit status.
+ *
+ * \param argc Argument count.
+ * \param argv Argument vector, as given to the client.
+ *
+ * \return Exit status.
+ */
+typedef int (*cc_oci_daemon_func) (int argc, char **argv);
+
+extern cc_oci_daemon_func cc_oci_daemon_handler;
+
+gboolean cc_oci_daemon_forward (int argc, char **argv,
+		gboolean *result);
+gboolean cc_oci_daemon_run (const gchar *socket_path,
+		cc_oci_daemon_func func);
+
+#endif /* _CC_OCI_DAEMON_H */
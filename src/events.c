@@ -18,11 +18,21 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
  */
 
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
 #include <glib.h>
+#include <glib-unix.h>
+#include <gio/gio.h>
 #include <json-glib/json-glib.h>
 #include <stdbool.h>
+#include "common.h"
 #include "oci.h"
 #include "util.h"
+#include "pidfd.h"
+#include "state.h"
+#include "events.h"
 
 /** used by watcher_destroyed_vm() */
 struct watcher_vm_data
@@ -78,6 +88,31 @@ watcher_destroyed_vm (GFileMonitor            *monitor,
 	g_main_loop_quit (data->loop);
 }
 
+/**
+ * Stops show_container_stats main loop when the pidfd of the
+ * container VM becomes readable, denoting its shutdown.
+ *
+ * \param fd pidfd.
+ * \param condition \c GIOCondition.
+ * \param data \ref watcher_destroyed_vm.
+ *
+ * \return \c false to remove the watch.
+ */
+static gboolean
+watcher_exited_vm (gint                      fd,
+		GIOCondition                  condition,
+		struct watcher_vm_data       *data)
+{
+	(void)fd;
+	(void)condition;
+
+	g_assert (data);
+
+	g_main_loop_quit (data->loop);
+
+	return false;
+}
+
 /*!
  * Get container stats (cpu, memory, etc) in json format.
  * \param config \ref cc_oci_config.
@@ -166,6 +201,7 @@ show_container_stats(struct cc_oci_config *config,
 	GError        *error = NULL;
 	GFile         *file = NULL;
 	GFileMonitor  *monitor = NULL;
+	int            pidfd = -1;
 	struct watcher_vm_data  data = {0};
 
 	if (interval) {
@@ -177,28 +213,38 @@ show_container_stats(struct cc_oci_config *config,
 			goto out;
 		}
 
-		file = g_file_new_for_path (config->state.runtime_path);
-		if (! file) {
-			g_main_loop_unref (data.loop);
-			goto out;
-		}
-		monitor = g_file_monitor_directory (file,
-				G_FILE_MONITOR_WATCH_MOVES,
-				NULL, &error);
-		if (! monitor) {
-			g_critical ("failed to monitor %s: %s",
-					g_file_get_path (file),
-					error->message);
-			g_error_free (error);
-			g_object_unref (file);
-			g_main_loop_unref (data.loop);
+		/* Prefer a pidfd, which also notices VMs that didn't
+		 * get to remove their process socket.
+		 */
+		pidfd = cc_oci_pidfd_open (state->pid, state->pid_start_time);
+		if (pidfd >= 0) {
+			g_unix_fd_add (pidfd, G_IO_IN,
+					(GUnixFDSourceFunc) watcher_exited_vm,
+					&data);
+		} else {
+			file = g_file_new_for_path (config->state.runtime_path);
+			if (! file) {
+				g_main_loop_unref (data.loop);
+				goto out;
+			}
+			monitor = g_file_monitor_directory (file,
+					G_FILE_MONITOR_WATCH_MOVES,
+					NULL, &error);
+			if (! monitor) {
+				g_critical ("failed to monitor %s: %s",
+						g_file_get_path (file),
+						error->message);
+				g_error_free (error);
+				g_object_unref (file);
+				g_main_loop_unref (data.loop);
 
-			goto out;
-		}
+				goto out;
+			}
 
-		g_signal_connect (monitor, "changed",
-				G_CALLBACK (watcher_destroyed_vm),
-				&data);
+			g_signal_connect (monitor, "changed",
+					G_CALLBACK (watcher_destroyed_vm),
+					&data);
+		}
 
 		g_timeout_add_seconds ((guint) interval,
 				       (GSourceFunc) show_interval_stats,
@@ -216,6 +262,496 @@ show_container_stats(struct cc_oci_config *config,
 
 	result = true;
 out:
+	if (pidfd >= 0) {
+		close (pidfd);
+	}
 	g_free_if_set(stats_str);
 	return result;
 }
+
+/** used by show_all_container_events() */
+struct watcher_all_data
+{
+	GMainLoop     *loop;
+
+	/** Runtime root directory. */
+	gchar         *root_dir;
+
+	/** Containers being watched, by id (\ref watcher_container). */
+	GHashTable    *containers;
+};
+
+/** State of a container watched by show_all_container_events(). */
+struct watcher_container
+{
+	gchar                    *id;
+
+	/** Last status read from the state file
+	 * (\ref OCI_STATUS_INVALID if not read yet).
+	 */
+	enum oci_status           status;
+
+	/** Pid of the VM (or \c 0 if not known yet). */
+	GPid                      pid;
+
+	/** pidfd of the VM (or \c -1), and its watch. */
+	int                       pidfd;
+	guint                     pidfd_source;
+
+	/** If \c true, an "exit" event has been emitted. */
+	gboolean                  exited;
+
+	/** Monitor of the container runtime directory. */
+	GFileMonitor             *monitor;
+
+	struct watcher_all_data  *data;
+};
+
+/*!
+ * Display a container event as a single line of JSON.
+ *
+ * \param type Type of event.
+ * \param id Container id.
+ * \param status Container status (or \ref OCI_STATUS_INVALID).
+ * \param pid Pid of the VM (or \c 0).
+ */
+static void
+emit_container_event (const gchar *type, const gchar *id,
+		enum oci_status status, GPid pid)
+{
+	JsonObject  *root = NULL;
+	JsonObject  *data = NULL;
+	gchar       *timestamp = NULL;
+	gchar       *str = NULL;
+
+	root = json_object_new ();
+	data = json_object_new ();
+
+	timestamp = cc_oci_get_iso8601_timestamp ();
+
+	if (status != OCI_STATUS_INVALID) {
+		json_object_set_string_member (data, "status",
+				cc_oci_status_to_str (status));
+	}
+
+	if (pid) {
+		json_object_set_int_member (data, "pid", (gint64)pid);
+	}
+
+	json_object_set_string_member (root, "type", type);
+	json_object_set_string_member (root, "id", id);
+	json_object_set_string_member (root, "timestamp",
+			timestamp ? timestamp : "");
+	json_object_set_object_member (root, "data", data);
+
+	str = cc_oci_json_obj_to_string (root, false, NULL);
+	if (str) {
+		/* one event per line, displayed as soon as it happens */
+		g_print ("%s\n", str);
+		fflush (stdout);
+	}
+
+	json_object_unref (root);
+	g_free_if_set (timestamp);
+	g_free_if_set (str);
+}
+
+/*!
+ * Determine the event a change of container status denotes.
+ *
+ * \param from Previous status (or \ref OCI_STATUS_INVALID).
+ * \param to New status.
+ *
+ * \return Type of event, or \c NULL if there is no event to emit.
+ */
+private const gchar *
+container_status_event (enum oci_status from, enum oci_status to)
+{
+	if (from == to) {
+		return NULL;
+	}
+
+	switch (to) {
+	case OCI_STATUS_CREATED:
+		return "create";
+	case OCI_STATUS_RUNNING:
+		return from == OCI_STATUS_PAUSED ? "resume" : "start";
+	case OCI_STATUS_PAUSED:
+		return "pause";
+	case OCI_STATUS_STOPPED:
+		return "stop";
+	default:
+		return NULL;
+	}
+}
+
+/*!
+ * Free a \ref watcher_container.
+ *
+ * \param c \ref watcher_container.
+ */
+static void
+watcher_container_free (struct watcher_container *c)
+{
+	if (! c) {
+		return;
+	}
+
+	if (c->pidfd_source) {
+		g_source_remove (c->pidfd_source);
+	}
+
+	if (c->pidfd >= 0) {
+		close (c->pidfd);
+	}
+
+	if (c->monitor) {
+		g_file_monitor_cancel (c->monitor);
+		g_object_unref (c->monitor);
+	}
+
+	g_free (c->id);
+	g_free (c);
+}
+
+/*!
+ * Emit an "exit" event when the pidfd of a container VM becomes
+ * readable, denoting its shutdown.
+ *
+ * \param fd pidfd.
+ * \param condition \c GIOCondition.
+ * \param c \ref watcher_container.
+ *
+ * \return \c false to remove the watch.
+ */
+static gboolean
+watcher_container_exited (gint fd, GIOCondition condition,
+		struct watcher_container *c)
+{
+	(void)condition;
+
+	g_assert (c);
+
+	close (fd);
+	c->pidfd = -1;
+	c->pidfd_source = 0;
+
+	if (! c->exited) {
+		c->exited = true;
+		emit_container_event ("exit", c->id, OCI_STATUS_INVALID,
+				c->pid);
+	}
+
+	return false;
+}
+
+/*!
+ * Read the state of a container and emit the events its changes
+ * denote.
+ *
+ * \param c \ref watcher_container.
+ * \param quiet If \c true, only record the state.
+ */
+static void
+watcher_container_update (struct watcher_container *c, gboolean quiet)
+{
+	struct oci_state  *state;
+	const gchar       *type;
+
+	g_assert (c);
+
+	state = cc_oci_vm_get_state (c->id, c->data->root_dir);
+	if (! state) {
+		/* not written yet or being deleted */
+		return;
+	}
+
+	type = container_status_event (c->status, state->status);
+	if (type && ! quiet) {
+		emit_container_event (type, c->id, state->status,
+				state->pid);
+	}
+
+	c->status = state->status;
+
+	if (state->pid && ! c->pid) {
+		c->pid = state->pid;
+
+		/* Prefer a pidfd, which also notices VMs that didn't
+		 * get to remove their process socket.
+		 */
+		c->pidfd = cc_oci_pidfd_open (state->pid,
+				state->pid_start_time);
+		if (c->pidfd >= 0) {
+			c->pidfd_source = g_unix_fd_add (c->pidfd, G_IO_IN,
+					(GUnixFDSourceFunc)watcher_container_exited,
+					c);
+		} else if (! cc_oci_pid_running (state->pid,
+					state->pid_start_time)) {
+			c->exited = true;
+		}
+	}
+
+	cc_oci_state_free (state);
+}
+
+/*!
+ * Handle changes to a container runtime directory.
+ *
+ * \param monitor \c GFileMonitor.
+ * \param file \c GFile.
+ * \param other_file \c GFile.
+ * \param event_type \c GFileMonitorEvent.
+ * \param c \ref watcher_container.
+ */
+static void
+watcher_container_changed (GFileMonitor *monitor,
+		GFile                    *file,
+		GFile                    *other_file,
+		GFileMonitorEvent         event_type,
+		struct watcher_container *c)
+{
+	g_autofree gchar  *name = NULL;
+	g_autofree gchar  *other_name = NULL;
+
+	(void)monitor;
+
+	g_assert (c);
+
+	name = g_file_get_basename (file);
+	if (other_file) {
+		other_name = g_file_get_basename (other_file);
+	}
+
+	if (event_type == G_FILE_MONITOR_EVENT_DELETED) {
+		/* Without a pidfd, the VM is assumed to exit when its
+		 * process socket is removed.
+		 */
+		if (c->pidfd < 0 && c->pid && ! c->exited &&
+				! g_strcmp0 (name, CC_OCI_PROCESS_SOCKET)) {
+			c->exited = true;
+			emit_container_event ("exit", c->id,
+					OCI_STATUS_INVALID, c->pid);
+		}
+		return;
+	}
+
+	if (event_type == G_FILE_MONITOR_EVENT_MOVED_OUT) {
+		return;
+	}
+
+	/* The state file is replaced atomically, so is renamed into
+	 * place rather than modified.
+	 */
+	if (g_strcmp0 (name, CC_OCI_STATE_FILE) &&
+			g_strcmp0 (other_name, CC_OCI_STATE_FILE)) {
+		return;
+	}
+
+	watcher_container_update (c, false);
+}
+
+/*!
+ * Start watching a container.
+ *
+ * \param data \ref watcher_all_data.
+ * \param id Container id.
+ * \param quiet If \c true, don't emit events for the current state
+ * of the container.
+ */
+static void
+watcher_container_add (struct watcher_all_data *data, const gchar *id,
+		gboolean quiet)
+{
+	struct watcher_container  *c;
+	g_autofree gchar          *path = NULL;
+	GFile                     *file;
+	GError                    *error = NULL;
+
+	g_assert (data);
+	g_assert (id);
+
+	if (g_hash_table_contains (data->containers, id)) {
+		return;
+	}
+
+	path = g_build_path ("/", data->root_dir, id, NULL);
+	if (! g_file_test (path, G_FILE_TEST_IS_DIR)) {
+		return;
+	}
+
+	c = g_new0 (struct watcher_container, 1);
+	c->id = g_strdup (id);
+	c->status = OCI_STATUS_INVALID;
+	c->pidfd = -1;
+	c->data = data;
+
+	file = g_file_new_for_path (path);
+	c->monitor = g_file_monitor_directory (file,
+			G_FILE_MONITOR_WATCH_MOVES, NULL, &error);
+	g_object_unref (file);
+
+	if (! c->monitor) {
+		g_warning ("failed to monitor %s: %s", path,
+				error->message);
+		g_error_free (error);
+		watcher_container_free (c);
+		return;
+	}
+
+	g_signal_connect (c->monitor, "changed",
+			G_CALLBACK (watcher_container_changed), c);
+
+	g_hash_table_insert (data->containers, c->id, c);
+
+	/* the state file may have been written before the monitor
+	 * was set up.
+	 */
+	watcher_container_update (c, quiet);
+}
+
+/*!
+ * Handle containers being added to and removed from the runtime
+ * root directory.
+ *
+ * \param monitor \c GFileMonitor.
+ * \param file \c GFile.
+ * \param other_file \c GFile.
+ * \param event_type \c GFileMonitorEvent.
+ * \param data \ref watcher_all_data.
+ */
+static void
+watcher_root_changed (GFileMonitor *monitor,
+		GFile                    *file,
+		GFile                    *other_file,
+		GFileMonitorEvent         event_type,
+		struct watcher_all_data  *data)
+{
+	g_autofree gchar  *name = NULL;
+
+	(void)monitor;
+	(void)other_file;
+
+	g_assert (data);
+
+	name = g_file_get_basename (file);
+	if (! name) {
+		return;
+	}
+
+	switch (event_type) {
+	case G_FILE_MONITOR_EVENT_CREATED:
+	case G_FILE_MONITOR_EVENT_MOVED_IN:
+		watcher_container_add (data, name, false);
+		break;
+	case G_FILE_MONITOR_EVENT_DELETED:
+	case G_FILE_MONITOR_EVENT_MOVED_OUT:
+		if (g_hash_table_contains (data->containers, name)) {
+			emit_container_event ("delete", name,
+					OCI_STATUS_INVALID, 0);
+			g_hash_table_remove (data->containers, name);
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+/*!
+ * Show the events of all containers.
+ *
+ * The runtime root directory is watched for containers being created
+ * and deleted, and the runtime directory of each container for its
+ * state changing. A JSON object is displayed on its own line for
+ * every event: "create", "start", "pause", "resume", "stop" and
+ * "delete" as the state of containers change, and "exit" when the
+ * VM of a container exits. Events are only reported for changes made
+ * after this function is called.
+ *
+ * This function blocks until the main loop is stopped.
+ *
+ * \param config \ref cc_oci_config.
+ *
+ * \return \c true on success, else \c false.
+ */
+gboolean
+show_all_container_events (struct cc_oci_config *config)
+{
+	struct watcher_all_data  data = { 0 };
+	GFile                   *file = NULL;
+	GFileMonitor            *monitor = NULL;
+	GError                  *error = NULL;
+	GDir                    *dir = NULL;
+	const gchar             *name;
+	gboolean                 ret = false;
+
+	if (! config) {
+		return false;
+	}
+
+	data.root_dir = g_strdup (config->root_dir
+			? config->root_dir
+			: CC_OCI_RUNTIME_DIR_PREFIX);
+
+	/* No containers yet, so the directory may not exist */
+	if (g_mkdir_with_parents (data.root_dir, CC_OCI_DIR_MODE)) {
+		g_critical ("failed to create directory %s: %s",
+				data.root_dir, strerror (errno));
+		goto out;
+	}
+
+	data.containers = g_hash_table_new_full (g_str_hash, g_str_equal,
+			NULL, (GDestroyNotify)watcher_container_free);
+
+	data.loop = g_main_loop_new (NULL, 0);
+	if (! data.loop) {
+		g_critical ("cannot create main loop");
+		goto out;
+	}
+
+	/* Watch the root directory before listing it, so no container
+	 * created meanwhile is missed.
+	 */
+	file = g_file_new_for_path (data.root_dir);
+	monitor = g_file_monitor_directory (file,
+			G_FILE_MONITOR_WATCH_MOVES, NULL, &error);
+	if (! monitor) {
+		g_critical ("failed to monitor %s: %s", data.root_dir,
+				error->message);
+		g_error_free (error);
+		goto out;
+	}
+
+	g_signal_connect (monitor, "changed",
+			G_CALLBACK (watcher_root_changed), &data);
+
+	dir = g_dir_open (data.root_dir, 0x0, NULL);
+	if (dir) {
+		while ((name = g_dir_read_name (dir)) != NULL) {
+			watcher_container_add (&data, name, true);
+		}
+		g_dir_close (dir);
+	}
+
+	g_main_loop_run (data.loop);
+
+	ret = true;
+
+out:
+	if (monitor) {
+		g_file_monitor_cancel (monitor);
+		g_object_unref (monitor);
+	}
+	if (file) {
+		g_object_unref (file);
+	}
+	if (data.containers) {
+		g_hash_table_destroy (data.containers);
+	}
+	if (data.loop) {
+		g_main_loop_unref (data.loop);
+	}
+	g_free (data.root_dir);
+
+	return ret;
+}
@@ -24,4 +24,6 @@
 gboolean
 show_container_stats(struct cc_oci_config *config,
 	struct oci_state *state, int interval);
+gboolean
+show_all_container_events(struct cc_oci_config *config);
 #endif /* _CC_OCI_EVENTS_H */
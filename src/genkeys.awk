@@ -0,0 +1,161 @@
+#  This file is part of cc-oci-runtime.
+#
+#  Copyright (C) 2016 Intel Corporation
+#
+#  This program is free software; you can redistribute it and/or
+#  modify it under the terms of the GNU General Public License
+#  as published by the Free Software Foundation; either version 2
+#  of the License, or (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program; if not, write to the Free Software
+#  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+# Generate a perfect hash table of keys for cc_oci_key_lookup().
+#
+# Usage: awk -v output=header|source -f genkeys.awk <file>.keys
+#
+# The input lists one key per line as "<name> <enum value>", after
+# the directives:
+#
+#   %doc <text>     doc comment of the enum.
+#   %enum <name>    name of the enum of key ids (in input order).
+#   %table <name>   name of the \ref cc_oci_key_table.
+#   %count <name>   optional enum value after the last key.
+#
+# Lines starting with '#' are comments.
+#
+# "header" output declares the enum and the table, "source" output
+# defines the table. The table size and hash seed are the first pair
+# for which cc_oci_key_hash() (src/keys.c) gives each key a slot of
+# its own, so a lookup is one hash and one string compare.
+
+function die(msg) {
+	printf ("%s:%d: %s\n", FILENAME, FNR, msg) > "/dev/stderr"
+	failed = 1
+	exit 1
+}
+
+# Must match cc_oci_key_hash(), which wraps modulo 2^32 (with seeds
+# below 2^21 the values stay below 2^53 so are exact in awk).
+function hash(seed, name,    h, i) {
+	h = 0
+	for (i = 1; i <= length (name); i++) {
+		h = (h * seed + ord[substr (name, i, 1)]) % 4294967296
+	}
+	return h
+}
+
+BEGIN {
+	for (i = 1; i < 128; i++) {
+		ord[sprintf ("%c", i)] = i
+	}
+	n = 0
+}
+
+/^[ \t]*(#|$)/ { next }
+
+$1 == "%doc" {
+	sub (/^%doc[ \t]+/, "")
+	doc = $0
+	next
+}
+
+$1 == "%enum" { enum_name = $2; next }
+$1 == "%table" { table = $2; next }
+$1 == "%count" { count = $2; next }
+
+/^%/ { die("unknown directive " $1) }
+
+{
+	if (NF != 2 || $1 !~ /^[A-Za-z0-9_.-]+$/) {
+		die("expected \"<name> <enum value>\"")
+	}
+	if ($1 in seen) {
+		die("duplicate key " $1)
+	}
+	seen[$1] = 1
+	names[n] = $1
+	ids[n] = $2
+	n++
+}
+
+END {
+	if (failed) {
+		exit 1
+	}
+	if (! (enum_name && table && n)) {
+		die("%enum, %table and at least one key are required")
+	}
+	if (output != "header" && output != "source") {
+		die("output must be \"header\" or \"source\"")
+	}
+
+	size = 0
+	for (s = n; s <= 4 * n && ! size; s++) {
+		for (seed = 1; seed < 4096; seed++) {
+			delete used
+			for (i = 0; i < n; i++) {
+				slot = hash(seed, names[i]) % s
+				if (slot in used) {
+					break
+				}
+				used[slot] = i
+			}
+			if (i == n) {
+				size = s
+				break
+			}
+		}
+	}
+	if (! size) {
+		die("no perfect hash found")
+	}
+
+	base = FILENAME
+	sub (/.*\//, "", base)
+	sub (/\.keys$/, "", base)
+
+	printf ("/* Generated from %s.keys by genkeys.awk: do not edit. */\n\n",
+		base)
+
+	if (output == "header") {
+		guard = "_CC_OCI_" toupper (table) "_H"
+		printf ("#ifndef %s\n#define %s\n\n", guard, guard)
+		printf ("#include \"keys.h\"\n\n")
+		if (doc) {
+			printf ("/** %s */\n", doc)
+		}
+		printf ("enum %s {\n", enum_name)
+		for (i = 0; i < n; i++) {
+			printf ("\t%s,\n", ids[i])
+		}
+		if (count) {
+			printf ("\n\t%s\n", count)
+		}
+		printf ("};\n\n")
+		printf ("extern const struct cc_oci_key_table %s;\n\n", table)
+		printf ("#endif /* %s */\n", guard)
+		exit 0
+	}
+
+	printf ("#include \"keys.h\"\n")
+	printf ("#include \"%s-keys.h\"\n\n", base)
+	printf ("static const struct cc_oci_key %s_slots[%d] =\n{\n",
+		table, size)
+	for (slot = 0; slot < size; slot++) {
+		if (slot in used) {
+			i = used[slot]
+			printf ("\t[%d] = { \"%s\", %s },\n", slot,
+				names[i], ids[i])
+		}
+	}
+	printf ("};\n\n")
+	printf ("const struct cc_oci_key_table %s =\n", table)
+	printf ("\t{ %s_slots, %d, %d };\n", table, size, seed)
+}
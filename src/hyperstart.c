@@ -0,0 +1,2040 @@
+/*
+ * This file is part of cc-oci-runtime.
+ *
+ * Copyright (C) 2016 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/** \file
+ *
+ * Client for the hyperstart agent running inside the VM.
+ *
+ * hyperstart exposes two channels, both available on the host as
+ * named sockets created by the hypervisor:
+ *
+ * - the control channel (\ref CC_OCI_AGENT_CTL_SOCKET) carries
+ *   commands and their replies. Each message is an 8-byte header
+ *   (big-endian 32-bit command code, big-endian 32-bit length
+ *   including the header) followed by a JSON payload.
+ *
+ * - the tty channel (\ref CC_OCI_AGENT_TTY_SOCKET) carries process
+ *   I/O. Each message is a 12-byte header (big-endian 64-bit
+ *   sequence number, big-endian 32-bit length including the header)
+ *   followed by raw data. Streams are identified by their sequence
+ *   number; an empty message closes a stream.
+ *
+ * The hypervisor only accepts one client on each channel. While the
+ * workload of a \ref CC_OCI_VM_BOOT_AGENT VM runs, its relay
+ * (\ref cc_oci_hyper_run_workload) holds both channels, so other
+ * commands reach the agent through the relay socket
+ * (\ref CC_OCI_AGENT_RELAY_SOCKET) instead, which carries both
+ * channels (see \ref cc_oci_hyper_channel).
+ *
+ * See: https://github.com/hyperhq/hyperstart
+ */
+
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <termios.h>
+#include <sys/ioctl.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+#include <gio/gunixsocketaddress.h>
+#include <json-glib/json-glib.h>
+
+#include "common.h"
+#include "util.h"
+#include "hyperstart.h"
+
+/** 9p mount tag of the container rootfs share
+ * (see "rootfs" in hypervisor.args).
+ */
+#define CC_OCI_HYPER_SHARE_TAG "rootfs"
+
+/** Default PATH for commands run by \ref cc_oci_hyper_exec. */
+#define CC_OCI_HYPER_EXEC_PATH \
+	"/usr/local/sbin:/usr/local/bin:/usr/sbin:/usr/bin:/sbin:/bin"
+
+/** Data shared by the \ref cc_oci_hyper_exec watchers. */
+struct cc_oci_hyper_exec_data {
+	GMainLoop                 *loop;
+	struct cc_oci_hyper_conn  *conn;
+
+	/** Sequence number of the process stdin/stdout. */
+	guint64                    stdio_seq;
+
+	/** Sequence number of the process stderr (0 if a terminal). */
+	guint64                    stderr_seq;
+
+	/** Set when hyperstart closes the stdout stream. */
+	gboolean                   stdout_closed;
+
+	/** Exit code of the process. */
+	gint                       exit_code;
+
+	/** Set if the exit code was received. */
+	gboolean                   exited;
+
+	/** Source id of the tty channel watcher (0 once removed). */
+	guint                      tty_watch;
+
+	/** Source id of the stdin watcher (0 once removed). */
+	guint                      stdin_watch;
+
+	/** Listening socket of the agent relay (or \c NULL). */
+	GSocket                   *relay;
+
+	/** Source id of the relay socket watcher (0 once removed). */
+	guint                      relay_watch;
+
+	/** Clients of the relay (\ref cc_oci_hyper_relay_client). */
+	GSList                    *clients;
+
+	/** Streams of relay clients: sequence number to
+	 * \ref cc_oci_hyper_relay_client.
+	 */
+	GHashTable                *routes;
+};
+
+/** Process using the agent through the workload relay. */
+struct cc_oci_hyper_relay_client {
+	GSocket                        *socket;
+	GIOChannel                     *io;
+
+	/** Source id of the client watcher (0 once removed). */
+	guint                           watch;
+
+	struct cc_oci_hyper_exec_data  *data;
+};
+
+/*!
+ * Write a hyperstart control message header.
+ *
+ * \param buf Buffer of at least \ref CC_OCI_HYPER_CTL_HEADER_SIZE bytes.
+ * \param cmd \ref cc_oci_hyper_cmd.
+ * \param len Total message length (header included).
+ */
+private void
+cc_oci_hyper_ctl_header_set (guint8 *buf, guint32 cmd, guint32 len)
+{
+	guint32 be;
+
+	be = GUINT32_TO_BE (cmd);
+	memcpy (buf, &be, sizeof (be));
+
+	be = GUINT32_TO_BE (len);
+	memcpy (buf + sizeof (be), &be, sizeof (be));
+}
+
+/*!
+ * Write a hyperstart tty message header.
+ *
+ * \param buf Buffer of at least \ref CC_OCI_HYPER_TTY_HEADER_SIZE bytes.
+ * \param seq Sequence number of the stream.
+ * \param len Total message length (header included).
+ */
+private void
+cc_oci_hyper_tty_header_set (guint8 *buf, guint64 seq, guint32 len)
+{
+	guint64 be64;
+	guint32 be32;
+
+	be64 = GUINT64_TO_BE (seq);
+	memcpy (buf, &be64, sizeof (be64));
+
+	be32 = GUINT32_TO_BE (len);
+	memcpy (buf + sizeof (be64), &be32, sizeof (be32));
+}
+
+/*!
+ * Read a big-endian 32-bit value.
+ *
+ * \param buf Buffer to read from.
+ *
+ * \return Value in host byte order.
+ */
+private guint32
+cc_oci_hyper_get_be32 (const guint8 *buf)
+{
+	guint32 be;
+
+	memcpy (&be, buf, sizeof (be));
+
+	return GUINT32_FROM_BE (be);
+}
+
+/*!
+ * Read a big-endian 64-bit value.
+ *
+ * \param buf Buffer to read from.
+ *
+ * \return Value in host byte order.
+ */
+private guint64
+cc_oci_hyper_get_be64 (const guint8 *buf)
+{
+	guint64 be;
+
+	memcpy (&be, buf, sizeof (be));
+
+	return GUINT64_FROM_BE (be);
+}
+
+/*!
+ * Read exactly \p len bytes from \p socket.
+ *
+ * \param socket GSocket.
+ * \param buf Buffer to fill.
+ * \param len Number of bytes to read.
+ *
+ * \return \c true on success, else \c false.
+ */
+static gboolean
+cc_oci_hyper_recv_full (GSocket *socket, guint8 *buf, gsize len)
+{
+	GError  *error = NULL;
+	gssize   bytes;
+	gsize    done = 0;
+
+	while (done < len) {
+		bytes = g_socket_receive (socket, (gchar *)buf + done,
+				len - done, NULL, &error);
+		if (bytes <= 0) {
+			if (error) {
+				g_critical ("failed to read from agent: %s",
+						error->message);
+				g_error_free (error);
+			}
+			return false;
+		}
+
+		done += (gsize)bytes;
+	}
+
+	return true;
+}
+
+/*!
+ * Write exactly \p len bytes to \p socket.
+ *
+ * \param socket GSocket.
+ * \param buf Data to write.
+ * \param len Number of bytes to write.
+ *
+ * \return \c true on success, else \c false.
+ */
+static gboolean
+cc_oci_hyper_send_full (GSocket *socket, const guint8 *buf, gsize len)
+{
+	GError  *error = NULL;
+	gssize   bytes;
+	gsize    done = 0;
+
+	while (done < len) {
+		bytes = g_socket_send (socket, (const gchar *)buf + done,
+				len - done, NULL, &error);
+		if (bytes < 0) {
+			g_critical ("failed to write to agent: %s",
+					error->message);
+			g_error_free (error);
+			return false;
+		}
+
+		done += (gsize)bytes;
+	}
+
+	return true;
+}
+
+/*!
+ * Write exactly \p len bytes to file descriptor \p fd.
+ *
+ * \param fd File descriptor.
+ * \param buf Data to write.
+ * \param len Number of bytes to write.
+ *
+ * \return \c true on success, else \c false.
+ */
+static gboolean
+cc_oci_hyper_write_fd (int fd, const guint8 *buf, gsize len)
+{
+	ssize_t  bytes;
+	gsize    done = 0;
+
+	while (done < len) {
+		bytes = write (fd, buf + done, len - done);
+		if (bytes < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return false;
+		}
+
+		done += (gsize)bytes;
+	}
+
+	return true;
+}
+
+/*!
+ * Read a complete message from an agent channel.
+ *
+ * \param socket GSocket.
+ * \param channel \ref cc_oci_hyper_channel the message belongs to.
+ * \param[out] msg Newly-allocated message (header included).
+ *
+ * \return \c true on success, else \c false.
+ */
+static gboolean
+cc_oci_hyper_recv_msg (GSocket *socket, enum cc_oci_hyper_channel channel,
+		GByteArray **msg)
+{
+	guint8       header[CC_OCI_HYPER_TTY_HEADER_SIZE];
+	gsize        header_size;
+	guint32      msg_len;
+	GByteArray  *buf;
+
+	header_size = channel == CC_OCI_HYPER_CHANNEL_CTL
+		? CC_OCI_HYPER_CTL_HEADER_SIZE
+		: CC_OCI_HYPER_TTY_HEADER_SIZE;
+
+	if (! cc_oci_hyper_recv_full (socket, header, header_size)) {
+		return false;
+	}
+
+	/* the length is the last field of both headers */
+	msg_len = cc_oci_hyper_get_be32 (header + header_size
+			- sizeof (guint32));
+
+	if (msg_len < header_size || msg_len > CC_OCI_HYPER_MAX_MSG_SIZE) {
+		g_critical ("invalid agent message length %u", msg_len);
+		return false;
+	}
+
+	buf = g_byte_array_sized_new (msg_len);
+	g_byte_array_append (buf, header, (guint)header_size);
+	g_byte_array_set_size (buf, msg_len);
+
+	if (! cc_oci_hyper_recv_full (socket, buf->data + header_size,
+				msg_len - header_size)) {
+		g_byte_array_free (buf, true);
+		return false;
+	}
+
+	*msg = buf;
+
+	return true;
+}
+
+/*!
+ * Read a message from a connection to the agent relay.
+ *
+ * \param socket GSocket.
+ * \param[out] channel \ref cc_oci_hyper_channel of the message.
+ * \param[out] msg Newly-allocated message (header included,
+ *   channel excluded).
+ *
+ * \return \c true on success, else \c false.
+ */
+static gboolean
+cc_oci_hyper_relay_recv (GSocket *socket,
+		enum cc_oci_hyper_channel *channel, GByteArray **msg)
+{
+	guint8  tag;
+
+	if (! cc_oci_hyper_recv_full (socket, &tag, sizeof (tag))) {
+		return false;
+	}
+
+	if (tag != CC_OCI_HYPER_CHANNEL_CTL &&
+			tag != CC_OCI_HYPER_CHANNEL_TTY) {
+		g_critical ("invalid agent relay channel %u", tag);
+		return false;
+	}
+
+	*channel = (enum cc_oci_hyper_channel)tag;
+
+	return cc_oci_hyper_recv_msg (socket, *channel, msg);
+}
+
+/*!
+ * Write a message to a connection to the agent relay.
+ *
+ * \param socket GSocket.
+ * \param channel \ref cc_oci_hyper_channel of the message.
+ * \param header Message header.
+ * \param header_size Size of \p header.
+ * \param data Message data.
+ * \param len Length of \p data.
+ *
+ * \return \c true on success, else \c false.
+ */
+static gboolean
+cc_oci_hyper_relay_send (GSocket *socket,
+		enum cc_oci_hyper_channel channel,
+		const guint8 *header, gsize header_size,
+		const guint8 *data, gsize len)
+{
+	guint8    *buf;
+	gboolean   ret;
+
+	/* a single write, so messages of several writers can't mix */
+	buf = g_malloc (1 + header_size + len);
+	buf[0] = (guint8)channel;
+	memcpy (buf + 1, header, header_size);
+	if (len) {
+		memcpy (buf + 1 + header_size, data, len);
+	}
+
+	ret = cc_oci_hyper_send_full (socket, buf, 1 + header_size + len);
+
+	g_free (buf);
+
+	return ret;
+}
+
+/*!
+ * Write a message to an agent channel, directly or through the relay.
+ *
+ * \param conn \ref cc_oci_hyper_conn.
+ * \param channel \ref cc_oci_hyper_channel.
+ * \param msg Message (header included).
+ * \param len Length of \p msg.
+ *
+ * \return \c true on success, else \c false.
+ */
+static gboolean
+cc_oci_hyper_conn_send (struct cc_oci_hyper_conn *conn,
+		enum cc_oci_hyper_channel channel,
+		const guint8 *msg, gsize len)
+{
+	GSocket *socket;
+
+	if (conn->relay) {
+		return cc_oci_hyper_relay_send (conn->relay, channel,
+				msg, len, NULL, 0);
+	}
+
+	socket = channel == CC_OCI_HYPER_CHANNEL_CTL ? conn->ctl : conn->tty;
+	if (! socket) {
+		return false;
+	}
+
+	return cc_oci_hyper_send_full (socket, msg, len);
+}
+
+/*!
+ * Read the next message of an agent channel, directly or through
+ * the relay.
+ *
+ * The relay carries both channels, so tty messages received while
+ * waiting for a control reply are kept for \ref cc_oci_hyper_tty_recv.
+ *
+ * \param conn \ref cc_oci_hyper_conn.
+ * \param channel \ref cc_oci_hyper_channel.
+ * \param[out] msg Newly-allocated message (header included).
+ *
+ * \return \c true on success, else \c false.
+ */
+static gboolean
+cc_oci_hyper_conn_recv (struct cc_oci_hyper_conn *conn,
+		enum cc_oci_hyper_channel channel, GByteArray **msg)
+{
+	enum cc_oci_hyper_channel   got;
+	GByteArray                 *buf = NULL;
+	GSocket                    *socket;
+
+	if (! conn->relay) {
+		socket = channel == CC_OCI_HYPER_CHANNEL_CTL
+			? conn->ctl : conn->tty;
+		if (! socket) {
+			return false;
+		}
+
+		return cc_oci_hyper_recv_msg (socket, channel, msg);
+	}
+
+	if (channel == CC_OCI_HYPER_CHANNEL_TTY && conn->pending &&
+			! g_queue_is_empty (conn->pending)) {
+		*msg = g_queue_pop_head (conn->pending);
+		return true;
+	}
+
+	while (true) {
+		if (! cc_oci_hyper_relay_recv (conn->relay, &got, &buf)) {
+			return false;
+		}
+
+		if (got == channel) {
+			*msg = buf;
+			return true;
+		}
+
+		if (got == CC_OCI_HYPER_CHANNEL_TTY) {
+			if (! conn->pending) {
+				conn->pending = g_queue_new ();
+			}
+			g_queue_push_tail (conn->pending, buf);
+		} else {
+			g_debug ("ignoring unexpected agent control message");
+			g_byte_array_free (buf, true);
+		}
+	}
+}
+
+/*!
+ * Connect to the named socket at \p path.
+ *
+ * \param path Full path to the socket.
+ *
+ * \return Connected GSocket on success, else \c NULL.
+ */
+static GSocket *
+cc_oci_hyper_socket_connect (const gchar *path)
+{
+	GSocket         *socket = NULL;
+	GSocketAddress  *addr = NULL;
+	GError          *error = NULL;
+
+	socket = g_socket_new (G_SOCKET_FAMILY_UNIX,
+			G_SOCKET_TYPE_STREAM, 0, &error);
+	if (! socket) {
+		g_critical ("failed to create socket: %s", error->message);
+		g_error_free (error);
+		return NULL;
+	}
+
+	addr = g_unix_socket_address_new (path);
+	if (! addr) {
+		g_critical ("failed to create socket address for %s", path);
+		goto err;
+	}
+
+	if (! g_socket_connect (socket, addr, NULL, &error)) {
+		g_critical ("failed to connect to %s: %s",
+				path, error->message);
+		g_error_free (error);
+		goto err;
+	}
+
+	g_object_unref (addr);
+
+	return socket;
+
+err:
+	if (addr) {
+		g_object_unref (addr);
+	}
+	g_object_unref (socket);
+
+	return NULL;
+}
+
+/*!
+ * Connect to the hyperstart control channel of a VM only.
+ *
+ * This is sufficient for commands that do not involve process I/O.
+ *
+ * \param conn \ref cc_oci_hyper_conn.
+ * \param runtime_path Runtime directory containing the agent sockets.
+ *
+ * \return \c true on success, else \c false.
+ */
+gboolean
+cc_oci_hyper_connect_ctl (struct cc_oci_hyper_conn *conn,
+		const gchar *runtime_path)
+{
+	gchar *path = NULL;
+
+	if (! (conn && runtime_path && *runtime_path)) {
+		return false;
+	}
+
+	conn->ctl = NULL;
+	conn->tty = NULL;
+	conn->relay = NULL;
+	conn->pending = NULL;
+
+	path = g_build_path ("/", runtime_path,
+			CC_OCI_AGENT_CTL_SOCKET, NULL);
+	conn->ctl = cc_oci_hyper_socket_connect (path);
+	g_free (path);
+
+	return conn->ctl != NULL;
+}
+
+/*!
+ * Connect to the hyperstart channels of a VM.
+ *
+ * \param conn \ref cc_oci_hyper_conn.
+ * \param runtime_path Runtime directory containing the agent sockets.
+ *
+ * \return \c true on success, else \c false.
+ */
+gboolean
+cc_oci_hyper_connect (struct cc_oci_hyper_conn *conn,
+		const gchar *runtime_path)
+{
+	gchar *path = NULL;
+
+	if (! cc_oci_hyper_connect_ctl (conn, runtime_path)) {
+		return false;
+	}
+
+	path = g_build_path ("/", runtime_path,
+			CC_OCI_AGENT_TTY_SOCKET, NULL);
+	conn->tty = cc_oci_hyper_socket_connect (path);
+	g_free (path);
+	if (! conn->tty) {
+		cc_oci_hyper_disconnect (conn);
+		return false;
+	}
+
+	return true;
+}
+
+/*!
+ * Connect to the hyperstart channels of a VM through the workload
+ * relay (see \ref cc_oci_hyper_relay_listen).
+ *
+ * \param conn \ref cc_oci_hyper_conn.
+ * \param runtime_path Runtime directory containing the relay socket.
+ *
+ * \return \c true on success, else \c false.
+ */
+gboolean
+cc_oci_hyper_connect_relay (struct cc_oci_hyper_conn *conn,
+		const gchar *runtime_path)
+{
+	gchar *path = NULL;
+
+	if (! (conn && runtime_path && *runtime_path)) {
+		return false;
+	}
+
+	conn->ctl = NULL;
+	conn->tty = NULL;
+	conn->pending = NULL;
+
+	path = g_build_path ("/", runtime_path,
+			CC_OCI_AGENT_RELAY_SOCKET, NULL);
+	conn->relay = cc_oci_hyper_socket_connect (path);
+	g_free (path);
+
+	return conn->relay != NULL;
+}
+
+/*!
+ * Connect to the agent of the VM of a container.
+ *
+ * VMs booted with \ref CC_OCI_VM_BOOT_AGENT are reached through the
+ * relay of their workload, which holds the agent channels.
+ *
+ * \param conn \ref cc_oci_hyper_conn.
+ * \param config \ref cc_oci_config.
+ * \param ctl_only If \c true, the tty channel is not needed.
+ *
+ * \return \c true on success, else \c false.
+ */
+static gboolean
+cc_oci_hyper_connect_config (struct cc_oci_hyper_conn *conn,
+		const struct cc_oci_config *config, gboolean ctl_only)
+{
+	if (config->vm && config->vm->boot == CC_OCI_VM_BOOT_AGENT) {
+		return cc_oci_hyper_connect_relay (conn,
+				config->state.runtime_path);
+	}
+
+	if (ctl_only) {
+		return cc_oci_hyper_connect_ctl (conn,
+				config->state.runtime_path);
+	}
+
+	return cc_oci_hyper_connect (conn, config->state.runtime_path);
+}
+
+/*!
+ * Close the hyperstart channels.
+ *
+ * \param conn \ref cc_oci_hyper_conn.
+ */
+void
+cc_oci_hyper_disconnect (struct cc_oci_hyper_conn *conn)
+{
+	if (! conn) {
+		return;
+	}
+
+	if (conn->ctl) {
+		g_object_unref (conn->ctl);
+		conn->ctl = NULL;
+	}
+
+	if (conn->tty) {
+		g_object_unref (conn->tty);
+		conn->tty = NULL;
+	}
+
+	if (conn->relay) {
+		g_object_unref (conn->relay);
+		conn->relay = NULL;
+	}
+
+	if (conn->pending) {
+		g_queue_free_full (conn->pending,
+				(GDestroyNotify)g_byte_array_unref);
+		conn->pending = NULL;
+	}
+}
+
+/*!
+ * Send a command on the control channel and wait for its reply.
+ *
+ * \ref CC_OCI_HYPER_NEXT and \ref CC_OCI_HYPER_READY messages
+ * received while waiting are ignored.
+ *
+ * \param conn \ref cc_oci_hyper_conn.
+ * \param cmd \ref cc_oci_hyper_cmd.
+ * \param payload JSON payload (may be \c NULL).
+ * \param len Length of \p payload.
+ * \param[out] code \ref CC_OCI_HYPER_ACK or \ref CC_OCI_HYPER_ERROR.
+ * \param[out] reply Payload of the reply.
+ *
+ * \return \c true if the agent replied, else \c false.
+ */
+static gboolean
+cc_oci_hyper_ctl_request (struct cc_oci_hyper_conn *conn,
+		guint32 cmd, const gchar *payload, gsize len,
+		guint32 *code, GByteArray **reply)
+{
+	guint8       *msg = NULL;
+	GByteArray   *body = NULL;
+	guint32       msg_code;
+	gboolean      ret;
+
+	if (! (conn && (conn->ctl || conn->relay))) {
+		return false;
+	}
+
+	if (len > CC_OCI_HYPER_MAX_MSG_SIZE - CC_OCI_HYPER_CTL_HEADER_SIZE) {
+		g_critical ("agent command %u too large (%lu bytes)",
+				cmd, (unsigned long)len);
+		return false;
+	}
+
+	msg = g_malloc (CC_OCI_HYPER_CTL_HEADER_SIZE + len);
+	cc_oci_hyper_ctl_header_set (msg, cmd,
+			(guint32)(CC_OCI_HYPER_CTL_HEADER_SIZE + len));
+	if (len) {
+		memcpy (msg + CC_OCI_HYPER_CTL_HEADER_SIZE, payload, len);
+	}
+
+	ret = cc_oci_hyper_conn_send (conn, CC_OCI_HYPER_CHANNEL_CTL,
+			msg, CC_OCI_HYPER_CTL_HEADER_SIZE + len);
+	g_free (msg);
+	if (! ret) {
+		return false;
+	}
+
+	while (true) {
+		if (! cc_oci_hyper_conn_recv (conn, CC_OCI_HYPER_CHANNEL_CTL,
+					&body)) {
+			return false;
+		}
+
+		msg_code = cc_oci_hyper_get_be32 (body->data);
+
+		if (msg_code == CC_OCI_HYPER_ACK ||
+				msg_code == CC_OCI_HYPER_ERROR) {
+			break;
+		}
+
+		if (msg_code != CC_OCI_HYPER_NEXT &&
+				msg_code != CC_OCI_HYPER_READY) {
+			g_debug ("ignoring agent message %u", msg_code);
+		}
+
+		g_byte_array_free (body, true);
+	}
+
+	g_byte_array_remove_range (body, 0, CC_OCI_HYPER_CTL_HEADER_SIZE);
+
+	*code = msg_code;
+	*reply = body;
+
+	return true;
+}
+
+/*!
+ * Send a command on the control channel and wait for its result.
+ *
+ * \ref CC_OCI_HYPER_NEXT and \ref CC_OCI_HYPER_READY messages
+ * received while waiting are ignored.
+ *
+ * \param conn \ref cc_oci_hyper_conn.
+ * \param cmd \ref cc_oci_hyper_cmd.
+ * \param payload JSON payload (may be \c NULL).
+ * \param len Length of \p payload.
+ * \param[out] reply If not \c NULL, payload of the \ref
+ *   CC_OCI_HYPER_ACK reply.
+ *
+ * \return \c true if the agent acknowledged the command,
+ * else \c false.
+ */
+gboolean
+cc_oci_hyper_ctl_cmd (struct cc_oci_hyper_conn *conn,
+		guint32 cmd, const gchar *payload, gsize len,
+		GByteArray **reply)
+{
+	GByteArray  *body = NULL;
+	guint32      code;
+
+	if (! cc_oci_hyper_ctl_request (conn, cmd, payload, len,
+				&code, &body)) {
+		return false;
+	}
+
+	if (code == CC_OCI_HYPER_ERROR) {
+		g_critical ("agent failed command %u: %.*s", cmd,
+				(int)body->len, (const gchar *)body->data);
+		g_byte_array_free (body, true);
+		return false;
+	}
+
+	if (reply) {
+		*reply = body;
+	} else {
+		g_byte_array_free (body, true);
+	}
+
+	return true;
+}
+
+/*!
+ * Send data to a stream on the tty channel.
+ *
+ * \param conn \ref cc_oci_hyper_conn.
+ * \param seq Sequence number of the stream.
+ * \param data Data to send.
+ * \param len Length of \p data (0 closes the stream).
+ *
+ * \return \c true on success, else \c false.
+ */
+gboolean
+cc_oci_hyper_tty_send (struct cc_oci_hyper_conn *conn,
+		guint64 seq, const guint8 *data, gsize len)
+{
+	guint8    msg[CC_OCI_HYPER_MAX_MSG_SIZE];
+	gsize     chunk;
+
+	if (! (conn && (conn->tty || conn->relay))) {
+		return false;
+	}
+
+	do {
+		chunk = MIN (len, sizeof (msg) - CC_OCI_HYPER_TTY_HEADER_SIZE);
+
+		cc_oci_hyper_tty_header_set (msg, seq,
+			(guint32)(CC_OCI_HYPER_TTY_HEADER_SIZE + chunk));
+		if (chunk) {
+			memcpy (msg + CC_OCI_HYPER_TTY_HEADER_SIZE, data, chunk);
+		}
+
+		if (! cc_oci_hyper_conn_send (conn, CC_OCI_HYPER_CHANNEL_TTY,
+					msg,
+					CC_OCI_HYPER_TTY_HEADER_SIZE + chunk)) {
+			return false;
+		}
+
+		data += chunk;
+		len -= chunk;
+	} while (len);
+
+	return true;
+}
+
+/*!
+ * Receive the next message from the tty channel.
+ *
+ * \param conn \ref cc_oci_hyper_conn.
+ * \param[out] seq Sequence number of the stream.
+ * \param[out] data Newly-allocated message data (empty if the
+ *   stream was closed).
+ *
+ * \return \c true on success, else \c false.
+ */
+gboolean
+cc_oci_hyper_tty_recv (struct cc_oci_hyper_conn *conn,
+		guint64 *seq, GByteArray **data)
+{
+	GByteArray  *msg = NULL;
+
+	if (! (conn && (conn->tty || conn->relay) && seq && data)) {
+		return false;
+	}
+
+	if (! cc_oci_hyper_conn_recv (conn, CC_OCI_HYPER_CHANNEL_TTY, &msg)) {
+		return false;
+	}
+
+	*seq = cc_oci_hyper_get_be64 (msg->data);
+
+	g_byte_array_remove_range (msg, 0, CC_OCI_HYPER_TTY_HEADER_SIZE);
+
+	*data = msg;
+
+	return true;
+}
+
+/*!
+ * Determine if tty messages received through the relay are waiting
+ * to be read by \ref cc_oci_hyper_tty_recv.
+ *
+ * \param conn \ref cc_oci_hyper_conn.
+ *
+ * \return \c true if messages are pending, else \c false.
+ */
+static gboolean
+cc_oci_hyper_tty_pending (const struct cc_oci_hyper_conn *conn)
+{
+	return conn->pending && ! g_queue_is_empty (conn->pending);
+}
+
+/*!
+ * Create the "envs" array of a hyperstart process.
+ *
+ * Variables of \p env without a name are skipped. \c PATH is set to
+ * \ref CC_OCI_HYPER_EXEC_PATH (as container-workload.service does)
+ * and \c TERM to \p term unless \p env sets them.
+ *
+ * \param env Environment ("name=value" strings, may be \c NULL).
+ * \param term Value of \c TERM, or \c NULL to leave it unset.
+ *
+ * \return Newly-allocated \c JsonArray.
+ */
+static JsonArray *
+cc_oci_hyper_envs_new (gchar **env, const gchar *term)
+{
+	JsonArray   *envs;
+	JsonObject  *obj;
+	gboolean     have_path = false;
+	gboolean     have_term = false;
+	gchar      **e;
+
+	envs = json_array_new ();
+
+	for (e = env; e && *e; e++) {
+		const gchar *value = strchr (*e, '=');
+		g_autofree gchar *name = NULL;
+
+		if (! value || value == *e) {
+			continue;
+		}
+
+		name = g_strndup (*e, (gsize)(value - *e));
+		if (! g_strcmp0 (name, "PATH")) {
+			have_path = true;
+		} else if (! g_strcmp0 (name, "TERM")) {
+			have_term = true;
+		}
+
+		obj = json_object_new ();
+		json_object_set_string_member (obj, "env", name);
+		json_object_set_string_member (obj, "value", value + 1);
+		json_array_add_object_element (envs, obj);
+	}
+
+	if (! have_path) {
+		obj = json_object_new ();
+		json_object_set_string_member (obj, "env", "PATH");
+		json_object_set_string_member (obj, "value",
+				CC_OCI_HYPER_EXEC_PATH);
+		json_array_add_object_element (envs, obj);
+	}
+
+	if (term && ! have_term) {
+		obj = json_object_new ();
+		json_object_set_string_member (obj, "env", "TERM");
+		json_object_set_string_member (obj, "value", term);
+		json_array_add_object_element (envs, obj);
+	}
+
+	return envs;
+}
+
+/*!
+ * Create the JSON payload for \ref CC_OCI_HYPER_EXECCMD.
+ *
+ * The command runs with the environment, working directory and
+ * user of the container process (\p process).
+ *
+ * \param container_id Container to run the command in.
+ * \param process \ref oci_cfg_process of the container.
+ * \param stdio_seq Sequence number of stdin/stdout.
+ * \param stderr_seq Sequence number of stderr (0 if \p terminal).
+ * \param terminal \c true if the command needs a terminal.
+ * \param argc Argument count.
+ * \param argv Argument vector.
+ *
+ * \return Newly-allocated JSON string on success, else \c NULL.
+ */
+private gchar *
+cc_oci_hyper_exec_cmd_new (const gchar *container_id,
+		const struct oci_cfg_process *process,
+		guint64 stdio_seq, guint64 stderr_seq,
+		gboolean terminal, int argc, char *const argv[])
+{
+	JsonObject  *cmd = NULL;
+	JsonObject  *obj = NULL;
+	JsonArray   *args = NULL;
+	const gchar *term = NULL;
+	gchar       *str;
+	int          i;
+
+	if (! (container_id && process && argc > 0 && argv)) {
+		return NULL;
+	}
+
+	args = json_array_new ();
+	for (i = 0; i < argc; i++) {
+		json_array_add_string_element (args, argv[i]);
+	}
+
+	if (terminal) {
+		term = g_getenv ("TERM");
+		if (! term) {
+			term = "xterm";
+		}
+	}
+
+	/* the agent takes user and group names or numeric ids */
+	obj = json_object_new ();
+	json_object_set_boolean_member (obj, "terminal", terminal);
+	json_object_set_int_member (obj, "stdio", (gint64)stdio_seq);
+	json_object_set_int_member (obj, "stderr", (gint64)stderr_seq);
+	json_object_set_array_member (obj, "args", args);
+	json_object_set_array_member (obj, "envs",
+			cc_oci_hyper_envs_new (process->env, term));
+	json_object_set_string_member (obj, "workdir",
+			process->cwd && *process->cwd ? process->cwd : "/");
+	str = g_strdup_printf ("%u", (guint)process->user.uid);
+	json_object_set_string_member (obj, "user", str);
+	g_free (str);
+	str = g_strdup_printf ("%u", (guint)process->user.gid);
+	json_object_set_string_member (obj, "group", str);
+	g_free (str);
+
+	cmd = json_object_new ();
+	json_object_set_string_member (cmd, "container", container_id);
+	json_object_set_object_member (cmd, "process", obj);
+
+	str = cc_oci_json_obj_to_string (cmd, false, NULL);
+
+	json_object_unref (cmd);
+
+	return str;
+}
+
+/*!
+ * Tell the agent the size of the local terminal.
+ *
+ * \param conn \ref cc_oci_hyper_conn.
+ * \param seq Sequence number of the process terminal.
+ *
+ * \return \c true on success, else \c false.
+ */
+static gboolean
+cc_oci_hyper_send_winsize (struct cc_oci_hyper_conn *conn, guint64 seq)
+{
+	struct winsize  ws;
+	JsonObject     *obj;
+	gchar          *str;
+	gsize           len = 0;
+	gboolean        ret;
+
+	if (ioctl (STDOUT_FILENO, TIOCGWINSZ, &ws) < 0) {
+		/* nothing to report */
+		return true;
+	}
+
+	obj = json_object_new ();
+	json_object_set_int_member (obj, "seq", (gint64)seq);
+	json_object_set_int_member (obj, "row", ws.ws_row);
+	json_object_set_int_member (obj, "column", ws.ws_col);
+
+	str = cc_oci_json_obj_to_string (obj, false, &len);
+	json_object_unref (obj);
+
+	ret = cc_oci_hyper_ctl_cmd (conn, CC_OCI_HYPER_WINSIZE,
+			str, len, NULL);
+	g_free (str);
+
+	return ret;
+}
+
+/*!
+ * Watcher forwarding local stdin to the process.
+ *
+ * \param source GIOChannel.
+ * \param condition GIOCondition.
+ * \param data \ref cc_oci_hyper_exec_data.
+ *
+ * \return \c false to unregister the watcher.
+ */
+static gboolean
+watcher_hyper_stdin (GIOChannel *source, GIOCondition condition,
+		struct cc_oci_hyper_exec_data *data)
+{
+	guint8   buffer[CC_OCI_HYPER_MAX_MSG_SIZE - CC_OCI_HYPER_TTY_HEADER_SIZE];
+	ssize_t  bytes;
+
+	(void)source;
+	(void)condition;
+
+	bytes = read (STDIN_FILENO, buffer, sizeof (buffer));
+	if (bytes < 0 && errno == EINTR) {
+		return true;
+	}
+
+	if (bytes <= 0) {
+		/* close the process stdin */
+		(void)cc_oci_hyper_tty_send (data->conn,
+				data->stdio_seq, NULL, 0);
+		data->stdin_watch = 0;
+		return false;
+	}
+
+	if (! cc_oci_hyper_tty_send (data->conn, data->stdio_seq,
+				buffer, (gsize)bytes)) {
+		g_main_loop_quit (data->loop);
+		data->stdin_watch = 0;
+		return false;
+	}
+
+	return true;
+}
+
+/*!
+ * Choose the sequence numbers of a process's streams.
+ *
+ * \param data \ref cc_oci_hyper_exec_data.
+ * \param terminal \c true if the process runs on a terminal.
+ */
+static void
+cc_oci_hyper_exec_data_init (struct cc_oci_hyper_exec_data *data,
+		gboolean terminal)
+{
+	/* hyperstart only requires sequence numbers to be unique within
+	 * the VM. The proxy allocates them upwards from 1, so pick a
+	 * random base in the upper range to avoid clashing with it.
+	 */
+	data->stdio_seq = (G_GUINT64_CONSTANT (1) << 62) |
+		((guint64)g_random_int () << 8);
+	data->stderr_seq = terminal ? 0 : data->stdio_seq + 1;
+}
+
+/*!
+ * Free a relay client, forgetting its streams.
+ *
+ * \param client \ref cc_oci_hyper_relay_client.
+ */
+static void
+cc_oci_hyper_relay_client_free (struct cc_oci_hyper_relay_client *client)
+{
+	GHashTableIter   iter;
+	gpointer         value;
+
+	if (! client) {
+		return;
+	}
+
+	if (client->data->routes) {
+		g_hash_table_iter_init (&iter, client->data->routes);
+		while (g_hash_table_iter_next (&iter, NULL, &value)) {
+			if (value == client) {
+				g_hash_table_iter_remove (&iter);
+			}
+		}
+	}
+
+	client->data->clients = g_slist_remove (client->data->clients,
+			client);
+
+	if (client->watch) {
+		g_source_remove (client->watch);
+	}
+
+	g_io_channel_unref (client->io);
+	g_object_unref (client->socket);
+	g_free (client);
+}
+
+/*!
+ * Handle the next message of the agent tty channel.
+ *
+ * Messages of the process are written to local stdout and stderr.
+ * Messages of relay clients' streams are passed on to the client.
+ *
+ * \param data \ref cc_oci_hyper_exec_data.
+ *
+ * \return \c true to keep reading, \c false once the process
+ * exited or the channel failed.
+ */
+static gboolean
+cc_oci_hyper_tty_dispatch (struct cc_oci_hyper_exec_data *data)
+{
+	struct cc_oci_hyper_relay_client  *client = NULL;
+	guint8                             header[CC_OCI_HYPER_TTY_HEADER_SIZE];
+	GByteArray                        *msg = NULL;
+	guint64                            seq;
+	gboolean                           ret = true;
+
+	if (! cc_oci_hyper_tty_recv (data->conn, &seq, &msg)) {
+		return false;
+	}
+
+	if (data->routes) {
+		client = g_hash_table_lookup (data->routes, &seq);
+	}
+
+	if (seq == data->stdio_seq) {
+		if (! msg->len) {
+			data->stdout_closed = true;
+		} else if (data->stdout_closed && msg->len == 1) {
+			/* after closing stdout, hyperstart sends
+			 * the exit code as a single byte.
+			 */
+			data->exit_code = msg->data[0];
+			data->exited = true;
+			ret = false;
+		} else {
+			(void)cc_oci_hyper_write_fd (STDOUT_FILENO,
+					msg->data, msg->len);
+		}
+	} else if (data->stderr_seq && seq == data->stderr_seq) {
+		if (msg->len) {
+			(void)cc_oci_hyper_write_fd (STDERR_FILENO,
+					msg->data, msg->len);
+		}
+	} else if (client) {
+		cc_oci_hyper_tty_header_set (header, seq,
+				(guint32)(sizeof (header) + msg->len));
+
+		if (! cc_oci_hyper_relay_send (client->socket,
+					CC_OCI_HYPER_CHANNEL_TTY,
+					header, sizeof (header),
+					msg->data, msg->len)) {
+			cc_oci_hyper_relay_client_free (client);
+		}
+	} else {
+		g_debug ("ignoring agent data for sequence %lu",
+				(unsigned long)seq);
+	}
+
+	g_byte_array_free (msg, true);
+
+	return ret;
+}
+
+/*!
+ * Watcher demultiplexing the agent tty channel.
+ *
+ * \param source GIOChannel.
+ * \param condition GIOCondition.
+ * \param data \ref cc_oci_hyper_exec_data.
+ *
+ * \return \c false to unregister the watcher.
+ */
+static gboolean
+watcher_hyper_tty (GIOChannel *source, GIOCondition condition,
+		struct cc_oci_hyper_exec_data *data)
+{
+	(void)source;
+
+	if (! (condition & G_IO_IN)) {
+		g_critical ("agent tty channel closed");
+		goto quit;
+	}
+
+	if (cc_oci_hyper_tty_dispatch (data)) {
+		return true;
+	}
+
+quit:
+	g_main_loop_quit (data->loop);
+	data->tty_watch = 0;
+
+	return false;
+}
+
+/*!
+ * Record the streams of a process a relay client starts, so that
+ * their output is passed on to the client.
+ *
+ * \param client \ref cc_oci_hyper_relay_client.
+ * \param payload JSON payload of \ref CC_OCI_HYPER_EXECCMD.
+ * \param len Length of \p payload.
+ *
+ * \return \c true on success, else \c false (invalid payload or
+ * stream already in use).
+ */
+static gboolean
+cc_oci_hyper_relay_route (struct cc_oci_hyper_relay_client *client,
+		const guint8 *payload, gsize len)
+{
+	struct cc_oci_hyper_exec_data  *data = client->data;
+	JsonParser                     *parser;
+	JsonNode                       *root;
+	JsonObject                     *process = NULL;
+	const gchar                    *members[] = { "stdio", "stderr" };
+	guint64                         seqs[2] = { 0 };
+	gboolean                        ret = false;
+	gsize                           i;
+
+	parser = json_parser_new ();
+
+	if (! json_parser_load_from_data (parser, (const gchar *)payload,
+				(gssize)len, NULL)) {
+		goto out;
+	}
+
+	root = json_parser_get_root (parser);
+	if (root && JSON_NODE_HOLDS_OBJECT (root) &&
+			json_object_has_member (json_node_get_object (root),
+				"process")) {
+		process = json_object_get_object_member
+			(json_node_get_object (root), "process");
+	}
+
+	if (! process) {
+		goto out;
+	}
+
+	for (i = 0; i < G_N_ELEMENTS (members); i++) {
+		if (json_object_has_member (process, members[i])) {
+			seqs[i] = (guint64)json_object_get_int_member
+				(process, members[i]);
+		}
+
+		if (! seqs[i]) {
+			continue;
+		}
+
+		/* streams of other processes are not for this client */
+		if (seqs[i] == data->stdio_seq ||
+				seqs[i] == data->stderr_seq ||
+				g_hash_table_contains (data->routes,
+					&seqs[i])) {
+			goto out;
+		}
+	}
+
+	if (! seqs[0]) {
+		goto out;
+	}
+
+	for (i = 0; i < G_N_ELEMENTS (seqs); i++) {
+		if (seqs[i]) {
+			g_hash_table_insert (data->routes,
+					g_memdup (&seqs[i], sizeof (guint64)),
+					client);
+		}
+	}
+
+	ret = true;
+
+out:
+	g_object_unref (parser);
+
+	return ret;
+}
+
+/*!
+ * Handle a control message of a relay client: pass it on to the
+ * agent and return the reply to the client.
+ *
+ * \param client \ref cc_oci_hyper_relay_client.
+ * \param msg Control message (header included).
+ *
+ * \return \c true on success, \c false if the client is gone.
+ */
+static gboolean
+cc_oci_hyper_relay_ctl (struct cc_oci_hyper_relay_client *client,
+		GByteArray *msg)
+{
+	static const gchar   busy[] = "process streams in use";
+	static const gchar   gone[] = "agent unavailable";
+	guint8               header[CC_OCI_HYPER_CTL_HEADER_SIZE];
+	GByteArray          *reply = NULL;
+	const guint8        *payload;
+	gsize                len;
+	guint32              cmd;
+	guint32              code;
+	gboolean             ret;
+
+	cmd = cc_oci_hyper_get_be32 (msg->data);
+	payload = msg->data + CC_OCI_HYPER_CTL_HEADER_SIZE;
+	len = msg->len - CC_OCI_HYPER_CTL_HEADER_SIZE;
+
+	if (cmd == CC_OCI_HYPER_EXECCMD &&
+			! cc_oci_hyper_relay_route (client, payload, len)) {
+		code = CC_OCI_HYPER_ERROR;
+		reply = g_byte_array_new ();
+		g_byte_array_append (reply, (const guint8 *)busy,
+				sizeof (busy) - 1);
+	} else if (! cc_oci_hyper_ctl_request (client->data->conn, cmd,
+				(const gchar *)payload, len,
+				&code, &reply)) {
+		code = CC_OCI_HYPER_ERROR;
+		reply = g_byte_array_new ();
+		g_byte_array_append (reply, (const guint8 *)gone,
+				sizeof (gone) - 1);
+	}
+
+	cc_oci_hyper_ctl_header_set (header, code,
+			(guint32)(sizeof (header) + reply->len));
+
+	ret = cc_oci_hyper_relay_send (client->socket,
+			CC_OCI_HYPER_CHANNEL_CTL,
+			header, sizeof (header),
+			reply->data, reply->len);
+
+	g_byte_array_free (reply, true);
+
+	return ret;
+}
+
+/*!
+ * Watcher passing on the messages of a relay client to the agent.
+ *
+ * \param source GIOChannel.
+ * \param condition GIOCondition.
+ * \param client \ref cc_oci_hyper_relay_client.
+ *
+ * \return \c false to unregister the watcher.
+ */
+static gboolean
+watcher_hyper_relay_client (GIOChannel *source, GIOCondition condition,
+		struct cc_oci_hyper_relay_client *client)
+{
+	enum cc_oci_hyper_channel   channel;
+	GByteArray                 *msg = NULL;
+	guint64                     seq;
+	gboolean                    ret = false;
+
+	(void)source;
+
+	if (! (condition & G_IO_IN)) {
+		goto out;
+	}
+
+	if (! cc_oci_hyper_relay_recv (client->socket, &channel, &msg)) {
+		goto out;
+	}
+
+	if (channel == CC_OCI_HYPER_CHANNEL_CTL) {
+		ret = cc_oci_hyper_relay_ctl (client, msg);
+		goto out;
+	}
+
+	/* clients can only write to the processes they started */
+	seq = cc_oci_hyper_get_be64 (msg->data);
+	if (g_hash_table_lookup (client->data->routes, &seq) != client) {
+		g_debug ("ignoring relay client data for sequence %lu",
+				(unsigned long)seq);
+		ret = true;
+		goto out;
+	}
+
+	ret = cc_oci_hyper_conn_send (client->data->conn,
+			CC_OCI_HYPER_CHANNEL_TTY, msg->data, msg->len);
+
+out:
+	if (msg) {
+		g_byte_array_free (msg, true);
+	}
+
+	if (! ret) {
+		client->watch = 0;
+		cc_oci_hyper_relay_client_free (client);
+	}
+
+	return ret;
+}
+
+/*!
+ * Watcher accepting connections to the relay socket.
+ *
+ * \param source GIOChannel.
+ * \param condition GIOCondition.
+ * \param data \ref cc_oci_hyper_exec_data.
+ *
+ * \return \c false to unregister the watcher.
+ */
+static gboolean
+watcher_hyper_relay (GIOChannel *source, GIOCondition condition,
+		struct cc_oci_hyper_exec_data *data)
+{
+	struct cc_oci_hyper_relay_client  *client;
+	GSocket                           *socket;
+	GError                            *error = NULL;
+
+	(void)source;
+	(void)condition;
+
+	socket = g_socket_accept (data->relay, NULL, &error);
+	if (! socket) {
+		g_warning ("failed to accept agent relay client: %s",
+				error->message);
+		g_error_free (error);
+		return true;
+	}
+
+	client = g_new0 (struct cc_oci_hyper_relay_client, 1);
+	client->socket = socket;
+	client->data = data;
+	client->io = g_io_channel_unix_new (g_socket_get_fd (socket));
+	client->watch = g_io_add_watch (client->io,
+			G_IO_IN | G_IO_HUP | G_IO_ERR,
+			(GIOFunc)watcher_hyper_relay_client, client);
+
+	data->clients = g_slist_prepend (data->clients, client);
+
+	return true;
+}
+
+/*!
+ * Create the listening socket of a workload relay.
+ *
+ * The socket is created before the relay runs, so that clients
+ * connecting early wait for the relay rather than reaching the
+ * agent themselves.
+ *
+ * \param runtime_path Runtime directory of the container.
+ *
+ * \return Listening GSocket on success, else \c NULL.
+ */
+GSocket *
+cc_oci_hyper_relay_listen (const gchar *runtime_path)
+{
+	GSocket         *socket = NULL;
+	GSocketAddress  *addr = NULL;
+	GError          *error = NULL;
+	gchar           *path = NULL;
+
+	if (! (runtime_path && *runtime_path)) {
+		return NULL;
+	}
+
+	path = g_build_path ("/", runtime_path,
+			CC_OCI_AGENT_RELAY_SOCKET, NULL);
+
+	socket = g_socket_new (G_SOCKET_FAMILY_UNIX,
+			G_SOCKET_TYPE_STREAM, 0, &error);
+	if (! socket) {
+		g_critical ("failed to create socket: %s", error->message);
+		g_error_free (error);
+		goto out;
+	}
+
+	addr = g_unix_socket_address_new (path);
+	if (! addr) {
+		g_critical ("failed to create socket address for %s", path);
+		goto err;
+	}
+
+	if (! g_socket_bind (socket, addr, false, &error)) {
+		g_critical ("failed to bind to %s: %s", path,
+				error->message);
+		g_error_free (error);
+		goto err;
+	}
+
+	if (! g_socket_listen (socket, &error)) {
+		g_critical ("failed to listen on %s: %s", path,
+				error->message);
+		g_error_free (error);
+		(void)g_unlink (path);
+		goto err;
+	}
+
+	goto out;
+
+err:
+	g_object_unref (socket);
+	socket = NULL;
+
+out:
+	if (addr) {
+		g_object_unref (addr);
+	}
+	g_free (path);
+
+	return socket;
+}
+
+/*!
+ * Send a command starting a process to the agent, then multiplex
+ * local stdin, stdout and stderr over the agent tty channel until
+ * the process exits.
+ *
+ * If \p data has a relay socket, clients connecting to it reach the
+ * agent through \p conn while the process runs.
+ *
+ * \param conn Connected \ref cc_oci_hyper_conn.
+ * \param cmd \ref cc_oci_hyper_cmd.
+ * \param payload JSON payload of \p cmd.
+ * \param data \ref cc_oci_hyper_exec_data
+ *   (initialised by \ref cc_oci_hyper_exec_data_init).
+ * \param terminal \c true if the process runs on a terminal.
+ * \param[out] exit_code Exit code of the process.
+ *
+ * \return \c true if the process ran, else \c false.
+ */
+static gboolean
+cc_oci_hyper_run (struct cc_oci_hyper_conn *conn,
+		guint32 cmd, const gchar *payload,
+		struct cc_oci_hyper_exec_data *data,
+		gboolean terminal, gint *exit_code)
+{
+	struct termios                 saved_termios;
+	struct termios                 raw_termios;
+	gboolean                       restore_termios = false;
+	gboolean                       running = true;
+	GIOChannel                    *tty_io = NULL;
+	GIOChannel                    *stdin_io = NULL;
+	GIOChannel                    *relay_io = NULL;
+	GSocket                       *tty;
+	gboolean                       ret = false;
+
+	data->conn = conn;
+
+	if (data->relay) {
+		data->routes = g_hash_table_new_full (g_int64_hash,
+				g_int64_equal, g_free, NULL);
+	}
+
+	if (! cc_oci_hyper_ctl_cmd (conn, cmd,
+				payload, strlen (payload), NULL)) {
+		goto out;
+	}
+
+	if (terminal) {
+		if (! cc_oci_hyper_send_winsize (conn, data->stdio_seq)) {
+			g_warning ("failed to set terminal size");
+		}
+
+		if (tcgetattr (STDIN_FILENO, &saved_termios) == 0) {
+			raw_termios = saved_termios;
+			cfmakeraw (&raw_termios);
+			restore_termios = tcsetattr (STDIN_FILENO,
+					TCSANOW, &raw_termios) == 0;
+		}
+	}
+
+	/* output the relay passed on while the commands above were
+	 * acknowledged.
+	 */
+	while (running && cc_oci_hyper_tty_pending (conn)) {
+		running = cc_oci_hyper_tty_dispatch (data);
+	}
+
+	if (running) {
+		data->loop = g_main_loop_new (NULL, false);
+
+		tty = conn->relay ? conn->relay : conn->tty;
+		tty_io = g_io_channel_unix_new (g_socket_get_fd (tty));
+		stdin_io = g_io_channel_unix_new (STDIN_FILENO);
+
+		data->tty_watch = g_io_add_watch (tty_io,
+				G_IO_IN | G_IO_HUP | G_IO_ERR,
+				(GIOFunc)watcher_hyper_tty, data);
+		data->stdin_watch = g_io_add_watch (stdin_io,
+				G_IO_IN | G_IO_HUP,
+				(GIOFunc)watcher_hyper_stdin, data);
+
+		if (data->relay) {
+			relay_io = g_io_channel_unix_new
+				(g_socket_get_fd (data->relay));
+			data->relay_watch = g_io_add_watch (relay_io,
+					G_IO_IN,
+					(GIOFunc)watcher_hyper_relay, data);
+		}
+
+		g_main_loop_run (data->loop);
+	}
+
+	if (! data->exited) {
+		g_critical ("lost connection to agent before "
+				"command exited");
+		goto out;
+	}
+
+	*exit_code = data->exit_code;
+
+	ret = true;
+
+out:
+	if (restore_termios) {
+		(void)tcsetattr (STDIN_FILENO, TCSANOW, &saved_termios);
+	}
+
+	if (data->tty_watch) {
+		g_source_remove (data->tty_watch);
+		data->tty_watch = 0;
+	}
+
+	if (data->stdin_watch) {
+		g_source_remove (data->stdin_watch);
+		data->stdin_watch = 0;
+	}
+
+	if (data->relay_watch) {
+		g_source_remove (data->relay_watch);
+		data->relay_watch = 0;
+	}
+
+	/* the process is gone, so are its relay clients' streams */
+	while (data->clients) {
+		cc_oci_hyper_relay_client_free (data->clients->data);
+	}
+
+	if (data->routes) {
+		g_hash_table_destroy (data->routes);
+		data->routes = NULL;
+	}
+
+	if (data->loop) {
+		g_main_loop_unref (data->loop);
+		data->loop = NULL;
+	}
+
+	if (tty_io) {
+		g_io_channel_unref (tty_io);
+	}
+
+	if (stdin_io) {
+		g_io_channel_unref (stdin_io);
+	}
+
+	if (relay_io) {
+		g_io_channel_unref (relay_io);
+	}
+
+	data->conn = NULL;
+
+	return ret;
+}
+
+/*!
+ * Run a command inside a container using the hyperstart agent.
+ *
+ * Local stdin, stdout and stderr are multiplexed over the agent tty
+ * channel. If stdin is a terminal, the command runs on a guest
+ * terminal and the local terminal is put into raw mode.
+ *
+ * \param config \ref cc_oci_config.
+ * \param argc Argument count.
+ * \param argv Argument vector.
+ * \param[out] exit_code Exit code of the command.
+ *
+ * \return \c true if the command ran, else \c false.
+ */
+gboolean
+cc_oci_hyper_exec (const struct cc_oci_config *config,
+		int argc, char *const argv[], gint *exit_code)
+{
+	struct cc_oci_hyper_exec_data  data = { 0 };
+	struct cc_oci_hyper_conn       conn = { 0 };
+	gboolean                       terminal;
+	gchar                         *cmd = NULL;
+	gboolean                       ret;
+
+	if (! (config && argc > 0 && argv && exit_code)) {
+		return false;
+	}
+
+	terminal = isatty (STDIN_FILENO) && isatty (STDOUT_FILENO);
+
+	cc_oci_hyper_exec_data_init (&data, terminal);
+
+	cmd = cc_oci_hyper_exec_cmd_new (config->optarg_container_id,
+			&config->oci.process, data.stdio_seq, data.stderr_seq,
+			terminal, argc, argv);
+	if (! cmd) {
+		return false;
+	}
+
+	ret = cc_oci_hyper_connect_config (&conn, config, false) &&
+		cc_oci_hyper_run (&conn, CC_OCI_HYPER_EXECCMD, cmd,
+			&data, terminal, exit_code);
+
+	cc_oci_hyper_disconnect (&conn);
+	g_free (cmd);
+
+	return ret;
+}
+
+/*!
+ * Create the JSON payload for \ref CC_OCI_HYPER_STARTPOD, running
+ * \ref CC_OCI_WORKLOAD_FILE in a container whose rootfs is the
+ * 9p share (as created by "create").
+ *
+ * \param container_id Container to create.
+ * \param hostname Hostname of the VM (may be \c NULL).
+ * \param stdio_seq Sequence number of stdin/stdout.
+ * \param stderr_seq Sequence number of stderr (0 if \p terminal).
+ * \param terminal \c true if the workload needs a terminal.
+ * \param env Workload environment ("name=value" strings,
+ *   may be \c NULL).
+ *
+ * \return Newly-allocated JSON string on success, else \c NULL.
+ */
+private gchar *
+cc_oci_hyper_startpod_cmd_new (const gchar *container_id,
+		const gchar *hostname,
+		guint64 stdio_seq, guint64 stderr_seq,
+		gboolean terminal, gchar **env)
+{
+	JsonObject  *cmd = NULL;
+	JsonObject  *container = NULL;
+	JsonObject  *process = NULL;
+	JsonArray   *containers = NULL;
+	JsonArray   *args = NULL;
+	JsonArray   *envs = NULL;
+	gchar       *str;
+
+	if (! container_id) {
+		return NULL;
+	}
+
+	args = json_array_new ();
+	json_array_add_string_element (args, CC_OCI_WORKLOAD_FILE);
+
+	envs = cc_oci_hyper_envs_new (env, NULL);
+
+	process = json_object_new ();
+	json_object_set_boolean_member (process, "terminal", terminal);
+	json_object_set_int_member (process, "stdio", (gint64)stdio_seq);
+	json_object_set_int_member (process, "stderr", (gint64)stderr_seq);
+	json_object_set_array_member (process, "args", args);
+	json_object_set_array_member (process, "envs", envs);
+	json_object_set_string_member (process, "workdir", "/");
+
+	/* An empty image and rootfs make the root of the share the
+	 * container rootfs.
+	 */
+	container = json_object_new ();
+	json_object_set_string_member (container, "id", container_id);
+	json_object_set_string_member (container, "rootfs", "");
+	json_object_set_string_member (container, "fstype", "");
+	json_object_set_string_member (container, "image", "");
+	json_object_set_string_member (container, "restartPolicy", "never");
+	json_object_set_boolean_member (container, "initialize", false);
+	json_object_set_object_member (container, "process", process);
+
+	containers = json_array_new ();
+	json_array_add_object_element (containers, container);
+
+	cmd = json_object_new ();
+	json_object_set_string_member (cmd, "hostname",
+			hostname ? hostname : container_id);
+	json_object_set_string_member (cmd, "shareDir",
+			CC_OCI_HYPER_SHARE_TAG);
+	json_object_set_array_member (cmd, "containers", containers);
+
+	str = cc_oci_json_obj_to_string (cmd, false, NULL);
+
+	json_object_unref (cmd);
+
+	return str;
+}
+
+/*!
+ * Run the container workload (\ref CC_OCI_WORKLOAD_FILE) using the
+ * hyperstart agent, for VMs booted with \ref CC_OCI_VM_BOOT_AGENT.
+ *
+ * Local stdin, stdout and stderr are multiplexed over the agent tty
+ * channel until the workload exits, then the VM is shut down (as
+ * container-workload.service does for \ref CC_OCI_VM_BOOT_SYSTEMD).
+ *
+ * QEMU serves a single client per agent channel, so this is the only
+ * process connected to the agent while the workload runs: commands
+ * such as "exec" and "ps" reach the agent through \p relay.
+ *
+ * \param config \ref cc_oci_config.
+ * \param terminal \c true if the workload needs a terminal.
+ * \param relay Listening socket of the relay (see
+ *   \ref cc_oci_hyper_relay_listen), or \c NULL. Consumed.
+ * \param[out] exit_code Exit code of the workload.
+ *
+ * \return \c true if the workload ran, else \c false.
+ */
+gboolean
+cc_oci_hyper_run_workload (const struct cc_oci_config *config,
+		gboolean terminal, GSocket *relay, gint *exit_code)
+{
+	struct cc_oci_hyper_exec_data  data = { 0 };
+	struct cc_oci_hyper_conn       conn = { 0 };
+	g_autofree gchar              *rootfs = NULL;
+	g_autofree gchar              *env_path = NULL;
+	g_autofree gchar              *contents = NULL;
+	g_autofree gchar              *relay_path = NULL;
+	gchar                        **env = NULL;
+	gchar                         *cmd = NULL;
+	gboolean                       ret = false;
+
+	if (! (config && config->vm && exit_code)) {
+		goto out;
+	}
+
+	/* written next to the workload file by "create" */
+	rootfs = g_path_get_dirname (config->vm->workload_path);
+	env_path = g_build_path ("/", rootfs, CC_OCI_ENV_FILE, NULL);
+	if (g_file_get_contents (env_path, &contents, NULL, NULL)) {
+		env = g_strsplit (contents, "\n", -1);
+	}
+
+	cc_oci_hyper_exec_data_init (&data, terminal);
+	data.relay = relay;
+
+	cmd = cc_oci_hyper_startpod_cmd_new (config->optarg_container_id,
+			config->oci.hostname,
+			data.stdio_seq, data.stderr_seq, terminal, env);
+	g_strfreev (env);
+	if (! cmd) {
+		goto out;
+	}
+
+	if (! cc_oci_hyper_connect (&conn, config->state.runtime_path)) {
+		goto out;
+	}
+
+	ret = cc_oci_hyper_run (&conn, CC_OCI_HYPER_STARTPOD, cmd,
+			&data, terminal, exit_code);
+
+	/* Power the VM off. The agent may not get to acknowledge. */
+	(void)cc_oci_hyper_ctl_cmd (&conn, CC_OCI_HYPER_DESTROYPOD,
+			NULL, 0, NULL);
+
+out:
+	cc_oci_hyper_disconnect (&conn);
+	g_free (cmd);
+
+	if (relay) {
+		relay_path = g_build_path ("/", config->state.runtime_path,
+				CC_OCI_AGENT_RELAY_SOCKET, NULL);
+		(void)g_unlink (relay_path);
+		g_object_unref (relay);
+	}
+
+	return ret;
+}
+
+/*!
+ * Create the JSON payload for \ref CC_OCI_HYPER_PSCONTAINER.
+ *
+ * \param container_id Container to list processes for.
+ * \param format Output format ("table" or "json").
+ * \param argc Number of ps(1) arguments.
+ * \param argv ps(1) arguments (only used for "table").
+ *
+ * \return Newly-allocated JSON string on success, else \c NULL.
+ */
+private gchar *
+cc_oci_hyper_ps_cmd_new (const gchar *container_id,
+		const gchar *format, int argc, char *const argv[])
+{
+	JsonObject  *cmd = NULL;
+	JsonArray   *args = NULL;
+	gchar       *str;
+	int          i;
+
+	if (! (container_id && format)) {
+		return NULL;
+	}
+
+	if (argc && ! argv) {
+		return NULL;
+	}
+
+	args = json_array_new ();
+	for (i = 0; i < argc; i++) {
+		json_array_add_string_element (args, argv[i]);
+	}
+
+	cmd = json_object_new ();
+	json_object_set_string_member (cmd, "container", container_id);
+	json_object_set_string_member (cmd, "format", format);
+	json_object_set_array_member (cmd, "psargs", args);
+
+	str = cc_oci_json_obj_to_string (cmd, false, NULL);
+
+	json_object_unref (cmd);
+
+	return str;
+}
+
+/*!
+ * List the processes running inside a container.
+ *
+ * This is a single request on the control channel: the agent
+ * replies with the listing in the payload of its acknowledgement.
+ *
+ * \param config \ref cc_oci_config.
+ * \param format Output format ("table" or "json").
+ * \param argc Number of ps(1) arguments.
+ * \param argv ps(1) arguments.
+ * \param[out] output Newly-allocated listing, as returned by the agent.
+ *
+ * \return \c true on success, else \c false.
+ */
+gboolean
+cc_oci_hyper_ps (const struct cc_oci_config *config,
+		const gchar *format, int argc, char *const argv[],
+		GByteArray **output)
+{
+	struct cc_oci_hyper_conn  conn = { 0 };
+	gchar                    *cmd = NULL;
+	gboolean                  ret = false;
+
+	if (! (config && format && output)) {
+		return false;
+	}
+
+	cmd = cc_oci_hyper_ps_cmd_new (config->optarg_container_id,
+			format, argc, argv);
+	if (! cmd) {
+		return false;
+	}
+
+	if (! cc_oci_hyper_connect_config (&conn, config, true)) {
+		goto out;
+	}
+
+	ret = cc_oci_hyper_ctl_cmd (&conn, CC_OCI_HYPER_PSCONTAINER,
+			cmd, strlen (cmd), output);
+
+out:
+	cc_oci_hyper_disconnect (&conn);
+	g_free (cmd);
+
+	return ret;
+}
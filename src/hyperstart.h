@@ -0,0 +1,122 @@
+/*
+ * This file is part of cc-oci-runtime.
+ *
+ * Copyright (C) 2016 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef _CC_OCI_HYPERSTART_H
+#define _CC_OCI_HYPERSTART_H
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include "oci.h"
+
+/** Size of the header of a message on the hyperstart control channel. */
+#define CC_OCI_HYPER_CTL_HEADER_SIZE	8
+
+/** Size of the header of a message on the hyperstart tty channel. */
+#define CC_OCI_HYPER_TTY_HEADER_SIZE	12
+
+/** Largest message (header included) hyperstart will accept. */
+#define CC_OCI_HYPER_MAX_MSG_SIZE	10240
+
+/** hyperstart control channel commands. */
+enum cc_oci_hyper_cmd {
+	CC_OCI_HYPER_VERSION = 0,
+	CC_OCI_HYPER_STARTPOD,
+	CC_OCI_HYPER_GETPOD,
+	CC_OCI_HYPER_STOPPOD_DEPRECATED,
+	CC_OCI_HYPER_DESTROYPOD,
+	CC_OCI_HYPER_RESTARTCONTAINER,
+	CC_OCI_HYPER_EXECCMD,
+	CC_OCI_HYPER_FINISHCMD,
+	CC_OCI_HYPER_READY,
+	CC_OCI_HYPER_ACK,
+	CC_OCI_HYPER_ERROR,
+	CC_OCI_HYPER_WINSIZE,
+	CC_OCI_HYPER_PING,
+	CC_OCI_HYPER_FINISHPOD,
+	CC_OCI_HYPER_NEXT,
+	CC_OCI_HYPER_WRITEFILE,
+	CC_OCI_HYPER_READFILE,
+	CC_OCI_HYPER_NEWCONTAINER,
+	CC_OCI_HYPER_KILLCONTAINER,
+	CC_OCI_HYPER_ONLINECPUMEM,
+	CC_OCI_HYPER_SETUPINTERFACE,
+	CC_OCI_HYPER_SETUPROUTE,
+	CC_OCI_HYPER_REMOVECONTAINER,
+	CC_OCI_HYPER_PROCESSASYNCEVENT,
+	CC_OCI_HYPER_SIGNALPROCESS,
+	CC_OCI_HYPER_DELETEINTERFACE,
+	CC_OCI_HYPER_PSCONTAINER,
+};
+
+/** Channels multiplexed on a connection to the agent relay
+ * (\ref CC_OCI_AGENT_RELAY_SOCKET).
+ *
+ * Each message is prefixed with a byte holding its channel and is
+ * otherwise the same as on the agent channel.
+ */
+enum cc_oci_hyper_channel {
+	CC_OCI_HYPER_CHANNEL_CTL = 0,
+	CC_OCI_HYPER_CHANNEL_TTY,
+};
+
+/** Connection to the hyperstart agent running inside the VM. */
+struct cc_oci_hyper_conn {
+	/** Control channel (commands and their replies). */
+	GSocket  *ctl;
+
+	/** Tty channel (process I/O multiplexed by sequence number). */
+	GSocket  *tty;
+
+	/** Connection to the agent relay, carrying both channels
+	 * (used instead of \c ctl and \c tty).
+	 */
+	GSocket  *relay;
+
+	/** tty messages the relay sent while a control reply was
+	 * awaited (\c GByteArray, header included).
+	 */
+	GQueue   *pending;
+};
+
+gboolean cc_oci_hyper_connect (struct cc_oci_hyper_conn *conn,
+		const gchar *runtime_path);
+gboolean cc_oci_hyper_connect_ctl (struct cc_oci_hyper_conn *conn,
+		const gchar *runtime_path);
+gboolean cc_oci_hyper_connect_relay (struct cc_oci_hyper_conn *conn,
+		const gchar *runtime_path);
+GSocket *cc_oci_hyper_relay_listen (const gchar *runtime_path);
+void cc_oci_hyper_disconnect (struct cc_oci_hyper_conn *conn);
+gboolean cc_oci_hyper_ctl_cmd (struct cc_oci_hyper_conn *conn,
+		guint32 cmd, const gchar *payload, gsize len,
+		GByteArray **reply);
+gboolean cc_oci_hyper_tty_send (struct cc_oci_hyper_conn *conn,
+		guint64 seq, const guint8 *data, gsize len);
+gboolean cc_oci_hyper_tty_recv (struct cc_oci_hyper_conn *conn,
+		guint64 *seq, GByteArray **data);
+gboolean cc_oci_hyper_exec (const struct cc_oci_config *config,
+		int argc, char *const argv[], gint *exit_code);
+gboolean cc_oci_hyper_run_workload (const struct cc_oci_config *config,
+		gboolean terminal, GSocket *relay, gint *exit_code);
+gboolean cc_oci_hyper_ps (const struct cc_oci_config *config,
+		const gchar *format, int argc, char *const argv[],
+		GByteArray **output);
+
+#endif /* _CC_OCI_HYPERSTART_H */
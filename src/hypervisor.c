@@ -33,6 +33,8 @@
 #include "util.h"
 #include "hypervisor.h"
 #include "common.h"
+#include "vm_socket.h"
+#include "rootfs.h"
 
 /** Length of an ASCII-formatted UUID */
 #define UUID_MAX 37
@@ -132,6 +134,280 @@ out:
 	return g_strdup("");
 }
 
+#define QEMU_FMT_MEMORY_BACKEND \
+	"memory-backend-file,id=ram-node0,size=%" G_GUINT64_FORMAT ",mem-path=%s%s"
+#define QEMU_FMT_MEMORY_NUMA "node,memdev=ram-node0"
+
+/*!
+ * Generate the memory backend object parameters used to provide
+ * guest RAM.
+ *
+ * The backend covers the boot memory so is sized from the
+ * (unexpanded) memory option in \p args.
+ *
+ * \param config \ref cc_oci_config.
+ * \param args Hypervisor command-line.
+ *
+ * \return Newly-allocated string (\c "" for the default anonymous
+ * memory), or \c NULL on error.
+ */
+static gchar *
+cc_oci_expand_memory_backend_cmdline(struct cc_oci_config *config,
+		gchar **args) {
+	struct cc_oci_vm_resources resources;
+
+	if (config->vm->memory_backend == CC_OCI_VM_MEMORY_ANONYMOUS) {
+		return g_strdup("");
+	}
+
+	if (! cc_oci_vm_resources_get (args, &resources)) {
+		return NULL;
+	}
+
+	/* Huge pages must be reserved up-front to avoid the
+	 * hypervisor being killed when the pool is exhausted, whereas
+	 * the shared backend must be mapped shared so that other
+	 * processes can map the same pages.
+	 */
+	return g_strdup_printf(QEMU_FMT_MEMORY_BACKEND,
+		resources.boot_memory,
+		config->vm->memory_path,
+		config->vm->memory_backend == CC_OCI_VM_MEMORY_HUGEPAGES
+		? ",prealloc=on" : ",share=on");
+}
+
+/** Map of \ref cc_oci_vm_boot values to vm.json names. */
+static struct cc_oci_map vm_boot_map[] =
+{
+	{ CC_OCI_VM_BOOT_SYSTEMD , "systemd" },
+	{ CC_OCI_VM_BOOT_AGENT   , "agent"   },
+
+	{ CC_OCI_VM_BOOT_INVALID , NULL      }
+};
+
+/*!
+ * Convert a boot profile name to a \ref cc_oci_vm_boot.
+ *
+ * \param str Name of boot profile.
+ *
+ * \return \ref cc_oci_vm_boot (\ref CC_OCI_VM_BOOT_INVALID if unknown).
+ */
+enum cc_oci_vm_boot
+cc_oci_str_to_vm_boot (const gchar *str)
+{
+	struct cc_oci_map  *p;
+
+	for (p = vm_boot_map; str && p->name; p++) {
+		if (! g_strcmp0 (str, p->name)) {
+			return p->num;
+		}
+	}
+
+	return CC_OCI_VM_BOOT_INVALID;
+}
+
+/*!
+ * Convert a \ref cc_oci_vm_boot to its name.
+ *
+ * \param boot \ref cc_oci_vm_boot.
+ *
+ * \return Name, or \c NULL if invalid.
+ */
+const gchar *
+cc_oci_vm_boot_to_str (enum cc_oci_vm_boot boot)
+{
+	struct cc_oci_map  *p;
+
+	for (p = vm_boot_map; p->name; p++) {
+		if (p->num == (int)boot) {
+			return p->name;
+		}
+	}
+
+	return NULL;
+}
+
+/*!
+ * Generate the kernel parameters for the boot profile of the VM.
+ *
+ * For \ref CC_OCI_VM_BOOT_AGENT, the parameters selecting and
+ * configuring systemd (and initcall_debug, which slows down boot by
+ * logging every initcall) are replaced by an init= parameter starting
+ * the agent.
+ *
+ * \param vm \ref cc_oci_vm_cfg.
+ *
+ * \return Newly-allocated string (\c NULL if the VM has no kernel
+ * parameters and boots with systemd).
+ */
+private gchar *
+cc_oci_expand_kernel_params (const struct cc_oci_vm_cfg *vm)
+{
+	GString  *params;
+	gchar   **tokens;
+	gchar   **token;
+
+	if (! vm) {
+		return NULL;
+	}
+
+	if (vm->boot != CC_OCI_VM_BOOT_AGENT) {
+		return g_strdup (vm->kernel_params);
+	}
+
+	params = g_string_new ("");
+	tokens = g_strsplit (vm->kernel_params ? vm->kernel_params : "",
+			" ", -1);
+
+	for (token = tokens; *token; token++) {
+		if (! **token
+		    || g_str_has_prefix (*token, "init=")
+		    || g_str_has_prefix (*token, "systemd.")
+		    || ! g_strcmp0 (*token, "initcall_debug")) {
+			continue;
+		}
+
+		g_string_append_printf (params, "%s ", *token);
+	}
+
+	g_string_append (params, "init=" CC_OCI_VM_AGENT_INIT);
+
+	g_strfreev (tokens);
+
+	return g_string_free (params, false);
+}
+
+#define QEMU_FMT_ROOTFS_9P_DEVICE \
+	"virtio-9p-pci,fsdev=workload9p,mount_tag=rootfs"
+#define QEMU_FMT_ROOTFS_9P_BACKEND \
+	"local,id=workload9p,path=%s,security_model=none"
+#define QEMU_FMT_ROOTFS_BLOCK_DEVICE \
+	"virtio-blk-pci,drive=workloadblk,serial=rootfs"
+#define QEMU_FMT_ROOTFS_BLOCK_BACKEND \
+	"file=%s,id=workloadblk,if=none,format=raw%s"
+
+/** Hypervisor and kernel parameters providing the container rootfs
+ * to the guest (see \ref cc_oci_expand_rootfs_cmdline).
+ */
+struct cc_oci_rootfs_cmdline {
+	/** Option for \ref device_params. */
+	const gchar  *device_option;
+
+	/** Rootfs device parameters. */
+	gchar        *device_params;
+
+	/** Option for \ref backend_params. */
+	const gchar  *backend_option;
+
+	/** Rootfs backend parameters. */
+	gchar        *backend_params;
+
+	/** Option for \ref share_device_params ("" for none). */
+	const gchar  *share_device_option;
+
+	/** Parameters of the device sharing the volumes of a
+	 * \ref CC_OCI_VM_ROOTFS_BLOCK rootfs over 9p ("" for none).
+	 */
+	gchar        *share_device_params;
+
+	/** Option for \ref share_backend_params ("" for none). */
+	const gchar  *share_backend_option;
+
+	/** Backend parameters of the volumes share ("" for none). */
+	gchar        *share_backend_params;
+
+	/** Kernel parameters specifying how the guest mounts the
+	 * rootfs ("" for none).
+	 */
+	gchar        *mount_params;
+};
+
+/*!
+ * Generate the device and backend parameters used to provide the
+ * container rootfs to the guest.
+ *
+ * \param config \ref cc_oci_config.
+ * \param[out] cmdline \ref cc_oci_rootfs_cmdline, whose strings
+ *   are newly-allocated.
+ *
+ * \return \c true on success, else \c false.
+ */
+static gboolean
+cc_oci_expand_rootfs_cmdline(struct cc_oci_config *config,
+		struct cc_oci_rootfs_cmdline *cmdline) {
+	enum cc_oci_vm_rootfs_profile profile;
+	const gchar *mount_options;
+	g_autofree gchar *volumes = NULL;
+
+	cmdline->device_option = "-device";
+	cmdline->share_device_option = "";
+	cmdline->share_backend_option = "";
+
+	if (config->vm->rootfs_backend == CC_OCI_VM_ROOTFS_9P) {
+		if (! cc_oci_rootfs_profile_get(config, &profile)) {
+			return false;
+		}
+
+		mount_options = cc_oci_rootfs_profile_mount_options(profile);
+
+		cmdline->device_params = g_strdup(QEMU_FMT_ROOTFS_9P_DEVICE);
+		cmdline->backend_option = "-fsdev";
+		cmdline->backend_params = g_strdup_printf(QEMU_FMT_ROOTFS_9P_BACKEND,
+			config->oci.root.path);
+		cmdline->share_device_params = g_strdup("");
+		cmdline->share_backend_params = g_strdup("");
+		cmdline->mount_params = mount_options
+			? g_strdup_printf("%s=%s",
+				CC_OCI_VM_ROOTFS_OPTIONS_PARAM, mount_options)
+			: g_strdup("");
+		return true;
+	}
+
+	if (! config->vm->rootfs_image) {
+		g_critical ("No rootfs image");
+		return false;
+	}
+
+	/* The image may be shared with other containers, so the
+	 * writes of the workload go to a snapshot.
+	 */
+	cmdline->device_params = g_strdup(QEMU_FMT_ROOTFS_BLOCK_DEVICE);
+	cmdline->backend_option = "-drive";
+	cmdline->backend_params = g_strdup_printf(QEMU_FMT_ROOTFS_BLOCK_BACKEND,
+		config->vm->rootfs_image,
+		config->oci.root.read_only ? ",readonly=on" : ",snapshot=on");
+
+	/* The volumes are mounted below the rootfs directory on the
+	 * host, so share it for the guest to bind mount them.
+	 */
+	volumes = cc_oci_rootfs_volumes(config);
+	if (*volumes) {
+		cmdline->share_device_option = "-device";
+		cmdline->share_device_params = g_strdup(QEMU_FMT_ROOTFS_9P_DEVICE);
+		cmdline->share_backend_option = "-fsdev";
+		cmdline->share_backend_params = g_strdup_printf(QEMU_FMT_ROOTFS_9P_BACKEND,
+			config->oci.root.path);
+		cmdline->mount_params = g_strdup_printf("%s=%s %s=%s",
+			CC_OCI_VM_ROOTFS_DEVICE_PARAM, CC_OCI_VM_ROOTFS_DEVICE,
+			CC_OCI_VM_ROOTFS_VOLUMES_PARAM, volumes);
+	} else {
+		cmdline->share_device_params = g_strdup("");
+		cmdline->share_backend_params = g_strdup("");
+		cmdline->mount_params = g_strdup_printf("%s=%s",
+			CC_OCI_VM_ROOTFS_DEVICE_PARAM, CC_OCI_VM_ROOTFS_DEVICE);
+	}
+
+	/* ext4 refuses a read-write mount of a read-only disk */
+	if (config->oci.root.read_only) {
+		gchar *params = cmdline->mount_params;
+
+		cmdline->mount_params = g_strdup_printf("%s %s=ro",
+			params, CC_OCI_VM_ROOTFS_OPTIONS_PARAM);
+		g_free(params);
+	}
+
+	return true;
+}
 
 /*!
  * Replace any special tokens found in \p args with their expanded
@@ -155,6 +431,8 @@ cc_oci_expand_cmdline (struct cc_oci_config *config,
 	g_autofree gchar *procsock_device = NULL;
 	g_autofree gchar *agent_ctl_socket = NULL;
 	g_autofree gchar *agent_tty_socket = NULL;
+	gchar            *socket_fds[CC_OCI_VM_SOCKET_MAX] = { NULL };
+	gboolean          console_socket = false;
 
 	gboolean          ret = false;
 	gint              count;
@@ -169,6 +447,12 @@ cc_oci_expand_cmdline (struct cc_oci_config *config,
 	gchar            *netdev_params = NULL;
 	gchar            *net_device_option = NULL;
 	gchar            *netdev_option = NULL;
+	gchar            *memory_backend_params = NULL;
+	const gchar      *memory_backend_option = "";
+	const gchar      *memory_numa_option = "";
+	const gchar      *memory_numa_params = "";
+	struct cc_oci_rootfs_cmdline rootfs = { 0 };
+	gchar            *kernel_params = NULL;
 
 	if (! (config && args)) {
 		return false;
@@ -186,21 +470,25 @@ cc_oci_expand_cmdline (struct cc_oci_config *config,
 
 	/* We're about to launch the hypervisor so validate paths.*/
 
-	if ((!config->vm->image_path[0])
-		|| stat (config->vm->image_path, &st) < 0) {
-		g_critical ("image file: %s does not exist",
-			    config->vm->image_path);
-		return false;
+	if (! config->vm->image_size) {
+		if ((!config->vm->image_path)
+			|| stat (config->vm->image_path, &st) < 0) {
+			g_critical ("image file: %s does not exist",
+				    config->vm->image_path);
+			return false;
+		}
+
+		config->vm->image_size = (guint64)st.st_size;
 	}
 
-	if (!(config->vm->kernel_path[0]
+	if (!(config->vm->kernel_path
 		&& g_file_test (config->vm->kernel_path, G_FILE_TEST_EXISTS))) {
 		g_critical ("kernel image: %s does not exist",
 			    config->vm->kernel_path);
 		return false;
 	}
 
-	if (!(config->oci.root.path[0]
+	if (!(config->oci.root.path
 		&& g_file_test (config->oci.root.path, G_FILE_TEST_EXISTS|G_FILE_TEST_IS_DIR))) {
 		g_critical ("workload directory: %s does not exist",
 			    config->oci.root.path);
@@ -221,7 +509,8 @@ cc_oci_expand_cmdline (struct cc_oci_config *config,
 		}
 	}
 
-	bytes = g_strdup_printf ("%lu", (unsigned long int)st.st_size);
+	bytes = g_strdup_printf ("%" G_GUINT64_FORMAT,
+			config->vm->image_size);
 
 	/* XXX: Note that "signal=off" ensures that the key sequence
 	 * CONTROL+c will not cause the VM to exit.
@@ -295,12 +584,37 @@ cc_oci_expand_cmdline (struct cc_oci_config *config,
 
 			console_device = g_strdup_printf ("socket,path=%s,server,nowait,id=charconsole0,signal=off",
 				config->console);
+			console_socket = true;
 		}
 	} else {
 		console_device = g_strdup_printf ("serial,id=charconsole0,path=%s", config->console);
 	}
 
-	procsock_device = g_strdup_printf ("socket,id=procsock,path=%s,server,nowait", config->state.procsock_path);
+	/* Create the hypervisor sockets up front if the arguments
+	 * ask for it, so that they can be connected to without
+	 * waiting for the hypervisor to create them.
+	 */
+	if (! cc_oci_vm_sockets_create (config, args, console_socket)) {
+		goto out;
+	}
+
+	if (config->vm_sockets[CC_OCI_VM_SOCKET_CONSOLE]) {
+		g_free (console_device);
+		console_device = g_strdup_printf ("socket,fd=%d,server,nowait,id=charconsole0,signal=off",
+			config->vm_sockets[CC_OCI_VM_SOCKET_CONSOLE]);
+	}
+
+	if (config->vm_sockets[CC_OCI_VM_SOCKET_PROCESS]) {
+		procsock_device = g_strdup_printf ("socket,id=procsock,fd=%d,server,nowait",
+			config->vm_sockets[CC_OCI_VM_SOCKET_PROCESS]);
+	} else {
+		procsock_device = g_strdup_printf ("socket,id=procsock,path=%s,server,nowait", config->state.procsock_path);
+	}
+
+	for (count = 0; count < CC_OCI_VM_SOCKET_MAX; count++) {
+		socket_fds[count] = g_strdup_printf ("%d",
+				config->vm_sockets[count]);
+	}
 
 	agent_ctl_socket = g_build_path ("/", config->state.runtime_path,
 					CC_OCI_AGENT_CTL_SOCKET, NULL);
@@ -313,6 +627,7 @@ cc_oci_expand_cmdline (struct cc_oci_config *config,
 	g_debug("guest agent tty socket: %s", agent_tty_socket);
 
 	kernel_net_params = cc_oci_expand_net_cmdline(config);
+	kernel_params = cc_oci_expand_kernel_params(config->vm);
 
 	if ( config->net.interfaces == NULL ) {
 		/* Support --net=none */
@@ -334,6 +649,22 @@ cc_oci_expand_cmdline (struct cc_oci_config *config,
 		net_device_params = cc_oci_expand_net_device_cmdline(config, 0);
 	}
 
+	memory_backend_params = cc_oci_expand_memory_backend_cmdline(config,
+			args);
+	if (! memory_backend_params) {
+		goto out;
+	}
+
+	if (*memory_backend_params) {
+		memory_backend_option = "-object";
+		memory_numa_option = "-numa";
+		memory_numa_params = QEMU_FMT_MEMORY_NUMA;
+	}
+
+	if (! cc_oci_expand_rootfs_cmdline(config, &rootfs)) {
+		goto out;
+	}
+
 	/* Note: @NETDEV@: For multiple network we need to have a way to append
 	 * args to the hypervisor command line vs substitution
 	 */
@@ -343,7 +674,7 @@ cc_oci_expand_cmdline (struct cc_oci_config *config,
 	} special_tags[] = {
 		{ "@WORKLOAD_DIR@"      , config->oci.root.path      },
 		{ "@KERNEL@"            , config->vm->kernel_path    },
-		{ "@KERNEL_PARAMS@"     , config->vm->kernel_params  },
+		{ "@KERNEL_PARAMS@"     , kernel_params              },
 		{ "@KERNEL_NET_PARAMS@" , kernel_net_params          },
 		{ "@IMAGE@"             , config->vm->image_path     },
 		{ "@SIZE@"              , bytes                      },
@@ -358,6 +689,22 @@ cc_oci_expand_cmdline (struct cc_oci_config *config,
 		{ "@NETDEVICE_PARAMS@"  , net_device_params          },
 		{ "@AGENT_CTL_SOCKET@"  , agent_ctl_socket           },
 		{ "@AGENT_TTY_SOCKET@"  , agent_tty_socket           },
+		{ "@COMMS_SOCKET_FD@"     , socket_fds[CC_OCI_VM_SOCKET_COMMS]     },
+		{ "@AGENT_CTL_SOCKET_FD@" , socket_fds[CC_OCI_VM_SOCKET_AGENT_CTL] },
+		{ "@AGENT_TTY_SOCKET_FD@" , socket_fds[CC_OCI_VM_SOCKET_AGENT_TTY] },
+		{ "@MEMORY_BACKEND@"        , memory_backend_option  },
+		{ "@MEMORY_BACKEND_PARAMS@" , memory_backend_params  },
+		{ "@MEMORY_NUMA@"           , memory_numa_option     },
+		{ "@MEMORY_NUMA_PARAMS@"    , memory_numa_params     },
+		{ "@ROOTFS_DEVICE@"         , rootfs.device_option   },
+		{ "@ROOTFS_DEVICE_PARAMS@"  , rootfs.device_params   },
+		{ "@ROOTFS_BACKEND@"        , rootfs.backend_option  },
+		{ "@ROOTFS_BACKEND_PARAMS@" , rootfs.backend_params  },
+		{ "@ROOTFS_SHARE_DEVICE@"         , rootfs.share_device_option  },
+		{ "@ROOTFS_SHARE_DEVICE_PARAMS@"  , rootfs.share_device_params  },
+		{ "@ROOTFS_SHARE_BACKEND@"        , rootfs.share_backend_option },
+		{ "@ROOTFS_SHARE_BACKEND_PARAMS@" , rootfs.share_backend_params },
+		{ "@ROOTFS_MOUNT_PARAMS@"   , rootfs.mount_params    },
 		{ NULL }
 	};
 
@@ -404,10 +751,21 @@ out:
 	g_free_if_set (bytes);
 	g_free_if_set (console_device);
 	g_free_if_set (kernel_net_params);
+	g_free_if_set (kernel_params);
 	g_free_if_set (net_device_params);
 	g_free_if_set (netdev_params);
 	g_free_if_set (net_device_option);
 	g_free_if_set (netdev_option);
+	g_free_if_set (memory_backend_params);
+	g_free_if_set (rootfs.device_params);
+	g_free_if_set (rootfs.backend_params);
+	g_free_if_set (rootfs.share_device_params);
+	g_free_if_set (rootfs.share_backend_params);
+	g_free_if_set (rootfs.mount_params);
+
+	for (count = 0; count < CC_OCI_VM_SOCKET_MAX; count++) {
+		g_free_if_set (socket_fds[count]);
+	}
 
 	return ret;
 }
@@ -582,3 +940,180 @@ cc_oci_populate_extra_args(struct cc_oci_config *config ,
 
 	return;
 }
+
+/*!
+ * Parse the value of the hypervisor memory option
+ * (for example "2G,slots=2,maxmem=3G").
+ *
+ * \param value Option value.
+ * \param[out] resources \ref cc_oci_vm_resources.
+ *
+ * \return \c true on success, else \c false.
+ */
+static gboolean
+cc_oci_vm_resources_parse_memory (const gchar *value,
+		struct cc_oci_vm_resources *resources)
+{
+	gchar    **fields = NULL;
+	gchar    **field;
+	gboolean   ret = false;
+	guint64    slots;
+
+	fields = g_strsplit (value, ",", -1);
+
+	for (field = fields; field && *field; field++) {
+		const gchar *size = NULL;
+
+		if (g_str_has_prefix (*field, "slots=")) {
+			if (! cc_oci_str_to_bytes (*field + strlen ("slots="),
+						1, &slots)) {
+				goto out;
+			}
+			resources->memory_slots = (guint)slots;
+			continue;
+		} else if (g_str_has_prefix (*field, "maxmem=")) {
+			if (! cc_oci_str_to_bytes (*field + strlen ("maxmem="),
+						CC_OCI_MiB, &resources->max_memory)) {
+				goto out;
+			}
+			continue;
+		} else if (g_str_has_prefix (*field, "size=")) {
+			size = *field + strlen ("size=");
+		} else if (field == fields) {
+			size = *field;
+		} else {
+			continue;
+		}
+
+		if (! cc_oci_str_to_bytes (size, CC_OCI_MiB,
+					&resources->boot_memory)) {
+			goto out;
+		}
+	}
+
+	ret = true;
+
+out:
+	if (! ret) {
+		g_critical ("invalid memory option: %s", value);
+	}
+	g_strfreev (fields);
+	return ret;
+}
+
+/*!
+ * Parse the value of the hypervisor smp option
+ * (for example "2,maxcpus=8,sockets=4,cores=2,threads=1").
+ *
+ * \param value Option value.
+ * \param[out] resources \ref cc_oci_vm_resources.
+ *
+ * \return \c true on success, else \c false.
+ */
+static gboolean
+cc_oci_vm_resources_parse_smp (const gchar *value,
+		struct cc_oci_vm_resources *resources)
+{
+	gchar    **fields = NULL;
+	gchar    **field;
+	gboolean   ret = false;
+	guint64    count;
+
+	fields = g_strsplit (value, ",", -1);
+
+	for (field = fields; field && *field; field++) {
+		const gchar *cpus = NULL;
+
+		if (g_str_has_prefix (*field, "maxcpus=")) {
+			if (! cc_oci_str_to_bytes (*field + strlen ("maxcpus="),
+						1, &count) || ! count) {
+				goto out;
+			}
+			resources->max_vcpus = (guint)count;
+			continue;
+		} else if (g_str_has_prefix (*field, "cpus=")) {
+			cpus = *field + strlen ("cpus=");
+		} else if (field == fields) {
+			cpus = *field;
+		} else {
+			continue;
+		}
+
+		if (! cc_oci_str_to_bytes (cpus, 1, &count) || ! count) {
+			goto out;
+		}
+		resources->boot_vcpus = (guint)count;
+	}
+
+	ret = true;
+
+out:
+	if (! ret) {
+		g_critical ("invalid smp option: %s", value);
+	}
+	g_strfreev (fields);
+	return ret;
+}
+
+/*!
+ * Determine the boot and maximum resources (vCPUs and memory) of the
+ * VM from its expanded command-line.
+ *
+ * Unspecified values take the hypervisor defaults (1 vCPU and 128M
+ * of memory, no hotplug capacity).
+ *
+ * \param args Expanded hypervisor command-line.
+ * \param[out] resources \ref cc_oci_vm_resources.
+ *
+ * \return \c true on success, else \c false.
+ */
+gboolean
+cc_oci_vm_resources_get (gchar **args,
+		struct cc_oci_vm_resources *resources)
+{
+	gchar **arg;
+
+	if (! (args && resources)) {
+		return false;
+	}
+
+	memset (resources, 0, sizeof (*resources));
+
+	for (arg = args; *arg; arg++) {
+		if (! *(arg+1)) {
+			break;
+		}
+
+		if (! g_strcmp0 (*arg, "-m")) {
+			if (! cc_oci_vm_resources_parse_memory (*(arg+1),
+						resources)) {
+				return false;
+			}
+		} else if (! g_strcmp0 (*arg, "-smp")) {
+			if (! cc_oci_vm_resources_parse_smp (*(arg+1),
+						resources)) {
+				return false;
+			}
+		}
+	}
+
+	if (! resources->boot_vcpus) {
+		resources->boot_vcpus = 1;
+	}
+
+	if (resources->max_vcpus < resources->boot_vcpus) {
+		resources->max_vcpus = resources->boot_vcpus;
+	}
+
+	if (! resources->boot_memory) {
+		resources->boot_memory = CC_OCI_DEFAULT_VM_MEMORY;
+	}
+
+	if (resources->max_memory < resources->boot_memory) {
+		resources->max_memory = resources->boot_memory;
+	}
+
+	resources->vcpus = resources->boot_vcpus;
+
+	return true;
+}
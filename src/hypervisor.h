@@ -24,11 +24,26 @@
 /** Name of file containing hypervisor arguments (one per line) */
 #define CC_OCI_HYPERVISOR_CMDLINE_FILE "hypervisor.args"
 
+/** Number of bytes in a mebibyte. */
+#define CC_OCI_MiB (1024ULL * 1024)
+
+/** Memory the hypervisor gives a VM if not specified. */
+#define CC_OCI_DEFAULT_VM_MEMORY (128 * CC_OCI_MiB)
+
+/** Agent run as init by \ref CC_OCI_VM_BOOT_AGENT
+ * (as started by cc-agent.service).
+ */
+#define CC_OCI_VM_AGENT_INIT "/bin/hyperstart"
+
 gboolean cc_oci_vm_args_get (struct cc_oci_config *config,
 		gchar ***args, GPtrArray *hypervisor_extra_args);
 gboolean cc_oci_expand_cmdline (struct cc_oci_config *config,
 		gchar **args);
 void cc_oci_populate_extra_args(struct cc_oci_config *config,
                 GPtrArray **additional_args);
+gboolean cc_oci_vm_resources_get (gchar **args,
+		struct cc_oci_vm_resources *resources);
+enum cc_oci_vm_boot cc_oci_str_to_vm_boot (const gchar *str);
+const gchar *cc_oci_vm_boot_to_str (enum cc_oci_vm_boot boot);
 
 #endif /* _CC_OCI_HYPERVISOR_H */
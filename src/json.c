@@ -23,26 +23,86 @@
 
 #include <json-glib/json-glib.h>
 
+#include "json.h"
+#include "arena.h"
+
 /**
  * Buffer which must be large enough to hold the string representation
  * of any JSON node type (\c GType).
  */
 #define NODE_BUF_SIZE 64
 
+/**
+ * Tree returned by cc_oci_json_parse() and cc_oci_json_parse_data().
+ *
+ * The nodes of the tree and the strings they point to are all
+ * allocated from \ref arena, so the tree is freed in one go by
+ * cc_oci_json_free().
+ */
+struct cc_oci_json_tree {
+	/** Root of the tree (must be first). */
+	GNode root;
+
+	/** Arena holding the tree (including this structure). */
+	struct cc_oci_arena *arena;
+};
+
+/** Arena of the tree rooted at \p node. */
+#define json_tree_arena(node) \
+	(((struct cc_oci_json_tree *)(node))->arena)
+
+/*!
+ * Create a tree node.
+ *
+ * \param arena \ref cc_oci_arena to allocate from.
+ * \param data Node data (owned by \p arena).
+ *
+ * \return The new node.
+ */
+static GNode *
+cc_oci_json_node_new (struct cc_oci_arena *arena, gpointer data) {
+	GNode *node = cc_oci_arena_alloc0 (arena, sizeof (GNode));
+
+	node->data = data;
+
+	return node;
+}
+
+/*!
+ * Create an empty tree.
+ *
+ * \param[out] node Root of the tree.
+ * \param data Data of the root node (copied).
+ */
+static void
+cc_oci_json_tree_new (GNode **node, const gchar *data) {
+	struct cc_oci_arena     *arena;
+	struct cc_oci_json_tree *tree;
+
+	arena = cc_oci_arena_new (0);
+
+	tree = cc_oci_arena_alloc0 (arena, sizeof (struct cc_oci_json_tree));
+	tree->arena = arena;
+	tree->root.data = cc_oci_arena_strdup (arena, data);
+
+	*node = &tree->root;
+}
+
 /*!
  * Convert the specified \c JsonNode into a string.
  *
+ * \param arena \ref cc_oci_arena to allocate from.
  * \param node \c JsonNode.
- * \return Newly-allocated string on success, else \c NULL.
+ * \return String allocated from \p arena on success, else \c NULL.
  */
 static gchar *
-cc_oci_json_string (JsonNode* node) {
+cc_oci_json_string (struct cc_oci_arena *arena, JsonNode* node) {
 	gchar buffer[NODE_BUF_SIZE];
 	GType valueType = json_node_get_value_type(node);
 
 	switch (valueType) {
 	case G_TYPE_STRING:
-		return json_node_dup_string(node);
+		return cc_oci_arena_strdup(arena, json_node_get_string(node));
 
 	case G_TYPE_DOUBLE:
 	case G_TYPE_FLOAT:
@@ -67,19 +127,21 @@ cc_oci_json_string (JsonNode* node) {
 		break;
 	}
 
-	return g_strdup(buffer);
+	return cc_oci_arena_strdup(arena, buffer);
 }
 
 /*!
  * Recursive function that handles converging \c JsonNode's to \c
  * GNode's.
  *
+ * \param arena \ref cc_oci_arena the nodes are allocated from.
  * \param root \c Root JsonNode to convert.
  * \param node \c GNode.
  * \param parsing_array \c true if handling an array, else \c false.
  */
 static void
-cc_oci_json_parse_aux(JsonNode* root, GNode* node, bool parsing_array) {
+cc_oci_json_parse_aux(struct cc_oci_arena *arena, JsonNode* root,
+		GNode* node, bool parsing_array) {
 	guint i;
 
 	g_assert (root);
@@ -97,14 +159,16 @@ cc_oci_json_parse_aux(JsonNode* root, GNode* node, bool parsing_array) {
 			size = json_object_get_size(object);
 			keys = json_object_get_members(object);
 			values = json_object_get_values(object);
-			node = g_node_append(node, g_node_new(NULL));
+			node = g_node_append(node, cc_oci_json_node_new(arena, NULL));
 
 			for (j = 0, key = keys, value = values; j < size; j++) {
 				if (key) {
-					node = g_node_append(node->parent, g_node_new(g_strdup(key->data)));
+					node = g_node_append(node->parent,
+						cc_oci_json_node_new(arena,
+							cc_oci_arena_strdup(arena, key->data)));
 				}
 				if (value) {
-					cc_oci_json_parse_aux(value->data, node, false);
+					cc_oci_json_parse_aux(arena, value->data, node, false);
 				}
 
 				key = g_list_next(key);
@@ -124,13 +188,14 @@ cc_oci_json_parse_aux(JsonNode* root, GNode* node, bool parsing_array) {
 
 		for (i = 0; i < array_size; i++) {
 			JsonNode *array_element = json_array_get_element(array, i);
-			cc_oci_json_parse_aux(array_element, node, true);
+			cc_oci_json_parse_aux(arena, array_element, node, true);
 		}
 	} else if (JSON_NODE_TYPE(root) == JSON_NODE_VALUE) {
-		node = g_node_append(node, g_node_new(cc_oci_json_string(root)));
+		node = g_node_append(node, cc_oci_json_node_new(arena,
+					cc_oci_json_string(arena, root)));
 
 		if (parsing_array) {
-			node = g_node_append(node, g_node_new(NULL));
+			node = g_node_append(node, cc_oci_json_node_new(arena, NULL));
 		}
 	}
 }
@@ -169,8 +234,8 @@ cc_oci_json_parse (GNode** node, const gchar* filename) {
 		goto exit;
 	}
 
-	*node = g_node_new(g_strdup(filename));
-	cc_oci_json_parse_aux(root, *node, false);
+	cc_oci_json_tree_new(node, filename);
+	cc_oci_json_parse_aux(json_tree_arena(*node), root, *node, false);
 
 	result = true;
 
@@ -178,3 +243,64 @@ exit:
 	g_object_unref(parser);
 	return result;
 }
+
+/*!
+ * Convert a JSON string into a tree of nodes.
+ *
+ * \param[out] node Tree representation of \p data.
+ * \param data JSON string to parse.
+ * \param length Length of \p data in bytes, or -1 if \p data is
+ *   nul-terminated.
+ *
+ * \return \c true on success, else \c false.
+ */
+bool
+cc_oci_json_parse_data (GNode** node, const gchar* data, gssize length) {
+	bool result = false;
+	GError* error = NULL;
+	JsonParser* parser = NULL;
+	JsonNode *root = NULL;
+
+	if ((!node) || (!data) || (!(*data))) {
+		return false;
+	}
+
+	parser = json_parser_new();
+	if (! json_parser_load_from_data(parser, data, length, &error)) {
+		g_debug("unable to parse data");
+		if (error) {
+			g_debug("Error parsing data: %s", error->message);
+			g_error_free(error);
+		}
+		goto exit;
+	}
+
+	root = json_parser_get_root (parser);
+	if (! root) {
+		goto exit;
+	}
+
+	cc_oci_json_tree_new(node, NULL);
+	cc_oci_json_parse_aux(json_tree_arena(*node), root, *node, false);
+
+	result = true;
+
+exit:
+	g_object_unref(parser);
+	return result;
+}
+
+/*!
+ * Free a tree returned by cc_oci_json_parse() or
+ * cc_oci_json_parse_data().
+ *
+ * \param node Root of the tree.
+ */
+void
+cc_oci_json_free (GNode* node) {
+	if (! node) {
+		return;
+	}
+
+	cc_oci_arena_free (json_tree_arena (node));
+}
@@ -26,5 +26,8 @@
 #include <json-glib/json-glib.h>
 
 bool cc_oci_json_parse (GNode** node, const gchar* filename);
+bool cc_oci_json_parse_data (GNode** node, const gchar* data,
+		gssize length);
+void cc_oci_json_free (GNode* node);
 
 #endif /* _CC_OCI_JSON_H */
@@ -0,0 +1,87 @@
+/*
+ * This file is part of cc-oci-runtime.
+ *
+ * Copyright (C) 2016 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/**
+ * \file
+ *
+ * Lookup of the names recognised in JSON sections.
+ */
+
+#include <string.h>
+
+#include <glib.h>
+
+#include "keys.h"
+
+/*!
+ * Hash a key name.
+ *
+ * src/genkeys.awk computes the same hash to lay out the tables, trying
+ * seeds (used as the multiplier) until each key has a slot of its own.
+ *
+ * \param seed Seed of the table (below 2^21).
+ * \param name Key name.
+ *
+ * \return Hash of \p name.
+ */
+guint
+cc_oci_key_hash (guint seed, const gchar *name)
+{
+	const guchar  *p;
+	guint32        h = 0;
+
+	g_assert (name);
+
+	/* wraps modulo 2^32 */
+	for (p = (const guchar *)name; *p; p++) {
+		h = h * seed + *p;
+	}
+
+	return h;
+}
+
+/*!
+ * Find the id of a key.
+ *
+ * \param table \ref cc_oci_key_table.
+ * \param name Name to look up.
+ *
+ * \return Id of \p name, or \ref CC_OCI_KEY_UNKNOWN if \p name is not
+ * in \p table.
+ */
+gint
+cc_oci_key_lookup (const struct cc_oci_key_table *table,
+		const gchar *name)
+{
+	const struct cc_oci_key *key;
+
+	if (! (table && name)) {
+		return CC_OCI_KEY_UNKNOWN;
+	}
+
+	key = &table->keys[cc_oci_key_hash (table->seed, name)
+		% table->size];
+
+	if (! (key->name && ! strcmp (key->name, name))) {
+		return CC_OCI_KEY_UNKNOWN;
+	}
+
+	return key->id;
+}
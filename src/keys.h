@@ -0,0 +1,56 @@
+/*
+ * This file is part of cc-oci-runtime.
+ *
+ * Copyright (C) 2016 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef _CC_OCI_KEYS_H
+#define _CC_OCI_KEYS_H
+
+#include <glib.h>
+
+/** Value returned by cc_oci_key_lookup() for unrecognised names. */
+#define CC_OCI_KEY_UNKNOWN (-1)
+
+/** Name recognised in a JSON section and the value handlers switch on. */
+struct cc_oci_key {
+	const gchar *name;
+	gint         id;
+};
+
+/**
+ * Perfect hash table of keys, generated at build time from a
+ * "<name>.keys" list by src/genkeys.awk.
+ */
+struct cc_oci_key_table {
+	/** Keys, in the slot cc_oci_key_hash() gives them modulo
+	 * \c size (unused slots have a \c NULL name).
+	 */
+	const struct cc_oci_key *keys;
+
+	/** Number of slots in \c keys. */
+	guint size;
+
+	/** Seed for cc_oci_key_hash(). */
+	guint seed;
+};
+
+guint cc_oci_key_hash (guint seed, const gchar *name);
+gint cc_oci_key_lookup (const struct cc_oci_key_table *table,
+		const gchar *name);
+
+#endif /* _CC_OCI_KEYS_H */
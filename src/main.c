@@ -28,8 +28,10 @@
 #include "util.h"
 #include "logging.h"
 #include "command.h"
+#include "daemon.h"
 #include "oci-config.h"
 #include "priv.h"
+#include "state.h"
 
 /* globals */
 static char *program_name;
@@ -46,6 +48,15 @@ static gboolean systemd_cgroup;
 /** Path to create state under */
 static gchar *root_dir;
 
+/** Durability of state file writes */
+static gchar *state_sync;
+
+/** Set when handling a request forwarded to \ref command_daemon */
+static gboolean daemon_worker;
+
+/** Exit status to use if the sub-command succeeds */
+static int exit_code = EXIT_SUCCESS;
+
 struct start_data start_data;
 
 /** Global options (available to all sub-commands) */
@@ -96,6 +107,12 @@ static GOptionEntry options_global[] =
 		"directory to use for runtime state files",
 		NULL
 	},
+	{
+		"state-sync", 0, G_OPTION_FLAG_NONE,
+		G_OPTION_ARG_STRING, &state_sync,
+		"flush state files to storage (auto, none, data or full)",
+		NULL
+	},
 	{
 		"systemd-cgroup", 0, G_OPTION_FLAG_NONE,
 		G_OPTION_ARG_NONE, &systemd_cgroup,
@@ -267,6 +284,13 @@ handle_arguments (int argc, char **argv)
 	GError                *error = NULL;
 	const char            *cmd;
 	struct cc_oci_config  config = { {0} };
+	int                    orig_argc = argc;
+	char                 **orig_argv;
+
+	/* Option parsing modifies argv, keep the original arguments in
+	 * case the command is forwarded to a daemon.
+	 */
+	orig_argv = g_memdup (argv, (guint)sizeof (char *) * (guint)(argc + 1));
 
 	program_name = argv[0];
 	context = g_option_context_new ("- OCI runtime for Clear Containers");
@@ -336,6 +360,15 @@ handle_arguments (int argc, char **argv)
 		config.root_dir = g_strdup (root_dir);
 	}
 
+	if (state_sync) {
+		config.state.sync = cc_oci_str_to_state_sync (state_sync);
+		if (config.state.sync == CC_OCI_STATE_SYNC_INVALID) {
+			g_critical ("invalid state sync mode: %s", state_sync);
+			ret = false;
+			goto out;
+		}
+	}
+
 	cmd = argv[0];
 
 	/* Find the options for the specific sub-command */
@@ -347,6 +380,12 @@ handle_arguments (int argc, char **argv)
 		goto out;
 	}
 
+	/* Let a running daemon handle the command, if there is one */
+	if (sub->daemon && ! daemon_worker
+			&& cc_oci_daemon_forward (orig_argc, orig_argv, &ret)) {
+		goto out;
+	}
+
 	priv_level = cc_oci_get_priv_level (argc, argv, sub, &config);
 	if (priv_level == 1 && getuid ()) {
 		g_critical ("must run as root");
@@ -381,10 +420,13 @@ handle_arguments (int argc, char **argv)
 		goto out;
 	}
 
+	exit_code = config.exit_code;
+
 	cc_oci_config_free (&config);
 
 out:
 	g_option_context_free (context);
+	g_free (orig_argv);
 
 	return ret;
 }
@@ -402,6 +444,43 @@ cleanup (struct cc_log_options *options)
 	cc_oci_log_free (options);
 	g_free_if_set (criu);
 	g_free_if_set (root_dir);
+	g_free_if_set (state_sync);
+}
+
+/*!
+ * Handle a request forwarded to \ref command_daemon.
+ *
+ * This runs in a worker forked from the daemon, so the options the
+ * daemon itself was started with are forgotten first.
+ *
+ * \param argc Argument count.
+ * \param argv Argument vector.
+ *
+ * \return Exit status.
+ */
+static int
+handle_daemon_request (int argc, char **argv)
+{
+	gboolean ret;
+
+	memset (&cc_log_options, 0, sizeof (cc_log_options));
+	memset (&start_data, 0, sizeof (start_data));
+	criu = NULL;
+	format = NULL;
+	root_dir = NULL;
+	state_sync = NULL;
+	show_version = false;
+	show_help = false;
+	systemd_cgroup = false;
+
+	daemon_worker = true;
+	exit_code = EXIT_SUCCESS;
+
+	ret = handle_arguments (argc, argv);
+
+	cleanup (&cc_log_options);
+
+	return ret ? exit_code : EXIT_FAILURE;
 }
 
 /** Entry point. */
@@ -410,9 +489,11 @@ main (int argc, char **argv)
 {
 	gboolean ret;
 
+	cc_oci_daemon_handler = handle_daemon_request;
+
 	ret = handle_arguments (argc, argv);
 
 	cleanup (&cc_log_options);
 
-	exit (ret ? EXIT_SUCCESS : EXIT_FAILURE);
+	exit (ret ? exit_code : EXIT_FAILURE);
 }
@@ -101,6 +101,7 @@ cc_oci_mount_free (struct cc_oci_mount *m)
 	g_free_if_set (m->mnt.mnt_dir);
 	g_free_if_set (m->mnt.mnt_type);
 	g_free_if_set (m->mnt.mnt_opts);
+	g_free_if_set (m->dest);
 	g_free_if_set (m->directory_created);
 
 	g_free (m);
@@ -140,7 +141,7 @@ cc_oci_perform_mount (const struct cc_oci_mount *m, gboolean dry_run)
 	int ret;
 	struct stat st;
 
-	if (! m) {
+	if (! (m && m->dest)) {
 		return false;
 	}
 
@@ -234,8 +235,8 @@ cc_oci_handle_mounts (struct cc_oci_config *config)
 			continue;
 		}
 
-		g_snprintf (m->dest, sizeof (m->dest),
-				"%s%s",
+		g_free_if_set (m->dest);
+		m->dest = g_strdup_printf ("%s%s",
 				config->oci.root.path, m->mnt.mnt_dir);
 
 		if (m->mnt.mnt_fsname[0] == '/') {
@@ -304,7 +305,7 @@ cc_oci_handle_mounts (struct cc_oci_config *config)
 private gboolean
 cc_oci_perform_unmount (const struct cc_oci_mount *m)
 {
-	if (! m) {
+	if (! (m && m->dest)) {
 		return false;
 	}
 
@@ -38,6 +38,7 @@
 #include <gio/gio.h>
 #include <gio/gunixsocketaddress.h>
 
+#include "common.h"
 #include "oci.h"
 #include "util.h"
 #include "network.h"
@@ -48,6 +49,9 @@
 /** String that separates messages returned from the hypervisor */
 #define CC_OCI_MSG_SEPARATOR "\r\n"
 
+/** Granularity (in bytes) of guest memory hotplug */
+#define CC_OCI_MEMORY_BLOCK_SIZE (128ULL * 1024 * 1024)
+
 /*! VM connection object. */
 struct cc_oci_vm_conn
 {
@@ -59,6 +63,12 @@ struct cc_oci_vm_conn
 
 	/*! The socket. */
 	GSocket *socket;
+
+	/*! Set once QMP capabilities have been negotiated. */
+	gboolean negotiated;
+
+	/*! Start of a message received after the last complete one. */
+	GString *pending;
 };
 
 /*!
@@ -92,15 +102,22 @@ cc_oci_net_msgs_free_all (GSList *msgs)
 /*!
  * Read a QMP message.
  *
+ * The hypervisor may send an asynchronous event at any time, so the
+ * final read can end part way through a message: that data is kept
+ * in \p pending and handled by the next call.
+ *
  * \param socket \c GSocket to use.
+ * \param[in,out] pending Data received after the last complete
+ *   message (\c NULL if none).
  * \param expected_count Number of messages to try to receive.
  * \param[out] msgs List of received messages (which are of
  *   type \c GString).
  * \param[out] count Number of messages saved in \p msgs.
  * \return \c true on success, else \c false.
  */
-static gboolean
+private gboolean
 cc_oci_qmp_msg_recv (GSocket *socket,
+		GString **pending,
 		gsize expected_count,
 		GSList **msgs,
 		gsize *count)
@@ -116,10 +133,14 @@ cc_oci_qmp_msg_recv (GSocket *socket,
 	gchar       *p;
 
 	g_assert (socket);
+	g_assert (pending);
 	g_assert (expected_count);
 	g_assert (msgs);
 	g_assert (count);
 
+	received = *pending;
+	*pending = NULL;
+
 	g_debug ("client expects %lu message%s",
 			expected_count,
 			expected_count == 1 ? "" : "s");
@@ -134,8 +155,11 @@ cc_oci_qmp_msg_recv (GSocket *socket,
 
 		if (bytes <= 0) {
 			g_critical ("client failed to receive: %s",
-					error->message);
-			g_error_free (error);
+					error ? error->message
+					: "connection closed");
+			if (error) {
+				g_error_free (error);
+			}
 			goto out;
 		}
 
@@ -157,7 +181,7 @@ cc_oci_qmp_msg_recv (GSocket *socket,
 			/* Check for end of message marker to determine if a
 			 * complete message has been received yet.
 			 */
-			p = g_strstr_len (received->str, (gssize)total,
+			p = g_strstr_len (received->str, (gssize)received->len,
 					CC_OCI_MSG_SEPARATOR);
 			if (! p) {
 				/* No complete message to operate on */
@@ -194,7 +218,11 @@ cc_oci_qmp_msg_recv (GSocket *socket,
 			msg = NULL;
 		}
 
-		if (*count == expected_count) {
+		/* The hypervisor may send asynchronous events at any
+		 * time, so more messages than expected can arrive in a
+		 * single read.
+		 */
+		if (*count >= expected_count) {
 			g_debug ("found expected number of messages (%lu)",
 					(unsigned long int)expected_count);
 			break;
@@ -204,11 +232,12 @@ cc_oci_qmp_msg_recv (GSocket *socket,
 	/* All complete messages should have been added to the list */
 	g_assert (! msg);
 
-	/* All received data should have been handled */
-	g_assert (! received->len);
-
-	/* clean up */
-	g_string_free (received, true);
+	if (received->len) {
+		g_debug ("client keeping %lu bytes of partial message",
+				(unsigned long int)received->len);
+		*pending = received;
+		received = NULL;
+	}
 
 	g_debug ("client received %lu message%s "
 			"(expected %lu) in %lu bytes",
@@ -217,9 +246,13 @@ cc_oci_qmp_msg_recv (GSocket *socket,
 			(unsigned long int)expected_count,
 			(unsigned long int)total);
 
-	ret = *count == expected_count;
+	ret = *count >= expected_count;
 
 out:
+	if (received) {
+		g_string_free (received, true);
+	}
+
 	return ret;
 }
 
@@ -294,6 +327,77 @@ out:
 	return ret;
 }
 
+/*!
+ * Negotiate QMP capabilities with the hypervisor.
+ *
+ * The QMP protocol requires we query its capabilities
+ * before sending any further messages.
+ *
+ * \param conn \ref cc_oci_vm_conn to use.
+ *
+ * \return \c true on success, else \c false.
+ */
+static gboolean
+cc_oci_qmp_negotiate (struct cc_oci_vm_conn *conn)
+{
+	const  gchar      capabilities[] = "{ \"execute\": \"qmp_capabilities\" }";
+	GError           *error = NULL;
+	gssize            size;
+	gboolean          ret = false;
+	GSList           *msgs = NULL;
+	GString          *recv_msg = NULL;
+	gsize             msg_count = 0;
+
+	g_assert (conn);
+
+	if (conn->negotiated) {
+		return true;
+	}
+
+	g_debug ("sending required initial capabilities "
+			"message (%s)", capabilities);
+
+	size = g_socket_send (conn->socket, capabilities,
+			sizeof (capabilities)-1, NULL, &error);
+	if (size < 0) {
+		g_critical ("failed to send json: %s", capabilities);
+		if (error) {
+			g_critical ("error: %s", error->message);
+			g_error_free (error);
+		}
+		goto out;
+	}
+
+	/* Get the response */
+	ret = cc_oci_qmp_msg_recv (conn->socket, &conn->pending,
+			1, &msgs, &msg_count);
+	if (! ret) {
+		goto out;
+	}
+
+	recv_msg = g_slist_nth_data (msgs, 0);
+	if (! recv_msg) {
+		ret = false;
+		goto out;
+	}
+
+	/* Check it */
+	ret = cc_oci_qmp_check_result (recv_msg->str,
+			recv_msg->len, true);
+	if (! ret) {
+		goto out;
+	}
+
+	conn->negotiated = true;
+
+out:
+	if (msgs) {
+		cc_oci_net_msgs_free_all (msgs);
+	}
+
+	return ret;
+}
+
 /*!
  * Send a QMP message to the hypervisor.
  *
@@ -313,8 +417,6 @@ cc_oci_qmp_msg_send (struct cc_oci_vm_conn *conn,
 		gsize expected_resp_count,
 		gboolean expect_empty)
 {
-	static gboolean   initialised = false;
-	const  gchar      capabilities[] = "{ \"execute\": \"qmp_capabilities\" }";
 	GError           *error = NULL;
 	gssize            size;
 	gboolean          ret = false;
@@ -325,53 +427,8 @@ cc_oci_qmp_msg_send (struct cc_oci_vm_conn *conn,
 	g_assert (conn);
 	g_assert (msg);
 
-	if (! initialised) {
-		/* The QMP protocol requires we query its capabilities
-		 * before sending any further messages.
-		 */
-
-		g_debug ("sending required initial capabilities "
-				"message (%s)", capabilities);
-
-		size = g_socket_send (conn->socket, capabilities,
-				sizeof (capabilities)-1, NULL, &error);
-		if (size < 0) {
-			g_critical ("failed to send json: %s", capabilities);
-			if (error) {
-				g_critical ("error: %s", error->message);
-				g_error_free (error);
-			}
-			goto out;
-		}
-
-		/* Get the response */
-		ret = cc_oci_qmp_msg_recv (conn->socket,
-				1, &msgs, &msg_count);
-		if (! ret) {
-			goto out;
-		}
-
-		recv_msg = g_slist_nth_data (msgs, 0);
-		if (! recv_msg) {
-			ret = false;
-			goto out;
-		}
-
-		/* Check it */
-		ret = cc_oci_qmp_check_result (recv_msg->str,
-				recv_msg->len, true);
-		if (! ret) {
-			goto out;
-		}
-
-		cc_oci_net_msgs_free_all (msgs);
-
-		initialised = true;
-
-		/* reset */
-		recv_msg = NULL;
-		msgs = NULL;
-		msg_count = 0;
+	if (! cc_oci_qmp_negotiate (conn)) {
+		goto out;
 	}
 
 	g_debug ("sending message '%s'", msg);
@@ -393,7 +450,7 @@ cc_oci_qmp_msg_send (struct cc_oci_vm_conn *conn,
 	}
 
 	/* Get the response */
-	ret = cc_oci_qmp_msg_recv (conn->socket,
+	ret = cc_oci_qmp_msg_recv (conn->socket, &conn->pending,
 			expected_resp_count,
 			&msgs, &msg_count);
 	if (! ret) {
@@ -520,15 +577,490 @@ cc_oci_qmp_resume (struct cc_oci_vm_conn *conn, GPid pid)
 			sizeof(resume_msg)-1, 2, false);
 }
 
+/*!
+ * Execute a QMP command and retrieve its result.
+ *
+ * Asynchronous events sent by the hypervisor before the command
+ * response are ignored.
+ *
+ * \param conn \ref cc_oci_vm_conn to use.
+ * \param command Name of QMP command.
+ * \param arguments Command arguments (or \c NULL).
+ * \param[out] result Newly-allocated "return" value of the command
+ *   (or \c NULL if the caller does not require it).
+ *
+ * \return \c true on success, else \c false.
+ */
+static gboolean
+cc_oci_qmp_execute (struct cc_oci_vm_conn *conn,
+		const gchar *command,
+		JsonObject *arguments,
+		JsonNode **result)
+{
+	JsonObject   *obj = NULL;
+	JsonParser   *parser = NULL;
+	JsonObject   *response;
+	JsonNode     *root;
+	GSList       *msgs = NULL;
+	GSList       *l;
+	GString      *msg;
+	GError       *error = NULL;
+	gchar        *str = NULL;
+	gsize         str_len = 0;
+	gsize         msg_count;
+	gboolean      ret = false;
+	gboolean      done = false;
+
+	g_assert (conn);
+	g_assert (command);
+
+	obj = json_object_new ();
+
+	json_object_set_string_member (obj, "execute", command);
+
+	if (arguments) {
+		json_object_set_object_member (obj, "arguments",
+				json_object_ref (arguments));
+	}
+
+	str = cc_oci_json_obj_to_string (obj, false, &str_len);
+	if (! str) {
+		goto out;
+	}
+
+	if (! cc_oci_qmp_msg_send (conn, str, str_len, 0, false)) {
+		goto out;
+	}
+
+	parser = json_parser_new ();
+
+	while (! done) {
+		msg_count = 0;
+
+		if (! cc_oci_qmp_msg_recv (conn->socket, &conn->pending,
+					1, &msgs, &msg_count)) {
+			goto out;
+		}
+
+		for (l = msgs; l && ! done; l = g_slist_next (l)) {
+			msg = l->data;
+
+			if (! json_parser_load_from_data (parser, msg->str,
+						(gssize)msg->len, &error)) {
+				g_critical ("failed to parse qmp response: %s",
+						error->message);
+				g_error_free (error);
+				goto out;
+			}
+
+			root = json_parser_get_root (parser);
+			if (! (root && JSON_NODE_HOLDS_OBJECT (root))) {
+				g_critical ("unexpected qmp response: %s",
+						msg->str);
+				goto out;
+			}
+
+			response = json_node_get_object (root);
+
+			if (json_object_has_member (response, "event")) {
+				g_debug ("ignoring qmp event %s",
+						json_object_get_string_member (response,
+							"event"));
+				continue;
+			}
+
+			if (json_object_has_member (response, "error")) {
+				JsonObject *err;
+
+				err = json_object_get_object_member (response,
+						"error");
+				g_critical ("qmp command %s failed: %s",
+						command,
+						err && json_object_has_member (err, "desc")
+						? json_object_get_string_member (err, "desc")
+						: msg->str);
+				goto out;
+			}
+
+			if (! json_object_has_member (response, "return")) {
+				g_critical ("unexpected qmp response: %s",
+						msg->str);
+				goto out;
+			}
+
+			if (result) {
+				*result = json_node_copy
+					(json_object_get_member (response,
+								 "return"));
+			}
+
+			done = true;
+		}
+
+		cc_oci_net_msgs_free_all (msgs);
+		msgs = NULL;
+	}
+
+	ret = true;
+
+out:
+	if (msgs) {
+		cc_oci_net_msgs_free_all (msgs);
+	}
+	if (parser) {
+		g_object_unref (parser);
+	}
+	if (obj) {
+		json_object_unref (obj);
+	}
+	g_free_if_set (str);
+
+	return ret;
+}
+
+/*!
+ * Determine the QOM identifier of a hotplugged device from its
+ * QOM path.
+ *
+ * \param qom_path QOM path of device.
+ *
+ * \return Device identifier, or \c NULL if the device was not
+ * hotplugged.
+ */
+static const gchar *
+cc_oci_qmp_device_id (const gchar *qom_path)
+{
+	const gchar prefix[] = "/machine/peripheral/";
+
+	if (! (qom_path && g_str_has_prefix (qom_path, prefix))) {
+		return NULL;
+	}
+
+	return qom_path + sizeof (prefix)-1;
+}
+
+/*!
+ * Hotplug or unplug vCPUs so that the VM has the specified number
+ * of vCPUs.
+ *
+ * Only vCPUs that were previously hotplugged can be unplugged.
+ *
+ * \param conn \ref cc_oci_vm_conn to use.
+ * \param resources \ref cc_oci_vm_resources.
+ * \param vcpus Required number of vCPUs.
+ *
+ * \return \c true on success, else \c false.
+ */
+static gboolean
+cc_oci_qmp_cpu_hotplug (struct cc_oci_vm_conn *conn,
+		struct cc_oci_vm_resources *resources,
+		guint vcpus)
+{
+	JsonNode    *result = NULL;
+	JsonArray   *cpus;
+	JsonObject  *cpu;
+	JsonObject  *args = NULL;
+	gboolean     ret = false;
+	guint        len;
+	guint        i;
+
+	g_assert (conn);
+	g_assert (resources);
+
+	if (vcpus == resources->vcpus) {
+		return true;
+	}
+
+	if (! cc_oci_qmp_execute (conn, "query-hotpluggable-cpus",
+				NULL, &result)) {
+		goto out;
+	}
+
+	if (! JSON_NODE_HOLDS_ARRAY (result)) {
+		g_critical ("unexpected hotpluggable cpus response");
+		goto out;
+	}
+
+	cpus = json_node_get_array (result);
+	len = json_array_get_length (cpus);
+
+	/* Entries are listed in descending order, so walk backwards
+	 * to plug in ascending order and forwards to unplug the most
+	 * recently plugged vCPUs first.
+	 */
+	for (i = 0; i < len && vcpus != resources->vcpus; i++) {
+		const gchar  *qom_path = NULL;
+		const gchar  *id;
+		guint         index;
+		guint         count;
+
+		index = vcpus > resources->vcpus ? len - i - 1 : i;
+
+		cpu = json_array_get_object_element (cpus, index);
+		if (! cpu) {
+			continue;
+		}
+
+		count = (guint)json_object_get_int_member (cpu,
+				"vcpus-count");
+
+		if (json_object_has_member (cpu, "qom-path")) {
+			qom_path = json_object_get_string_member (cpu,
+					"qom-path");
+		}
+
+		args = json_object_new ();
+
+		if (vcpus > resources->vcpus) {
+			g_autofree gchar *new_id = NULL;
+			JsonObject *props;
+			GList *members;
+			GList *m;
+
+			if (qom_path) {
+				/* already plugged */
+				json_object_unref (args);
+				args = NULL;
+				continue;
+			}
+
+			if (resources->vcpus + count > vcpus) {
+				json_object_unref (args);
+				args = NULL;
+				break;
+			}
+
+			new_id = g_strdup_printf ("cpu-%u", index);
+
+			json_object_set_string_member (args, "driver",
+					json_object_get_string_member (cpu, "type"));
+			json_object_set_string_member (args, "id", new_id);
+
+			/* The properties identify the socket, core and
+			 * thread the vCPU is plugged into.
+			 */
+			props = json_object_get_object_member (cpu, "props");
+			members = props ? json_object_get_members (props) : NULL;
+
+			for (m = members; m; m = g_list_next (m)) {
+				json_object_set_member (args, m->data,
+						json_node_copy
+						(json_object_get_member (props,
+									 m->data)));
+			}
+
+			g_list_free (members);
+
+			if (! cc_oci_qmp_execute (conn, "device_add",
+						args, NULL)) {
+				goto out;
+			}
+
+			resources->vcpus += count;
+		} else {
+			id = cc_oci_qmp_device_id (qom_path);
+			if (! id) {
+				/* boot vCPU */
+				json_object_unref (args);
+				args = NULL;
+				continue;
+			}
+
+			json_object_set_string_member (args, "id", id);
+
+			if (! cc_oci_qmp_execute (conn, "device_del",
+						args, NULL)) {
+				goto out;
+			}
+
+			resources->vcpus -= count;
+		}
+
+		json_object_unref (args);
+		args = NULL;
+	}
+
+	if (vcpus != resources->vcpus) {
+		g_critical ("unable to change vCPUs from %u to %u",
+				resources->vcpus, vcpus);
+		goto out;
+	}
+
+	ret = true;
+
+out:
+	if (args) {
+		json_object_unref (args);
+	}
+	if (result) {
+		json_node_free (result);
+	}
+
+	return ret;
+}
+
+/*!
+ * Hotplug a memory device so that the VM has atleast the specified
+ * amount of memory.
+ *
+ * \param conn \ref cc_oci_vm_conn to use.
+ * \param resources \ref cc_oci_vm_resources.
+ * \param memory Required amount of memory in bytes.
+ *
+ * \return \c true on success, else \c false.
+ */
+static gboolean
+cc_oci_qmp_memory_hotplug (struct cc_oci_vm_conn *conn,
+		struct cc_oci_vm_resources *resources,
+		guint64 memory)
+{
+	JsonNode          *result = NULL;
+	JsonArray         *devices;
+	JsonObject        *args = NULL;
+	JsonObject        *props;
+	g_autofree gchar  *memdev_id = NULL;
+	g_autofree gchar  *dimm_id = NULL;
+	gboolean           ret = false;
+	guint64            current;
+	guint64            size;
+	guint64            device_memory = 0;
+	guint              slots_used;
+	guint              i;
+
+	g_assert (conn);
+	g_assert (resources);
+
+	current = resources->boot_memory + resources->hotplugged_memory;
+
+	if (memory <= current) {
+		return true;
+	}
+
+	/* Guests can only online memory in whole blocks */
+	size = memory - current;
+	size = ((size + CC_OCI_MEMORY_BLOCK_SIZE - 1)
+			/ CC_OCI_MEMORY_BLOCK_SIZE) * CC_OCI_MEMORY_BLOCK_SIZE;
+
+	/* Existing memory devices (including any NVDIMMs) occupy
+	 * slots and count towards the maximum memory.
+	 */
+	if (! cc_oci_qmp_execute (conn, "query-memory-devices",
+				NULL, &result)) {
+		goto out;
+	}
+
+	if (! JSON_NODE_HOLDS_ARRAY (result)) {
+		g_critical ("unexpected memory devices response");
+		goto out;
+	}
+
+	devices = json_node_get_array (result);
+	slots_used = json_array_get_length (devices);
+
+	for (i = 0; i < slots_used; i++) {
+		JsonObject *device = json_array_get_object_element (devices, i);
+		JsonObject *data;
+
+		data = device ? json_object_get_object_member (device,
+				"data") : NULL;
+		if (data && json_object_has_member (data, "size")) {
+			device_memory += (guint64)json_object_get_int_member (data,
+					"size");
+		}
+	}
+
+	if (slots_used >= resources->memory_slots) {
+		g_critical ("no free memory slots (%u in use)", slots_used);
+		goto out;
+	}
+
+	if (resources->boot_memory + device_memory + size
+			> resources->max_memory) {
+		g_critical ("cannot add %" G_GUINT64_FORMAT
+				" bytes of memory: maximum is %" G_GUINT64_FORMAT,
+				size, resources->max_memory);
+		goto out;
+	}
+
+	memdev_id = g_strdup_printf ("hotmem%u", slots_used);
+	dimm_id = g_strdup_printf ("hotdimm%u", slots_used);
+
+	args = json_object_new ();
+	props = json_object_new ();
+
+	json_object_set_int_member (props, "size", (gint64)size);
+
+	json_object_set_string_member (args, "qom-type",
+			"memory-backend-ram");
+	json_object_set_string_member (args, "id", memdev_id);
+	json_object_set_object_member (args, "props", props);
+
+	if (! cc_oci_qmp_execute (conn, "object-add", args, NULL)) {
+		goto out;
+	}
+
+	json_object_unref (args);
+	args = json_object_new ();
+
+	json_object_set_string_member (args, "driver", "pc-dimm");
+	json_object_set_string_member (args, "id", dimm_id);
+	json_object_set_string_member (args, "memdev", memdev_id);
+
+	if (! cc_oci_qmp_execute (conn, "device_add", args, NULL)) {
+		goto out;
+	}
+
+	resources->hotplugged_memory += size;
+
+	ret = true;
+
+out:
+	if (args) {
+		json_object_unref (args);
+	}
+	if (result) {
+		json_node_free (result);
+	}
+
+	return ret;
+}
+
+/*!
+ * Set the target memory size of the VM balloon device.
+ *
+ * \param conn \ref cc_oci_vm_conn to use.
+ * \param target Target memory size in bytes.
+ *
+ * \return \c true on success, else \c false.
+ */
+static gboolean
+cc_oci_qmp_balloon (struct cc_oci_vm_conn *conn, guint64 target)
+{
+	JsonObject  *args;
+	gboolean     ret;
+
+	g_assert (conn);
+
+	args = json_object_new ();
+
+	json_object_set_int_member (args, "value", (gint64)target);
+
+	ret = cc_oci_qmp_execute (conn, "balloon", args, NULL);
+
+	json_object_unref (args);
+
+	return ret;
+}
+
 /*!
  * Read the expected QMP welcome message.
  *
- * \param socket \c GSocket to use.
+ * \param conn \ref cc_oci_vm_conn to use.
  *
  * \return \c true on success, else \c false.
  */
 static gboolean
-cc_oci_qmp_check_welcome (GSocket *socket)
+cc_oci_qmp_check_welcome (struct cc_oci_vm_conn *conn)
 {
 	GError      *error = NULL;
 	JsonParser  *parser = NULL;
@@ -538,9 +1070,10 @@ cc_oci_qmp_check_welcome (GSocket *socket)
 	gboolean     ret;
 	GString     *msg = NULL;
 
-	g_assert (socket);
+	g_assert (conn);
 
-	ret = cc_oci_qmp_msg_recv (socket, 1, &msgs, &msg_count);
+	ret = cc_oci_qmp_msg_recv (conn->socket, &conn->pending,
+			1, &msgs, &msg_count);
 	if (! ret) {
 		goto out;
 	}
@@ -593,6 +1126,9 @@ cc_oci_vm_conn_free (struct cc_oci_vm_conn *conn)
 
 	g_object_unref (conn->socket_addr);
 	g_object_unref (conn->socket);
+	if (conn->pending) {
+		g_string_free (conn->pending, true);
+	}
 	g_free (conn);
 }
 
@@ -651,7 +1187,7 @@ cc_oci_vm_conn_new (const gchar *socket_path, GPid pid)
 
 	g_debug ("connected to socket path %s", socket_path);
 
-	ret = cc_oci_qmp_check_welcome (conn->socket);
+	ret = cc_oci_qmp_check_welcome (conn);
 	if (! ret) {
 		goto err;
 	}
@@ -764,3 +1300,90 @@ out:
 
 	return ret;
 }
+
+/*!
+ * Change the resources available to the running hypervisor.
+ *
+ * vCPUs are hotplugged or unplugged, memory is hotplugged when
+ * \p memory exceeds the current VM memory and a memory limit below
+ * the VM memory is enforced using the balloon device.
+ *
+ * \param socket_path Path to \ref CC_OCI_HYPERVISOR_SOCKET.
+ * \param pid \c GPid of hypervisor process.
+ * \param[in,out] resources \ref cc_oci_vm_resources of the VM,
+ *   updated to reflect the changes made.
+ * \param vcpus Required number of vCPUs (0 to leave unchanged).
+ * \param memory Required memory limit in bytes (0 to leave unchanged).
+ *
+ * \return \c true on success, else \c false.
+ */
+gboolean
+cc_oci_vm_update (const gchar *socket_path, GPid pid,
+		struct cc_oci_vm_resources *resources,
+		guint vcpus, guint64 memory)
+{
+	gboolean                 ret = false;
+	struct cc_oci_vm_conn   *conn = NULL;
+	guint64                  total;
+
+	g_assert (socket_path);
+	g_assert (pid);
+	g_assert (resources);
+
+	if (vcpus && vcpus > resources->max_vcpus) {
+		g_critical ("cannot use %u vCPUs: maximum is %u",
+				vcpus, resources->max_vcpus);
+		return false;
+	}
+
+	if (vcpus && vcpus < resources->boot_vcpus) {
+		g_warning ("cannot use %u vCPUs: "
+				"using boot value of %u",
+				vcpus, resources->boot_vcpus);
+		vcpus = resources->boot_vcpus;
+	}
+
+	if (memory > resources->max_memory) {
+		g_critical ("cannot use %" G_GUINT64_FORMAT
+				" bytes of memory: maximum is %" G_GUINT64_FORMAT,
+				memory, resources->max_memory);
+		return false;
+	}
+
+	conn = cc_oci_vm_conn_new (socket_path, pid);
+	if (! conn) {
+		goto out;
+	}
+
+	if (vcpus) {
+		ret = cc_oci_qmp_cpu_hotplug (conn, resources, vcpus);
+		if (! ret) {
+			goto out;
+		}
+	}
+
+	if (memory) {
+		ret = cc_oci_qmp_memory_hotplug (conn, resources, memory);
+		if (! ret) {
+			goto out;
+		}
+
+		total = resources->boot_memory + resources->hotplugged_memory;
+
+		ret = cc_oci_qmp_balloon (conn, MIN (memory, total));
+		if (! ret) {
+			goto out;
+		}
+
+		resources->memory_limit = memory;
+	}
+
+	ret = true;
+
+out:
+	if (conn) {
+		cc_oci_vm_conn_free (conn);
+	}
+
+	return ret;
+}
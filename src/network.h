@@ -24,5 +24,8 @@
 gboolean cc_oci_vm_pause (const gchar *socket_path, GPid pid);
 gboolean cc_oci_vm_resume (const gchar *socket_path, GPid pid);
 gboolean cc_oci_vm_shutdown (const gchar *socket_path, GPid pid);
+gboolean cc_oci_vm_update (const gchar *socket_path, GPid pid,
+		struct cc_oci_vm_resources *resources,
+		guint vcpus, guint64 memory);
 
 #endif /* _CC_OCI_NETWORK_H */
@@ -33,6 +33,7 @@
 #include "semver.h"
 #include "oci-config.h"
 #include "networking.h"
+#include "vm_socket.h"
 
 /*!
  * Free all resources associated with \p h hook object.
@@ -42,6 +43,7 @@
 void
 cc_oci_hook_free (struct oci_cfg_hook *h) {
 	if (h) {
+		g_free_if_set (h->path);
 		if (h->args) {
 			g_strfreev(h->args);
 		}
@@ -105,6 +107,29 @@ cc_oci_config_file_path (const gchar *bundle_path)
 			CC_OCI_CONFIG_FILE);
 }
 
+/*!
+ * Free the specified \ref cc_oci_vm_cfg.
+ *
+ * \param vm \ref cc_oci_vm_cfg.
+ */
+void
+cc_oci_vm_cfg_free (struct cc_oci_vm_cfg *vm)
+{
+	if (! vm) {
+		return;
+	}
+
+	g_free_if_set (vm->hypervisor_path);
+	g_free_if_set (vm->image_path);
+	g_free_if_set (vm->kernel_path);
+	g_free_if_set (vm->workload_path);
+	g_free_if_set (vm->kernel_params);
+	g_free_if_set (vm->rootfs_path);
+	g_free_if_set (vm->rootfs_image);
+	g_free_if_set (vm->memory_path);
+	g_free (vm);
+}
+
 /*!
  * Free all resources associated with the static \p config object.
  *
@@ -124,10 +149,15 @@ cc_oci_config_free (struct cc_oci_config *config)
 	g_free_if_set (config->root_dir);
 	g_free_if_set (config->pid_file);
 
-	if (config->vm) {
-		g_free_if_set (config->vm->kernel_params);
-		g_free (config->vm);
-	}
+	g_free_if_set (config->state.state_file_path);
+	g_free_if_set (config->state.runtime_path);
+	g_free_if_set (config->state.comms_path);
+	g_free_if_set (config->state.procsock_path);
+
+	cc_oci_vm_sockets_close (config);
+
+	cc_oci_vm_cfg_free (config->vm);
+	config->vm = NULL;
 
 	if (config->oci.process.args) {
 		g_strfreev (config->oci.process.args);
@@ -142,6 +172,8 @@ cc_oci_config_free (struct cc_oci_config *config)
 
 	g_free_if_set (config->oci.platform.os);
 	g_free_if_set (config->oci.platform.arch);
+	g_free_if_set (config->oci.root.path);
+	g_free_if_set (config->oci.process.cwd);
 
 	if (config->oci.hooks.prestart) {
 		g_slist_free_full(config->oci.hooks.prestart,
@@ -160,6 +192,8 @@ cc_oci_config_free (struct cc_oci_config *config)
                 (GDestroyNotify)cc_oci_ns_free);
 	}
 
+	g_free_if_set (config->oci.oci_linux.resources.cpu_cpus);
+
 	g_free_if_set (config->net.hostname);
 	g_free_if_set (config->net.gateway);
 	g_free_if_set (config->net.dns_ip1);
@@ -176,7 +210,8 @@ cc_oci_config_free (struct cc_oci_config *config)
  *
  * \param [in] root \c GNode
  * \param[in,out] config \ref cc_oci_config.
- * \param spec_handlers Array of \ref spec_handler's.
+ * \param spec_handlers Array of \ref spec_handler's, indexed by
+ *   \ref spec_section (\c NULL for sections to skip).
  *
  * \return \c false if a spec handler fails, else \c true.
  */
@@ -185,32 +220,34 @@ cc_oci_process_config (GNode *root, struct cc_oci_config *config,
 	struct spec_handler **spec_handlers)
 {
 	GNode* node;
+	struct spec_handler* handler;
+	gint section;
 
 	for (node = g_node_first_child(root); node; node = g_node_next_sibling(node)) {
 		if (! node->data) {
 			continue;
 		}
 
+		section = cc_oci_key_lookup (&spec_section_keys, node->data);
+		if (section == CC_OCI_KEY_UNKNOWN) {
+			continue;
+		}
+
 		if (node->children) {
-			if (g_strcmp0 (node->data, "ociVersion") == 0) {
+			if (section == SPEC_OCI_VERSION) {
 				config->oci.oci_version = g_strdup (node->children->data);
 			}
 
-			if (g_strcmp0 (node->data, "hostname") == 0) {
+			if (section == SPEC_HOSTNAME) {
 				config->oci.hostname = g_strdup (node->children->data);
 			}
 		}
 
-		/* looking for right spec handler */
-		for (struct spec_handler** i=spec_handlers; (*i); ++i) {
-			if (g_strcmp0((*i)->name, node->data) == 0) {
-				/* run spec handler */
-				if (! (*i)->handle_section(node, config)) {
-					g_critical("failed spec handler: %s", (*i)->name);
-					return false;
-				}
-				break;
-			}
+		/* run spec handler */
+		handler = spec_handlers[section];
+		if (handler && ! handler->handle_section(node, config)) {
+			g_critical("failed spec handler: %s", handler->name);
+			return false;
 		}
 	}
 
@@ -25,6 +25,7 @@
 
 gchar *cc_oci_config_file_path (const char *bundle_path);
 void cc_oci_config_free (struct cc_oci_config *config);
+void cc_oci_vm_cfg_free (struct cc_oci_vm_cfg *vm);
 
 gboolean
 cc_oci_config_check (const struct cc_oci_config *config);
@@ -26,18 +26,23 @@
  * \see https://www.opencontainers.org/
  */
 
+#include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
 #include <errno.h>
 #include <sys/types.h>
 #include <stdio.h>
 #include <sys/types.h>
+#include <sys/wait.h>
 #include <pwd.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 #include <glib.h>
 #include <glib/gstdio.h>
 #include <glib/gprintf.h>
 #include <gio/gunixsocketaddress.h>
+#include <glib-unix.h>
 #include <json-glib/json-glib.h>
 #include <json-glib/json-gobject.h>
 
@@ -53,6 +58,10 @@
 #include "runtime.h"
 #include "spec_handler.h"
 #include "command.h"
+#include "hyperstart.h"
+#include "pidfd.h"
+#include "rootfs.h"
+#include "batch.h"
 
 extern struct start_data start_data;
 
@@ -62,8 +71,8 @@ struct format_options
 	/** If \c true, output in JSON format. */
 	gboolean    use_json;
 
-	/** Used for JSON formatting. */
-	JsonArray  *array;
+	/** Number of VMs displayed so far (used for JSON formatting). */
+	guint       count;
 
 	/* If \c true, show hypervisor, image and kernel details. */
 	gboolean    show_all;
@@ -100,24 +109,22 @@ struct process_watcher_data
 	GSocket                *socket;
 	GSocketAddress         *src_address;
 	GIOChannel             *channel;
+	int                     pidfd;
 	gboolean                failed;
 };
 
 /**
- * List of spec handlers used to process config on start
+ * Spec handlers used to process config on start
  */
-static struct spec_handler* start_spec_handlers[] = {
-	&annotations_spec_handler,
-	&hooks_spec_handler,
-	&mounts_spec_handler,
-	&platform_spec_handler,
-	&process_spec_handler,
-	&root_spec_handler,
-	&vm_spec_handler,
-	&linux_spec_handler,
-
-	/* terminator */
-	NULL
+static struct spec_handler* start_spec_handlers[SPEC_SECTIONS] = {
+	[SPEC_ANNOTATIONS] = &annotations_spec_handler,
+	[SPEC_HOOKS]       = &hooks_spec_handler,
+	[SPEC_MOUNTS]      = &mounts_spec_handler,
+	[SPEC_PLATFORM]    = &platform_spec_handler,
+	[SPEC_PROCESS]     = &process_spec_handler,
+	[SPEC_ROOT]        = &root_spec_handler,
+	[SPEC_VM]          = &vm_spec_handler,
+	[SPEC_LINUX]       = &linux_spec_handler,
 };
 
 /*!
@@ -180,14 +187,14 @@ cc_oci_get_config_and_state (gchar **config_file,
 	/* Fill in further details to make the config valid */
 	config->bundle_path = g_strdup ((*state)->bundle_path);
 	config->state.workload_pid = (*state)->pid;
+	config->state.workload_start_time = (*state)->pid_start_time;
 	config->state.status = (*state)->status;
 
-	g_strlcpy (config->state.comms_path, (*state)->comms_path,
-			sizeof (config->state.comms_path));
+	g_free (config->state.comms_path);
+	config->state.comms_path = g_strdup ((*state)->comms_path);
 
-	g_strlcpy (config->state.procsock_path,
-			(*state)->procsock_path,
-			sizeof (config->state.procsock_path));
+	g_free (config->state.procsock_path);
+	config->state.procsock_path = g_strdup ((*state)->procsock_path);
 
 	*config_file = cc_oci_config_file_path ((*state)->bundle_path);
 	if (! (*config_file)) {
@@ -225,8 +232,12 @@ cc_oci_kill (struct cc_oci_config *config,
 	/* save current status */
 	last_status = config->state.status;
 
-	/* stopping container */
-	config->state.status = OCI_STATUS_STOPPING;
+	/* Commit the final status before signalling, so that anything
+	 * waiting for the hypervisor to exit already sees the container
+	 * as stopped. An intermediate "stopping" status would only be
+	 * visible while kill(2) runs and cost another state file write.
+	 */
+	config->state.status = OCI_STATUS_STOPPED;
 
 	/* update state file */
 	if (! cc_oci_state_file_create (config, state->create_time)) {
@@ -248,16 +259,6 @@ cc_oci_kill (struct cc_oci_config *config,
 		return false;
 	}
 
-	last_status = config->state.status;
-
-	config->state.status = OCI_STATUS_STOPPED;
-
-	/* update state file */
-	if (! cc_oci_state_file_create (config, state->create_time)) {
-		g_critical ("failed to recreate state file");
-		goto error;
-	}
-
 	return true;
 
 error:
@@ -274,14 +275,14 @@ error:
  *
  * \return \c true on success, else \c false.
  */
-private gboolean
+gboolean
 cc_oci_vm_running (const struct oci_state *state)
 {
 	if (! (state && state->pid)) {
 		return false;
 	}
 
-	return kill (state->pid, 0) == 0;
+	return cc_oci_pid_running (state->pid, state->pid_start_time);
 }
 
 /*!
@@ -683,8 +684,8 @@ cc_oci_create_container_workload (struct cc_oci_config *config)
 		return false;
 	}
 
-	g_strlcpy (config->vm->workload_path, path,
-			sizeof (config->vm->workload_path));
+	g_free (config->vm->workload_path);
+	config->vm->workload_path = g_strdup (path);
 
 	args = config->oci.process.args;
 	while (*args != NULL) {
@@ -759,6 +760,10 @@ cc_oci_cleanup (struct cc_oci_config *config)
 		return false;
 	}
 
+	if (config->vm && ! cc_oci_rootfs_image_delete (config)) {
+		return false;
+	}
+
 	if (! cc_oci_state_file_delete (config)) {
 		return false;
 	}
@@ -874,7 +879,8 @@ cc_oci_create (struct cc_oci_config *config)
 	}
 
 	if (! cc_oci_runtime_dir_setup (config)) {
-		if (g_file_test (config->state.runtime_path,
+		if (config->state.runtime_path
+				&& g_file_test (config->state.runtime_path,
 					G_FILE_TEST_EXISTS |
 					G_FILE_TEST_IS_DIR)) {
 			g_critical ("container %s already exists",
@@ -886,20 +892,20 @@ cc_oci_create (struct cc_oci_config *config)
 		return false;
 	}
 
-	if (! cc_oci_handle_mounts (config)) {
-		g_critical ("failed to handle mounts");
-		return false;
-	}
-
 	if (! cc_oci_create_container_workload (config)) {
 		g_critical ("failed to create workload");
 		return false;
 	}
 
-	// FIXME: consider dry-run mode.
-	if (config->dry_run_mode) {
-		g_debug ("dry-run mode: not launching VM");
-		return true;
+	/* must precede the mounts: volumes stay on the host */
+	if (! cc_oci_rootfs_image_create (config)) {
+		g_critical ("failed to create rootfs image");
+		goto out;
+	}
+
+	if (! cc_oci_handle_mounts (config)) {
+		g_critical ("failed to handle mounts");
+		goto out;
 	}
 
 	/* start VM is a stopped state (containerd requires a
@@ -913,6 +919,10 @@ cc_oci_create (struct cc_oci_config *config)
 	ret = true;
 
 out:
+	if (! ret) {
+		(void)cc_oci_rootfs_image_delete (config);
+	}
+
 	return ret;
 }
 
@@ -943,6 +953,32 @@ handle_socket_close (GIOChannel              *source,
 	return false;
 }
 
+/*!
+ * Called when the pidfd of the VM becomes readable, denoting its
+ * shutdown.
+ *
+ * \param fd pidfd.
+ * \param condition \c GIOCondition.
+ * \param data \ref process_watcher_data.
+ *
+ * \return \c false to remove the watch.
+ */
+static gboolean
+handle_vm_exit (gint                          fd,
+		GIOCondition                  condition,
+		struct process_watcher_data  *data)
+{
+	(void)fd;
+	(void)condition;
+
+	g_assert (data);
+	g_assert (data->loop);
+
+	g_main_loop_quit (data->loop);
+
+	return false;
+}
+
 /**
  * Connect to \ref CC_OCI_PROCESS_SOCKET and set a watch to trigger
  * when the socket is closed (denoting the VM has shutdown).
@@ -963,7 +999,7 @@ handle_process_socket (struct process_watcher_data *data)
 		return false;
 	}
 
-	if (! data->config->state.procsock_path[0]) {
+	if (! data->config->state.procsock_path) {
 		return false;
 	}
 
@@ -1018,10 +1054,13 @@ handle_process_socket (struct process_watcher_data *data)
 fail4:
 	g_io_channel_shutdown (data->channel, true, NULL);
 	g_io_channel_unref (data->channel);
+	data->channel = NULL;
 fail3:
 	g_object_unref (data->src_address);
+	data->src_address = NULL;
 fail2:
 	g_object_unref (data->socket);
+	data->socket = NULL;
 fail1:
 	g_main_loop_unref (data->loop);
 	data->loop = NULL;
@@ -1080,6 +1119,136 @@ watcher_runtime_dir (GFileMonitor            *monitor,
 	}
 }
 
+/*!
+ * Run the relay of a VM booted with the \ref CC_OCI_VM_BOOT_AGENT
+ * profile. Only returns on failure to start the workload.
+ *
+ * \param config \ref cc_oci_config.
+ * \param wait \c true if the caller is attached to the workload.
+ * \param relay Listening socket of the relay (consumed).
+ */
+static void
+cc_oci_agent_relay_run (struct cc_oci_config *config, gboolean wait,
+		GSocket *relay)
+{
+	gboolean  terminal = false;
+	gint      exit_code = -1;
+	int       fd;
+
+	if (wait) {
+		terminal = isatty (STDIN_FILENO) && isatty (STDOUT_FILENO);
+	} else {
+		/* outlive the runtime, writing to the container console
+		 * rather than the terminal "start" was run from.
+		 */
+		(void)setsid ();
+
+		fd = -1;
+		if (config->console && ! config->use_socket_console) {
+			fd = g_open (config->console, O_RDWR | O_NOCTTY, 0);
+		}
+		if (fd < 0) {
+			fd = g_open ("/dev/null", O_RDWR, 0);
+		}
+		if (fd < 0) {
+			/* never write to the caller's console */
+			close (STDIN_FILENO);
+			close (STDOUT_FILENO);
+			close (STDERR_FILENO);
+		} else {
+			dup2 (fd, STDIN_FILENO);
+			dup2 (fd, STDOUT_FILENO);
+			dup2 (fd, STDERR_FILENO);
+			if (fd > STDERR_FILENO) {
+				close (fd);
+			}
+		}
+	}
+
+	if (! cc_oci_hyper_run_workload (config, terminal, relay,
+				&exit_code)) {
+		_exit (EXIT_FAILURE);
+	}
+
+	_exit (exit_code);
+}
+
+/*!
+ * Hand the workload to the agent of a VM booted with the
+ * \ref CC_OCI_VM_BOOT_AGENT profile.
+ *
+ * The VM has no workload of its own in that case, so a child process
+ * sends it to the agent and relays its I/O until it exits. Using a
+ * child keeps the relay off the main loop the caller uses to wait
+ * for the VM. The relay holds the agent channels for the lifetime of
+ * the workload, so it listens on \ref CC_OCI_AGENT_RELAY_SOCKET for
+ * other commands needing the agent. The socket is created here so
+ * that it exists once "start" returns.
+ *
+ * If \p wait is \c false, the relay is detached (double fork) so
+ * that it is neither a child of the runtime nor attached to its
+ * terminal.
+ *
+ * \param config \ref cc_oci_config.
+ * \param wait \c true if the caller is attached to the workload.
+ * \param[out] relay_pid Pid of the relay for the caller to reap
+ *   (only set if \p wait is \c true).
+ *
+ * \return \c true on success, else \c false.
+ */
+static gboolean
+cc_oci_start_agent_workload (struct cc_oci_config *config, gboolean wait,
+		pid_t *relay_pid)
+{
+	GSocket  *relay;
+	pid_t     pid;
+	int       status;
+
+	relay = cc_oci_hyper_relay_listen (config->state.runtime_path);
+	if (! relay) {
+		return false;
+	}
+
+	pid = fork ();
+	if (pid < 0) {
+		g_critical ("failed to fork workload relay: %s",
+				strerror (errno));
+		g_object_unref (relay);
+		return false;
+	}
+
+	if (! pid) {
+		if (! wait) {
+			pid = fork ();
+			if (pid < 0) {
+				_exit (EXIT_FAILURE);
+			} else if (pid > 0) {
+				_exit (EXIT_SUCCESS);
+			}
+		}
+
+		cc_oci_agent_relay_run (config, wait, relay);
+	}
+
+	/* the relay owns the socket now */
+	g_object_unref (relay);
+
+	if (wait) {
+		*relay_pid = pid;
+		return true;
+	}
+
+	/* reap the intermediate child */
+	if (waitpid (pid, &status, 0) < 0 ||
+			! WIFEXITED (status) ||
+			WEXITSTATUS (status) != EXIT_SUCCESS) {
+		g_critical ("failed to detach workload relay");
+		return false;
+	}
+
+	return true;
+}
+
 /*!
  * Start a VM previously setup by a call to cc_oci_create().
  *
@@ -1098,7 +1267,8 @@ cc_oci_start (struct cc_oci_config *config,
 	GFile         *file = NULL;
 	GError        *error = NULL;
 	gboolean       wait = false;
-	struct process_watcher_data data = { 0 };
+	pid_t          relay_pid = -1;
+	struct process_watcher_data data = { .pidfd = -1 };
 	gchar         *config_file = NULL;
 
 	if (! config || ! state) {
@@ -1136,6 +1306,19 @@ cc_oci_start (struct cc_oci_config *config,
 
 	pid = config->state.workload_pid;
 
+	/* Refer to the VM through a pidfd so that neither the signal
+	 * below nor the wait can reach another process reusing its pid.
+	 * Kernels without pidfds fall back to the pid and the process
+	 * socket.
+	 */
+	data.pidfd = cc_oci_pidfd_open (pid,
+			config->state.workload_start_time);
+	if (data.pidfd < 0 && errno != ENOSYS) {
+		g_critical ("container %s no longer running",
+				config->optarg_container_id);
+		return false;
+	}
+
 	/* XXX: If running stand-alone, wait for the hypervisor to
 	 * finish. But if running under containerd, don't wait.
 	 *
@@ -1154,13 +1337,30 @@ cc_oci_start (struct cc_oci_config *config,
 		data.loop = g_main_loop_new (NULL, 0);
 		if (! data.loop) {
 			g_critical ("cannot create main loop for client");
-			return false;
+			goto out;
 		}
+	}
 
+	if (wait && data.pidfd >= 0) {
+		/* the pidfd becomes readable when the VM exits */
+		g_unix_fd_add (data.pidfd, G_IO_IN,
+				(GUnixFDSourceFunc)handle_vm_exit,
+				&data);
+	} else if (wait && g_file_test (config->state.procsock_path,
+				G_FILE_TEST_EXISTS)) {
+		/* The socket was created by "create" (see vm_socket.c),
+		 * so there is no need to wait for it to appear: connect
+		 * now, the hypervisor accepts the connection once
+		 * resumed.
+		 */
+		if (! handle_process_socket (&data)) {
+			g_critical ("failed to handle process socket");
+			goto out;
+		}
+	} else if (wait) {
 		file = g_file_new_for_path (config->state.runtime_path);
 		if (! file) {
-			g_main_loop_unref (data.loop);
-			return false;
+			goto out;
 		}
 
 		/* create inotify watch on runtime directory
@@ -1174,10 +1374,7 @@ cc_oci_start (struct cc_oci_config *config,
 					g_file_get_path (file),
 					error->message);
 			g_error_free (error);
-			g_object_unref (file);
-			g_main_loop_unref (data.loop);
-
-			return false;
+			goto out;
 		}
 
 		g_signal_connect (monitor, "changed",
@@ -1188,17 +1385,19 @@ cc_oci_start (struct cc_oci_config *config,
 	/* "create" left the VM in a stopped state, so now let it
 	 * continue.
 	 *
-	 * This will result in \ref CC_OCI_PROCESS_SOCKET being
-	 * created, however there will be a delay. Since we wish to
-	 * connect to this socket, the approach is to use an inotify
-	 * watch to wait for the socket file to exist, then connect to
-	 * it.
+	 * Without a pidfd, and unless "create" made it already, this
+	 * will result in \ref CC_OCI_PROCESS_SOCKET being created,
+	 * however there will be a delay. Since we wish to connect to
+	 * this socket, the approach is to use an inotify watch to wait
+	 * for the socket file to exist, then connect to it.
 	 */
-	if (kill (pid, SIGCONT) < 0) {
+	if ((data.pidfd >= 0
+			? cc_oci_pidfd_send_signal (data.pidfd, SIGCONT)
+			: kill (pid, SIGCONT)) < 0) {
 		g_critical ("failed to start VM %s: %s",
 				config->optarg_container_id,
 				strerror (errno));
-		return false;
+		goto out;
 	}
 
 	g_debug ("activated VM %s (pid %d)",
@@ -1220,6 +1419,13 @@ cc_oci_start (struct cc_oci_config *config,
 	cc_run_hooks (config->oci.hooks.poststart,
 	              config->state.state_file_path, false);
 
+	if (config->vm && config->vm->boot == CC_OCI_VM_BOOT_AGENT) {
+		if (! cc_oci_start_agent_workload (config, wait,
+					&relay_pid)) {
+			goto out;
+		}
+	}
+
 	if (wait) {
 		g_main_loop_run (data.loop);
 
@@ -1243,6 +1449,13 @@ cc_oci_start (struct cc_oci_config *config,
 	}
 
 out:
+	if (data.pidfd >= 0) {
+		close (data.pidfd);
+	}
+	if (relay_pid > 0) {
+		/* the relay exits once the workload (and VM) has */
+		(void)waitpid (relay_pid, NULL, 0);
+	}
 	if (wait) {
 		if (file) {
 			g_object_unref (file);
@@ -1404,6 +1617,72 @@ cc_oci_toggle (struct cc_oci_config *config,
 	return cc_oci_state_file_create (config, state->create_time);
 }
 
+/*!
+ * Apply new resource constraints to a running Hypervisor.
+ *
+ * The number of vCPUs is derived from the CPU quota and period
+ * (rounded up) or, if those are not set, from the cpuset. The memory
+ * limit is applied using memory hotplug and the balloon device.
+ *
+ * \param config \ref cc_oci_config.
+ * \param state \ref oci_state.
+ * \param resources \ref oci_cfg_resources to apply.
+ *
+ * \return \c true on success, else \c false.
+ */
+gboolean
+cc_oci_update (struct cc_oci_config *config,
+		struct oci_state *state,
+		const struct oci_cfg_resources *resources)
+{
+	guint     vcpus = 0;
+	guint64   memory;
+	gboolean  ret;
+
+	g_assert (config);
+	g_assert (state);
+	g_assert (resources);
+
+	if (! (state->status == OCI_STATUS_RUNNING
+			|| state->status == OCI_STATUS_PAUSED)) {
+		g_critical ("cannot update container %s in state %s",
+				config->optarg_container_id,
+				cc_oci_status_to_str (state->status));
+		return false;
+	}
+
+	if (! state->vm_resources) {
+		g_critical ("resources of container %s are unknown",
+				config->optarg_container_id);
+		return false;
+	}
+
+	if (resources->cpu_quota && resources->cpu_period) {
+		vcpus = (guint)(((guint64)resources->cpu_quota
+					+ resources->cpu_period - 1)
+				/ resources->cpu_period);
+	} else if (resources->cpu_cpus) {
+		vcpus = cc_oci_cpuset_count (resources->cpu_cpus);
+	}
+
+	memory = (guint64)resources->memory_limit;
+
+	if (! (vcpus || memory)) {
+		g_warning ("no resources to update");
+		return true;
+	}
+
+	ret = cc_oci_vm_update (state->comms_path, state->pid,
+			&config->vm_resources, vcpus, memory);
+	if (! ret) {
+		return false;
+	}
+
+	config->state.status = state->status;
+
+	return cc_oci_state_file_create (config, state->create_time);
+}
+
 /*!
  * Run the command specified by \p argv in the hypervisor
  * and wait for it to finish.
@@ -1413,6 +1692,9 @@ cc_oci_toggle (struct cc_oci_config *config,
  * \param argc Argument count.
  * \param argv Argument vector.
  *
+ * The exit code of the command is recorded in
+ * \ref cc_oci_config.exit_code.
+ *
  * \return \c true on success, else \c false.
  */
 gboolean
@@ -1426,7 +1708,13 @@ cc_oci_exec (struct cc_oci_config *config,
 	g_assert (argc);
 	g_assert (argv);
 
-	if (! cc_oci_vm_connect (config, argc, argv)) {
+	if (! cc_oci_vm_running (state)) {
+		g_critical ("container %s is not running",
+				config->optarg_container_id);
+		return false;
+	}
+
+	if (! cc_oci_vm_connect (config, argc, argv, &config->exit_code)) {
 		g_critical ("failed to connect to VM");
 		return false;
 	}
@@ -1434,6 +1722,93 @@ cc_oci_exec (struct cc_oci_config *config,
 	return true;
 }
 
+/*!
+ * List the processes running inside a container.
+ *
+ * \param config \ref cc_oci_config.
+ * \param state \ref oci_state.
+ * \param format Output format ("table" or "json").
+ * \param argc Number of ps(1) arguments.
+ * \param argv ps(1) arguments (ignored for "json").
+ *
+ * \return \c true on success, else \c false.
+ */
+gboolean
+cc_oci_ps (struct cc_oci_config *config,
+		struct oci_state *state, const gchar *format,
+		int argc, char *const argv[])
+{
+	GByteArray  *output = NULL;
+	JsonParser  *parser = NULL;
+	JsonNode    *root;
+	gchar       *str = NULL;
+	GError      *error = NULL;
+	gboolean     ret = false;
+
+	if (! (config && state && format)) {
+		return false;
+	}
+
+	if (g_strcmp0 (format, "table") && g_strcmp0 (format, "json")) {
+		g_critical ("invalid ps format: %s", format);
+		return false;
+	}
+
+	if (! cc_oci_vm_running (state)) {
+		g_critical ("container %s is not running",
+				config->optarg_container_id);
+		return false;
+	}
+
+	if (! cc_oci_hyper_ps (config, format, argc, argv, &output)) {
+		g_critical ("failed to list processes of container %s",
+				config->optarg_container_id);
+		return false;
+	}
+
+	if (! g_strcmp0 (format, "table")) {
+		g_print ("%.*s", (int)output->len, (const gchar *)output->data);
+		ret = true;
+		goto out;
+	}
+
+	/* json: the agent returns an array of pids */
+	parser = json_parser_new ();
+
+	if (! json_parser_load_from_data (parser,
+				(const gchar *)output->data,
+				(gssize)output->len, &error)) {
+		g_critical ("invalid ps output from agent: %s",
+				error->message);
+		g_error_free (error);
+		goto out;
+	}
+
+	root = json_parser_get_root (parser);
+	if (! (root && JSON_NODE_HOLDS_ARRAY (root))) {
+		g_critical ("invalid ps output from agent: expected array");
+		goto out;
+	}
+
+	str = cc_oci_json_arr_to_string (json_node_get_array (root), false);
+	if (! str) {
+		goto out;
+	}
+
+	g_print ("%s\n", str);
+
+	ret = true;
+
+out:
+	if (parser) {
+		g_object_unref (parser);
+	}
+	g_free_if_set (str);
+	g_byte_array_free (output, true);
+
+	return ret;
+}
+
 /*!
  * Display details of a VM.
  *
@@ -1445,10 +1820,11 @@ cc_oci_exec (struct cc_oci_config *config,
  */
 static void
 cc_oci_list_vm (const struct oci_state *state,
-		const struct format_options *options)
+		struct format_options *options)
 {
 	JsonObject  *obj = NULL;
 	const gchar  *status = NULL;
+	gchar        *str = NULL;
 
 	g_assert (state);
 	g_assert (options);
@@ -1528,8 +1904,20 @@ cc_oci_list_vm (const struct oci_state *state,
 				state->vm->image_path);
 	}
 
-	/* The array now owns the object, so no need to free it */
-	json_array_add_object_element (options->array, obj);
+	str = cc_oci_json_obj_to_string (obj, false, NULL);
+	json_object_unref (obj);
+
+	if (! str) {
+		return;
+	}
+
+	/* Stream the array one element at a time rather than building
+	 * it in full before displaying anything.
+	 */
+	g_print ("%s%s", options->count ? "," : "[", str);
+	options->count++;
+
+	g_free (str);
 }
 
 /*!
@@ -1544,35 +1932,22 @@ cc_oci_list_vm (const struct oci_state *state,
  *
  * \return \ref oci_state on success, else \c NULL.
  */
-static struct oci_state *
+struct oci_state *
 cc_oci_vm_get_state (const gchar *name, const char *root_dir)
 {
-	struct cc_oci_config  config = { { 0 } };
-	struct oci_state      *state = NULL;
-	gchar                 *config_file = NULL;
+	g_autofree gchar  *state_file_path = NULL;
 
 	g_assert (name);
 
-	config.optarg_container_id = name;
-
-	if (root_dir) {
-		config.root_dir = g_strdup (root_dir);
-	}
-
-	if (! cc_oci_runtime_path_get (&config)) {
-		return NULL;
-	}
-
-	if (! cc_oci_state_file_get (&config)) {
-		return NULL;
-	}
-
-	state = cc_oci_state_file_read (config.state.state_file_path);
-
-	g_free_if_set (config_file);
-	cc_oci_config_free (&config);
+	/* Same path as cc_oci_runtime_path_get() and
+	 * cc_oci_state_file_get() would produce, without setting
+	 * up a whole config object for every container listed.
+	 */
+	state_file_path = g_strdup_printf ("%s/%s/%s",
+			root_dir ? root_dir : CC_OCI_RUNTIME_DIR_PREFIX,
+			name, CC_OCI_STATE_FILE);
 
-	return state;
+	return cc_oci_state_file_read (state_file_path);
 }
 
 /*!
@@ -1649,23 +2024,32 @@ cc_oci_update_options (const struct oci_state *state,
  * - There may be no VMS to report on.
  * - VMs may be destroyed as this function runs.
  *
+ * Containers are filtered by id before their state file is read. JSON
+ * output and container ids are displayed as each container is found;
+ * only table output needs all states to calculate the column widths.
+ *
  * \param config \ref cc_oci_config.
  * \param format Type of format to present list in ("json", "table",
  * or NULL for text).
  * \param show_all If \c true, show all details.
+ * \param selector \ref cc_oci_batch_selector to filter the containers
+ *   with (or \c NULL to list all containers).
+ * \param quiet If \c true, only display container ids, one per line
+ *   (\p format and \p show_all are then ignored).
  *
  * \return \c true on success, else \c false.
  */
 gboolean
 cc_oci_list (struct cc_oci_config *config, const gchar *format,
-        gboolean show_all)
+        gboolean show_all, const struct cc_oci_batch_selector *selector,
+        gboolean quiet)
 {
 	GDir                   *dir;
 	const gchar            *dirname;
 	const gchar            *name;
 	GSList                 *vms = NULL;
 	struct oci_state       *state = NULL;
-	gchar                  *str = NULL;
+	gboolean                need_state;
 	struct format_options   options = { 0 };
 
 	if ((!config) || (!format) || (!(*format))) {
@@ -1687,17 +2071,31 @@ cc_oci_list (struct cc_oci_config *config, const gchar *format,
 
 	options.show_all = show_all;
 
+	/* ids alone can be listed without parsing any state */
+	need_state = ! quiet ||
+		(selector && cc_oci_batch_selector_needs_state (selector));
+
 	dir = g_dir_open (dirname, 0x0, NULL);
 	if (! dir) {
 		/* No containers yet, so not an error */
 		goto no_vms;
 	}
 
-	/* Read all VM state files and add to a list */
 	while ((name = g_dir_read_name (dir)) != NULL) {
 		gboolean ret;
 		gchar *path;
 
+		if (selector && ! cc_oci_batch_id_match (name, selector)) {
+			continue;
+		}
+
+		if (! need_state) {
+			if (cc_oci_batch_state_exists (dirname, name)) {
+				g_print ("%s\n", name);
+			}
+			continue;
+		}
+
 		path = g_build_path ("/", dirname, name, NULL);
 
 		ret = g_file_test (path, G_FILE_TEST_IS_DIR);
@@ -1713,73 +2111,88 @@ cc_oci_list (struct cc_oci_config *config, const gchar *format,
 			continue;
 		}
 
-		if (! options.use_json) {
-			/* calculate the maximum field widths
-			 * to display the state values.
-			 */
-			cc_oci_update_options (state, &options);
+		/* A VM that has exited is displayed as stopped */
+		if (! cc_oci_vm_running (state)) {
+			state->status = OCI_STATUS_STOPPED;
+		}
+
+		if (selector && ! cc_oci_batch_state_match (state, selector)) {
+			cc_oci_state_free (state);
+			continue;
+		}
+
+		if (quiet) {
+			g_print ("%s\n", state->id);
+			cc_oci_state_free (state);
+			continue;
 		}
 
-		vms = g_slist_append (vms, state);
+		if (options.use_json) {
+			cc_oci_list_vm (state, &options);
+			cc_oci_state_free (state);
+			continue;
+		}
+
+		/* calculate the maximum field widths
+		 * to display the state values.
+		 */
+		cc_oci_update_options (state, &options);
+
+		vms = g_slist_prepend (vms, state);
 	}
 
 no_vms:
+	if (quiet) {
+		goto out;
+	}
+
 	if (options.use_json) {
-		if (! vms) {
+		if (! options.count) {
 			/* List is empty */
 			/* Be runc compatible */
 			g_print ("%s", "null");
-
-			goto out;
 		} else {
-			options.array = json_array_new ();
+			g_print ("]\n");
 		}
-	} else {
-		/* format the header using the calculated widths */
-		g_print ("%-*s %-*s %-*s %-*s %-*s%s",
-				options.id_width,
-				"ID",
 
-				options.pid_width,
-				"PID",
+		goto out;
+	}
 
-				options.status_width,
-				"STATUS",
+	/* format the header using the calculated widths */
+	g_print ("%-*s %-*s %-*s %-*s %-*s%s",
+			options.id_width,
+			"ID",
 
-				options.bundle_width,
-				"BUNDLE",
+			options.pid_width,
+			"PID",
 
-				options.created_width,
-				"CREATED",
+			options.status_width,
+			"STATUS",
 
-				options.show_all ? " " : "\n");
+			options.bundle_width,
+			"BUNDLE",
 
-		if (options.show_all) {
-			g_print ("%-*s %-*s %-*s\n",
-					options.hypervisor_width,
-					"HYPERVISOR",
+			options.created_width,
+			"CREATED",
 
-					options.kernel_width,
-					"KERNEL",
+			options.show_all ? " " : "\n");
 
-					options.image_width,
-					"IMAGE");
-		}
+	if (options.show_all) {
+		g_print ("%-*s %-*s %-*s\n",
+				options.hypervisor_width,
+				"HYPERVISOR",
+
+				options.kernel_width,
+				"KERNEL",
+
+				options.image_width,
+				"IMAGE");
 	}
 
 	/* display the VMs, again using the calculated widths */
+	vms = g_slist_reverse (vms);
 	g_slist_foreach (vms, (GFunc)cc_oci_list_vm, &options);
 
-	if (options.use_json) {
-		str = cc_oci_json_arr_to_string (options.array, false);
-		if (! str) {
-			goto out;
-		}
-
-		g_print ("%s\n", str);
-		json_array_unref (options.array);
-	}
-
 	/* clean up */
 	g_slist_free_full (vms, (GDestroyNotify)cc_oci_state_free);
 
@@ -1787,7 +2200,6 @@ out:
 	if (dir) {
 		g_dir_close (dir);
 	}
-	g_free_if_set (str);
 
 	return true;
 }
@@ -1828,11 +2240,14 @@ cc_oci_config_update (struct cc_oci_config *config,
 		state->vm = NULL;
 	}
 
+	if (state->vm_resources) {
+		config->vm_resources = *state->vm_resources;
+	}
+
 	if (state->procsock_path) {
 		/* No need to do a full transfer */
-		g_strlcpy (config->state.procsock_path,
-				state->procsock_path,
-				sizeof (config->state.procsock_path));
+		g_free (config->state.procsock_path);
+		config->state.procsock_path = g_strdup (state->procsock_path);
 	}
 
 	return true;
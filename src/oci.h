@@ -67,6 +67,12 @@
 /** Name of hypervisor socket used as a console device. */
 #define CC_OCI_AGENT_TTY_SOCKET		"ga-tty.sock"
 
+/** Name of socket used to reach the guest agent while the
+ * workload relay of a \ref CC_OCI_VM_BOOT_AGENT VM holds its
+ * channels.
+ */
+#define CC_OCI_AGENT_RELAY_SOCKET	"ga-relay.sock"
+
 /** File generated below \ref CC_OCI_RUNTIME_DIR_PREFIX at runtime that
  * contains metadata about the running instance.
  */
@@ -101,9 +107,6 @@
 /** Shell to use for \ref CC_OCI_WORKLOAD_FILE. */
 #define CC_OCI_WORKLOAD_SHELL		"/bin/sh"
 
-/** Command to use to allow "exec" to connect to the container. */
-#define CC_OCI_EXEC_CMD               "ssh"
-
 /** File that contains vm spec configuration, used if vm node
  * in CC_OCI_CONFIG_FILE bundle file
 */
@@ -125,6 +128,25 @@ enum oci_status {
 	OCI_STATUS_INVALID = -1
 };
 
+/** Durability of \ref CC_OCI_STATE_FILE writes. */
+enum cc_oci_state_sync {
+	/** \ref CC_OCI_STATE_SYNC_NONE on memory-backed file systems,
+	 * else \ref CC_OCI_STATE_SYNC_DATA.
+	 */
+	CC_OCI_STATE_SYNC_AUTO = 0,
+
+	/** Never flush state files to storage. */
+	CC_OCI_STATE_SYNC_NONE,
+
+	/** Flush state file contents before replacing the old file. */
+	CC_OCI_STATE_SYNC_DATA,
+
+	/** Also flush the directory, so the new file survives a crash. */
+	CC_OCI_STATE_SYNC_FULL,
+
+	CC_OCI_STATE_SYNC_INVALID = -1
+};
+
 enum oci_namespace {
 	OCI_NS_PID     = CLONE_NEWPID,
 	OCI_NS_NET     = CLONE_NEWNET,
@@ -137,6 +159,60 @@ enum oci_namespace {
 	OCI_NS_INVALID = -1,
 };
 
+/** Backend used to provide guest RAM. */
+enum cc_oci_vm_memory_backend {
+	/** Anonymous hypervisor memory (the default). */
+	CC_OCI_VM_MEMORY_ANONYMOUS = 0,
+
+	/** Files on a hugetlbfs mount. */
+	CC_OCI_VM_MEMORY_HUGEPAGES,
+
+	/** Shared (share=on) files on a tmpfs mount. */
+	CC_OCI_VM_MEMORY_SHARED,
+
+	CC_OCI_VM_MEMORY_INVALID = -1,
+};
+
+/** Transport used to provide the container rootfs to the guest. */
+enum cc_oci_vm_rootfs_backend {
+	/** 9p share of the rootfs directory (the default). */
+	CC_OCI_VM_ROOTFS_9P = 0,
+
+	/** virtio-blk disk holding an image built from the rootfs. */
+	CC_OCI_VM_ROOTFS_BLOCK,
+
+	CC_OCI_VM_ROOTFS_INVALID = -1,
+};
+
+/** How the guest starts the workload. */
+enum cc_oci_vm_boot {
+	/** systemd runs the workload from container-workload.service
+	 * (the default).
+	 */
+	CC_OCI_VM_BOOT_SYSTEMD = 0,
+
+	/** The agent runs as init and is sent the workload by
+	 * "start".
+	 */
+	CC_OCI_VM_BOOT_AGENT,
+
+	CC_OCI_VM_BOOT_INVALID = -1,
+};
+
+/** Performance profile of the \ref CC_OCI_VM_ROOTFS_9P share. */
+enum cc_oci_vm_rootfs_profile {
+	/** Mount options chosen by the guest image (the default). */
+	CC_OCI_VM_ROOTFS_PROFILE_DEFAULT = 0,
+
+	/** Data and metadata cached by the guest. */
+	CC_OCI_VM_ROOTFS_PROFILE_READMOSTLY,
+
+	/** Large messages, only mmap'd data cached by the guest. */
+	CC_OCI_VM_ROOTFS_PROFILE_BUILD,
+
+	CC_OCI_VM_ROOTFS_PROFILE_INVALID = -1,
+};
+
 struct oci_cfg_platform {
 	gchar  *os;
 	gchar  *arch;
@@ -144,7 +220,7 @@ struct oci_cfg_platform {
 
 struct oci_cfg_root {
 	/** Full path to chroot workload directory. */
-	gchar     path[PATH_MAX];
+	gchar    *path;
 
 	gboolean  read_only;
 };
@@ -156,7 +232,7 @@ struct oci_cfg_user {
 };
 
 struct oci_cfg_hook {
-	gchar    path[PATH_MAX]; /*!< Hook command to run. */
+	gchar   *path;           /*!< Hook command to run. */
 	gchar  **args;           /*!< Arguments to command (argv[0] is the first argument). */
 	gchar  **env;            /*!< List of environment variables to set. */
 
@@ -192,7 +268,7 @@ struct oci_cfg_process {
 	gchar              **args;
 
 	/** Full path to working directory to run workload command in. */
-	gchar                cwd[PATH_MAX];
+	gchar               *cwd;
 
 	gchar              **env;
 
@@ -202,6 +278,26 @@ struct oci_cfg_process {
 	struct oci_cfg_user  user;
 };
 
+/**
+ * Representation of the subset of the OCI linux resources that can be
+ * applied to a VM.
+ *
+ * \see https://github.com/opencontainers/runtime-spec/blob/master/config-linux.md#control-groups
+ */
+struct oci_cfg_resources {
+	/** Memory limit in bytes (0 if not specified). */
+	gint64   memory_limit;
+
+	/** CPU quota in microseconds (0 if not specified). */
+	gint64   cpu_quota;
+
+	/** CPU period in microseconds (0 if not specified). */
+	guint64  cpu_period;
+
+	/** List of CPUs the container may use (cpuset format). */
+	gchar   *cpu_cpus;
+};
+
 /**
  * Representation of OCI linux-specific configuration.
  *
@@ -213,6 +309,9 @@ struct oci_cfg_process {
 struct oci_cfg_linux {
 	/** List of \ref oci_cfg_namespace namespaces */
 	GSList          *namespaces;
+
+	/** Resource limits for the container. */
+	struct oci_cfg_resources  resources;
 };
 
 /** Representation of the OCI runtime schema embodied by
@@ -249,21 +348,93 @@ struct oci_cfg {
 /** clr-specific VM configuration data. */
 struct cc_oci_vm_cfg {
 	/** Full path to the hypervisor. */
-	gchar hypervisor_path[PATH_MAX];
+	gchar *hypervisor_path;
 
 	/** Full path to Clear Containers disk image. */
-	gchar image_path[PATH_MAX];
+	gchar *image_path;
+
+	/** Size of \ref image_path in bytes (\c 0 until validated). */
+	guint64 image_size;
 
 	/** Full path to kernel to use for VM. */
-	gchar kernel_path[PATH_MAX];
+	gchar *kernel_path;
 
 	/** Full path to CC_OCI_WORKLOAD_FILE
 	 * (which exists below "root_path").
 	 */
-	gchar workload_path[PATH_MAX];
+	gchar *workload_path;
 
 	/** Kernel parameters (optional). */
 	gchar *kernel_params;
+
+	/** Boot profile of the guest. */
+	enum cc_oci_vm_boot boot;
+
+	/** Backend for guest RAM. */
+	enum cc_oci_vm_memory_backend memory_backend;
+
+	/** Full path to directory containing the files that back
+	 * guest RAM (unused for \ref CC_OCI_VM_MEMORY_ANONYMOUS).
+	 */
+	gchar *memory_path;
+
+	/** Required huge page size in bytes (0 for any size). */
+	guint64 hugepage_size;
+
+	/** Transport for the container rootfs. */
+	enum cc_oci_vm_rootfs_backend rootfs_backend;
+
+	/** Full path to directory the rootfs images are created in
+	 * (unused for \ref CC_OCI_VM_ROOTFS_9P).
+	 */
+	gchar *rootfs_path;
+
+	/** Profile used for \ref CC_OCI_VM_ROOTFS_9P unless
+	 * overridden by the \ref CC_OCI_ANNOTATION_ROOTFS_PROFILE
+	 * annotation.
+	 */
+	enum cc_oci_vm_rootfs_profile rootfs_profile;
+
+	/** Size of the rootfs image in bytes (0 for the default). */
+	guint64 rootfs_size;
+
+	/** Full path to the rootfs image built for the container
+	 * (\c NULL if none).
+	 */
+	gchar *rootfs_image;
+};
+
+/** Resources (vCPUs and memory) of a running VM.
+ *
+ * The boot values are determined from the hypervisor command-line,
+ * the remaining values track changes made by the "update" command.
+ */
+struct cc_oci_vm_resources {
+	/** Number of vCPUs the VM was started with. */
+	guint    boot_vcpus;
+
+	/** Maximum number of vCPUs the VM can have. */
+	guint    max_vcpus;
+
+	/** Number of vCPUs currently available to the VM. */
+	guint    vcpus;
+
+	/** Memory (in bytes) the VM was started with. */
+	guint64  boot_memory;
+
+	/** Maximum memory (in bytes) the VM can have. */
+	guint64  max_memory;
+
+	/** Number of memory hotplug slots. */
+	guint    memory_slots;
+
+	/** Memory (in bytes) hotplugged into the VM. */
+	guint64  hotplugged_memory;
+
+	/** Memory limit (in bytes) enforced by the balloon device
+	 * (0 if no limit has been set).
+	 */
+	guint64  memory_limit;
 };
 
 /** cc-specific network configuration data. */
@@ -355,6 +526,11 @@ struct oci_state {
 	/** Process ID of VM. */
 	GPid             pid;
 
+	/** Start time of \c pid, used to detect reused pids
+	 * (\c 0 if not recorded).
+	 */
+	guint64          pid_start_time;
+
 	gchar           *bundle_path;
 	gchar           *comms_path;
 
@@ -384,37 +560,48 @@ struct oci_state {
 	gboolean         use_socket_console;
 
 	struct cc_oci_vm_cfg *vm;
+
+	/** VM resources (\c NULL if not recorded). */
+	struct cc_oci_vm_resources *vm_resources;
 };
 
 /** clr-specific state fields. */
 struct cc_oci_container_state {
 	/** Full path to generated state file. */
-	gchar state_file_path[PATH_MAX];
+	gchar *state_file_path;
 
 	/** Full path to container-specific directory below
 	 * \ref CC_OCI_RUNTIME_DIR_PREFIX (or below the modified root
 	 * specified in \ref cc_oci_config).
 	 */
-	gchar runtime_path[PATH_MAX];
+	gchar *runtime_path;
 
 	/** Full path to socket used to control the hypervisor
 	 * below \ref CC_OCI_RUNTIME_DIR_PREFIX (or below the modified
 	 * root specified in \ref cc_oci_config).
 	 */
-	gchar comms_path[PATH_MAX];
+	gchar *comms_path;
 
 	/** Full path to socket used to determine when the hypervisor
 	 * has been shut down.
 	 * Created below \ref CC_OCI_RUNTIME_DIR_PREFIX
 	 * (or below the modified root specified in \ref cc_oci_config).
 	 */
-	gchar procsock_path[PATH_MAX];
+	gchar *procsock_path;
 
 	/* Process ID of hypervisor. */
 	GPid workload_pid;
 
+	/** Start time of \c workload_pid (see cc_oci_pid_start_time()),
+	 * or 0 if unknown.
+	 */
+	guint64 workload_start_time;
+
 	/** OCI status of container. */
 	enum oci_status status;
+
+	/** Durability of state file writes. */
+	enum cc_oci_state_sync sync;
 };
 
 /** clr-specific mount details. */
@@ -427,7 +614,7 @@ struct cc_oci_mount {
 	/** Full path to mnt_dir directory
 	 * (root_dir + '/' + mnt.mnt_dir).
 	 */
-	gchar          dest[PATH_MAX];
+	gchar         *dest;
 
 	/** \c true if mount should not be honoured. */
 	gboolean       ignore_mount;
@@ -440,6 +627,20 @@ struct cc_oci_mount {
 	gchar          *directory_created;
 };
 
+/** Hypervisor sockets the runtime can create on its behalf
+ * (see vm_socket.c).
+ */
+enum cc_oci_vm_socket {
+	CC_OCI_VM_SOCKET_COMMS = 0,
+	CC_OCI_VM_SOCKET_PROCESS,
+	CC_OCI_VM_SOCKET_CONSOLE,
+	CC_OCI_VM_SOCKET_AGENT_CTL,
+	CC_OCI_VM_SOCKET_AGENT_TTY,
+
+	/* last entry */
+	CC_OCI_VM_SOCKET_MAX
+};
+
 /** The main object holding all configuration data.
  *
  * \note The main user of this object is "start" - other commands
@@ -459,6 +660,9 @@ struct cc_oci_config {
 	/** Network configuration. */
 	struct cc_oci_net_cfg           net;
 
+	/** VM resources. */
+	struct cc_oci_vm_resources      vm_resources;
+
 	/** Container-specific state. */
 	struct cc_oci_container_state  state;
 
@@ -476,6 +680,12 @@ struct cc_oci_config {
 	 */
 	gboolean use_socket_console;
 
+	/** Listening sockets inherited by the hypervisor, indexed by
+	 * \ref cc_oci_vm_socket (\c 0 if the hypervisor creates the
+	 * socket itself).
+	 */
+	int vm_sockets[CC_OCI_VM_SOCKET_MAX];
+
 	/** If set, use an alternative root directory to the default
 	 * CC_OCI_RUNTIME_DIR_PREFIX.
 	 */
@@ -489,8 +699,16 @@ struct cc_oci_config {
 
 	/** If \c true, don't wait for hypervisor process to finish. */
 	gboolean detached_mode;
+
+	/** Exit status the runtime should exit with once the
+	 * sub-command succeeds (set by \c exec to that of the command).
+	 */
+	gint exit_code;
 };
 
+/* defined in batch.h */
+struct cc_oci_batch_selector;
+
 gboolean cc_oci_attach(struct cc_oci_config *config,
 		struct oci_state *state);
 gchar *cc_oci_config_file_path (const gchar *bundle_path);
@@ -499,6 +717,7 @@ gboolean cc_oci_start (struct cc_oci_config *config,
 		struct oci_state *state);
 gboolean cc_oci_run (struct cc_oci_config *config);
 void cc_oci_config_free (struct cc_oci_config *config);
+void cc_oci_vm_cfg_free (struct cc_oci_vm_cfg *vm);
 gchar *cc_oci_get_bundlepath_file (const gchar *bundle_path,
 		const gchar *file);
 gboolean cc_oci_get_config_and_state (gchar **config_file,
@@ -512,12 +731,23 @@ gboolean cc_oci_toggle (struct cc_oci_config *config,
 gboolean cc_oci_exec (struct cc_oci_config *config,
 		struct oci_state *state,
 		int argc, char *const args[]);
+gboolean cc_oci_ps (struct cc_oci_config *config,
+		struct oci_state *state, const gchar *format,
+		int argc, char *const argv[]);
 gboolean cc_oci_list (struct cc_oci_config *config,
-		const gchar *format, gboolean show_all);
+		const gchar *format, gboolean show_all,
+		const struct cc_oci_batch_selector *selector,
+		gboolean quiet);
+struct oci_state *cc_oci_vm_get_state (const gchar *name,
+		const char *root_dir);
+gboolean cc_oci_vm_running (const struct oci_state *state);
 gboolean cc_oci_delete (struct cc_oci_config *config,
 		struct oci_state *state);
 gboolean cc_oci_kill (struct cc_oci_config *config,
 		struct oci_state *state, int signum);
+gboolean cc_oci_update (struct cc_oci_config *config,
+		struct oci_state *state,
+		const struct oci_cfg_resources *resources);
 
 gboolean cc_oci_config_update (struct cc_oci_config *config,
 		struct oci_state *state);
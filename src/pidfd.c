@@ -0,0 +1,199 @@
+/*
+ * This file is part of cc-oci-runtime.
+ *
+ * Copyright (C) 2016 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/**
+ * \file
+ *
+ * Process liveness tracking.
+ *
+ * A pid alone can be reused once its process has been reaped, so
+ * processes are identified by their pid and start time (as found in
+ * \c /proc/[pid]/stat), and watched through a pidfd where the kernel
+ * supports them (Linux 5.3+).
+ */
+
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+
+#include <glib.h>
+
+#include "pidfd.h"
+
+#ifndef SYS_pidfd_open
+/* same number on all architectures */
+#define SYS_pidfd_open 434
+#endif
+
+#ifndef SYS_pidfd_send_signal
+#define SYS_pidfd_send_signal 424
+#endif
+
+/** Index of the start time in \c /proc/[pid]/stat, counting from the
+ * field following the command name.
+ */
+#define CC_OCI_PROC_STAT_STARTTIME 19
+
+/*!
+ * Determine when a process started.
+ *
+ * \param pid Process ID.
+ *
+ * \return Start time in clock ticks since boot on success, else \c 0.
+ */
+guint64
+cc_oci_pid_start_time (GPid pid)
+{
+	g_autofree gchar  *path = NULL;
+	g_autofree gchar  *contents = NULL;
+	gchar            **fields = NULL;
+	gchar             *p;
+	guint64            start_time = 0;
+
+	if (pid <= 0) {
+		return 0;
+	}
+
+	path = g_strdup_printf ("/proc/%d/stat", (int)pid);
+
+	if (! g_file_get_contents (path, &contents, NULL, NULL)) {
+		return 0;
+	}
+
+	/* the command name may contain spaces and parentheses */
+	p = strrchr (contents, ')');
+	if (! p || p[1] != ' ') {
+		return 0;
+	}
+
+	fields = g_strsplit (p + 2, " ", CC_OCI_PROC_STAT_STARTTIME + 2);
+	if (g_strv_length (fields) > CC_OCI_PROC_STAT_STARTTIME) {
+		start_time = g_ascii_strtoull (
+				fields[CC_OCI_PROC_STAT_STARTTIME], NULL, 10);
+	}
+
+	g_strfreev (fields);
+
+	return start_time;
+}
+
+/*!
+ * Obtain a pidfd for a process.
+ *
+ * The pidfd becomes readable once the process has exited.
+ *
+ * \param pid Process ID.
+ * \param start_time Start time of the process, as returned by
+ *   \ref cc_oci_pid_start_time (or \c 0 to skip the check).
+ *
+ * \return pidfd on success, else -1 with \c errno set: \c ESRCH if
+ * the process doesn't exist (or \p pid now belongs to another
+ * process), \c ENOSYS if the kernel doesn't support pidfds.
+ */
+int
+cc_oci_pidfd_open (GPid pid, guint64 start_time)
+{
+	int fd;
+
+	if (pid <= 0) {
+		errno = ESRCH;
+		return -1;
+	}
+
+	fd = (int)syscall (SYS_pidfd_open, pid, 0);
+	if (fd < 0) {
+		if (errno == EPERM) {
+			/* blocked by a seccomp filter unaware of it */
+			errno = ENOSYS;
+		}
+		return -1;
+	}
+
+	/* The pid may have been reused before the pidfd was opened,
+	 * but the process it refers to can't change afterwards.
+	 */
+	if (start_time && cc_oci_pid_start_time (pid) != start_time) {
+		close (fd);
+		errno = ESRCH;
+		return -1;
+	}
+
+	return fd;
+}
+
+/*!
+ * Send a signal to the process referred to by a pidfd.
+ *
+ * \param pidfd pidfd, as returned by \ref cc_oci_pidfd_open.
+ * \param signum Signal number.
+ *
+ * \return \c 0 on success, else -1 with \c errno set.
+ */
+int
+cc_oci_pidfd_send_signal (int pidfd, int signum)
+{
+	return (int)syscall (SYS_pidfd_send_signal, pidfd, signum, NULL, 0);
+}
+
+/*!
+ * Determine if a process is running.
+ *
+ * Contrary to \c kill(pid, 0), exited but not yet reaped processes
+ * and reused pids are not considered running.
+ *
+ * \param pid Process ID.
+ * \param start_time Start time of the process, as returned by
+ *   \ref cc_oci_pid_start_time (or \c 0 to skip the check).
+ *
+ * \return \c true if the process is running, else \c false.
+ */
+gboolean
+cc_oci_pid_running (GPid pid, guint64 start_time)
+{
+	struct pollfd  pfd = { 0 };
+	gboolean       ret;
+
+	pfd.fd = cc_oci_pidfd_open (pid, start_time);
+	if (pfd.fd < 0) {
+		if (errno != ENOSYS) {
+			return false;
+		}
+
+		/* kernel without pidfd support */
+		if (kill (pid, 0) < 0) {
+			return false;
+		}
+
+		return ! start_time
+			|| cc_oci_pid_start_time (pid) == start_time;
+	}
+
+	pfd.events = POLLIN;
+
+	ret = poll (&pfd, 1, 0) == 0;
+
+	close (pfd.fd);
+
+	return ret;
+}
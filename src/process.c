@@ -59,67 +59,22 @@
 #include "common.h"
 #include "logging.h"
 #include "netlink.h"
+#include "hyperstart.h"
+#include "vm_socket.h"
+#include "pidfd.h"
 
-static GMainLoop* main_loop = NULL;
 private GMainLoop* hook_loop = NULL;
 
-/** List of shells that are recognised by "exec", ordered by likelihood. */
-static const gchar *recognised_shells[] =
-{
-	"sh",
-	"bash",
-	"zsh",
-	"ksh",
-	"csh",
-
-	/* terminator */
-	NULL,
-};
-
 /*!
- * Determine if \p cmd is a shell.
- *
- * \param cmd Command to check.
+ * Close file descriptors, excluding standard streams and the sockets
+ * the hypervisor inherits.
  *
- * \return \c true on success, else \c false.
- */
-private gboolean
-cc_oci_cmd_is_shell (const char *cmd)
-{
-	const gchar **shell;
-
-	if (! cmd) {
-		return false;
-	}
-
-	for (shell = (const gchar **)recognised_shells;
-			shell && *shell;
-			shell++) {
-		g_autofree gchar *suffix = NULL;
-
-		if (! g_strcmp0 (*shell, cmd)) {
-			/* exact match */
-			return true;
-		}
-
-		suffix = g_strdup_printf ("/%s", *shell);
-
-		if (g_str_has_suffix (cmd, suffix)) {
-			/* full path to shell was specified */
-			return true;
-		}
-	}
-
-	return false;
-}
-
-/*!
- * Close file descriptors, excluding standard streams.
+ * \param config \ref cc_oci_config.
  *
  * \return \c true on success, else \c false.
  */
 static gboolean
-cc_oci_close_fds (void) {
+cc_oci_close_fds (const struct cc_oci_config *config) {
 	char           *fd_dir = "/proc/self/fd";
 	DIR            *dir;
 	struct dirent  *ent;
@@ -148,6 +103,11 @@ cc_oci_close_fds (void) {
 			continue;
 		}
 
+		if (cc_oci_vm_socket_inherited (config, fd)) {
+			/* ignore the sockets created for the hypervisor */
+			continue;
+		}
+
 		(void)close (fd);
 	}
 
@@ -185,7 +145,7 @@ cc_oci_setup_child (struct cc_oci_config *config)
 
 	/* Do not close fds when VM runs in detached mode*/
 	if (! config->detached_mode) {
-		cc_oci_close_fds ();
+		cc_oci_close_fds (config);
 	}
 
 	cc_oci_setup_hypervisor_logs(config);
@@ -193,32 +153,6 @@ cc_oci_setup_child (struct cc_oci_config *config)
 	return true;
 }
 
-/*!
- * Close spawned container and stop the main loop.
- *
- * \param pid Process ID.
- * \param status status of child process.
- * \param[out] exit_code exit code of child process.
- *
- * \note \p exit_code may be \c NULL to avoid returning the
- * child exit code.
- */
-#if 0
-static void
-cc_oci_child_watcher (GPid pid, gint status,
-		gpointer exit_code) {
-	g_debug ("pid %u ended with exit status %d", pid, status);
-
-	if (exit_code) {
-		*((gint*)exit_code) = status;
-	}
-
-	g_spawn_close_pid (pid);
-
-	g_main_loop_quit (main_loop);
-}
-#endif
-
 /*!
  * Close spawned hook and stop the hook loop.
  *
@@ -574,6 +508,8 @@ cc_oci_vm_launch (struct cc_oci_config *config)
 	if (! pid) {
 		/* child */
 		pid = config->state.workload_pid = getpid ();
+		config->state.workload_start_time =
+			cc_oci_pid_start_time (pid);
 
 		close (hook_status_pipe[1]);
 		close (child_err_pipe[0]);
@@ -631,6 +567,21 @@ cc_oci_vm_launch (struct cc_oci_config *config)
 			goto child_failed;
 		}
 
+		ret = cc_oci_vm_resources_get (args, &config->vm_resources);
+		if (! ret) {
+			goto child_failed;
+		}
+
+		/* Everything up to here is what a real launch does.
+		 * The placeholder exits as soon as "start" resumes it.
+		 */
+		if (config->dry_run_mode) {
+			g_debug ("dry-run mode: not launching hypervisor");
+			g_strfreev (args);
+			args = g_new0 (gchar *, 2);
+			args[0] = g_strdup (CC_OCI_DRY_RUN_HYPERVISOR);
+		}
+
 		// FIXME: add netcfg to state file
 		ret = cc_oci_state_file_create (config, timestamp);
 		if (! ret) {
@@ -659,6 +610,11 @@ cc_oci_vm_launch (struct cc_oci_config *config)
 
 	g_debug ("child pid is %u", (unsigned)pid);
 
+	/* The child can't have been reaped yet, so this is its start
+	 * time rather than that of a process reusing its pid.
+	 */
+	config->state.workload_start_time = cc_oci_pid_start_time (pid);
+
 	close (hook_status_pipe[0]);
 	hook_status_pipe[0] = -1;
 
@@ -836,160 +792,35 @@ exit:
 /*!
  * Create a connection to the VM, run a command and disconnect.
  *
+ * The command is run by the hyperstart agent, with its standard
+ * streams multiplexed over the agent tty channel.
+ *
  * \param config \ref cc_oci_config.
  * \param argc Argument count.
  * \param argv Argument vector.
+ * \param[out] exit_code Exit code of the command.
  *
- * \return \c true on success, else \c false.
+ * \return \c true if the command was run, else \c false.
  */
 gboolean
 cc_oci_vm_connect (struct cc_oci_config *config,
 		int argc,
-		char *const argv[]) {
-	gchar     **args = NULL;
-	gboolean    ret = false;
-	guint       args_len = 0;
-	gboolean    cmd_is_just_shell = false;
-#if 0
-	GError     *err = NULL;
-	GPid        pid;
-	gint        exit_code = -1;
-	GSpawnFlags flags = (G_SPAWN_CHILD_INHERITS_STDIN |
-			     /* XXX: required for g_child_watch_add! */
-			     G_SPAWN_DO_NOT_REAP_CHILD |
-			     G_SPAWN_SEARCH_PATH);
-	guint i;
-#endif
-
+		char *const argv[],
+		gint *exit_code) {
 	g_assert (config);
 	g_assert (argc);
 	g_assert (argv);
+	g_assert (exit_code);
 
-	/* Check if the user has specified a shell to run.
-	 *
-	 * FIXME: This is a pragmatic (but potentially unreliable) solution
-	 * FIXME:   if the user wants to run an unknown shell.
-	 */
-	if (cc_oci_cmd_is_shell (argv[0])) {
-		cmd_is_just_shell = true;
-	}
-
-	/* The user wants to run an interactive shell.
-	 * However, this is the default with ssh if no command is
-	 * specified.
-	 *
-	 * If a shell is passed as the 1st arg, ssh gets
-	 * confused as it's expecting to run a non-interactive command,
-	 * so simply remove it to get the behaviour the user wants.
-	 *
-	 * An extra check is performed to ensure that the argument after
-	 * the shell is not an option to ensure that commands like:
-	 * "bash -c ..." still work as expected.
-	 */
-	if (argv[1] && argv[1][0] == '-') {
-		cmd_is_just_shell = false;
-	}
-
-	/* Just a shell, so remove the argument to get the expected
-	 * behavior of an interactive shell.
-	 */
-	if (cmd_is_just_shell) {
-		argc--;
-		argv++;
-	}
-
-	args_len = (guint)argc;
-
-	/* +2 for CC_OCI_EXEC_CMD + hostname to connect to */
-	args_len += 2;
+	g_debug ("running command '%s' in container %s",
+			argv[0], config->optarg_container_id);
 
-	/* +1 for NULL terminator */
-	args = g_new0 (gchar *, args_len + 1);
-	if (! args) {
+	if (! cc_oci_hyper_exec (config, argc, argv, exit_code)) {
 		return false;
 	}
 
-	/* The command to use to connect to the VM */
-	args[0] = g_strdup (CC_OCI_EXEC_CMD);
-	if (! args[0]) {
-		ret = false;
-		goto out;
-	}
-
-	/* connection string to connect to the VM */
-	// FIXME: replace with proper connection string once networking details available.
-#if 0
-	args[1] = g_strdup_printf (ip_address);
-
-	/* append argv to the end of args */
-	if (argc) {
-		for (i = 0; i < args_len; ++i) {
-			args[i+2] = g_strdup (argv[i]);
-		}
-	}
-
-	g_debug ("running command:");
-	for (gchar** p = args; p && *p; p++) {
-		g_debug ("arg: '%s'", *p);
-	}
-
-	/* create a new main loop */
-	main_loop = g_main_loop_new (NULL, 0);
-	if (! main_loop) {
-		g_critical ("cannot create main loop for client");
-		goto out;
-	}
-
-	ret = g_spawn_async_with_pipes (NULL, /* working directory */
-			args,
-			NULL, /* inherit parents environment */
-			flags,
-			(GSpawnChildSetupFunc)cc_oci_close_fds,
-			NULL, /* user_data */
-			&pid,
-			NULL, /* standard_input */
-			NULL, /* standard_output */
-			NULL, /* standard_error */
-			&err);
-
-	if (! ret) {
-		g_critical ("failed to spawn child process (%s): %s",
-				args[0], err->message);
-		g_error_free (err);
-		goto out;
-	}
-
-	g_debug ("child process ('%s') running with pid %u",
-			args[0], (unsigned)pid);
-
-	g_child_watch_add (pid, cc_oci_child_watcher, &exit_code);
-
-	/* wait for child to finish */
-	g_main_loop_run (main_loop);
-
-	g_debug ("child pid %u exited with code %d",
-			(unsigned )pid, (int)exit_code);
-
-	if (exit_code) {
-		/* failed */
-		goto out;
-	}
-
-	ret = true;
-#else
-	g_critical ("not implemented yet");
-	ret = false;
-#endif
+	g_debug ("command '%s' exited with code %d",
+			argv[0], (int)*exit_code);
 
-out:
-	if (args) {
-		g_strfreev (args);
-	}
-
-	if (main_loop) {
-		g_main_loop_unref (main_loop);
-		main_loop = NULL;
-	}
-
-	return ret;
+	return true;
 }
@@ -21,12 +21,15 @@
 #ifndef _CC_OCI_PROCESS_H
 #define _CC_OCI_PROCESS_H
 
+/** Command run instead of the hypervisor in dry-run mode. */
+#define CC_OCI_DRY_RUN_HYPERVISOR "true"
+
 gboolean cc_oci_vm_launch (struct cc_oci_config *config);
 
 gboolean cc_run_hooks(GSList* hooks, const gchar* state_file_path,
                        gboolean stop_on_failure);
 
 gboolean cc_oci_vm_connect (struct cc_oci_config *config,
-		int argc, char *const argv[]);
+		int argc, char *const argv[], gint *exit_code);
 
 #endif /* _CC_OCI_PROCESS_H */
@@ -0,0 +1,721 @@
+/*
+ * This file is part of cc-oci-runtime.
+ *
+ * Copyright (C) 2016 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/**
+ * \file
+ *
+ * Block device rootfs images.
+ *
+ * With the \ref CC_OCI_VM_ROOTFS_BLOCK backend, the container rootfs
+ * is not shared with the guest over 9p. Instead, a sparse raw ext4
+ * image is populated from the rootfs directory and attached to the
+ * VM as a virtio-blk disk. Metadata operations in the guest are then
+ * handled by the guest kernel rather than each requiring a 9p
+ * round-trip to the hypervisor.
+ *
+ * The image is built before the bundle mounts are applied, so it
+ * never contains the volumes. These stay on the host and are shared
+ * with the guest over 9p, which bind mounts them over the image (see
+ * \ref CC_OCI_VM_ROOTFS_VOLUMES_PARAM).
+ *
+ * Images are cached by a fingerprint of the rootfs directory, so
+ * containers created from an unchanged rootfs share an image rather
+ * than each copying the rootfs again. The hypervisor opens the image
+ * as a snapshot: changes made by the workload are not visible below
+ * the rootfs directory on the host, and are discarded when the VM
+ * exits.
+ *
+ * The \ref CC_OCI_VM_ROOTFS_9P share can be tuned instead by
+ * selecting a \ref cc_oci_vm_rootfs_profile, which sets the options
+ * the guest mounts the share with.
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <utime.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "common.h"
+#include "oci.h"
+#include "util.h"
+#include "rootfs.h"
+#include "annotation.h"
+
+/** Prefix of the name of cached \ref CC_OCI_VM_ROOTFS_BLOCK images. */
+#define CC_OCI_VM_ROOTFS_CACHE_PREFIX "cc-oci-rootfs-cache-"
+
+/** Number of cached images no container uses that are kept. */
+#define CC_OCI_VM_ROOTFS_CACHE_UNUSED 4
+
+/** 9p mount options common to all profiles. */
+#define CC_OCI_VM_ROOTFS_9P_OPTIONS "trans=virtio,version=9p2000.L"
+
+/** Names and guest mount options of the
+ * \ref cc_oci_vm_rootfs_profile values.
+ */
+static struct cc_oci_rootfs_profile {
+	enum cc_oci_vm_rootfs_profile  profile;
+	const gchar                   *name;
+
+	/** Options the guest mounts the 9p share with
+	 * (\c NULL to leave them to the guest image).
+	 */
+	const gchar                   *mount_options;
+} rootfs_profiles[] = {
+	{ CC_OCI_VM_ROOTFS_PROFILE_DEFAULT, "default", NULL },
+
+	/* The guest caches everything, so changes made to the rootfs
+	 * from the host may not be seen by the workload.
+	 */
+	{ CC_OCI_VM_ROOTFS_PROFILE_READMOSTLY, "readmostly",
+		CC_OCI_VM_ROOTFS_9P_OPTIONS ",msize=262144,cache=loose" },
+
+	/* Stays coherent with the host (sources are often edited
+	 * there) whilst allowing shared writable mappings, as used by
+	 * linkers, and large reads and writes.
+	 */
+	{ CC_OCI_VM_ROOTFS_PROFILE_BUILD, "build",
+		CC_OCI_VM_ROOTFS_9P_OPTIONS ",msize=524288,cache=mmap" },
+
+	{ CC_OCI_VM_ROOTFS_PROFILE_INVALID, NULL, NULL }
+};
+
+/*!
+ * Determine the full path to the rootfs image for the container.
+ *
+ * \param config \ref cc_oci_config.
+ *
+ * \return Newly-allocated string on success, else \c NULL.
+ */
+private gchar *
+cc_oci_rootfs_image_path (const struct cc_oci_config *config)
+{
+	g_autofree gchar *name = NULL;
+
+	if (! (config && config->vm && config->optarg_container_id)) {
+		return NULL;
+	}
+
+	if (! config->vm->rootfs_path) {
+		return NULL;
+	}
+
+	name = g_strdup_printf ("cc-oci-rootfs-%s.img",
+			config->optarg_container_id);
+
+	return g_build_path ("/", config->vm->rootfs_path, name, NULL);
+}
+
+static gint
+cc_oci_rootfs_name_cmp (gconstpointer a, gconstpointer b)
+{
+	return g_strcmp0 (*(const gchar * const *)a,
+			*(const gchar * const *)b);
+}
+
+/*!
+ * Add the contents of a directory below the rootfs to a fingerprint.
+ *
+ * Entries are added in name order with their metadata, rather than
+ * their contents, so that the fingerprint is cheap to compute
+ * compared to building an image.
+ *
+ * \param sum GChecksum to update.
+ * \param root Rootfs directory.
+ * \param rel Path of the directory relative to \p root
+ *   (\c "" for \p root itself).
+ *
+ * \return \c true on success, else \c false.
+ */
+static gboolean
+cc_oci_rootfs_fingerprint_dir (GChecksum *sum, const gchar *root,
+		const gchar *rel)
+{
+	g_autofree gchar  *path = NULL;
+	GPtrArray         *names = NULL;
+	GDir              *dir = NULL;
+	GError            *error = NULL;
+	const gchar       *name;
+	gboolean           ret = false;
+	guint              i;
+
+	path = g_build_path ("/", root, rel, NULL);
+
+	dir = g_dir_open (path, 0, &error);
+	if (! dir) {
+		g_critical ("failed to open %s: %s", path, error->message);
+		g_error_free (error);
+		return false;
+	}
+
+	names = g_ptr_array_new_with_free_func (g_free);
+	while ((name = g_dir_read_name (dir))) {
+		g_ptr_array_add (names, g_strdup (name));
+	}
+
+	g_ptr_array_sort (names, cc_oci_rootfs_name_cmp);
+
+	for (i = 0; i < names->len; i++) {
+		g_autofree gchar  *child_rel = NULL;
+		g_autofree gchar  *child = NULL;
+		g_autofree gchar  *meta = NULL;
+		g_autofree gchar  *contents = NULL;
+		gsize              len = 0;
+		struct stat        st;
+
+		name = g_ptr_array_index (names, i);
+		child_rel = *rel ? g_build_path ("/", rel, name, NULL)
+			: g_strdup (name);
+		child = g_build_path ("/", root, child_rel, NULL);
+
+		if (lstat (child, &st) < 0) {
+			g_critical ("failed to stat %s: %s",
+					child, strerror (errno));
+			goto out;
+		}
+
+		g_checksum_update (sum, (const guchar *)child_rel,
+				(gssize)strlen (child_rel) + 1);
+
+		/* a directory changes with its entries, added below */
+		meta = g_strdup_printf ("%o:%u:%u:%" G_GUINT64_FORMAT
+				":%ld.%09ld:%" G_GUINT64_FORMAT,
+				(unsigned)st.st_mode,
+				(unsigned)st.st_uid, (unsigned)st.st_gid,
+				(guint64)st.st_size,
+				S_ISDIR (st.st_mode) ? 0L
+				: (long)st.st_mtim.tv_sec,
+				S_ISDIR (st.st_mode) ? 0L
+				: (long)st.st_mtim.tv_nsec,
+				(guint64)st.st_rdev);
+
+		/* The workload files are rewritten by every "create",
+		 * so use their contents: containers running the same
+		 * command can then share an image.
+		 */
+		if (S_ISREG (st.st_mode) && ! *rel &&
+				(! g_strcmp0 (name, CC_OCI_WORKLOAD_FILE + 1) ||
+				 ! g_strcmp0 (name, CC_OCI_ENV_FILE + 1))) {
+			if (! g_file_get_contents (child, &contents,
+						&len, NULL)) {
+				goto out;
+			}
+
+			g_free (meta);
+			meta = g_strdup_printf ("%o:%u:%u",
+					(unsigned)st.st_mode,
+					(unsigned)st.st_uid,
+					(unsigned)st.st_gid);
+		} else if (S_ISLNK (st.st_mode)) {
+			contents = g_file_read_link (child, NULL);
+			len = contents ? strlen (contents) : 0;
+		}
+
+		g_checksum_update (sum, (const guchar *)meta,
+				(gssize)strlen (meta) + 1);
+		if (len) {
+			g_checksum_update (sum, (const guchar *)contents,
+					(gssize)len);
+		}
+
+		if (S_ISDIR (st.st_mode) &&
+				! cc_oci_rootfs_fingerprint_dir (sum, root,
+					child_rel)) {
+			goto out;
+		}
+	}
+
+	ret = true;
+
+out:
+	g_ptr_array_free (names, true);
+	g_dir_close (dir);
+
+	return ret;
+}
+
+/*!
+ * Compute the fingerprint of the rootfs image for the container:
+ * containers with the same fingerprint can share an image.
+ *
+ * \param config \ref cc_oci_config.
+ *
+ * \return Newly-allocated string on success, else \c NULL.
+ */
+private gchar *
+cc_oci_rootfs_fingerprint (const struct cc_oci_config *config)
+{
+	GChecksum  *sum;
+	gchar      *fingerprint = NULL;
+	gchar      *params;
+
+	if (! (config && config->vm && config->oci.root.path)) {
+		return NULL;
+	}
+
+	sum = g_checksum_new (G_CHECKSUM_SHA256);
+
+	params = g_strdup_printf ("%" G_GUINT64_FORMAT,
+			(guint64)(config->vm->rootfs_size
+			? config->vm->rootfs_size : CC_OCI_VM_ROOTFS_SIZE));
+	g_checksum_update (sum, (const guchar *)params,
+			(gssize)strlen (params) + 1);
+	g_free (params);
+
+	if (cc_oci_rootfs_fingerprint_dir (sum, config->oci.root.path, "")) {
+		fingerprint = g_strdup (g_checksum_get_string (sum));
+	}
+
+	g_checksum_free (sum);
+
+	return fingerprint;
+}
+
+/*!
+ * Build a rootfs image.
+ *
+ * \param rootfs Directory to populate the image from.
+ * \param path Image to create.
+ * \param size Size of the image in bytes.
+ *
+ * \return \c true on success, else \c false.
+ */
+static gboolean
+cc_oci_rootfs_image_build (const gchar *rootfs, const gchar *path,
+		guint64 size)
+{
+	g_autofree gchar *tmp = NULL;
+	gchar            *std_err = NULL;
+	GError           *error = NULL;
+	gint              exit_status = 0;
+	gboolean          ret = false;
+	int               fd;
+
+	/* Build under a temporary name, so that concurrent creates
+	 * never use a partial image.
+	 */
+	tmp = g_strdup_printf ("%s.XXXXXX", path);
+
+	/* Create the image sparse: mkfs only writes the metadata
+	 * and the files copied from the rootfs.
+	 */
+	fd = g_mkstemp_full (tmp, O_WRONLY | O_CLOEXEC, 0600);
+	if (fd < 0) {
+		g_critical ("failed to create rootfs image %s: %s",
+				path, strerror (errno));
+		return false;
+	}
+
+	if (ftruncate (fd, (off_t)size) < 0) {
+		g_critical ("failed to size rootfs image %s: %s",
+				path, strerror (errno));
+		close (fd);
+		goto out;
+	}
+
+	close (fd);
+
+	gchar *args[] = {
+		CC_OCI_VM_ROOTFS_MKFS,
+		"-q",
+		"-F",
+		"-L", "rootfs",
+		/* leave initialisation of the unused inode tables and
+		 * journal to the guest.
+		 */
+		"-E", "lazy_itable_init=1,lazy_journal_init=1,nodiscard",
+		"-d", (gchar *)rootfs,
+		tmp,
+		NULL
+	};
+
+	g_debug ("building rootfs image %s from %s", path, rootfs);
+
+	if (! g_spawn_sync (NULL, args, NULL,
+				G_SPAWN_SEARCH_PATH |
+				G_SPAWN_STDOUT_TO_DEV_NULL,
+				NULL, NULL, NULL, &std_err,
+				&exit_status, &error)) {
+		g_critical ("failed to run %s: %s",
+				CC_OCI_VM_ROOTFS_MKFS,
+				error->message);
+		g_error_free (error);
+		goto out;
+	}
+
+	if (! g_spawn_check_exit_status (exit_status, NULL)) {
+		g_critical ("failed to build rootfs image %s: %s",
+				path, std_err ? g_strstrip (std_err) : "");
+		goto out;
+	}
+
+	if (g_rename (tmp, path) < 0) {
+		g_critical ("failed to rename rootfs image %s: %s",
+				tmp, strerror (errno));
+		goto out;
+	}
+
+	ret = true;
+
+out:
+	g_free_if_set (std_err);
+
+	if (! ret) {
+		(void)g_remove (tmp);
+	}
+
+	return ret;
+}
+
+/** Cached image found by \ref cc_oci_rootfs_cache_prune. */
+struct cc_oci_rootfs_cached {
+	gchar   *path;
+	time_t   mtime;
+};
+
+static gint
+cc_oci_rootfs_cached_cmp (gconstpointer a, gconstpointer b)
+{
+	const struct cc_oci_rootfs_cached *ca =
+		*(struct cc_oci_rootfs_cached * const *)a;
+	const struct cc_oci_rootfs_cached *cb =
+		*(struct cc_oci_rootfs_cached * const *)b;
+
+	/* most recently used first */
+	return (ca->mtime < cb->mtime) - (ca->mtime > cb->mtime);
+}
+
+static void
+cc_oci_rootfs_cached_free (struct cc_oci_rootfs_cached *cached)
+{
+	g_free (cached->path);
+	g_free (cached);
+}
+
+/*!
+ * Remove the least recently used cached images that no container
+ * uses, keeping \ref CC_OCI_VM_ROOTFS_CACHE_UNUSED of them.
+ *
+ * Containers use a cached image through a hard link, so an image
+ * no container uses has a single link.
+ *
+ * \param dir Image directory.
+ */
+private void
+cc_oci_rootfs_cache_prune (const gchar *dir)
+{
+	GPtrArray    *unused;
+	GDir         *d;
+	const gchar  *name;
+	struct stat   st;
+	guint         i;
+
+	d = g_dir_open (dir, 0, NULL);
+	if (! d) {
+		return;
+	}
+
+	unused = g_ptr_array_new_with_free_func
+		((GDestroyNotify)cc_oci_rootfs_cached_free);
+
+	while ((name = g_dir_read_name (d))) {
+		struct cc_oci_rootfs_cached  *cached;
+		gchar                        *path;
+
+		if (! (g_str_has_prefix (name, CC_OCI_VM_ROOTFS_CACHE_PREFIX)
+					&& g_str_has_suffix (name, ".img"))) {
+			continue;
+		}
+
+		path = g_build_path ("/", dir, name, NULL);
+		if (lstat (path, &st) < 0 || ! S_ISREG (st.st_mode) ||
+				st.st_nlink != 1) {
+			g_free (path);
+			continue;
+		}
+
+		cached = g_new0 (struct cc_oci_rootfs_cached, 1);
+		cached->path = path;
+		cached->mtime = st.st_mtime;
+		g_ptr_array_add (unused, cached);
+	}
+
+	g_dir_close (d);
+
+	g_ptr_array_sort (unused, cc_oci_rootfs_cached_cmp);
+
+	for (i = CC_OCI_VM_ROOTFS_CACHE_UNUSED; i < unused->len; i++) {
+		struct cc_oci_rootfs_cached *cached =
+			g_ptr_array_index (unused, i);
+
+		g_debug ("removing unused rootfs image %s", cached->path);
+		(void)g_remove (cached->path);
+	}
+
+	g_ptr_array_free (unused, true);
+}
+
+/*!
+ * Build the rootfs image for the container, if the VM uses the
+ * \ref CC_OCI_VM_ROOTFS_BLOCK backend.
+ *
+ * Must be called before the bundle mounts are applied, so that the
+ * volumes are not copied into the image.
+ *
+ * \param config \ref cc_oci_config.
+ *
+ * \note On success, \ref cc_oci_vm_cfg::rootfs_image is set.
+ *
+ * \return \c true on success, else \c false.
+ */
+gboolean
+cc_oci_rootfs_image_create (struct cc_oci_config *config)
+{
+	g_autofree gchar *path = NULL;
+	g_autofree gchar *fingerprint = NULL;
+	g_autofree gchar *name = NULL;
+	g_autofree gchar *cached = NULL;
+	guint64           size;
+	gint              tries;
+
+	if (! (config && config->vm)) {
+		return false;
+	}
+
+	if (config->vm->rootfs_backend != CC_OCI_VM_ROOTFS_BLOCK) {
+		return true;
+	}
+
+	path = cc_oci_rootfs_image_path (config);
+	if (! path) {
+		return false;
+	}
+
+	fingerprint = cc_oci_rootfs_fingerprint (config);
+	if (! fingerprint) {
+		return false;
+	}
+
+	name = g_strdup_printf (CC_OCI_VM_ROOTFS_CACHE_PREFIX "%s.img",
+			fingerprint);
+	cached = g_build_path ("/", config->vm->rootfs_path, name, NULL);
+
+	size = config->vm->rootfs_size
+		? config->vm->rootfs_size : CC_OCI_VM_ROOTFS_SIZE;
+
+	(void)g_remove (path);
+
+	/* the cached image may be pruned before it is linked to */
+	for (tries = 0; tries < 2; tries++) {
+		if (g_file_test (cached, G_FILE_TEST_IS_REGULAR)) {
+			g_debug ("using cached rootfs image %s", cached);
+		} else if (! cc_oci_rootfs_image_build (config->oci.root.path,
+					cached, size)) {
+			return false;
+		}
+
+		if (link (cached, path) == 0) {
+			break;
+		}
+
+		if (errno != ENOENT) {
+			g_critical ("failed to link rootfs image %s to %s: %s",
+					cached, path, strerror (errno));
+			return false;
+		}
+	}
+
+	if (tries == 2) {
+		g_critical ("failed to create rootfs image %s", path);
+		return false;
+	}
+
+	/* mark as recently used */
+	(void)utime (cached, NULL);
+
+	g_free (config->vm->rootfs_image);
+	config->vm->rootfs_image = g_strdup (path);
+
+	cc_oci_rootfs_cache_prune (config->vm->rootfs_path);
+
+	return true;
+}
+
+/*!
+ * Remove the rootfs image for the container (if any).
+ *
+ * The cached image it was created from is kept for other
+ * containers.
+ *
+ * \param config \ref cc_oci_config.
+ *
+ * \return \c true on success, else \c false.
+ */
+gboolean
+cc_oci_rootfs_image_delete (struct cc_oci_config *config)
+{
+	g_autofree gchar *dir = NULL;
+
+	if (! (config && config->vm)) {
+		return false;
+	}
+
+	if (! config->vm->rootfs_image) {
+		return true;
+	}
+
+	if (g_remove (config->vm->rootfs_image) < 0 && errno != ENOENT) {
+		g_critical ("failed to remove rootfs image %s: %s",
+				config->vm->rootfs_image,
+				strerror (errno));
+		return false;
+	}
+
+	dir = g_path_get_dirname (config->vm->rootfs_image);
+	cc_oci_rootfs_cache_prune (dir);
+
+	g_free_if_set (config->vm->rootfs_image);
+
+	return true;
+}
+
+/*!
+ * Determine the volumes of the container, which the guest bind mounts
+ * from the 9p share over a \ref CC_OCI_VM_ROOTFS_BLOCK image.
+ *
+ * \param config \ref cc_oci_config.
+ *
+ * \return Newly-allocated value of \ref CC_OCI_VM_ROOTFS_VOLUMES_PARAM
+ * (\c "" if there are no volumes).
+ */
+gchar *
+cc_oci_rootfs_volumes (const struct cc_oci_config *config)
+{
+	GString  *volumes;
+	GSList   *l;
+
+	volumes = g_string_new ("");
+
+	for (l = config->oci.mounts; l; l = g_slist_next (l)) {
+		const struct cc_oci_mount *m = l->data;
+
+		/* only mounts applied below the rootfs have a dest */
+		if (! (m && m->dest)) {
+			continue;
+		}
+
+		if (strpbrk (m->mnt.mnt_dir, ": \t\n\"")) {
+			g_warning ("volume %s cannot be passed to the guest",
+					m->mnt.mnt_dir);
+			continue;
+		}
+
+		g_string_append_printf (volumes, "%s%s",
+				volumes->len ? ":" : "", m->mnt.mnt_dir);
+	}
+
+	return g_string_free (volumes, false);
+}
+
+/*!
+ * Convert a profile name to a \ref cc_oci_vm_rootfs_profile.
+ *
+ * \param str Name of profile.
+ *
+ * \return \ref cc_oci_vm_rootfs_profile
+ * (\ref CC_OCI_VM_ROOTFS_PROFILE_INVALID if unknown).
+ */
+enum cc_oci_vm_rootfs_profile
+cc_oci_str_to_rootfs_profile (const gchar *str)
+{
+	struct cc_oci_rootfs_profile  *p;
+
+	for (p = rootfs_profiles; str && p->name; p++) {
+		if (! g_strcmp0 (str, p->name)) {
+			return p->profile;
+		}
+	}
+
+	return CC_OCI_VM_ROOTFS_PROFILE_INVALID;
+}
+
+/*!
+ * Determine the rootfs profile of the container.
+ *
+ * \param config \ref cc_oci_config.
+ * \param[out] profile \ref cc_oci_vm_rootfs_profile.
+ *
+ * \return \c true on success, else \c false.
+ */
+gboolean
+cc_oci_rootfs_profile_get (const struct cc_oci_config *config,
+		enum cc_oci_vm_rootfs_profile *profile)
+{
+	const gchar *name;
+
+	if (! (config && config->vm && profile)) {
+		return false;
+	}
+
+	name = cc_oci_annotation_get (config->oci.annotations,
+			CC_OCI_ANNOTATION_ROOTFS_PROFILE);
+	if (! name) {
+		*profile = config->vm->rootfs_profile;
+		return true;
+	}
+
+	*profile = cc_oci_str_to_rootfs_profile (name);
+	if (*profile == CC_OCI_VM_ROOTFS_PROFILE_INVALID) {
+		g_critical ("invalid %s annotation: %s",
+				CC_OCI_ANNOTATION_ROOTFS_PROFILE, name);
+		return false;
+	}
+
+	return true;
+}
+
+/*!
+ * Determine the 9p mount options of a profile.
+ *
+ * \param profile \ref cc_oci_vm_rootfs_profile.
+ *
+ * \return Mount options, or \c NULL to use those of the guest image.
+ */
+const gchar *
+cc_oci_rootfs_profile_mount_options (enum cc_oci_vm_rootfs_profile profile)
+{
+	struct cc_oci_rootfs_profile  *p;
+
+	for (p = rootfs_profiles; p->name; p++) {
+		if (p->profile == profile) {
+			return p->mount_options;
+		}
+	}
+
+	return NULL;
+}
@@ -0,0 +1,77 @@
+/*
+ * This file is part of cc-oci-runtime.
+ *
+ * Copyright (C) 2016 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef _CC_OCI_ROOTFS_H
+#define _CC_OCI_ROOTFS_H
+
+#include <glib.h>
+
+#include "oci.h"
+
+/** Size of a \ref CC_OCI_VM_ROOTFS_BLOCK image unless specified in
+ * vm.json. The image is sparse so only the space used by the rootfs
+ * is allocated up-front.
+ */
+#define CC_OCI_VM_ROOTFS_SIZE (10ULL * 1024 * 1024 * 1024)
+
+/** Program used to build \ref CC_OCI_VM_ROOTFS_BLOCK images
+ * (requires support for the "-d" option).
+ */
+#define CC_OCI_VM_ROOTFS_MKFS "mkfs.ext4"
+
+/** Annotation selecting the \ref cc_oci_vm_rootfs_profile of a
+ * container by name (overriding the vm.json profile).
+ */
+#define CC_OCI_ANNOTATION_ROOTFS_PROFILE "io.clearcontainers.9p.profile"
+
+/** Kernel parameter passing the rootfs mount options to the guest:
+ * those of the \ref cc_oci_vm_rootfs_profile of a 9p share, or "ro"
+ * for a read-only \ref CC_OCI_VM_ROOTFS_BLOCK image. Applied by
+ * the cc-rootfs-generator of the guest image.
+ */
+#define CC_OCI_VM_ROOTFS_OPTIONS_PARAM "cc.rootfs_options"
+
+/** Kernel parameter passing the device of a
+ * \ref CC_OCI_VM_ROOTFS_BLOCK image to the guest, which mounts it
+ * rather than the 9p share.
+ */
+#define CC_OCI_VM_ROOTFS_DEVICE_PARAM "cc.rootfs_device"
+
+/** Guest device of a \ref CC_OCI_VM_ROOTFS_BLOCK image
+ * (named after the serial of the virtio-blk disk).
+ */
+#define CC_OCI_VM_ROOTFS_DEVICE "/dev/disk/by-id/virtio-rootfs"
+
+/** Kernel parameter passing the volumes of the container, separated
+ * by ':', to the guest. With a \ref CC_OCI_VM_ROOTFS_BLOCK image,
+ * the guest bind mounts them from the 9p share.
+ */
+#define CC_OCI_VM_ROOTFS_VOLUMES_PARAM "cc.rootfs_volumes"
+
+gboolean cc_oci_rootfs_image_create (struct cc_oci_config *config);
+gboolean cc_oci_rootfs_image_delete (struct cc_oci_config *config);
+gchar *cc_oci_rootfs_volumes (const struct cc_oci_config *config);
+enum cc_oci_vm_rootfs_profile cc_oci_str_to_rootfs_profile (const gchar *str);
+gboolean cc_oci_rootfs_profile_get (const struct cc_oci_config *config,
+		enum cc_oci_vm_rootfs_profile *profile);
+const gchar *cc_oci_rootfs_profile_mount_options
+		(enum cc_oci_vm_rootfs_profile profile);
+
+#endif /* _CC_OCI_ROOTFS_H */
@@ -47,9 +47,8 @@ cc_oci_runtime_path_get (struct cc_oci_config *config)
 		return false;
 	}
 
-	g_snprintf (config->state.runtime_path,
-			(gulong)sizeof (config->state.runtime_path),
-			"%s/%s",
+	g_free (config->state.runtime_path);
+	config->state.runtime_path = g_strdup_printf ("%s/%s",
 			config->root_dir ? config->root_dir
 			: CC_OCI_RUNTIME_DIR_PREFIX,
 			config->optarg_container_id);
@@ -77,21 +76,19 @@ cc_oci_runtime_dir_setup (struct cc_oci_config *config)
 	 * performing the check here, the tests can subvert
 	 * the path.
 	 */
-	if (! config->state.runtime_path[0]) {
+	if (! config->state.runtime_path) {
 		if (! cc_oci_runtime_path_get (config)) {
 			return false;
 		}
 	}
 
-	g_snprintf (config->state.comms_path,
-			(gulong)sizeof (config->state.comms_path),
-			"%s/%s",
+	g_free (config->state.comms_path);
+	config->state.comms_path = g_strdup_printf ("%s/%s",
 			config->state.runtime_path,
 			CC_OCI_HYPERVISOR_SOCKET);
 
-	g_snprintf (config->state.procsock_path,
-			(gulong)sizeof (config->state.procsock_path),
-			"%s/%s",
+	g_free (config->state.procsock_path);
+	config->state.procsock_path = g_strdup_printf ("%s/%s",
 			config->state.runtime_path,
 			CC_OCI_PROCESS_SOCKET);
 
@@ -122,7 +119,8 @@ cc_oci_runtime_dir_delete (struct cc_oci_config *config)
 	if (! config) {
 		return false;
 	}
-	if (config->state.runtime_path[0] != '/') {
+	if (! (config->state.runtime_path
+				&& config->state.runtime_path[0] == '/')) {
 		return false;
 	}
 
@@ -26,6 +26,7 @@
 #include <glib.h>
 
 #include "oci.h"
+#include "src/spec-keys.h"
 
 /** A spec-handler is a handler for each section
  * of config.json (spec file), spec-handler is used
@@ -49,5 +50,7 @@ extern struct spec_handler vm_spec_handler;
 extern struct spec_handler linux_spec_handler;
 
 gboolean get_spec_vm_from_cfg_file (struct cc_oci_config* config);
+gboolean cc_oci_resources_parse (GNode *root,
+		struct oci_cfg_resources *resources);
 
 #endif /* _CC_OCI_SPEC_HANDLER_H */
@@ -22,6 +22,7 @@
 
 #include "spec_handler.h"
 #include "util.h"
+#include "src/spec_handlers/hooks-keys.h"
 #include "../src/oci-config.h"
 
 static struct oci_cfg_hook* current_hook = NULL;
@@ -40,7 +41,7 @@ save_current_hook(GSList** hooks_list) {
 	* - env
 	* - timeout
 	*/
-	if (! current_hook->path[0]) {
+	if (! (current_hook->path && current_hook->path[0])) {
 		g_critical("missing hook path");
 		goto err;
 	}
@@ -72,20 +73,27 @@ handle_hook(GNode* root, GSList** list) {
 			current_hook = g_new0 (struct oci_cfg_hook, 1);
 		}
 
-		if (g_strcmp0(root->data, "path") == 0) {
-			g_snprintf(current_hook->path, sizeof(current_hook->path),
-			           "%s", (char*)root->children->data);
-		} else if (g_strcmp0(root->data, "args") == 0) {
+		switch (cc_oci_key_lookup (&hook_keys, root->data)) {
+		case HOOK_PATH:
+			g_free_if_set(current_hook->path);
+			current_hook->path = g_strdup(root->children->data);
+			break;
+		case HOOK_ARGS:
 			current_hook->args = node_to_strv(root);
-		} else if (g_strcmp0(root->data, "env") == 0) {
+			break;
+		case HOOK_ENV:
 			current_hook->env = node_to_strv(root);
-		} else if (g_strcmp0(root->data, "timeout") == 0) {
+			break;
+		case HOOK_TIMEOUT:
 			current_hook->timeout =
 			    (gint)g_ascii_strtoll((char*)root->children->data, &endptr, 10);
 			if (endptr == root->children->data) {
 				g_critical("failed to convert '%s' to int",
 				    (char*)root->children->data);
 			}
+			break;
+		default:
+			break;
 		}
 	}
 }
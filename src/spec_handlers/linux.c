@@ -24,6 +24,7 @@
 
 static struct oci_cfg_namespace *current_ns;
 static bool error_detected = false;
+static bool resources_error_detected = false;
 
 /*!
  * Add \ref current_ns to the specified \c GSList.
@@ -91,6 +92,157 @@ err:
 	current_ns = NULL;
 }
 
+/*!
+ * Convert a numeric resource value.
+ *
+ * \param name Name of value (for error reporting).
+ * \param str String representation of value.
+ * \param[out] value Converted value.
+ *
+ * \return \c true on success, else \c false.
+ */
+static bool
+resources_get_int (const gchar *name, const gchar *str, gint64 *value)
+{
+	gchar *end = NULL;
+
+	if (! (str && *str)) {
+		g_critical ("no value specified for resource %s", name);
+		return false;
+	}
+
+	*value = g_ascii_strtoll (str, &end, 10);
+	if (*end) {
+		g_critical ("invalid value for resource %s: %s", name, str);
+		return false;
+	}
+
+	return true;
+}
+
+static void
+handle_resources_memory_section (GNode *root,
+		struct oci_cfg_resources *resources)
+{
+	gint64 value;
+
+	if (! (root && root->children) || resources_error_detected) {
+		return;
+	}
+
+	if (! g_strcmp0 (root->data, "limit")) {
+		if (! resources_get_int (root->data,
+					root->children->data, &value)) {
+			goto err;
+		}
+
+		/* A negative limit denotes "unlimited" */
+		resources->memory_limit = value > 0 ? value : 0;
+	}
+
+	return;
+
+err:
+	resources_error_detected = true;
+}
+
+static void
+handle_resources_cpu_section (GNode *root,
+		struct oci_cfg_resources *resources)
+{
+	gint64 value;
+
+	if (! (root && root->children) || resources_error_detected) {
+		return;
+	}
+
+	if (! g_strcmp0 (root->data, "quota")) {
+		if (! resources_get_int (root->data,
+					root->children->data, &value)) {
+			goto err;
+		}
+
+		resources->cpu_quota = value > 0 ? value : 0;
+	} else if (! g_strcmp0 (root->data, "period")) {
+		if (! resources_get_int (root->data,
+					root->children->data, &value)) {
+			goto err;
+		}
+
+		if (value < 0) {
+			g_critical ("invalid cpu period: %s",
+					(gchar *)root->children->data);
+			goto err;
+		}
+
+		resources->cpu_period = (guint64)value;
+	} else if (! g_strcmp0 (root->data, "cpus")) {
+		const gchar *cpus = root->children->data;
+
+		g_free_if_set (resources->cpu_cpus);
+
+		if (cpus && *cpus) {
+			if (! cc_oci_cpuset_count (cpus)) {
+				g_critical ("invalid cpuset: %s", cpus);
+				goto err;
+			}
+
+			resources->cpu_cpus = g_strdup (cpus);
+		}
+	}
+
+	return;
+
+err:
+	resources_error_detected = true;
+}
+
+static void
+handle_resources_section (GNode *root, struct oci_cfg_resources *resources)
+{
+	if (! (root && root->children) || resources_error_detected) {
+		return;
+	}
+
+	if (! g_strcmp0 (root->data, "memory")) {
+		g_node_children_foreach(root, G_TRAVERSE_ALL,
+			(GNodeForeachFunc)handle_resources_memory_section,
+			resources);
+	} else if (! g_strcmp0 (root->data, "cpu")) {
+		g_node_children_foreach(root, G_TRAVERSE_ALL,
+			(GNodeForeachFunc)handle_resources_cpu_section,
+			resources);
+	}
+}
+
+/*!
+ * Parse an OCI "resources" object.
+ *
+ * Only the resources that can be applied to a VM (memory limit and
+ * cpu quota, period and cpuset) are considered, all others are
+ * ignored.
+ *
+ * \param root \c GNode whose children represent the "resources"
+ *   object members.
+ * \param[out] resources \ref oci_cfg_resources.
+ *
+ * \return \c true on success, else \c false.
+ */
+gboolean
+cc_oci_resources_parse (GNode *root, struct oci_cfg_resources *resources)
+{
+	if (! (root && resources)) {
+		return false;
+	}
+
+	resources_error_detected = false;
+
+	g_node_children_foreach (root, G_TRAVERSE_ALL,
+		(GNodeForeachFunc)handle_resources_section, resources);
+
+	return ! resources_error_detected;
+}
+
 static void
 handle_linux_section (GNode *root, struct cc_oci_config *config)
 {
@@ -102,6 +254,11 @@ handle_linux_section (GNode *root, struct cc_oci_config *config)
 		g_node_children_foreach(root, G_TRAVERSE_ALL,
 			(GNodeForeachFunc)handle_namespaces_section,
 			config);
+	} else if (! g_strcmp0 (root->data, "resources")) {
+		if (! cc_oci_resources_parse (root,
+					&config->oci.oci_linux.resources)) {
+			error_detected = true;
+		}
 	}
 }
 
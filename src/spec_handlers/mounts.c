@@ -20,6 +20,7 @@
 
 #include "spec_handler.h"
 #include "mount.h"
+#include "src/spec_handlers/mounts-keys.h"
 
 static struct cc_oci_mount* current_mount = NULL;
 static bool error_detected = false;
@@ -55,7 +56,6 @@ static struct cc_oci_mnt_flag_map {
 	{NULL          , 0}
 };
 
-
 /*!
  * \param flag String flag name.
  *
@@ -160,13 +160,17 @@ handle_mounts_section(GNode* root, struct cc_oci_config* config) {
 			current_mount = g_new0 (struct cc_oci_mount, 1);
 		}
 
-		if (g_strcmp0(root->data, "destination") == 0) {
+		switch (cc_oci_key_lookup (&mount_keys, root->data)) {
+		case MOUNT_DESTINATION:
 			current_mount->mnt.mnt_dir = g_strdup((gchar*)root->children->data);
-		} else if (g_strcmp0(root->data, "type") == 0) {
+			break;
+		case MOUNT_TYPE:
 			current_mount->mnt.mnt_type = g_strdup((gchar*)root->children->data);
-		} else if (g_strcmp0(root->data, "source") == 0) {
+			break;
+		case MOUNT_SOURCE:
 			current_mount->mnt.mnt_fsname = g_strdup((gchar*)root->children->data);
-		} else if (g_strcmp0(root->data, "options") == 0) {
+			break;
+		case MOUNT_OPTIONS:
 			mount_flags = g_string_new("");
 
 			/* fill mount_flags or current_mount->flags */
@@ -180,6 +184,9 @@ handle_mounts_section(GNode* root, struct cc_oci_config* config) {
 			}
 
 			g_string_free(mount_flags, true);
+			break;
+		default:
+			break;
 		}
 	}
 }
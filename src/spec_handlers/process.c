@@ -45,11 +45,8 @@ handle_process_section(GNode* root, struct cc_oci_config* config) {
 		return;
 	}
 	if (g_strcmp0(root->data, "cwd") == 0) {
-		if (snprintf(config->oci.process.cwd,
-		    sizeof(config->oci.process.cwd),
-		    "%s", (char*)root->children->data) < 0) {
-			g_critical("failed to copy process cwd");
-		}
+		g_free(config->oci.process.cwd);
+		config->oci.process.cwd = g_strdup(root->children->data);
 	} else if(g_strcmp0(root->data, "args") == 0) {
 		config->oci.process.args = node_to_strv(root);
 	} else if(g_strcmp0(root->data, "env") == 0) {
@@ -80,7 +77,7 @@ process_handle_section(GNode* root, struct cc_oci_config* config)
 	g_node_children_foreach(root, G_TRAVERSE_ALL,
 		(GNodeForeachFunc)handle_process_section, config);
 
-	if (! config->oci.process.cwd[0]) {
+	if (! (config->oci.process.cwd && *config->oci.process.cwd)) {
 		g_critical ("no cwd");
 		return false;
 	}
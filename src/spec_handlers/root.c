@@ -30,11 +30,10 @@ handle_root_section(GNode* root, struct cc_oci_config* config) {
 		return;
 	}
 	if (g_strcmp0(root->data, "path") == 0) {
-		g_autofree gchar *full = cc_oci_resolve_path ((char*)root->children->data);
+		gchar *full = cc_oci_resolve_path ((char*)root->children->data);
 		if (full) {
-			g_snprintf (config->oci.root.path,
-					sizeof(config->oci.root.path),
-					"%s", full);
+			g_free (config->oci.root.path);
+			config->oci.root.path = full;
 		}
 	} else if (g_strcmp0(root->data, "readonly") == 0) {
 		if (g_strcmp0(root->children->data, "true") == 0) {
@@ -69,7 +68,7 @@ root_handle_section(GNode* root, struct cc_oci_config* config) {
 	* Optional:
 	* - readonly
 	*/
-	if (! config->oci.root.path[0]) {
+	if (! config->oci.root.path) {
 		g_critical("missing root path");
 		goto out;
 	}
@@ -20,10 +20,248 @@
 
 #include <stdio.h>
 #include <sys/stat.h>
+#include <sys/vfs.h>
+#include <linux/magic.h>
 
 #include "spec_handler.h"
 #include "oci.h"
 #include "util.h"
+#include "rootfs.h"
+#include "hypervisor.h"
+#include "src/spec_handlers/vm-keys.h"
+
+/** Default hugetlbfs mount used for \ref CC_OCI_VM_MEMORY_HUGEPAGES. */
+#define CC_OCI_VM_HUGEPAGES_PATH "/dev/hugepages"
+
+/** Default tmpfs mount used for \ref CC_OCI_VM_MEMORY_SHARED. */
+#define CC_OCI_VM_SHARED_MEMORY_PATH "/dev/shm"
+
+/** Default directory for \ref CC_OCI_VM_ROOTFS_BLOCK images
+ * (must not be a tmpfs mount to avoid the rootfs being held in RAM).
+ */
+#define CC_OCI_VM_ROOTFS_PATH "/var/tmp"
+
+static bool memory_error_detected = false;
+static bool rootfs_error_detected = false;
+static bool boot_error_detected = false;
+
+/** Map of \ref cc_oci_vm_memory_backend values to vm.json names. */
+static struct cc_oci_map memory_backend_map[] =
+{
+	{ CC_OCI_VM_MEMORY_ANONYMOUS , "anonymous" },
+	{ CC_OCI_VM_MEMORY_HUGEPAGES , "hugepages" },
+	{ CC_OCI_VM_MEMORY_SHARED    , "shared"    },
+
+	{ CC_OCI_VM_MEMORY_INVALID   , NULL        }
+};
+
+static enum cc_oci_vm_memory_backend
+cc_oci_str_to_memory_backend (const gchar *str)
+{
+	struct cc_oci_map  *p;
+
+	for (p = memory_backend_map; str && p->name; p++) {
+		if (! g_strcmp0 (str, p->name)) {
+			return p->num;
+		}
+	}
+
+	return CC_OCI_VM_MEMORY_INVALID;
+}
+
+static void
+handle_memory_section(GNode* root, struct cc_oci_config* config) {
+	if (! (root && root->children)) {
+		return;
+	}
+	if (g_strcmp0(root->data, "backend") == 0) {
+		config->vm->memory_backend =
+			cc_oci_str_to_memory_backend (root->children->data);
+		if (config->vm->memory_backend == CC_OCI_VM_MEMORY_INVALID) {
+			g_critical("invalid VM memory backend: %s",
+				(gchar *)root->children->data);
+			memory_error_detected = true;
+		}
+	} else if (g_strcmp0(root->data, "path") == 0) {
+		gchar* path = cc_oci_resolve_path(root->children->data);
+		if (! path) {
+			g_critical("VM memory path does not exist: %s",
+				(gchar *)root->children->data);
+			memory_error_detected = true;
+		} else {
+			g_free(config->vm->memory_path);
+			config->vm->memory_path = path;
+		}
+	} else if (g_strcmp0(root->data, "hugepage_size") == 0) {
+		if (! cc_oci_str_to_bytes (root->children->data, 1,
+			    &config->vm->hugepage_size)) {
+			g_critical("invalid VM hugepage size: %s",
+				(gchar *)root->children->data);
+			memory_error_detected = true;
+		}
+	}
+}
+
+/*!
+ * Check the guest RAM backend is usable.
+ *
+ * \param vm \ref cc_oci_vm_cfg.
+ *
+ * \return \c true on success, else \c false.
+ */
+static bool
+vm_check_memory_backend(struct cc_oci_vm_cfg* vm) {
+	struct statfs sfs;
+
+	if (vm->memory_backend == CC_OCI_VM_MEMORY_ANONYMOUS) {
+		return true;
+	}
+
+	if (! vm->memory_path) {
+		vm->memory_path = g_strdup(
+			vm->memory_backend == CC_OCI_VM_MEMORY_HUGEPAGES
+			? CC_OCI_VM_HUGEPAGES_PATH
+			: CC_OCI_VM_SHARED_MEMORY_PATH);
+	}
+
+	if (statfs(vm->memory_path, &sfs) < 0) {
+		g_critical("VM memory path %s is not usable",
+			vm->memory_path);
+		return false;
+	}
+
+	if (vm->memory_backend == CC_OCI_VM_MEMORY_SHARED) {
+		return true;
+	}
+
+	if (sfs.f_type != HUGETLBFS_MAGIC) {
+		g_critical("VM memory path %s is not a hugetlbfs mount",
+			vm->memory_path);
+		return false;
+	}
+
+	/* The page size of a hugetlbfs mount is reported as its
+	 * block size.
+	 */
+	if (vm->hugepage_size
+	    && (guint64)sfs.f_bsize != vm->hugepage_size) {
+		g_critical("hugetlbfs mount %s has a page size of %lu bytes "
+			"(expected %" G_GUINT64_FORMAT ")",
+			vm->memory_path,
+			(unsigned long int)sfs.f_bsize,
+			vm->hugepage_size);
+		return false;
+	}
+
+	return true;
+}
+
+/** Map of \ref cc_oci_vm_rootfs_backend values to vm.json names. */
+static struct cc_oci_map rootfs_backend_map[] =
+{
+	{ CC_OCI_VM_ROOTFS_9P      , "9p"    },
+	{ CC_OCI_VM_ROOTFS_BLOCK   , "block" },
+
+	{ CC_OCI_VM_ROOTFS_INVALID , NULL    }
+};
+
+static enum cc_oci_vm_rootfs_backend
+cc_oci_str_to_rootfs_backend (const gchar *str)
+{
+	struct cc_oci_map  *p;
+
+	for (p = rootfs_backend_map; str && p->name; p++) {
+		if (! g_strcmp0 (str, p->name)) {
+			return p->num;
+		}
+	}
+
+	return CC_OCI_VM_ROOTFS_INVALID;
+}
+
+static void
+handle_rootfs_section(GNode* root, struct cc_oci_config* config) {
+	if (! (root && root->children)) {
+		return;
+	}
+	if (g_strcmp0(root->data, "backend") == 0) {
+		config->vm->rootfs_backend =
+			cc_oci_str_to_rootfs_backend (root->children->data);
+		if (config->vm->rootfs_backend == CC_OCI_VM_ROOTFS_INVALID) {
+			g_critical("invalid VM rootfs backend: %s",
+				(gchar *)root->children->data);
+			rootfs_error_detected = true;
+		}
+	} else if (g_strcmp0(root->data, "path") == 0) {
+		gchar* path = cc_oci_resolve_path(root->children->data);
+		if (! path) {
+			g_critical("VM rootfs path does not exist: %s",
+				(gchar *)root->children->data);
+			rootfs_error_detected = true;
+		} else {
+			g_free(config->vm->rootfs_path);
+			config->vm->rootfs_path = path;
+		}
+	} else if (g_strcmp0(root->data, "profile") == 0) {
+		config->vm->rootfs_profile =
+			cc_oci_str_to_rootfs_profile (root->children->data);
+		if (config->vm->rootfs_profile
+		    == CC_OCI_VM_ROOTFS_PROFILE_INVALID) {
+			g_critical("invalid VM rootfs profile: %s",
+				(gchar *)root->children->data);
+			rootfs_error_detected = true;
+		}
+	} else if (g_strcmp0(root->data, "size") == 0) {
+		if (! cc_oci_str_to_bytes (root->children->data, 1,
+			    &config->vm->rootfs_size)) {
+			g_critical("invalid VM rootfs size: %s",
+				(gchar *)root->children->data);
+			rootfs_error_detected = true;
+		}
+	}
+}
+
+/*!
+ * Check the rootfs backend is usable.
+ *
+ * \param vm \ref cc_oci_vm_cfg.
+ *
+ * \return \c true on success, else \c false.
+ */
+static bool
+vm_check_rootfs_backend(struct cc_oci_vm_cfg* vm) {
+	if (vm->rootfs_backend == CC_OCI_VM_ROOTFS_9P) {
+		return true;
+	}
+
+	if (! vm->rootfs_path) {
+		vm->rootfs_path = g_strdup(CC_OCI_VM_ROOTFS_PATH);
+	}
+
+	if (! g_file_test(vm->rootfs_path, G_FILE_TEST_IS_DIR)) {
+		g_critical("VM rootfs path %s is not a directory",
+			vm->rootfs_path);
+		return false;
+	}
+
+	return true;
+}
+
+static void
+handle_boot_section(GNode* root, struct cc_oci_config* config) {
+	if (! (root && root->children)) {
+		return;
+	}
+	if (g_strcmp0(root->data, "profile") == 0) {
+		config->vm->boot =
+			cc_oci_str_to_vm_boot (root->children->data);
+		if (config->vm->boot == CC_OCI_VM_BOOT_INVALID) {
+			g_critical("invalid VM boot profile: %s",
+				(gchar *)root->children->data);
+			boot_error_detected = true;
+		}
+	}
+}
 
 static void
 handle_kernel_section(GNode* root, struct cc_oci_config* config) {
@@ -31,15 +269,13 @@ handle_kernel_section(GNode* root, struct cc_oci_config* config) {
 		return;
 	}
 	if (g_strcmp0(root->data, "path") == 0) {
-		g_autofree gchar* path = cc_oci_resolve_path(root->children->data);
+		gchar* path = cc_oci_resolve_path(root->children->data);
 		if (path) {
-			if (snprintf(config->vm->kernel_path,
-			    sizeof(config->vm->kernel_path),
-			    "%s", path) < 0) {
-				g_critical("failed to copy vm kernel path");
-			}
+			g_free(config->vm->kernel_path);
+			config->vm->kernel_path = path;
 		}
 	} else if (g_strcmp0(root->data, "parameters") == 0) {
+		g_free(config->vm->kernel_params);
 		config->vm->kernel_params = g_strdup(root->children->data);
 	}
 }
@@ -49,28 +285,41 @@ handle_vm_section(GNode* root, struct cc_oci_config* config) {
 	if (! (root && root->children)) {
 		return;
 	}
-	if (g_strcmp0(root->data, "path") == 0) {
-		g_autofree gchar* path = cc_oci_resolve_path(root->children->data);
+	switch (cc_oci_key_lookup (&vm_keys, root->data)) {
+	case VM_PATH: {
+		gchar* path = cc_oci_resolve_path(root->children->data);
 		if (path) {
-			if (snprintf(config->vm->hypervisor_path,
-			    sizeof(config->vm->hypervisor_path),
-			    "%s", path) < 0) {
-				g_critical("failed to copy vm hypervisor path");
-			}
+			g_free(config->vm->hypervisor_path);
+			config->vm->hypervisor_path = path;
 		}
-
-	} else if(g_strcmp0(root->data, "image") == 0) {
-		g_autofree gchar* path = cc_oci_resolve_path(root->children->data);
+		break;
+	}
+	case VM_IMAGE: {
+		gchar* path = cc_oci_resolve_path(root->children->data);
 		if (path) {
-			if (snprintf(config->vm->image_path,
-			    sizeof(config->vm->image_path),
-			    "%s", path) < 0) {
-				g_critical("failed to copy vm image path");
-			}
+			g_free(config->vm->image_path);
+			config->vm->image_path = path;
 		}
-	} else if (g_strcmp0(root->data, "kernel") == 0) {
+		break;
+	}
+	case VM_KERNEL:
 		g_node_children_foreach(root, G_TRAVERSE_ALL,
 			(GNodeForeachFunc)handle_kernel_section, config);
+		break;
+	case VM_MEMORY:
+		g_node_children_foreach(root, G_TRAVERSE_ALL,
+			(GNodeForeachFunc)handle_memory_section, config);
+		break;
+	case VM_ROOTFS:
+		g_node_children_foreach(root, G_TRAVERSE_ALL,
+			(GNodeForeachFunc)handle_rootfs_section, config);
+		break;
+	case VM_BOOT:
+		g_node_children_foreach(root, G_TRAVERSE_ALL,
+			(GNodeForeachFunc)handle_boot_section, config);
+		break;
+	default:
+		break;
 	}
 }
 
@@ -93,6 +342,10 @@ vm_handle_section(GNode* root, struct cc_oci_config* config) {
 		config->vm = g_malloc0(sizeof(struct cc_oci_vm_cfg));
 	}
 
+	memory_error_detected = false;
+	rootfs_error_detected = false;
+	boot_error_detected = false;
+
 	g_node_children_foreach(root, G_TRAVERSE_ALL,
 		(GNodeForeachFunc)handle_vm_section, config);
 
@@ -102,32 +355,59 @@ vm_handle_section(GNode* root, struct cc_oci_config* config) {
 	* - kernel_path
 	* Optional:
 	* - kernel_params
+	* - memory
+	* - rootfs
+	* - boot
 	*/
 
-	if (! config->vm->hypervisor_path[0]
+	if (! config->vm->hypervisor_path
 	    || stat (config->vm->hypervisor_path, &st) < 0) {
 		g_critical("VM hypervisor path does not exist");
 		goto out;
 	}
 
-	if (! config->vm->image_path[0]
+	if (! config->vm->image_path
 	    || stat (config->vm->image_path, &st) < 0) {
 		g_critical("VM image path does not exist");
 		goto out;
 	}
 
-	if (! config->vm->kernel_path[0]
+	/* saves "@SIZE@" expansion from a second stat */
+	config->vm->image_size = (guint64)st.st_size;
+
+	if (! config->vm->kernel_path
 	    || stat (config->vm->kernel_path, &st) < 0) {
 		g_critical("VM kernel path does not exist");
 		goto out;
 	}
 
+	if (memory_error_detected
+	    || ! vm_check_memory_backend(config->vm)) {
+		goto out;
+	}
+
+	if (rootfs_error_detected
+	    || ! vm_check_rootfs_backend(config->vm)) {
+		goto out;
+	}
+
+	if (boot_error_detected) {
+		goto out;
+	}
+
+	/* the agent mounts the rootfs from the 9p share itself */
+	if (config->vm->boot == CC_OCI_VM_BOOT_AGENT
+	    && config->vm->rootfs_backend != CC_OCI_VM_ROOTFS_9P) {
+		g_critical("VM boot profile agent requires the 9p "
+			"rootfs backend");
+		goto out;
+	}
+
 	ret = true;
 
 out:
 	if (! ret) {
-		g_free_if_set (config->vm->kernel_params);
-		g_free (config->vm);
+		cc_oci_vm_cfg_free (config->vm);
 		config->vm = NULL;
 	}
 
@@ -26,6 +26,8 @@
 
 #include <string.h>
 #include <stdbool.h>
+#include <sys/vfs.h>
+#include <linux/magic.h>
 
 #include <glib.h>
 #include <glib/gstdio.h>
@@ -39,6 +41,10 @@
 #include "annotation.h"
 #include "json.h"
 #include "config.h"
+#include "hypervisor.h"
+#include "src/state-keys.h"
+#include "src/state-vm-keys.h"
+#include "src/state-resources-keys.h"
 
 #define update_subelements_and_strdup(node, data, member) \
 	if (node && node->data) { \
@@ -51,6 +57,7 @@ struct handler_data;
 static void handle_state_ociVersion_section(GNode*, struct handler_data*);
 static void handle_state_id_section(GNode*, struct handler_data*);
 static void handle_state_pid_section(GNode*, struct handler_data*);
+static void handle_state_pidStartTime_section(GNode*, struct handler_data*);
 static void handle_state_bundlePath_section(GNode*, struct handler_data*);
 static void handle_state_commsPath_section(GNode*, struct handler_data*);
 static void handle_state_processPath_section(GNode*, struct handler_data*);
@@ -60,8 +67,11 @@ static void handle_state_mounts_section(GNode*, struct handler_data*);
 static void handle_state_console_section(GNode*, struct handler_data*);
 static void handle_state_vm_section(GNode*, struct handler_data*);
 static void handle_state_annotations_section(GNode*, struct handler_data*);
+static void handle_state_resources_section(GNode*, struct handler_data*);
 
-/*! Used to handle each section in \ref CC_OCI_STATE_FILE. */
+/*! Used to handle each section in \ref CC_OCI_STATE_FILE
+ * (indexed by \ref state_section).
+ */
 static struct state_handler {
 	/** Name of JSON element in \ref CC_OCI_STATE_FILE. */
 	const char* name;
@@ -77,18 +87,20 @@ static struct state_handler {
 	 */
 	size_t subelements_count;
 } state_handlers[] = {
-	{ "ociVersion"  , handle_state_ociVersion_section  , 1 , 0 },
-	{ "id"          , handle_state_id_section          , 1 , 0 },
-	{ "pid"         , handle_state_pid_section         , 1 , 0 },
-	{ "bundlePath"  , handle_state_bundlePath_section  , 1 , 0 },
-	{ "commsPath"   , handle_state_commsPath_section   , 1 , 0 },
-	{ "processPath" , handle_state_processPath_section , 1 , 0 },
-	{ "status"      , handle_state_status_section      , 1 , 0 },
-	{ "created"     , handle_state_created_section     , 1 , 0 },
-	{ "mounts"      , handle_state_mounts_section      , 0 , 0 },
-	{ "console"     , handle_state_console_section     , 2 , 0 },
-	{ "vm"          , handle_state_vm_section          , 5 , 0 },
-	{ "annotations" , handle_state_annotations_section , 0 , 0 },
+	[STATE_OCI_VERSION]    = { "ociVersion"  , handle_state_ociVersion_section  , 1 , 0 },
+	[STATE_ID]             = { "id"          , handle_state_id_section          , 1 , 0 },
+	[STATE_PID]            = { "pid"         , handle_state_pid_section         , 1 , 0 },
+	[STATE_PID_START_TIME] = { "pidStartTime", handle_state_pidStartTime_section, 0 , 0 },
+	[STATE_BUNDLE_PATH]    = { "bundlePath"  , handle_state_bundlePath_section  , 1 , 0 },
+	[STATE_COMMS_PATH]     = { "commsPath"   , handle_state_commsPath_section   , 1 , 0 },
+	[STATE_PROCESS_PATH]   = { "processPath" , handle_state_processPath_section , 1 , 0 },
+	[STATE_STATUS]         = { "status"      , handle_state_status_section      , 1 , 0 },
+	[STATE_CREATED]        = { "created"     , handle_state_created_section     , 1 , 0 },
+	[STATE_MOUNTS]         = { "mounts"      , handle_state_mounts_section      , 0 , 0 },
+	[STATE_CONSOLE]        = { "console"     , handle_state_console_section     , 2 , 0 },
+	[STATE_VM]             = { "vm"          , handle_state_vm_section          , 5 , 0 },
+	[STATE_ANNOTATIONS]    = { "annotations" , handle_state_annotations_section , 0 , 0 },
+	[STATE_RESOURCES]      = { "resources"   , handle_state_resources_section   , 0 , 0 },
 
 	/* terminator */
 	{ NULL, NULL, 0, 0 }
@@ -120,6 +132,17 @@ static struct cc_oci_map oci_status_map[] =
 	{ OCI_STATUS_INVALID , NULL      }
 };
 
+/** Map of \ref cc_oci_state_sync values to human-readable strings. */
+static struct cc_oci_map state_sync_map[] =
+{
+	{ CC_OCI_STATE_SYNC_AUTO   , "auto" },
+	{ CC_OCI_STATE_SYNC_NONE   , "none" },
+	{ CC_OCI_STATE_SYNC_DATA   , "data" },
+	{ CC_OCI_STATE_SYNC_FULL   , "full" },
+
+	{ CC_OCI_STATE_SYNC_INVALID, NULL   }
+};
+
 /**
  * Determine the human-readable string to be used to show the state
  * of the specified VM.
@@ -186,6 +209,28 @@ handle_state_pid_section(GNode* node, struct handler_data* data) {
 	}
 }
 
+/*!
+ *  handler for pidStartTime section
+ *
+ * \param node \c GNode.
+ * \param data \ref handler_data.
+ */
+static void
+handle_state_pidStartTime_section(GNode* node, struct handler_data* data) {
+	gchar* endptr = NULL;
+
+	if (! (node && node->data)) {
+		return;
+	}
+
+	data->state->pid_start_time =
+		g_ascii_strtoull((char*)node->data, &endptr, 10);
+	if (endptr == node->data) {
+		g_critical("failed to convert '%s' to int",
+		    (char*)node->data);
+	}
+}
+
 /*!
  *  handler for bundlePath section
  *
@@ -265,7 +310,7 @@ handle_state_mounts_section(GNode* node, struct handler_data* data) {
 
 	if (! g_strcmp0(node->data, "destination")) {
 		m = g_new0 (struct cc_oci_mount, 1);
-		g_strlcpy (m->dest, (char*)node->children->data, sizeof (m->dest));
+		m->dest = g_strdup ((char*)node->children->data);
 		m->ignore_mount = false;
 		data->state->mounts = g_slist_append(data->state->mounts, m);
 	} else if (! g_strcmp0(node->data, "directory_created")) {
@@ -328,31 +373,49 @@ handle_state_vm_section(GNode* node, struct handler_data* data) {
 
 	g_assert (vm);
 
-	if (g_strcmp0(node->data, "workload_path") == 0) {
-		g_strlcpy (vm->workload_path,
-				node->children->data,
-				sizeof (vm->workload_path));
+	switch (cc_oci_key_lookup (&state_vm_keys, node->data)) {
+	case STATE_VM_WORKLOAD_PATH:
+		g_free (vm->workload_path);
+		vm->workload_path = g_strdup (node->children->data);
 		(*(data->subelements_count))++;
-	} else if (g_strcmp0(node->data, "hypervisor_path") == 0) {
-		g_strlcpy (vm->hypervisor_path,
-				node->children->data,
-				sizeof (vm->hypervisor_path));
+		break;
+	case STATE_VM_HYPERVISOR_PATH:
+		g_free (vm->hypervisor_path);
+		vm->hypervisor_path = g_strdup (node->children->data);
 		(*(data->subelements_count))++;
-	} else if (g_strcmp0(node->data, "kernel_path") == 0) {
-		g_strlcpy (vm->kernel_path,
-				node->children->data,
-				sizeof (vm->kernel_path));
+		break;
+	case STATE_VM_KERNEL_PATH:
+		g_free (vm->kernel_path);
+		vm->kernel_path = g_strdup (node->children->data);
 		(*(data->subelements_count))++;
-	} else if (g_strcmp0(node->data, "image_path") == 0) {
-		g_strlcpy (vm->image_path,
-				node->children->data,
-				sizeof (vm->image_path));
+		break;
+	case STATE_VM_IMAGE_PATH:
+		g_free (vm->image_path);
+		vm->image_path = g_strdup (node->children->data);
 		(*(data->subelements_count))++;
-	} else if (g_strcmp0(node->data, "kernel_params") == 0) {
+		break;
+	case STATE_VM_KERNEL_PARAMS:
+		g_free (vm->kernel_params);
 		vm->kernel_params = g_strdup(node->children->data);
 		(*(data->subelements_count))++;
-	} else {
+		break;
+	case STATE_VM_BOOT:
+		/* optional */
+		vm->boot = cc_oci_str_to_vm_boot (node->children->data);
+		if (vm->boot == CC_OCI_VM_BOOT_INVALID) {
+			g_critical("invalid VM boot profile: %s",
+				(gchar *)node->children->data);
+			vm->boot = CC_OCI_VM_BOOT_SYSTEMD;
+		}
+		break;
+	case STATE_VM_ROOTFS_IMAGE:
+		/* optional */
+		g_free (vm->rootfs_image);
+		vm->rootfs_image = g_strdup (node->children->data);
+		break;
+	default:
 		g_critical("unknown console option: %s", (char*)node->data);
+		break;
 	}
 }
 
@@ -388,6 +451,74 @@ handle_state_annotations_section(GNode* node, struct handler_data* data)
                                                         ann);
 }
 
+/*!
+ * handler for resources section
+ *
+ * \param node \c GNode.
+ * \param data \ref handler_data.
+ */
+static void
+handle_state_resources_section(GNode* node, struct handler_data* data)
+{
+	struct cc_oci_vm_resources *resources;
+	gchar *endptr = NULL;
+	guint64 value;
+
+	if (! (node && node->data)) {
+		return;
+	}
+	if (! (node->children && node->children->data)) {
+		g_critical("%s missing value", (char*)node->data);
+		return;
+	}
+
+	g_assert (data->state);
+
+	value = g_ascii_strtoull ((char*)node->children->data, &endptr, 10);
+	if (endptr == node->children->data || *endptr) {
+		g_critical("failed to convert '%s' to int",
+		    (char*)node->children->data);
+		return;
+	}
+
+	if (! data->state->vm_resources) {
+		data->state->vm_resources =
+			g_new0 (struct cc_oci_vm_resources, 1);
+	}
+
+	resources = data->state->vm_resources;
+
+	switch (cc_oci_key_lookup (&state_resources_keys, node->data)) {
+	case STATE_RESOURCES_BOOT_VCPUS:
+		resources->boot_vcpus = (guint)value;
+		break;
+	case STATE_RESOURCES_MAX_VCPUS:
+		resources->max_vcpus = (guint)value;
+		break;
+	case STATE_RESOURCES_VCPUS:
+		resources->vcpus = (guint)value;
+		break;
+	case STATE_RESOURCES_BOOT_MEMORY:
+		resources->boot_memory = value;
+		break;
+	case STATE_RESOURCES_MAX_MEMORY:
+		resources->max_memory = value;
+		break;
+	case STATE_RESOURCES_MEMORY_SLOTS:
+		resources->memory_slots = (guint)value;
+		break;
+	case STATE_RESOURCES_HOTPLUGGED_MEMORY:
+		resources->hotplugged_memory = value;
+		break;
+	case STATE_RESOURCES_MEMORY_LIMIT:
+		resources->memory_limit = value;
+		break;
+	default:
+		g_critical("unknown resources option: %s", (char*)node->data);
+		break;
+	}
+}
+
 /*!
  * process all sections in state.json using the right section handler
  *
@@ -398,21 +529,22 @@ static void
 handle_state_sections(GNode* node, struct oci_state* state) {
 	struct state_handler* handler;
 	struct handler_data data = { .state=state };
+	gint section;
 
 	if (! (node && node->data)) {
 		return;
 	}
 
-	for (handler=state_handlers; handler->name; handler++) {
-		if (g_strcmp0(handler->name, node->data) == 0) {
-			data.subelements_count = &handler->subelements_count;
-			g_node_children_foreach(node, G_TRAVERSE_ALL,
-				(GNodeForeachFunc)handler->handle_section, &data);
-			return;
-		}
+	section = cc_oci_key_lookup (&state_section_keys, node->data);
+	if (section == CC_OCI_KEY_UNKNOWN) {
+		g_critical("handler not found %s", (char*)node->data);
+		return;
 	}
 
-	g_critical("handler not found %s", (char*)node->data);
+	handler = &state_handlers[section];
+	data.subelements_count = &handler->subelements_count;
+	g_node_children_foreach(node, G_TRAVERSE_ALL,
+		(GNodeForeachFunc)handler->handle_section, &data);
 }
 
 /*!
@@ -427,13 +559,12 @@ cc_oci_state_file_get (struct cc_oci_config *config)
 {
 	g_assert (config);
 
-	if (! config->state.runtime_path[0]) {
+	if (! config->state.runtime_path) {
 		return false;
 	}
 
-	g_snprintf (config->state.state_file_path,
-			sizeof (config->state.state_file_path),
-			"%s/%s",
+	g_free (config->state.state_file_path);
+	config->state.state_file_path = g_strdup_printf ("%s/%s",
 			config->state.runtime_path,
 			CC_OCI_STATE_FILE);
 
@@ -549,10 +680,9 @@ cc_oci_state_free (struct oci_state *state)
 		cc_oci_mounts_free_all (state->mounts);
 	}
 
-	if (state->vm) {
-		g_free_if_set (state->vm->kernel_params);
-		g_free (state->vm);
-	}
+	cc_oci_vm_cfg_free (state->vm);
+
+	g_free_if_set (state->vm_resources);
 
         if (state->annotations) {
                 cc_oci_annotations_free_all(state->annotations);
@@ -560,6 +690,36 @@ cc_oci_state_free (struct oci_state *state)
 	g_free (state);
 }
 
+/*!
+ * Determine how state files written to \p dir should be flushed.
+ *
+ * \param sync Configured \ref cc_oci_state_sync.
+ * \param dir Directory the state file is written to.
+ *
+ * \return \ref cc_oci_state_sync other than
+ * \ref CC_OCI_STATE_SYNC_AUTO.
+ */
+private enum cc_oci_state_sync
+cc_oci_state_sync_resolve (enum cc_oci_state_sync sync, const gchar *dir)
+{
+	struct statfs  fs;
+
+	if (sync != CC_OCI_STATE_SYNC_AUTO) {
+		return sync;
+	}
+
+	/* Nothing to flush on memory-backed file systems (/run usually
+	 * is one).
+	 */
+	if (dir && statfs (dir, &fs) == 0
+			&& (fs.f_type == TMPFS_MAGIC
+				|| fs.f_type == RAMFS_MAGIC)) {
+		return CC_OCI_STATE_SYNC_NONE;
+	}
+
+	return CC_OCI_STATE_SYNC_DATA;
+}
+
 /*!
  * Create the state file for the specified \p config.
  *
@@ -577,14 +737,15 @@ cc_oci_state_file_create (struct cc_oci_config *config,
 	JsonObject  *obj = NULL;
 	JsonObject  *console = NULL;
 	JsonObject  *vm = NULL;
+	JsonObject  *resources = NULL;
 	JsonObject  *annotation_obj = NULL;
 	JsonArray   *mounts = NULL;
 	gchar       *str = NULL;
 	gsize        str_len = 0;
-	GError      *err = NULL;
 	const gchar *status;
 	gboolean     ret;
 	gboolean     result = false;
+	enum cc_oci_state_sync state_sync;
 
 	if (! (config && created_timestamp)) {
 		return false;
@@ -598,13 +759,13 @@ cc_oci_state_file_create (struct cc_oci_config *config,
 	if ( ! config->bundle_path) {
 		return false;
 	}
-	if ( ! config->state.runtime_path[0]) {
+	if ( ! config->state.runtime_path) {
 		return false;
 	}
-	if ( ! config->state.comms_path[0]) {
+	if ( ! config->state.comms_path) {
 		return false;
 	}
-	if ( ! config->state.procsock_path[0]) {
+	if ( ! config->state.procsock_path) {
 		return false;
 	}
 	if (! config->vm) {
@@ -627,6 +788,13 @@ cc_oci_state_file_create (struct cc_oci_config *config,
 	json_object_set_int_member (obj, "pid",
 			(unsigned)config->state.workload_pid);
 
+	/* Recorded when the hypervisor was forked. 0 means it is
+	 * unknown, so its pid can't be told apart from a later process
+	 * reusing it.
+	 */
+	json_object_set_int_member (obj, "pidStartTime",
+			(gint64)config->state.workload_start_time);
+
 	json_object_set_string_member (obj, "bundlePath",
 			config->bundle_path);
 
@@ -689,8 +857,44 @@ cc_oci_state_file_create (struct cc_oci_config *config,
 			config->vm->kernel_params
 			? config->vm->kernel_params : "");
 
+	if (config->vm->boot != CC_OCI_VM_BOOT_SYSTEMD) {
+		json_object_set_string_member (vm, "boot",
+				cc_oci_vm_boot_to_str (config->vm->boot));
+	}
+
+	if (config->vm->rootfs_image) {
+		json_object_set_string_member (vm, "rootfs_image",
+				config->vm->rootfs_image);
+	}
+
 	json_object_set_object_member (obj, "vm", vm);
 
+	if (config->vm_resources.boot_vcpus) {
+		/* Add an object containing the VM resources to allow
+		 * "update" to change them later.
+		 */
+		resources = json_object_new ();
+
+		json_object_set_int_member (resources, "boot_vcpus",
+				config->vm_resources.boot_vcpus);
+		json_object_set_int_member (resources, "max_vcpus",
+				config->vm_resources.max_vcpus);
+		json_object_set_int_member (resources, "vcpus",
+				config->vm_resources.vcpus);
+		json_object_set_int_member (resources, "boot_memory",
+				(gint64)config->vm_resources.boot_memory);
+		json_object_set_int_member (resources, "max_memory",
+				(gint64)config->vm_resources.max_memory);
+		json_object_set_int_member (resources, "memory_slots",
+				config->vm_resources.memory_slots);
+		json_object_set_int_member (resources, "hotplugged_memory",
+				(gint64)config->vm_resources.hotplugged_memory);
+		json_object_set_int_member (resources, "memory_limit",
+				(gint64)config->vm_resources.memory_limit);
+
+		json_object_set_object_member (obj, "resources", resources);
+	}
+
 	if (config->oci.annotations) {
 		/* Add an object containing annotations */
 		annotation_obj = cc_oci_annotations_to_json(config);
@@ -698,21 +902,27 @@ cc_oci_state_file_create (struct cc_oci_config *config,
 		json_object_set_object_member(obj, "annotations", annotation_obj);
 	}
 
-	/* convert JSON to string */
-	str = cc_oci_json_obj_to_string (obj, true, &str_len);
+	/* convert JSON to string (compact, see
+	 * cc_oci_state_file_format())
+	 */
+	str = cc_oci_json_obj_to_string (obj, false, &str_len);
 	if (! str) {
 		goto out;
 	}
 
+	state_sync = cc_oci_state_sync_resolve (config->state.sync,
+			config->state.runtime_path);
+
 	/* Create state file */
-	ret = g_file_set_contents (config->state.state_file_path,
-			str, (gssize)str_len, &err);
+	ret = cc_oci_file_write_atomic (config->state.state_file_path,
+			str, str_len,
+			state_sync != CC_OCI_STATE_SYNC_NONE,
+			state_sync == CC_OCI_STATE_SYNC_FULL);
 	if (ret) {
 		result = true;
 	} else {
-		g_critical ("failed to create state file %s: %s",
-				config->state.state_file_path, err->message);
-		g_error_free (err);
+		g_critical ("failed to create state file %s",
+				config->state.state_file_path);
 	}
 
 	g_debug ("created state file %s", config->state.state_file_path);
@@ -726,6 +936,55 @@ out:
 	return result;
 }
 
+/*!
+ * Format the contents of a state file for display.
+ *
+ * State files are written compactly; this returns the pretty-printed
+ * form "state" shows.
+ *
+ * \param contents Contents of a state file.
+ * \param length Length of \p contents.
+ * \param[out] formatted_len Length of the returned string.
+ *
+ * \return Newly-allocated string on success, else \c NULL.
+ */
+gchar *
+cc_oci_state_file_format (const gchar *contents, gsize length,
+		gsize *formatted_len)
+{
+	JsonParser     *parser = NULL;
+	JsonGenerator  *generator = NULL;
+	gchar          *str = NULL;
+	GError         *error = NULL;
+
+	if (! (contents && formatted_len)) {
+		return NULL;
+	}
+
+	parser = json_parser_new ();
+
+	if (! json_parser_load_from_data (parser, contents,
+				(gssize)length, &error)) {
+		g_critical ("failed to parse state: %s", error->message);
+		g_error_free (error);
+		goto out;
+	}
+
+	generator = json_generator_new ();
+	json_generator_set_root (generator, json_parser_get_root (parser));
+	g_object_set (generator, "pretty", true, NULL);
+
+	str = json_generator_to_data (generator, formatted_len);
+
+out:
+	if (generator) {
+		g_object_unref (generator);
+	}
+	g_object_unref (parser);
+
+	return str;
+}
+
 /*!
  * Delete the state file for the specified \p config.
  *
@@ -737,7 +996,7 @@ gboolean
 cc_oci_state_file_delete (const struct cc_oci_config *config)
 {
 	g_assert (config);
-	g_assert (config->state.state_file_path[0]);
+	g_assert (config->state.state_file_path);
 
 	g_debug ("deleting state file %s", config->state.state_file_path);
 
@@ -786,6 +1045,28 @@ cc_oci_status_length (void)
 	return max;
 }
 
+/**
+ * Convert a human-readable string into a \ref cc_oci_state_sync.
+ *
+ * \param str String to convert ("auto", "none", "data" or "full").
+ *
+ * \return Valid \ref cc_oci_state_sync value, or
+ * \ref CC_OCI_STATE_SYNC_INVALID on error.
+ */
+enum cc_oci_state_sync
+cc_oci_str_to_state_sync (const char *str)
+{
+	struct cc_oci_map  *p;
+
+	for (p = state_sync_map; p && p->name; p++) {
+		if (! g_strcmp0 (str, p->name)) {
+			return p->num;
+		}
+	}
+
+	return CC_OCI_STATE_SYNC_INVALID;
+}
+
 /**
  * Convert a human-readable string state into a \ref oci_status_map.
  *
@@ -27,9 +27,12 @@ void cc_oci_state_free (struct oci_state *state);
 gboolean cc_oci_state_file_create (struct cc_oci_config *config,
 		const char *created_timestamp);
 gboolean cc_oci_state_file_delete (const struct cc_oci_config *config);
+gchar *cc_oci_state_file_format (const gchar *contents, gsize length,
+		gsize *formatted_len);
 gboolean cc_oci_state_file_exists (struct cc_oci_config *config);
 const char *cc_oci_status_to_str (enum oci_status status);
 enum oci_status cc_oci_str_to_status (const char *str);
+enum cc_oci_state_sync cc_oci_str_to_state_sync (const char *str);
 int cc_oci_status_length (void);
 
 #endif /* _CC_OCI_STATE_H */
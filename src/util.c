@@ -18,6 +18,8 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
  */
 
+#define _GNU_SOURCE
+
 #include <string.h>
 #include <stdlib.h>
 #include <sys/types.h>
@@ -460,14 +462,6 @@ node_to_strv(GNode* root) {
 	return strv;
 }
 
-gboolean
-gnode_free(GNode* node, gpointer data) {
-	if (node->data) {
-		g_free(node->data);
-	}
-	return false;
-}
-
 /**
  * Resolve a path by converting to canonical form:
  *
@@ -538,6 +532,191 @@ cc_oci_fd_set_cloexec (int fd)
 	return true;
 }
 
+/*!
+ * Write all of a buffer to a file descriptor.
+ *
+ * \param fd File descriptor.
+ * \param data Data to write.
+ * \param len Length of \p data.
+ * \param sync_data If \c true, flush the data to storage.
+ *
+ * \return \c true on success, else \c false.
+ */
+static gboolean
+cc_oci_fd_write_all (int fd, const gchar *data, gsize len,
+		gboolean sync_data)
+{
+	ssize_t n;
+
+	while (len) {
+		n = write (fd, data, len);
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n < 0) {
+			return false;
+		}
+		data += n;
+		len -= (gsize)n;
+	}
+
+	return sync_data ? fdatasync (fd) == 0 : true;
+}
+
+/*!
+ * Write new file contents to a temporary file next to the file.
+ *
+ * An unnamed file (\c O_TMPFILE) is used where supported, so a
+ * partially written file is never visible, and only linked once
+ * complete.
+ *
+ * \param path Path of the file.
+ * \param dir Directory of \p path.
+ * \param data Data to write.
+ * \param len Length of \p data.
+ * \param sync_data If \c true, flush the data to storage.
+ *
+ * \return Newly-allocated path of the temporary file on success,
+ * else \c NULL.
+ */
+static gchar *
+cc_oci_file_write_tmp (const gchar *path, const gchar *dir,
+		const gchar *data, gsize len, gboolean sync_data)
+{
+	gchar  *tmp = NULL;
+	int     fd = -1;
+
+#ifdef O_TMPFILE
+	fd = open (dir, O_TMPFILE | O_WRONLY | O_CLOEXEC, 0666);
+	if (fd >= 0) {
+		gchar fd_path[64];
+
+		if (! cc_oci_fd_write_all (fd, data, len, sync_data)) {
+			goto err;
+		}
+
+		/* linkat(2) can't replace a file, so link to a
+		 * temporary name and rename that.
+		 */
+		tmp = g_strdup_printf ("%s.%d.tmp", path, (int)getpid ());
+		g_snprintf (fd_path, sizeof (fd_path),
+				"/proc/self/fd/%d", fd);
+
+		/* only a dead process with our pid can have left it */
+		(void)unlink (tmp);
+
+		if (! linkat (AT_FDCWD, fd_path, AT_FDCWD, tmp,
+					AT_SYMLINK_FOLLOW)) {
+			close (fd);
+			return tmp;
+		}
+
+		/* no /proc, fall back to a named file */
+		g_free (tmp);
+		tmp = NULL;
+		close (fd);
+		fd = -1;
+	}
+#else
+	(void)dir;
+#endif
+
+	tmp = g_strdup_printf ("%s.XXXXXX", path);
+
+	fd = g_mkstemp_full (tmp, O_WRONLY | O_CLOEXEC, 0666);
+	if (fd < 0) {
+		goto err;
+	}
+
+	if (! cc_oci_fd_write_all (fd, data, len, sync_data)) {
+		(void)unlink (tmp);
+		goto err;
+	}
+
+	close (fd);
+
+	return tmp;
+
+err:
+	if (fd >= 0) {
+		close (fd);
+	}
+	g_free_if_set (tmp);
+
+	return NULL;
+}
+
+/*!
+ * Atomically replace the contents of a file.
+ *
+ * The data is written to a temporary file which is then renamed over
+ * \p path: readers see either the old or the new contents, never a
+ * partially written file.
+ *
+ * \param path Path of the file.
+ * \param data Data to write.
+ * \param len Length of \p data.
+ * \param sync_data If \c true, flush the data to storage before
+ *   replacing the file.
+ * \param sync_dir If \c true, also flush the directory after
+ *   replacing the file.
+ *
+ * \return \c true on success, else \c false.
+ */
+gboolean
+cc_oci_file_write_atomic (const gchar *path, const gchar *data,
+		gsize len, gboolean sync_data, gboolean sync_dir)
+{
+	gchar     *dir = NULL;
+	gchar     *tmp = NULL;
+	gboolean   ret = false;
+	int        saved;
+	int        fd;
+
+	if (! (path && data)) {
+		return false;
+	}
+
+	dir = g_path_get_dirname (path);
+
+	tmp = cc_oci_file_write_tmp (path, dir, data, len, sync_data);
+	if (! tmp) {
+		saved = errno;
+		g_critical ("failed to write %s: %s", path, strerror (saved));
+		goto out;
+	}
+
+	if (rename (tmp, path) < 0) {
+		saved = errno;
+		g_critical ("failed to rename %s to %s: %s",
+				tmp, path, strerror (saved));
+		(void)unlink (tmp);
+		goto out;
+	}
+
+	if (sync_dir) {
+		fd = open (dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+		if (fd < 0 || fsync (fd) < 0) {
+			saved = errno;
+			g_critical ("failed to sync directory %s: %s",
+					dir, strerror (saved));
+			if (fd >= 0) {
+				close (fd);
+			}
+			goto out;
+		}
+		close (fd);
+	}
+
+	ret = true;
+
+out:
+	g_free (dir);
+	g_free_if_set (tmp);
+
+	return ret;
+}
+
 /**
  * Determine if networking setup should occur.
  *
@@ -559,6 +738,117 @@ cc_oci_enable_networking (void)
 	return enable;
 }
 
+/**
+ * Convert a size string such as "2G" into a number of bytes.
+ *
+ * Recognised suffixes are "K", "M", "G" and "T" (case-insensitive,
+ * binary multiples).
+ *
+ * \param str String to convert.
+ * \param default_multiplier Multiplier to apply if \p str has no suffix.
+ * \param[out] bytes Size in bytes.
+ *
+ * \return \c true on success, else \c false.
+ */
+gboolean
+cc_oci_str_to_bytes (const gchar *str, guint64 default_multiplier,
+		guint64 *bytes)
+{
+	gchar   *end = NULL;
+	guint64  value;
+	guint64  multiplier = default_multiplier;
+
+	if (! (str && *str && bytes)) {
+		return false;
+	}
+
+	if (! g_ascii_isdigit (*str)) {
+		return false;
+	}
+
+	value = g_ascii_strtoull (str, &end, 10);
+
+	if (*end) {
+		switch (g_ascii_toupper (*end)) {
+		case 'K': multiplier = 1ULL << 10; break;
+		case 'M': multiplier = 1ULL << 20; break;
+		case 'G': multiplier = 1ULL << 30; break;
+		case 'T': multiplier = 1ULL << 40; break;
+		default:
+			return false;
+		}
+
+		if (*(end+1)) {
+			return false;
+		}
+	}
+
+	if (multiplier && value > G_MAXUINT64 / multiplier) {
+		return false;
+	}
+
+	*bytes = value * multiplier;
+
+	return true;
+}
+
+/**
+ * Determine the number of CPUs specified by a cpuset string
+ * such as "0-3,6".
+ *
+ * \param cpus cpuset string.
+ *
+ * \return number of CPUs on success, else \c 0.
+ */
+guint
+cc_oci_cpuset_count (const gchar *cpus)
+{
+	gchar  **ranges = NULL;
+	gchar  **range;
+	guint    count = 0;
+
+	if (! (cpus && *cpus)) {
+		return 0;
+	}
+
+	ranges = g_strsplit (cpus, ",", -1);
+
+	for (range = ranges; range && *range; range++) {
+		gchar   *end = NULL;
+		guint64  first;
+		guint64  last;
+
+		if (! g_ascii_isdigit (**range)) {
+			goto err;
+		}
+
+		first = g_ascii_strtoull (*range, &end, 10);
+		last = first;
+
+		if (*end == '-') {
+			if (! g_ascii_isdigit (*(end+1))) {
+				goto err;
+			}
+
+			last = g_ascii_strtoull (end+1, &end, 10);
+		}
+
+		if (*end || last < first) {
+			goto err;
+		}
+
+		count += (guint)(last - first + 1);
+	}
+
+	g_strfreev (ranges);
+
+	return count;
+
+err:
+	g_strfreev (ranges);
+	return 0;
+}
+
 #ifdef DEBUG
 static gboolean
 cc_oci_node_dump_aux(GNode* node, gpointer data) {
@@ -28,6 +28,7 @@
 #include <json-glib/json-gobject.h>
 
 #include "config.h"
+#include "json.h"
 
 /** Calculate size of array specified by \a x. */
 #define CC_OCI_ARRAY_SIZE(x) (sizeof(x) / sizeof((x)[0]))
@@ -38,12 +39,9 @@
 #define g_free_if_set(ptr) \
 	if ((ptr)) { g_free ((ptr)); ptr=NULL; }
 
+/** Free a tree returned by \ref cc_oci_json_parse() and reset \a node */
 #define g_free_node(node) \
-	if ((node)) { \
-		g_node_traverse(node, G_POST_ORDER, G_TRAVERSE_ALL, \
-			-1, (GNodeTraverseFunc)gnode_free, NULL); \
-		g_node_destroy(node); \
-		node=NULL; }
+	if ((node)) { cc_oci_json_free ((node)); node=NULL; }
 
 #ifdef DEBUG
 	void cc_oci_node_dump(GNode* node);
@@ -84,10 +82,14 @@ gboolean cc_oci_replace_string (gchar **str, const char *from,
 		const char *to);
 gboolean cc_oci_file_to_strv (const char *file, gchar ***strv);
 char** node_to_strv(GNode* root);
-gboolean gnode_free(GNode* node, gpointer data);
 int cc_oci_get_signum (const gchar *signame);
 gchar *cc_oci_resolve_path (const gchar *path);
 gboolean cc_oci_fd_set_cloexec (int fd);
+gboolean cc_oci_file_write_atomic (const gchar *path, const gchar *data,
+		gsize len, gboolean sync_data, gboolean sync_dir);
 gboolean cc_oci_enable_networking (void);
+gboolean cc_oci_str_to_bytes (const gchar *str, guint64 default_multiplier,
+		guint64 *bytes);
+guint cc_oci_cpuset_count (const gchar *cpus);
 
 #endif /* _CC_OCI_UTIL_H */
@@ -0,0 +1,315 @@
+/*
+ * This file is part of cc-oci-runtime.
+ *
+ * Copyright (C) 2016 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/**
+ * \file
+ *
+ * Listening sockets created by the runtime on behalf of the hypervisor.
+ *
+ * By default, the hypervisor creates its sockets (QMP, process,
+ * console and agent sockets) itself once it starts running, so their
+ * users have to wait for them to appear. When the hypervisor
+ * arguments refer to a socket by fd (see \ref vm_socket_tags), the
+ * runtime creates all of them before the hypervisor is exec'd instead,
+ * and the hypervisor inherits the listening fds. The sockets can then
+ * be connected to as soon as "create" returns (connections are queued
+ * until the hypervisor accepts them).
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "common.h"
+#include "oci.h"
+#include "vm_socket.h"
+
+/** Hypervisor argument tags expanding to the fd of a socket. */
+static const struct vm_socket_tag {
+	const gchar            *name;
+	enum cc_oci_vm_socket   socket;
+} vm_socket_tags[] = {
+	{ "@COMMS_SOCKET_FD@"     , CC_OCI_VM_SOCKET_COMMS     },
+	{ "@AGENT_CTL_SOCKET_FD@" , CC_OCI_VM_SOCKET_AGENT_CTL },
+	{ "@AGENT_TTY_SOCKET_FD@" , CC_OCI_VM_SOCKET_AGENT_TTY },
+	{ NULL }
+};
+
+/*!
+ * Create a listening \c AF_UNIX socket.
+ *
+ * Any existing file at \p path is replaced. The returned fd is not
+ * close-on-exec and is never one of the standard streams.
+ *
+ * \param path Path to bind the socket to.
+ *
+ * \return fd on success, else -1.
+ */
+int
+cc_oci_vm_socket_listen (const gchar *path)
+{
+	struct sockaddr_un  addr = { 0 };
+	int                 fd;
+	int                 new_fd;
+
+	if (! (path && *path)) {
+		return -1;
+	}
+
+	if (strlen (path) >= sizeof (addr.sun_path)) {
+		g_critical ("socket path too long: %s", path);
+		return -1;
+	}
+
+	addr.sun_family = AF_UNIX;
+	g_strlcpy (addr.sun_path, path, sizeof (addr.sun_path));
+
+	fd = socket (AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0) {
+		g_critical ("failed to create socket: %s",
+				strerror (errno));
+		return -1;
+	}
+
+	/* A closed stdin would otherwise be reused, and the standard
+	 * streams are treated specially by the child setup.
+	 */
+	if (fd <= STDERR_FILENO) {
+		new_fd = fcntl (fd, F_DUPFD, STDERR_FILENO + 1);
+		close (fd);
+		if (new_fd < 0) {
+			g_critical ("failed to duplicate socket: %s",
+					strerror (errno));
+			return -1;
+		}
+		fd = new_fd;
+	}
+
+	if (g_unlink (path) < 0 && errno != ENOENT) {
+		g_critical ("failed to remove %s: %s",
+				path, strerror (errno));
+		goto err;
+	}
+
+	if (bind (fd, (struct sockaddr *)&addr, sizeof (addr)) < 0) {
+		g_critical ("failed to bind socket to %s: %s",
+				path, strerror (errno));
+		goto err;
+	}
+
+	if (listen (fd, SOMAXCONN) < 0) {
+		g_critical ("failed to listen on %s: %s",
+				path, strerror (errno));
+		goto err;
+	}
+
+	return fd;
+
+err:
+	close (fd);
+	return -1;
+}
+
+/*!
+ * Determine the path of a hypervisor socket.
+ *
+ * \param config \ref cc_oci_config.
+ * \param socket \ref cc_oci_vm_socket.
+ *
+ * \return Newly-allocated string on success, else \c NULL.
+ */
+private gchar *
+cc_oci_vm_socket_path (const struct cc_oci_config *config,
+		enum cc_oci_vm_socket socket)
+{
+	const gchar *name = NULL;
+
+	switch (socket) {
+	case CC_OCI_VM_SOCKET_COMMS:
+		return g_strdup (config->state.comms_path);
+	case CC_OCI_VM_SOCKET_PROCESS:
+		return g_strdup (config->state.procsock_path);
+	case CC_OCI_VM_SOCKET_CONSOLE:
+		name = CC_OCI_CONSOLE_SOCKET;
+		break;
+	case CC_OCI_VM_SOCKET_AGENT_CTL:
+		name = CC_OCI_AGENT_CTL_SOCKET;
+		break;
+	case CC_OCI_VM_SOCKET_AGENT_TTY:
+		name = CC_OCI_AGENT_TTY_SOCKET;
+		break;
+	default:
+		return NULL;
+	}
+
+	return g_build_path ("/", config->state.runtime_path, name, NULL);
+}
+
+/*!
+ * Determine if hypervisor arguments refer to a socket by fd.
+ *
+ * \param args Hypervisor arguments.
+ *
+ * \return \c true if the runtime should create the hypervisor
+ * sockets, else \c false.
+ */
+gboolean
+cc_oci_vm_sockets_wanted (gchar **args)
+{
+	const struct vm_socket_tag  *tag;
+	gchar                      **arg;
+
+	for (arg = args; arg && *arg; arg++) {
+		if (**arg == '#') {
+			continue;
+		}
+
+		for (tag = vm_socket_tags; tag->name; tag++) {
+			if (strstr (*arg, tag->name)) {
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+/*!
+ * Create the hypervisor sockets, if the hypervisor arguments ask for
+ * them (see \ref cc_oci_vm_sockets_wanted).
+ *
+ * The process socket is always created, the console socket if
+ * \p console is \c true. The other sockets are only created if their
+ * fd tag is used.
+ *
+ * \param config \ref cc_oci_config.
+ * \param args Hypervisor arguments.
+ * \param console \c true if the console is a socket.
+ *
+ * \return \c true on success, else \c false.
+ */
+gboolean
+cc_oci_vm_sockets_create (struct cc_oci_config *config, gchar **args,
+		gboolean console)
+{
+	const struct vm_socket_tag  *tag;
+	gboolean                     wanted[CC_OCI_VM_SOCKET_MAX] = { 0 };
+	gchar                      **arg;
+	gchar                       *path;
+	int                          i;
+
+	if (! (config && args)) {
+		return false;
+	}
+
+	if (! cc_oci_vm_sockets_wanted (args)) {
+		return true;
+	}
+
+	wanted[CC_OCI_VM_SOCKET_PROCESS] = true;
+	wanted[CC_OCI_VM_SOCKET_CONSOLE] = console;
+
+	for (arg = args; *arg; arg++) {
+		if (**arg == '#') {
+			continue;
+		}
+
+		for (tag = vm_socket_tags; tag->name; tag++) {
+			if (strstr (*arg, tag->name)) {
+				wanted[tag->socket] = true;
+			}
+		}
+	}
+
+	for (i = 0; i < CC_OCI_VM_SOCKET_MAX; i++) {
+		if (! wanted[i] || config->vm_sockets[i]) {
+			continue;
+		}
+
+		path = cc_oci_vm_socket_path (config, i);
+		config->vm_sockets[i] = cc_oci_vm_socket_listen (path);
+		g_free (path);
+
+		if (config->vm_sockets[i] < 0) {
+			config->vm_sockets[i] = 0;
+			cc_oci_vm_sockets_close (config);
+			return false;
+		}
+
+		g_debug ("created hypervisor socket %d (fd %d)",
+				i, config->vm_sockets[i]);
+	}
+
+	return true;
+}
+
+/*!
+ * Determine if an fd is a socket to be inherited by the hypervisor.
+ *
+ * \param config \ref cc_oci_config.
+ * \param fd File descriptor.
+ *
+ * \return \c true if \p fd must be kept open, else \c false.
+ */
+gboolean
+cc_oci_vm_socket_inherited (const struct cc_oci_config *config, int fd)
+{
+	int i;
+
+	if (! config || fd <= STDERR_FILENO) {
+		return false;
+	}
+
+	for (i = 0; i < CC_OCI_VM_SOCKET_MAX; i++) {
+		if (config->vm_sockets[i] == fd) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/*!
+ * Close the hypervisor sockets created by the runtime.
+ *
+ * \param config \ref cc_oci_config.
+ */
+void
+cc_oci_vm_sockets_close (struct cc_oci_config *config)
+{
+	int i;
+
+	if (! config) {
+		return;
+	}
+
+	for (i = 0; i < CC_OCI_VM_SOCKET_MAX; i++) {
+		if (config->vm_sockets[i]) {
+			close (config->vm_sockets[i]);
+			config->vm_sockets[i] = 0;
+		}
+	}
+}
@@ -0,0 +1,36 @@
+/*
+ * This file is part of cc-oci-runtime.
+ *
+ * Copyright (C) 2016 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef _CC_OCI_VM_SOCKET_H
+#define _CC_OCI_VM_SOCKET_H
+
+#include <glib.h>
+
+#include "oci.h"
+
+int cc_oci_vm_socket_listen (const gchar *path);
+gboolean cc_oci_vm_sockets_wanted (gchar **args);
+gboolean cc_oci_vm_sockets_create (struct cc_oci_config *config,
+		gchar **args, gboolean console);
+gboolean cc_oci_vm_socket_inherited (const struct cc_oci_config *config,
+		int fd);
+void cc_oci_vm_sockets_close (struct cc_oci_config *config);
+
+#endif /* _CC_OCI_VM_SOCKET_H */
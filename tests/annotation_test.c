@@ -27,9 +27,9 @@
 #include "test_common.h"
 #include "../src/oci.h"
 #include "../src/logging.h"
+#include "../src/annotation.h"
 
 void cc_oci_annotation_free (struct oci_cfg_annotation *a);
-void cc_oci_annotations_free_all (GSList *annotations);
 
 START_TEST(test_cc_oci_annotation_free) {
 	struct oci_cfg_annotation* a;
@@ -71,11 +71,40 @@ START_TEST(test_cc_oci_annotations_free_all) {
 
 } END_TEST
 
+START_TEST(test_cc_oci_annotation_get) {
+	GSList* list = NULL;
+	struct oci_cfg_annotation* a;
+
+	ck_assert (! cc_oci_annotation_get (NULL, NULL));
+	ck_assert (! cc_oci_annotation_get (NULL, "foo"));
+
+	list = g_slist_append(list, NULL);
+
+	a = g_new0(struct oci_cfg_annotation, 1);
+	a->key = g_strdup("foo");
+	a->value = g_strdup("bar");
+	list = g_slist_append(list, a);
+
+	a = g_new0(struct oci_cfg_annotation, 1);
+	a->key = g_strdup("hello");
+	a->value = g_strdup("world");
+	list = g_slist_append(list, a);
+
+	ck_assert (! cc_oci_annotation_get (list, NULL));
+	ck_assert (! cc_oci_annotation_get (list, "fo"));
+	ck_assert (! g_strcmp0 (cc_oci_annotation_get (list, "foo"), "bar"));
+	ck_assert (! g_strcmp0 (cc_oci_annotation_get (list, "hello"),
+				"world"));
+
+	cc_oci_annotations_free_all(list);
+} END_TEST
+
 Suite* make_annotation_suite(void) {
 	Suite* s = suite_create(__FILE__);
 
 	ADD_TEST(test_cc_oci_annotation_free, s);
 	ADD_TEST(test_cc_oci_annotations_free_all, s);
+	ADD_TEST(test_cc_oci_annotation_get, s);
 
 	return s;
 }
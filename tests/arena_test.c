@@ -0,0 +1,150 @@
+/*
+ * This file is part of cc-oci-runtime.
+ *
+ * Copyright (C) 2016 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <check.h>
+#include <glib.h>
+
+#include "test_common.h"
+#include "../src/logging.h"
+#include "../src/arena.h"
+
+START_TEST(test_cc_oci_arena_alloc) {
+	struct cc_oci_arena *arena;
+	guint8              *p;
+	guint8              *q;
+	guint8              *big;
+	int                  i;
+
+	ck_assert (! cc_oci_arena_alloc (NULL, 1));
+	ck_assert (! cc_oci_arena_alloc0 (NULL, 1));
+
+	arena = cc_oci_arena_new (0);
+	ck_assert (arena);
+	ck_assert (arena->block_size == CC_OCI_ARENA_BLOCK_SIZE);
+	cc_oci_arena_free (arena);
+
+	arena = cc_oci_arena_new (64);
+	ck_assert (arena);
+
+	/* allocations are aligned and do not overlap */
+	p = cc_oci_arena_alloc (arena, 3);
+	ck_assert (p);
+	q = cc_oci_arena_alloc (arena, 1);
+	ck_assert (q);
+	ck_assert (! ((gsize)p % sizeof (gpointer)));
+	ck_assert (! ((gsize)q % sizeof (gpointer)));
+	ck_assert (q >= p + 3);
+
+	/* zero-sized allocations still return distinct memory */
+	ck_assert (cc_oci_arena_alloc (arena, 0) !=
+			cc_oci_arena_alloc (arena, 0));
+
+	/* larger than a block */
+	big = cc_oci_arena_alloc0 (arena, 1000);
+	ck_assert (big);
+	for (i = 0; i < 1000; i++) {
+		ck_assert (! big[i]);
+	}
+	memset (big, 0xff, 1000);
+
+	/* the current block is still used after an oversized
+	 * allocation.
+	 */
+	q = cc_oci_arena_alloc (arena, 1);
+	ck_assert (q);
+	ck_assert (q < big || q >= big + 1000);
+
+	/* many blocks */
+	for (i = 0; i < 1000; i++) {
+		p = cc_oci_arena_alloc0 (arena, 24);
+		ck_assert (p);
+		ck_assert (! p[0] && ! p[23]);
+	}
+
+	cc_oci_arena_free (arena);
+
+	/* no-op */
+	cc_oci_arena_free (NULL);
+} END_TEST
+
+START_TEST(test_cc_oci_arena_strdup) {
+	struct cc_oci_arena *arena;
+	gchar               *str;
+
+	ck_assert (! cc_oci_arena_strdup (NULL, "foo"));
+
+	arena = cc_oci_arena_new (16);
+	ck_assert (arena);
+
+	ck_assert (! cc_oci_arena_strdup (arena, NULL));
+
+	str = cc_oci_arena_strdup (arena, "");
+	ck_assert (str);
+	ck_assert_str_eq (str, "");
+
+	str = cc_oci_arena_strdup (arena, "hello world");
+	ck_assert (str);
+	ck_assert_str_eq (str, "hello world");
+
+	/* longer than a block */
+	str = cc_oci_arena_strdup (arena,
+			"a string longer than the blocks of the arena");
+	ck_assert (str);
+	ck_assert_str_eq (str,
+			"a string longer than the blocks of the arena");
+
+	cc_oci_arena_free (arena);
+} END_TEST
+
+Suite* make_arena_suite(void) {
+	Suite* s = suite_create(__FILE__);
+
+	ADD_TEST(test_cc_oci_arena_alloc, s);
+	ADD_TEST(test_cc_oci_arena_strdup, s);
+
+	return s;
+}
+
+int main (void) {
+	int number_failed;
+	Suite* s;
+	SRunner* sr;
+	struct cc_log_options options = { 0 };
+
+	options.enable_debug = true;
+	options.use_json = false;
+	options.filename = g_strdup ("arena_test_debug.log");
+	(void)cc_oci_log_init(&options);
+
+	s = make_arena_suite();
+	sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_VERBOSE);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	cc_oci_log_free (&options);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
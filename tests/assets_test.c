@@ -0,0 +1,251 @@
+/*
+ * This file is part of cc-oci-runtime.
+ *
+ * Copyright (C) 2016 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include <check.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <json-glib/json-glib.h>
+
+#include "test_common.h"
+#include "../src/oci.h"
+#include "../src/assets.h"
+
+gboolean cc_oci_asset_registered (JsonObject *registry,
+		const struct cc_oci_asset *asset);
+void cc_oci_asset_register (JsonObject *registry,
+		const struct cc_oci_asset *asset);
+JsonObject *cc_oci_assets_load (const gchar *path);
+
+START_TEST(test_cc_oci_asset_get) {
+	struct cc_oci_asset  asset = { 0 };
+	g_autofree gchar    *tmpdir = NULL;
+	g_autofree gchar    *path = NULL;
+
+	ck_assert (! cc_oci_asset_get (NULL, &asset));
+	ck_assert (! cc_oci_asset_get ("", &asset));
+	ck_assert (! cc_oci_asset_get ("/", NULL));
+	ck_assert (! cc_oci_asset_get ("/does/not/exist", &asset));
+
+	tmpdir = g_dir_make_tmp (NULL, NULL);
+	ck_assert (tmpdir);
+
+	path = g_build_path ("/", tmpdir, "kernel", NULL);
+	ck_assert (g_file_set_contents (path, "hello", -1, NULL));
+
+	ck_assert (cc_oci_asset_get (path, &asset));
+	ck_assert (asset.path == path);
+	ck_assert (asset.ino);
+	ck_assert (asset.size == 5);
+	ck_assert (asset.mtime);
+
+	ck_assert (! cc_oci_asset_prewarm (NULL));
+	ck_assert (cc_oci_asset_prewarm (&asset));
+
+	ck_assert (! g_remove (path));
+	ck_assert (! cc_oci_asset_prewarm (&asset));
+
+	ck_assert (! g_remove (tmpdir));
+} END_TEST
+
+START_TEST(test_cc_oci_asset_resident) {
+	struct cc_oci_asset  asset = { 0 };
+	g_autofree gchar    *tmpdir = NULL;
+	g_autofree gchar    *path = NULL;
+
+	ck_assert (! cc_oci_asset_resident (NULL));
+	ck_assert (! cc_oci_asset_resident (&asset));
+
+	tmpdir = g_dir_make_tmp (NULL, NULL);
+	ck_assert (tmpdir);
+
+	path = g_build_path ("/", tmpdir, "image", NULL);
+
+	/* empty asset */
+	ck_assert (g_file_set_contents (path, "", -1, NULL));
+	ck_assert (cc_oci_asset_get (path, &asset));
+	ck_assert (cc_oci_asset_resident (&asset));
+
+	/* just written, so in the page cache */
+	ck_assert (g_file_set_contents (path, "image", -1, NULL));
+	ck_assert (cc_oci_asset_get (path, &asset));
+	ck_assert (cc_oci_asset_prewarm (&asset));
+	ck_assert (cc_oci_asset_resident (&asset));
+
+	ck_assert (! g_remove (path));
+	ck_assert (! cc_oci_asset_resident (&asset));
+
+	ck_assert (! g_remove (tmpdir));
+} END_TEST
+
+START_TEST(test_cc_oci_asset_registered) {
+	struct cc_oci_asset  asset = { 0 };
+	struct cc_oci_asset  other;
+	JsonObject          *registry;
+
+	asset.path = "/some/kernel";
+	asset.dev = 1;
+	asset.ino = 2;
+	asset.size = 3;
+	asset.mtime = 4;
+
+	registry = json_object_new ();
+
+	ck_assert (! cc_oci_asset_registered (NULL, &asset));
+	ck_assert (! cc_oci_asset_registered (registry, &asset));
+
+	cc_oci_asset_register (registry, &asset);
+	ck_assert (cc_oci_asset_registered (registry, &asset));
+
+	other = asset;
+	other.path = "/another/kernel";
+	ck_assert (! cc_oci_asset_registered (registry, &other));
+
+	other = asset;
+	other.ino++;
+	ck_assert (! cc_oci_asset_registered (registry, &other));
+
+	other = asset;
+	other.size++;
+	ck_assert (! cc_oci_asset_registered (registry, &other));
+
+	other = asset;
+	other.mtime++;
+	ck_assert (! cc_oci_asset_registered (registry, &other));
+
+	/* invalid entry */
+	json_object_set_string_member (registry, asset.path, "foo");
+	ck_assert (! cc_oci_asset_registered (registry, &asset));
+
+	json_object_unref (registry);
+} END_TEST
+
+START_TEST(test_cc_oci_assets_prewarm) {
+	struct cc_oci_config  config = { { 0 } };
+	struct cc_oci_asset   asset;
+	g_autofree gchar     *tmpdir = NULL;
+	g_autofree gchar     *path = NULL;
+	JsonObject           *registry;
+
+	ck_assert (! cc_oci_assets_prewarm (NULL, false));
+	ck_assert (! cc_oci_assets_prewarm (&config, false));
+
+	tmpdir = g_dir_make_tmp (NULL, NULL);
+	ck_assert (tmpdir);
+
+	config.root_dir = g_strdup (tmpdir);
+	config.vm = g_new0 (struct cc_oci_vm_cfg, 1);
+
+	config.vm->hypervisor_path = g_strdup_printf ("%s/hypervisor", tmpdir);
+	config.vm->kernel_path = g_strdup_printf ("%s/kernel", tmpdir);
+	config.vm->image_path = g_strdup_printf ("%s/image", tmpdir);
+
+	/* assets don't exist */
+	ck_assert (! cc_oci_assets_prewarm (&config, false));
+
+	ck_assert (g_file_set_contents (config.vm->hypervisor_path,
+				"hypervisor", -1, NULL));
+	ck_assert (g_file_set_contents (config.vm->kernel_path,
+				"kernel", -1, NULL));
+	ck_assert (g_file_set_contents (config.vm->image_path,
+				"image", -1, NULL));
+
+	path = cc_oci_assets_file_path (&config);
+	ck_assert (path);
+	ck_assert (g_str_has_prefix (path, tmpdir));
+	ck_assert (g_str_has_suffix (path, "/" CC_OCI_ASSETS_FILE));
+
+	ck_assert (cc_oci_assets_prewarm (&config, false));
+	ck_assert (g_file_test (path, G_FILE_TEST_EXISTS));
+
+	registry = cc_oci_assets_load (path);
+	ck_assert (json_object_get_size (registry) == 3);
+
+	ck_assert (cc_oci_asset_get (config.vm->image_path, &asset));
+	ck_assert (cc_oci_asset_registered (registry, &asset));
+	json_object_unref (registry);
+
+	/* a changed asset is recorded again */
+	ck_assert (g_file_set_contents (config.vm->image_path,
+				"new image", -1, NULL));
+	ck_assert (cc_oci_asset_get (config.vm->image_path, &asset));
+
+	registry = cc_oci_assets_load (path);
+	ck_assert (! cc_oci_asset_registered (registry, &asset));
+	json_object_unref (registry);
+
+	ck_assert (cc_oci_assets_prewarm (&config, false));
+
+	registry = cc_oci_assets_load (path);
+	ck_assert (cc_oci_asset_registered (registry, &asset));
+	json_object_unref (registry);
+
+	ck_assert (cc_oci_assets_prewarm (&config, true));
+
+	/* an invalid registry is ignored */
+	ck_assert (g_file_set_contents (path, "[", -1, NULL));
+	registry = cc_oci_assets_load (path);
+	ck_assert (! json_object_get_size (registry));
+	json_object_unref (registry);
+
+	ck_assert (cc_oci_assets_prewarm (&config, false));
+
+	/* an unset asset is reported */
+	g_free (config.vm->kernel_path);
+	config.vm->kernel_path = NULL;
+	ck_assert (! cc_oci_assets_prewarm (&config, false));
+	config.vm->kernel_path = g_strdup_printf ("%s/kernel", tmpdir);
+
+	ck_assert (! g_remove (path));
+	ck_assert (! g_remove (config.vm->hypervisor_path));
+	ck_assert (! g_remove (config.vm->kernel_path));
+	ck_assert (! g_remove (config.vm->image_path));
+	ck_assert (! g_remove (tmpdir));
+
+	cc_oci_config_free (&config);
+} END_TEST
+
+Suite* make_assets_suite(void) {
+	Suite* s = suite_create(__FILE__);
+
+	ADD_TEST(test_cc_oci_asset_get, s);
+	ADD_TEST(test_cc_oci_asset_resident, s);
+	ADD_TEST(test_cc_oci_asset_registered, s);
+	ADD_TEST(test_cc_oci_assets_prewarm, s);
+
+	return s;
+}
+
+int main (void) {
+	int number_failed;
+	Suite* s;
+	SRunner* sr;
+
+	s = make_assets_suite();
+	sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_VERBOSE);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
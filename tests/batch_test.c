@@ -0,0 +1,369 @@
+/*
+ * This file is part of cc-oci-runtime.
+ *
+ * Copyright (C) 2016 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+
+#include <check.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "test_common.h"
+#include "../src/logging.h"
+#include "../src/oci.h"
+#include "../src/annotation.h"
+#include "../src/batch.h"
+
+gboolean cc_oci_batch_annotation_match (GSList *annotations,
+		const gchar *spec);
+
+static struct oci_cfg_annotation *
+make_annotation (const gchar *key, const gchar *value)
+{
+	struct oci_cfg_annotation *a;
+
+	a = g_new0 (struct oci_cfg_annotation, 1);
+	a->key = g_strdup (key);
+	a->value = g_strdup (value);
+
+	return a;
+}
+
+START_TEST(test_cc_oci_batch_annotation_match) {
+	GSList *annotations = NULL;
+
+	ck_assert (! cc_oci_batch_annotation_match (NULL, "role"));
+
+	annotations = g_slist_append (annotations,
+			make_annotation ("role", "web"));
+	annotations = g_slist_append (annotations,
+			make_annotation ("tier", ""));
+
+	ck_assert (cc_oci_batch_annotation_match (annotations, "role"));
+	ck_assert (cc_oci_batch_annotation_match (annotations, "role=web"));
+	ck_assert (! cc_oci_batch_annotation_match (annotations, "role=db"));
+	ck_assert (! cc_oci_batch_annotation_match (annotations, "role="));
+	ck_assert (! cc_oci_batch_annotation_match (annotations, "rol"));
+	ck_assert (! cc_oci_batch_annotation_match (annotations, "roles"));
+	ck_assert (cc_oci_batch_annotation_match (annotations, "tier"));
+	ck_assert (cc_oci_batch_annotation_match (annotations, "tier="));
+
+	cc_oci_annotations_free_all (annotations);
+} END_TEST
+
+/* Check ids holds exactly the NULL-terminated list of expected ids */
+static gboolean
+check_ids (GSList *ids, const gchar *expected[])
+{
+	GSList *l = ids;
+
+	for (; *expected; expected++, l = g_slist_next (l)) {
+		if (! l || g_strcmp0 (l->data, *expected)) {
+			return false;
+		}
+	}
+
+	return l == NULL;
+}
+
+START_TEST(test_cc_oci_batch_state_match) {
+	struct oci_state              state = { 0 };
+	struct cc_oci_batch_selector  selector = { 0 };
+
+	selector.status = OCI_STATUS_INVALID;
+	state.status = OCI_STATUS_RUNNING;
+	ck_assert (cc_oci_batch_state_match (&state, &selector));
+
+	/* our pid */
+	state.pid = getpid ();
+
+	selector.status = OCI_STATUS_RUNNING;
+	ck_assert (cc_oci_batch_state_match (&state, &selector));
+
+	selector.status = OCI_STATUS_STOPPED;
+	ck_assert (! cc_oci_batch_state_match (&state, &selector));
+
+	/* a VM that has exited is stopped, as "list" shows it */
+	state.pid = (pid_t)INT_MAX;
+
+	selector.status = OCI_STATUS_RUNNING;
+	ck_assert (! cc_oci_batch_state_match (&state, &selector));
+
+	selector.status = OCI_STATUS_STOPPED;
+	ck_assert (cc_oci_batch_state_match (&state, &selector));
+} END_TEST
+
+START_TEST(test_cc_oci_batch_select) {
+	struct cc_oci_config          vm1_config = { { 0 } };
+	struct cc_oci_config          vm2_config = { { 0 } };
+	struct cc_oci_config          vm3_config = { { 0 } };
+	struct cc_oci_batch_selector  selector = { 0 };
+	gchar                        *tmpdir;
+	gchar                        *missing;
+	gchar                        *bad_dir;
+	gchar                        *bad_state;
+	gchar                        *empty_dir;
+	gchar                        *annotations[3] = { NULL };
+	GSList                       *ids;
+
+	selector.status = OCI_STATUS_INVALID;
+
+	ck_assert (! cc_oci_batch_select (NULL, NULL));
+
+	tmpdir = g_dir_make_tmp (NULL, NULL);
+	ck_assert (tmpdir);
+
+	/* no containers */
+	missing = g_build_path ("/", tmpdir, "does-not-exist", NULL);
+	selector.all = true;
+	ck_assert (! cc_oci_batch_select (missing, &selector));
+	ck_assert (! cc_oci_batch_select (tmpdir, &selector));
+
+	/* created, role=db */
+	vm1_config.state.status = OCI_STATUS_CREATED;
+	vm1_config.oci.annotations = g_slist_append (NULL,
+			make_annotation ("role", "db"));
+	ck_assert (test_helper_create_state_file ("vm1", tmpdir,
+				&vm1_config));
+
+	/* running, role=web */
+	vm2_config.state.status = OCI_STATUS_RUNNING;
+	vm2_config.oci.annotations = g_slist_append (NULL,
+			make_annotation ("role", "web"));
+	ck_assert (test_helper_create_state_file ("vm2", tmpdir,
+				&vm2_config));
+
+	/* running, no annotations */
+	vm3_config.state.status = OCI_STATUS_RUNNING;
+	ck_assert (test_helper_create_state_file ("vm3", tmpdir,
+				&vm3_config));
+
+	ids = cc_oci_batch_select (tmpdir, &selector);
+	ck_assert (check_ids (ids, (const gchar *[]){ "vm1", "vm2", "vm3", NULL }));
+	g_slist_free_full (ids, g_free);
+
+	selector.all = false;
+	selector.status = OCI_STATUS_RUNNING;
+	ids = cc_oci_batch_select (tmpdir, &selector);
+	ck_assert (check_ids (ids, (const gchar *[]){ "vm2", "vm3", NULL }));
+	g_slist_free_full (ids, g_free);
+
+	selector.status = OCI_STATUS_PAUSED;
+	ck_assert (! cc_oci_batch_select (tmpdir, &selector));
+
+	selector.status = OCI_STATUS_INVALID;
+	selector.annotations = annotations;
+	annotations[0] = "role";
+	ids = cc_oci_batch_select (tmpdir, &selector);
+	ck_assert (check_ids (ids, (const gchar *[]){ "vm1", "vm2", NULL }));
+	g_slist_free_full (ids, g_free);
+
+	annotations[0] = "role=web";
+	ids = cc_oci_batch_select (tmpdir, &selector);
+	ck_assert (check_ids (ids, (const gchar *[]){ "vm2", NULL }));
+	g_slist_free_full (ids, g_free);
+
+	/* all criteria must match */
+	selector.status = OCI_STATUS_CREATED;
+	ck_assert (! cc_oci_batch_select (tmpdir, &selector));
+
+	annotations[0] = "role";
+	annotations[1] = "role=db";
+	ids = cc_oci_batch_select (tmpdir, &selector);
+	ck_assert (check_ids (ids, (const gchar *[]){ "vm1", NULL }));
+	g_slist_free_full (ids, g_free);
+
+	/* id prefix */
+	selector.status = OCI_STATUS_INVALID;
+	selector.annotations = NULL;
+	ck_assert (! cc_oci_batch_selector_needs_state (&selector));
+
+	selector.id_prefix = "vm";
+	ids = cc_oci_batch_select (tmpdir, &selector);
+	ck_assert (check_ids (ids, (const gchar *[]){ "vm1", "vm2", "vm3", NULL }));
+	g_slist_free_full (ids, g_free);
+
+	selector.id_prefix = "vm2";
+	ids = cc_oci_batch_select (tmpdir, &selector);
+	ck_assert (check_ids (ids, (const gchar *[]){ "vm2", NULL }));
+	g_slist_free_full (ids, g_free);
+
+	selector.id_prefix = "vm4";
+	ck_assert (! cc_oci_batch_select (tmpdir, &selector));
+
+	selector.id_prefix = "vm";
+	selector.status = OCI_STATUS_RUNNING;
+	ck_assert (cc_oci_batch_selector_needs_state (&selector));
+	ids = cc_oci_batch_select (tmpdir, &selector);
+	ck_assert (check_ids (ids, (const gchar *[]){ "vm2", "vm3", NULL }));
+	g_slist_free_full (ids, g_free);
+
+	/* state is only read when filtering on it */
+	bad_dir = g_build_path ("/", tmpdir, "vm-bad", NULL);
+	ck_assert (! g_mkdir (bad_dir, 0750));
+	empty_dir = g_build_path ("/", tmpdir, "vm-empty", NULL);
+	ck_assert (! g_mkdir (empty_dir, 0750));
+	bad_state = g_build_path ("/", bad_dir, CC_OCI_STATE_FILE, NULL);
+	ck_assert (g_file_set_contents (bad_state, "{", -1, NULL));
+
+	ck_assert (cc_oci_batch_state_exists (tmpdir, "vm-bad"));
+	ck_assert (! cc_oci_batch_state_exists (tmpdir, "vm-empty"));
+
+	ids = cc_oci_batch_select (tmpdir, &selector);
+	ck_assert (check_ids (ids, (const gchar *[]){ "vm2", "vm3", NULL }));
+	g_slist_free_full (ids, g_free);
+
+	selector.status = OCI_STATUS_INVALID;
+	ids = cc_oci_batch_select (tmpdir, &selector);
+	ck_assert (check_ids (ids, (const gchar *[]){ "vm-bad", "vm1",
+				"vm2", "vm3", NULL }));
+	g_slist_free_full (ids, g_free);
+
+	ck_assert (! g_remove (bad_state));
+	ck_assert (! g_remove (bad_dir));
+	ck_assert (! g_remove (empty_dir));
+	g_free (bad_state);
+	g_free (bad_dir);
+	g_free (empty_dir);
+
+	/* clean up */
+	ck_assert (! g_remove (vm1_config.state.state_file_path));
+	ck_assert (! g_remove (vm1_config.state.runtime_path));
+	ck_assert (! g_remove (vm2_config.state.state_file_path));
+	ck_assert (! g_remove (vm2_config.state.runtime_path));
+	ck_assert (! g_remove (vm3_config.state.state_file_path));
+	ck_assert (! g_remove (vm3_config.state.runtime_path));
+	ck_assert (! g_remove (tmpdir));
+
+	cc_oci_config_free (&vm1_config);
+	cc_oci_config_free (&vm2_config);
+	cc_oci_config_free (&vm3_config);
+	g_free (missing);
+	g_free (tmpdir);
+} END_TEST
+
+/* Batch operation creating a file named after the container in the
+ * directory passed as user_data, failing for container "fail".
+ */
+static gboolean
+touch_container (struct cc_oci_config *config, gpointer user_data)
+{
+	gchar     *path;
+	gboolean   ret;
+
+	if (! g_strcmp0 (config->optarg_container_id, "fail")) {
+		return false;
+	}
+
+	path = g_build_path ("/", (const gchar *)user_data,
+			config->optarg_container_id, NULL);
+	ret = g_file_set_contents (path, "", -1, NULL);
+	g_free (path);
+
+	return ret;
+}
+
+START_TEST(test_cc_oci_batch_run) {
+	struct cc_oci_config   config = { { 0 } };
+	GSList                *ids = NULL;
+	gchar                 *tmpdir;
+	const gchar           *names[] = { "a", "b", "c", "d", "e" };
+
+	tmpdir = g_dir_make_tmp (NULL, NULL);
+	ck_assert (tmpdir);
+
+	for (gsize i = 0; i < G_N_ELEMENTS (names); i++) {
+		ids = g_slist_append (ids, g_strdup (names[i]));
+	}
+
+	ck_assert (! cc_oci_batch_run (NULL, ids, 2, touch_container, tmpdir));
+	ck_assert (! cc_oci_batch_run (&config, ids, 2, NULL, tmpdir));
+
+	/* nothing to do */
+	ck_assert (cc_oci_batch_run (&config, NULL, 2, touch_container,
+				tmpdir));
+
+	/* more containers than jobs */
+	ck_assert (cc_oci_batch_run (&config, ids, 2, touch_container,
+				tmpdir));
+
+	for (gsize i = 0; i < G_N_ELEMENTS (names); i++) {
+		gchar *path = g_build_path ("/", tmpdir, names[i], NULL);
+		ck_assert (g_file_test (path, G_FILE_TEST_EXISTS));
+		ck_assert (! g_remove (path));
+		g_free (path);
+	}
+
+	/* a failure doesn't prevent the other containers from being
+	 * handled, but is reported.
+	 */
+	ids = g_slist_insert (ids, g_strdup ("fail"), 1);
+	ck_assert (! cc_oci_batch_run (&config, ids, 0, touch_container,
+				tmpdir));
+
+	for (gsize i = 0; i < G_N_ELEMENTS (names); i++) {
+		gchar *path = g_build_path ("/", tmpdir, names[i], NULL);
+		ck_assert (g_file_test (path, G_FILE_TEST_EXISTS));
+		ck_assert (! g_remove (path));
+		g_free (path);
+	}
+
+	ck_assert (! g_remove (tmpdir));
+
+	g_slist_free_full (ids, g_free);
+	g_free (tmpdir);
+} END_TEST
+
+Suite* make_batch_suite(void) {
+	Suite* s = suite_create(__FILE__);
+
+	ADD_TEST(test_cc_oci_batch_annotation_match, s);
+	ADD_TEST(test_cc_oci_batch_state_match, s);
+	ADD_TEST(test_cc_oci_batch_select, s);
+	ADD_TEST(test_cc_oci_batch_run, s);
+
+	return s;
+}
+
+int main(void) {
+	int number_failed;
+	Suite* s;
+	SRunner* sr;
+	struct cc_log_options options = { 0 };
+
+	options.enable_debug = true;
+	options.use_json = false;
+	options.filename = g_strdup ("batch_test_debug.log");
+	(void)cc_oci_log_init(&options);
+
+	s = make_batch_suite();
+	sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_VERBOSE);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	cc_oci_log_free (&options);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
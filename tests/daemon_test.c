@@ -0,0 +1,315 @@
+/*
+ * This file is part of cc-oci-runtime.
+ *
+ * Copyright (C) 2016 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include <check.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "test_common.h"
+#include "../src/logging.h"
+#include "../src/daemon.h"
+
+struct cc_oci_daemon_request {
+	gchar   *cwd;
+	gint     argc;
+	gchar  **argv;
+	gchar  **envp;
+	int      fds[3];
+};
+
+GByteArray *cc_oci_daemon_request_encode (int argc, char **argv,
+		const gchar *cwd, char **envp);
+gboolean cc_oci_daemon_request_decode (const guint8 *data, gsize len,
+		struct cc_oci_daemon_request *request);
+void cc_oci_daemon_request_free (struct cc_oci_daemon_request *request);
+gboolean cc_oci_daemon_state_args (int argc, char **argv,
+		const gchar **root_dir, const gchar **container_id);
+void cc_oci_daemon_state_free (gpointer p);
+const gchar *cc_oci_daemon_state_get (GHashTable *states,
+		const gchar *path, gsize *length);
+
+START_TEST(test_cc_oci_daemon_request) {
+	struct cc_oci_daemon_request  request = { 0 };
+	GByteArray                   *encoded;
+	guint32                       len;
+	char                         *argv[] = { "cc-oci-runtime", "state", "foo" };
+	char                         *envp[] = { "A=1", "B=", NULL };
+
+	request.fds[0] = request.fds[1] = request.fds[2] = -1;
+
+	encoded = cc_oci_daemon_request_encode (3, argv, "/tmp", envp);
+	ck_assert (encoded);
+
+	memcpy (&len, encoded->data, sizeof (len));
+	ck_assert (ntohl (len) == encoded->len - sizeof (len));
+
+	ck_assert (cc_oci_daemon_request_decode (encoded->data + sizeof (len),
+				encoded->len - sizeof (len), &request));
+
+	ck_assert_str_eq (request.cwd, "/tmp");
+	ck_assert (request.argc == 3);
+	ck_assert_str_eq (request.argv[0], "cc-oci-runtime");
+	ck_assert_str_eq (request.argv[1], "state");
+	ck_assert_str_eq (request.argv[2], "foo");
+	ck_assert (! request.argv[3]);
+	ck_assert_str_eq (request.envp[0], "A=1");
+	ck_assert_str_eq (request.envp[1], "B=");
+	ck_assert (! request.envp[2]);
+
+	cc_oci_daemon_request_free (&request);
+
+	/* truncated */
+	ck_assert (! cc_oci_daemon_request_decode (encoded->data + sizeof (len),
+				encoded->len - sizeof (len) - 1, &request));
+	ck_assert (! cc_oci_daemon_request_decode (encoded->data + sizeof (len),
+				3, &request));
+
+	g_byte_array_free (encoded, true);
+
+	/* more arguments announced than sent */
+	encoded = cc_oci_daemon_request_encode (3, argv, "/tmp", NULL);
+	encoded->data[sizeof (len) + 3] = 4;
+	ck_assert (! cc_oci_daemon_request_decode (encoded->data + sizeof (len),
+				encoded->len - sizeof (len), &request));
+	g_byte_array_free (encoded, true);
+} END_TEST
+
+START_TEST(test_cc_oci_daemon_state_args) {
+	const gchar  *root_dir;
+	const gchar  *id;
+	char         *plain[] = { "cor", "state", "foo" };
+	char         *root[] = { "cor", "--root", "/r", "state", "foo" };
+	char         *root_eq[] = { "cor", "--root=/r", "state", "foo" };
+	char         *debug[] = { "cor", "--debug", "state", "foo" };
+	char         *help[] = { "cor", "state", "--help" };
+	char         *path[] = { "cor", "state", "../foo" };
+	char         *dots[] = { "cor", "state", ".." };
+	char         *list[] = { "cor", "list" };
+	char         *extra[] = { "cor", "state", "foo", "bar" };
+
+	ck_assert (cc_oci_daemon_state_args (3, plain, &root_dir, &id));
+	ck_assert (! root_dir);
+	ck_assert_str_eq (id, "foo");
+
+	ck_assert (cc_oci_daemon_state_args (5, root, &root_dir, &id));
+	ck_assert_str_eq (root_dir, "/r");
+	ck_assert_str_eq (id, "foo");
+
+	ck_assert (cc_oci_daemon_state_args (4, root_eq, &root_dir, &id));
+	ck_assert_str_eq (root_dir, "/r");
+	ck_assert_str_eq (id, "foo");
+
+	/* left to a worker */
+	ck_assert (! cc_oci_daemon_state_args (4, debug, &root_dir, &id));
+	ck_assert (! cc_oci_daemon_state_args (3, help, &root_dir, &id));
+	ck_assert (! cc_oci_daemon_state_args (3, path, &root_dir, &id));
+	ck_assert (! cc_oci_daemon_state_args (3, dots, &root_dir, &id));
+	ck_assert (! cc_oci_daemon_state_args (2, list, &root_dir, &id));
+	ck_assert (! cc_oci_daemon_state_args (4, extra, &root_dir, &id));
+} END_TEST
+
+START_TEST(test_cc_oci_daemon_state_get) {
+	GHashTable   *states;
+	const gchar  *contents;
+	gchar        *tmpdir;
+	gchar        *path;
+	gsize         length = 0;
+
+	tmpdir = g_dir_make_tmp (NULL, NULL);
+	ck_assert (tmpdir);
+
+	path = g_build_path ("/", tmpdir, "state.json", NULL);
+
+	states = g_hash_table_new_full (g_str_hash, g_str_equal,
+			g_free, cc_oci_daemon_state_free);
+
+	ck_assert (! cc_oci_daemon_state_get (states, path, &length));
+
+	/* not JSON */
+	ck_assert (g_file_set_contents (path, "{", -1, NULL));
+	ck_assert (! cc_oci_daemon_state_get (states, path, &length));
+
+	ck_assert (g_file_set_contents (path, "{\"a\":1}", -1, NULL));
+
+	/* formatted like "state" shows it */
+	contents = cc_oci_daemon_state_get (states, path, &length);
+	ck_assert (contents);
+	ck_assert (strstr (contents, "\"a\" : 1"));
+	ck_assert (length == strlen (contents));
+
+	/* unchanged file, served from the cache */
+	ck_assert (cc_oci_daemon_state_get (states, path, &length)
+			== contents);
+
+	/* replaced file */
+	ck_assert (g_file_set_contents (path, "{\"a\":22}", -1, NULL));
+	contents = cc_oci_daemon_state_get (states, path, &length);
+	ck_assert (contents);
+	ck_assert (strstr (contents, "\"a\" : 22"));
+
+	/* removed file */
+	ck_assert (! g_remove (path));
+	ck_assert (! cc_oci_daemon_state_get (states, path, &length));
+	ck_assert (g_hash_table_size (states) == 0);
+
+	ck_assert (! g_remove (tmpdir));
+
+	g_hash_table_destroy (states);
+	g_free (path);
+	g_free (tmpdir);
+} END_TEST
+
+static int
+test_handler (int argc, char **argv)
+{
+	return (argc == 3 && ! g_strcmp0 (argv[2], "ok")
+			&& ! g_strcmp0 (g_getenv ("CC_OCI_DAEMON_TEST"), "1"))
+		? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+START_TEST(test_cc_oci_daemon_forward) {
+	gchar     *tmpdir;
+	gchar     *socket_path;
+	gchar     *state_dir;
+	gchar     *state_file;
+	gboolean   result = true;
+	pid_t      pid;
+	int        status;
+	int        i;
+	char      *ok[] = { "cor", "test", "ok" };
+	char      *bad[] = { "cor", "test", "bad" };
+	char      *state[] = { "cor", "--root", NULL, "state", "foo" };
+
+	tmpdir = g_dir_make_tmp (NULL, NULL);
+	ck_assert (tmpdir);
+
+	socket_path = g_build_path ("/", tmpdir, "daemon.sock", NULL);
+	state_dir = g_build_path ("/", tmpdir, "foo", NULL);
+	state_file = g_build_path ("/", state_dir, "state.json", NULL);
+	state[2] = tmpdir;
+
+	/* disabled */
+	ck_assert (g_setenv (CC_OCI_DAEMON_SOCKET_ENV, "", true));
+	ck_assert (! cc_oci_daemon_forward (3, ok, &result));
+
+	/* no daemon running */
+	ck_assert (g_setenv (CC_OCI_DAEMON_SOCKET_ENV, socket_path, true));
+	ck_assert (! cc_oci_daemon_forward (3, ok, &result));
+
+	pid = fork ();
+	ck_assert (pid >= 0);
+	if (! pid) {
+		_exit (cc_oci_daemon_run (socket_path, test_handler)
+				? EXIT_SUCCESS : EXIT_FAILURE);
+	}
+
+	for (i = 0; i < 500; i++) {
+		if (g_file_test (socket_path, G_FILE_TEST_EXISTS)) {
+			break;
+		}
+		g_usleep (10000);
+	}
+
+	/* handled by a worker, with our environment */
+	ck_assert (g_setenv ("CC_OCI_DAEMON_TEST", "1", true));
+	ck_assert (cc_oci_daemon_forward (3, ok, &result));
+	ck_assert (result);
+
+	ck_assert (cc_oci_daemon_forward (3, bad, &result));
+	ck_assert (! result);
+
+	ck_assert (g_setenv ("CC_OCI_DAEMON_TEST", "0", true));
+	ck_assert (cc_oci_daemon_forward (3, ok, &result));
+	ck_assert (! result);
+
+	/* unknown container, left to a worker */
+	ck_assert (cc_oci_daemon_forward (5, state, &result));
+	ck_assert (! result);
+
+	/* answered by the daemon */
+	ck_assert (! g_mkdir (state_dir, 0750));
+	ck_assert (g_file_set_contents (state_file, "{}", -1, NULL));
+	ck_assert (cc_oci_daemon_forward (5, state, &result));
+	ck_assert (result);
+
+	ck_assert (! kill (pid, SIGTERM));
+	ck_assert (waitpid (pid, &status, 0) == pid);
+	ck_assert (WIFEXITED (status));
+	ck_assert (WEXITSTATUS (status) == EXIT_SUCCESS);
+
+	/* socket removed */
+	ck_assert (! g_file_test (socket_path, G_FILE_TEST_EXISTS));
+	ck_assert (! cc_oci_daemon_forward (3, ok, &result));
+
+	g_unsetenv (CC_OCI_DAEMON_SOCKET_ENV);
+	g_unsetenv ("CC_OCI_DAEMON_TEST");
+
+	ck_assert (! g_remove (state_file));
+	ck_assert (! g_remove (state_dir));
+	ck_assert (! g_remove (tmpdir));
+
+	g_free (state_file);
+	g_free (state_dir);
+	g_free (socket_path);
+	g_free (tmpdir);
+} END_TEST
+
+Suite* make_daemon_suite(void) {
+	Suite* s = suite_create(__FILE__);
+
+	ADD_TEST(test_cc_oci_daemon_request, s);
+	ADD_TEST(test_cc_oci_daemon_state_args, s);
+	ADD_TEST(test_cc_oci_daemon_state_get, s);
+	ADD_TEST(test_cc_oci_daemon_forward, s);
+
+	return s;
+}
+
+int main(void) {
+	int number_failed;
+	Suite* s;
+	SRunner* sr;
+	struct cc_log_options options = { 0 };
+
+	options.enable_debug = true;
+	options.use_json = false;
+	options.filename = g_strdup ("daemon_test_debug.log");
+	(void)cc_oci_log_init(&options);
+
+	s = make_daemon_suite();
+	sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_VERBOSE);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	cc_oci_log_free (&options);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
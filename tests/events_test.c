@@ -0,0 +1,97 @@
+/*
+ * This file is part of cc-oci-runtime.
+ *
+ * Copyright (C) 2016 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include <check.h>
+#include <glib.h>
+
+#include "test_common.h"
+#include "../src/logging.h"
+#include "../src/oci.h"
+#include "../src/events.h"
+
+const gchar *container_status_event (enum oci_status from,
+		enum oci_status to);
+
+START_TEST(test_container_status_event) {
+	ck_assert (! container_status_event (OCI_STATUS_INVALID,
+				OCI_STATUS_INVALID));
+
+	/* no change */
+	ck_assert (! container_status_event (OCI_STATUS_CREATED,
+				OCI_STATUS_CREATED));
+	ck_assert (! container_status_event (OCI_STATUS_RUNNING,
+				OCI_STATUS_RUNNING));
+
+	ck_assert (! g_strcmp0 (container_status_event (OCI_STATUS_INVALID,
+					OCI_STATUS_CREATED), "create"));
+	ck_assert (! g_strcmp0 (container_status_event (OCI_STATUS_CREATED,
+					OCI_STATUS_RUNNING), "start"));
+	ck_assert (! g_strcmp0 (container_status_event (OCI_STATUS_RUNNING,
+					OCI_STATUS_PAUSED), "pause"));
+	ck_assert (! g_strcmp0 (container_status_event (OCI_STATUS_PAUSED,
+					OCI_STATUS_RUNNING), "resume"));
+	ck_assert (! g_strcmp0 (container_status_event (OCI_STATUS_RUNNING,
+					OCI_STATUS_STOPPED), "stop"));
+	ck_assert (! g_strcmp0 (container_status_event (OCI_STATUS_PAUSED,
+					OCI_STATUS_STOPPED), "stop"));
+
+	/* a container first seen running was started */
+	ck_assert (! g_strcmp0 (container_status_event (OCI_STATUS_INVALID,
+					OCI_STATUS_RUNNING), "start"));
+} END_TEST
+
+START_TEST(test_show_all_container_events) {
+	ck_assert (! show_all_container_events (NULL));
+} END_TEST
+
+Suite* make_events_suite(void) {
+	Suite* s = suite_create(__FILE__);
+
+	ADD_TEST(test_container_status_event, s);
+	ADD_TEST(test_show_all_container_events, s);
+
+	return s;
+}
+
+int main (void) {
+	int number_failed;
+	Suite* s;
+	SRunner* sr;
+	struct cc_log_options options = { 0 };
+
+	options.enable_debug = true;
+	options.use_json = false;
+	options.filename = g_strdup ("events_test_debug.log");
+	(void)cc_oci_log_init(&options);
+
+	s = make_events_suite();
+	sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_VERBOSE);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	cc_oci_log_free (&options);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,731 @@
+/*
+ * This file is part of cc-oci-runtime.
+ *
+ * Copyright (C) 2016 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#include <check.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+
+#include "test_common.h"
+#include "../src/logging.h"
+#include "../src/json.h"
+#include "../src/util.h"
+#include "../src/oci.h"
+#include "../src/hyperstart.h"
+
+void cc_oci_hyper_ctl_header_set (guint8 *buf, guint32 cmd, guint32 len);
+void cc_oci_hyper_tty_header_set (guint8 *buf, guint64 seq, guint32 len);
+guint32 cc_oci_hyper_get_be32 (const guint8 *buf);
+guint64 cc_oci_hyper_get_be64 (const guint8 *buf);
+gchar *cc_oci_hyper_exec_cmd_new (const gchar *container_id,
+		const struct oci_cfg_process *process,
+		guint64 stdio_seq, guint64 stderr_seq,
+		gboolean terminal, int argc, char *const argv[]);
+gchar *cc_oci_hyper_ps_cmd_new (const gchar *container_id,
+		const gchar *format, int argc, char *const argv[]);
+gchar *cc_oci_hyper_startpod_cmd_new (const gchar *container_id,
+		const gchar *hostname,
+		guint64 stdio_seq, guint64 stderr_seq,
+		gboolean terminal, gchar **env);
+
+/*
+ * Create a connected socket pair, returning the local end as a
+ * GSocket and the peer as a file descriptor.
+ */
+static GSocket *
+make_socket_pair (int *peer)
+{
+	int      fds[2];
+	GSocket *socket;
+
+	if (socketpair (AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+		return NULL;
+	}
+
+	socket = g_socket_new_from_fd (fds[0], NULL);
+	if (! socket) {
+		close (fds[0]);
+		close (fds[1]);
+		return NULL;
+	}
+
+	*peer = fds[1];
+
+	return socket;
+}
+
+/* Write a control message to fd, as the agent would. */
+static gboolean
+write_ctl_msg (int fd, guint32 code, const gchar *payload)
+{
+	guint8  header[CC_OCI_HYPER_CTL_HEADER_SIZE];
+	gsize   len = payload ? strlen (payload) : 0;
+
+	cc_oci_hyper_ctl_header_set (header, code,
+			(guint32)(sizeof (header) + len));
+
+	if (write (fd, header, sizeof (header)) != sizeof (header)) {
+		return false;
+	}
+
+	if (len && write (fd, payload, len) != (ssize_t)len) {
+		return false;
+	}
+
+	return true;
+}
+
+START_TEST(test_cc_oci_hyper_headers) {
+	guint8 buf[CC_OCI_HYPER_TTY_HEADER_SIZE];
+	const guint8 ctl_expected[] = {
+		0x00, 0x00, 0x00, 0x06,
+		0x00, 0x00, 0x00, 0x20
+	};
+	const guint8 tty_expected[] = {
+		0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08,
+		0x00, 0x00, 0x01, 0x00
+	};
+
+	cc_oci_hyper_ctl_header_set (buf, CC_OCI_HYPER_EXECCMD, 32);
+	ck_assert (! memcmp (buf, ctl_expected, sizeof (ctl_expected)));
+	ck_assert (cc_oci_hyper_get_be32 (buf) == CC_OCI_HYPER_EXECCMD);
+	ck_assert (cc_oci_hyper_get_be32 (buf + 4) == 32);
+
+	cc_oci_hyper_tty_header_set (buf, 0x0102030405060708ULL, 256);
+	ck_assert (! memcmp (buf, tty_expected, sizeof (tty_expected)));
+	ck_assert (cc_oci_hyper_get_be64 (buf) == 0x0102030405060708ULL);
+	ck_assert (cc_oci_hyper_get_be32 (buf + 8) == 256);
+} END_TEST
+
+START_TEST(test_cc_oci_hyper_exec_cmd_new) {
+	struct oci_cfg_process  process = { 0 };
+	gchar                  *str;
+	GNode                  *root = NULL;
+	GNode                  *node;
+	GNode                  *envs;
+	char                   *argv[] = { "echo", "hello", NULL };
+	gchar                  *env[] = { "FOO=bar", "TERM=vt100", NULL };
+
+	ck_assert (! cc_oci_hyper_exec_cmd_new (NULL, &process,
+				1, 2, false, 2, argv));
+	ck_assert (! cc_oci_hyper_exec_cmd_new ("foo", NULL,
+				1, 2, false, 2, argv));
+	ck_assert (! cc_oci_hyper_exec_cmd_new ("foo", &process,
+				1, 2, false, 0, argv));
+	ck_assert (! cc_oci_hyper_exec_cmd_new ("foo", &process,
+				1, 2, false, 2, NULL));
+
+	/* no environment or cwd */
+	str = cc_oci_hyper_exec_cmd_new ("foo", &process,
+			1, 2, false, 2, argv);
+	ck_assert (str);
+
+	ck_assert (cc_oci_json_parse_data (&root, str, -1));
+	ck_assert (root);
+
+	node = node_find_child (root, "container");
+	ck_assert (node);
+	ck_assert_str_eq (node->children->data, "foo");
+
+	node = node_find_child (root, "process");
+	ck_assert (node);
+
+	ck_assert_str_eq (node_find_child (node, "stdio")->children->data, "1");
+	ck_assert_str_eq (node_find_child (node, "stderr")->children->data, "2");
+	ck_assert_str_eq (node_find_child (node, "workdir")->children->data, "/");
+	ck_assert_str_eq (node_find_child (node, "user")->children->data, "0");
+	ck_assert_str_eq (node_find_child (node, "group")->children->data, "0");
+
+	envs = node_find_child (node, "envs");
+	ck_assert (envs);
+	ck_assert (g_node_n_children (envs) == 1);
+	ck_assert_str_eq (node_find_child (envs->children, "env")
+			->children->data, "PATH");
+
+	node = node_find_child (node, "args");
+	ck_assert (node);
+	ck_assert (g_node_n_children (node) == 2);
+	ck_assert_str_eq (g_node_nth_child (node, 0)->data, "echo");
+	ck_assert_str_eq (g_node_nth_child (node, 1)->data, "hello");
+
+	g_free_node (root);
+	g_free (str);
+
+	/* the container process environment, cwd and user */
+	process.env = env;
+	process.cwd = "/home/foo";
+	process.user.uid = 1000;
+	process.user.gid = 100;
+
+	str = cc_oci_hyper_exec_cmd_new ("foo", &process,
+			1, 0, true, 2, argv);
+	ck_assert (str);
+
+	ck_assert (cc_oci_json_parse_data (&root, str, -1));
+	ck_assert (root);
+
+	node = node_find_child (root, "process");
+	ck_assert (node);
+
+	ck_assert_str_eq (node_find_child (node, "workdir")->children->data,
+			"/home/foo");
+	ck_assert_str_eq (node_find_child (node, "user")->children->data,
+			"1000");
+	ck_assert_str_eq (node_find_child (node, "group")->children->data,
+			"100");
+
+	/* TERM is not overridden and PATH is added last */
+	envs = node_find_child (node, "envs");
+	ck_assert (envs);
+	ck_assert (g_node_n_children (envs) == 3);
+
+	node = g_node_nth_child (envs, 0);
+	ck_assert_str_eq (node_find_child (node, "env")->children->data,
+			"FOO");
+	ck_assert_str_eq (node_find_child (node, "value")->children->data,
+			"bar");
+
+	node = g_node_nth_child (envs, 1);
+	ck_assert_str_eq (node_find_child (node, "env")->children->data,
+			"TERM");
+	ck_assert_str_eq (node_find_child (node, "value")->children->data,
+			"vt100");
+
+	node = g_node_nth_child (envs, 2);
+	ck_assert_str_eq (node_find_child (node, "env")->children->data,
+			"PATH");
+
+	g_free_node (root);
+	g_free (str);
+} END_TEST
+
+START_TEST(test_cc_oci_hyper_ps_cmd_new) {
+	gchar  *str;
+	GNode  *root = NULL;
+	GNode  *node;
+	char   *argv[] = { "-ef", NULL };
+
+	ck_assert (! cc_oci_hyper_ps_cmd_new (NULL, "json", 0, NULL));
+	ck_assert (! cc_oci_hyper_ps_cmd_new ("foo", NULL, 0, NULL));
+	ck_assert (! cc_oci_hyper_ps_cmd_new ("foo", "table", 1, NULL));
+
+	str = cc_oci_hyper_ps_cmd_new ("foo", "table", 1, argv);
+	ck_assert (str);
+
+	ck_assert (cc_oci_json_parse_data (&root, str, -1));
+	ck_assert (root);
+
+	ck_assert_str_eq (node_find_child (root, "container")->children->data,
+			"foo");
+	ck_assert_str_eq (node_find_child (root, "format")->children->data,
+			"table");
+
+	node = node_find_child (root, "psargs");
+	ck_assert (node);
+	ck_assert (g_node_n_children (node) == 1);
+	ck_assert_str_eq (g_node_nth_child (node, 0)->data, "-ef");
+
+	g_free_node (root);
+	g_free (str);
+
+	/* no ps arguments */
+	str = cc_oci_hyper_ps_cmd_new ("foo", "json", 0, NULL);
+	ck_assert (str);
+
+	ck_assert (cc_oci_json_parse_data (&root, str, -1));
+	ck_assert (root);
+
+	node = node_find_child (root, "psargs");
+	ck_assert (node);
+	ck_assert (! node->children);
+
+	g_free_node (root);
+	g_free (str);
+} END_TEST
+
+START_TEST(test_cc_oci_hyper_startpod_cmd_new) {
+	gchar  *str;
+	GNode  *root = NULL;
+	GNode  *node;
+	GNode  *process;
+	gchar  *env[] = { "HOME=/root", "PATH=/bin", "bogus", "=x", NULL };
+
+	ck_assert (! cc_oci_hyper_startpod_cmd_new (NULL, "h", 1, 2,
+				false, NULL));
+
+	str = cc_oci_hyper_startpod_cmd_new ("foo", "myhost", 1, 2,
+			true, env);
+	ck_assert (str);
+
+	ck_assert (cc_oci_json_parse_data (&root, str, -1));
+	ck_assert (root);
+
+	ck_assert_str_eq (node_find_child (root, "hostname")->children->data,
+			"myhost");
+	ck_assert_str_eq (node_find_child (root, "shareDir")->children->data,
+			"rootfs");
+
+	node = node_find_child (root, "containers");
+	ck_assert (node);
+	ck_assert (g_node_n_children (node) == 1);
+
+	/* the anonymous container object */
+	node = g_node_nth_child (node, 0);
+	ck_assert (node);
+	ck_assert_str_eq (node_find_child (node, "id")->children->data,
+			"foo");
+
+	process = node_find_child (node, "process");
+	ck_assert (process);
+	ck_assert_str_eq (node_find_child (process, "stdio")->children->data,
+			"1");
+	ck_assert_str_eq (node_find_child (process, "stderr")->children->data,
+			"2");
+
+	node = node_find_child (process, "args");
+	ck_assert (node);
+	ck_assert (g_node_n_children (node) == 1);
+	ck_assert_str_eq (g_node_nth_child (node, 0)->data,
+			"/.containerexec");
+
+	/* invalid entries are skipped, PATH is not duplicated */
+	node = node_find_child (process, "envs");
+	ck_assert (node);
+	ck_assert (g_node_n_children (node) == 2);
+
+	g_free_node (root);
+	g_free (str);
+
+	/* no environment and no hostname */
+	str = cc_oci_hyper_startpod_cmd_new ("foo", NULL, 1, 2,
+			false, NULL);
+	ck_assert (str);
+
+	ck_assert (cc_oci_json_parse_data (&root, str, -1));
+	ck_assert (root);
+
+	ck_assert_str_eq (node_find_child (root, "hostname")->children->data,
+			"foo");
+
+	node = node_find_child (root, "containers");
+	node = node_find_child (g_node_nth_child (node, 0), "process");
+	node = node_find_child (node, "envs");
+	ck_assert (node);
+
+	/* default PATH */
+	ck_assert (g_node_n_children (node) == 1);
+
+	g_free_node (root);
+	g_free (str);
+} END_TEST
+
+START_TEST(test_cc_oci_hyper_ctl_cmd) {
+	struct cc_oci_hyper_conn  conn = { 0 };
+	GByteArray               *reply = NULL;
+	guint8                    header[CC_OCI_HYPER_CTL_HEADER_SIZE];
+	gchar                     payload[16] = { 0 };
+	int                       peer = -1;
+
+	ck_assert (! cc_oci_hyper_ctl_cmd (NULL, CC_OCI_HYPER_PING,
+				NULL, 0, NULL));
+	ck_assert (! cc_oci_hyper_ctl_cmd (&conn, CC_OCI_HYPER_PING,
+				NULL, 0, NULL));
+
+	conn.ctl = make_socket_pair (&peer);
+	ck_assert (conn.ctl);
+
+	/* NEXT and READY must be skipped before the ACK */
+	ck_assert (write_ctl_msg (peer, CC_OCI_HYPER_NEXT, "1234"));
+	ck_assert (write_ctl_msg (peer, CC_OCI_HYPER_READY, NULL));
+	ck_assert (write_ctl_msg (peer, CC_OCI_HYPER_ACK, "{}"));
+
+	ck_assert (cc_oci_hyper_ctl_cmd (&conn, CC_OCI_HYPER_PING,
+				"{\"a\":1}", 7, &reply));
+	ck_assert (reply);
+	ck_assert (reply->len == 2);
+	ck_assert (! memcmp (reply->data, "{}", 2));
+	g_byte_array_free (reply, true);
+
+	/* check what the agent received */
+	ck_assert (read (peer, header, sizeof (header)) == sizeof (header));
+	ck_assert (cc_oci_hyper_get_be32 (header) == CC_OCI_HYPER_PING);
+	ck_assert (cc_oci_hyper_get_be32 (header + 4) == sizeof (header) + 7);
+	ck_assert (read (peer, payload, 7) == 7);
+	ck_assert_str_eq (payload, "{\"a\":1}");
+
+	/* agent rejects the command */
+	ck_assert (write_ctl_msg (peer, CC_OCI_HYPER_ERROR, NULL));
+	reply = NULL;
+	ck_assert (! cc_oci_hyper_ctl_cmd (&conn, CC_OCI_HYPER_PING,
+				NULL, 0, &reply));
+	ck_assert (! reply);
+
+	/* too large */
+	ck_assert (! cc_oci_hyper_ctl_cmd (&conn, CC_OCI_HYPER_PING,
+				payload, CC_OCI_HYPER_MAX_MSG_SIZE, NULL));
+
+	/* agent went away */
+	close (peer);
+	ck_assert (! cc_oci_hyper_ctl_cmd (&conn, CC_OCI_HYPER_PING,
+				NULL, 0, NULL));
+
+	cc_oci_hyper_disconnect (&conn);
+	ck_assert (! conn.ctl);
+} END_TEST
+
+START_TEST(test_cc_oci_hyper_tty) {
+	struct cc_oci_hyper_conn  conn = { 0 };
+	struct cc_oci_hyper_conn  agent = { 0 };
+	GByteArray               *data = NULL;
+	guint64                   seq = 0;
+	int                       fds[2];
+
+	ck_assert (socketpair (AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+	conn.tty = g_socket_new_from_fd (fds[0], NULL);
+	agent.tty = g_socket_new_from_fd (fds[1], NULL);
+	ck_assert (conn.tty && agent.tty);
+
+	ck_assert (cc_oci_hyper_tty_send (&conn, 42,
+				(const guint8 *)"hello", 5));
+	ck_assert (cc_oci_hyper_tty_recv (&agent, &seq, &data));
+	ck_assert (seq == 42);
+	ck_assert (data->len == 5);
+	ck_assert (! memcmp (data->data, "hello", 5));
+	g_byte_array_free (data, true);
+
+	/* empty message closes the stream */
+	ck_assert (cc_oci_hyper_tty_send (&conn, 43, NULL, 0));
+	ck_assert (cc_oci_hyper_tty_recv (&agent, &seq, &data));
+	ck_assert (seq == 43);
+	ck_assert (data->len == 0);
+	g_byte_array_free (data, true);
+
+	cc_oci_hyper_disconnect (&conn);
+	cc_oci_hyper_disconnect (&agent);
+} END_TEST
+
+/* Create a listening unix socket at dir/name. */
+static int
+listen_unix (const gchar *dir, const gchar *name)
+{
+	struct sockaddr_un  addr = { 0 };
+	gchar              *path;
+	int                 fd;
+
+	fd = socket (AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0) {
+		return -1;
+	}
+
+	path = g_build_path ("/", dir, name, NULL);
+	addr.sun_family = AF_UNIX;
+	g_strlcpy (addr.sun_path, path, sizeof (addr.sun_path));
+	g_free (path);
+
+	if (bind (fd, (struct sockaddr *)&addr, sizeof (addr)) < 0 ||
+			listen (fd, 1) < 0) {
+		close (fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+static gboolean
+read_full (int fd, guint8 *buf, gsize len)
+{
+	ssize_t bytes;
+
+	while (len) {
+		bytes = read (fd, buf, len);
+		if (bytes <= 0) {
+			return false;
+		}
+		buf += bytes;
+		len -= (gsize)bytes;
+	}
+
+	return true;
+}
+
+/* Write a tty message to fd, as the agent would. */
+static gboolean
+write_tty_msg (int fd, guint64 seq, const gchar *data, gsize len)
+{
+	guint8  header[CC_OCI_HYPER_TTY_HEADER_SIZE];
+
+	cc_oci_hyper_tty_header_set (header, seq,
+			(guint32)(sizeof (header) + len));
+
+	if (write (fd, header, sizeof (header)) != sizeof (header)) {
+		return false;
+	}
+
+	if (len && write (fd, data, len) != (ssize_t)len) {
+		return false;
+	}
+
+	return true;
+}
+
+/* Extract the stdio sequence number of a STARTPOD or EXECCMD payload. */
+static guint64
+payload_stdio_seq (const gchar *payload)
+{
+	JsonParser  *parser;
+	JsonObject  *obj;
+	guint64      seq = 0;
+
+	parser = json_parser_new ();
+	if (! json_parser_load_from_data (parser, payload, -1, NULL)) {
+		goto out;
+	}
+
+	obj = json_node_get_object (json_parser_get_root (parser));
+	if (json_object_has_member (obj, "containers")) {
+		obj = json_array_get_object_element
+			(json_object_get_array_member (obj, "containers"), 0);
+	}
+
+	obj = json_object_get_object_member (obj, "process");
+	seq = (guint64)json_object_get_int_member (obj, "stdio");
+
+out:
+	g_object_unref (parser);
+
+	return seq;
+}
+
+/*
+ * Minimal agent: runs the workload until a command is executed
+ * alongside it, which outputs "hello" and exits 3. The workload then
+ * exits 0.
+ */
+static void
+fake_agent (int ctl_listen, int tty_listen)
+{
+	guint8   header[CC_OCI_HYPER_CTL_HEADER_SIZE];
+	gchar   *payload;
+	guint32  cmd;
+	guint32  len;
+	guint64  work_seq = 0;
+	guint64  exec_seq;
+	int      ctl;
+	int      tty;
+
+	ctl = accept (ctl_listen, NULL, NULL);
+	tty = accept (tty_listen, NULL, NULL);
+	if (ctl < 0 || tty < 0) {
+		_exit (EXIT_FAILURE);
+	}
+
+	while (read_full (ctl, header, sizeof (header))) {
+		cmd = cc_oci_hyper_get_be32 (header);
+		len = cc_oci_hyper_get_be32 (header + 4) - sizeof (header);
+
+		payload = g_malloc0 (len + 1);
+		if (! read_full (ctl, (guint8 *)payload, len)) {
+			_exit (EXIT_FAILURE);
+		}
+
+		switch (cmd) {
+		case CC_OCI_HYPER_STARTPOD:
+			work_seq = payload_stdio_seq (payload);
+			(void)write_ctl_msg (ctl, CC_OCI_HYPER_ACK, NULL);
+			break;
+
+		case CC_OCI_HYPER_EXECCMD:
+			exec_seq = payload_stdio_seq (payload);
+			(void)write_ctl_msg (ctl, CC_OCI_HYPER_ACK, NULL);
+
+			(void)write_tty_msg (tty, exec_seq, "hello\n", 6);
+			(void)write_tty_msg (tty, exec_seq, NULL, 0);
+			(void)write_tty_msg (tty, exec_seq, "\3", 1);
+
+			(void)write_tty_msg (tty, work_seq, "workload\n", 9);
+			(void)write_tty_msg (tty, work_seq, NULL, 0);
+			(void)write_tty_msg (tty, work_seq, "\0", 1);
+			break;
+
+		case CC_OCI_HYPER_DESTROYPOD:
+			(void)write_ctl_msg (ctl, CC_OCI_HYPER_ACK, NULL);
+			_exit (EXIT_SUCCESS);
+
+		default:
+			(void)write_ctl_msg (ctl, CC_OCI_HYPER_ERROR, NULL);
+			break;
+		}
+
+		g_free (payload);
+	}
+
+	_exit (EXIT_FAILURE);
+}
+
+START_TEST(test_cc_oci_hyper_exec_relay) {
+	struct cc_oci_config  config = { 0 };
+	struct cc_oci_vm_cfg  vm = { 0 };
+	GSocket              *relay;
+	gchar                *tmpdir;
+	gchar                *path;
+	gchar                *outfile = NULL;
+	gchar                *contents = NULL;
+	char                 *argv[] = { "echo", "hello" };
+	gint                  exit_code = -1;
+	gboolean              ret = false;
+	pid_t                 agent_pid;
+	pid_t                 relay_pid;
+	int                   ctl_listen;
+	int                   tty_listen;
+	int                   saved_stdin;
+	int                   null_fd;
+	int                   status;
+
+	tmpdir = g_dir_make_tmp (NULL, NULL);
+	ck_assert (tmpdir);
+
+	config.vm = &vm;
+	vm.boot = CC_OCI_VM_BOOT_AGENT;
+	vm.workload_path = g_build_path ("/", tmpdir, "workload", NULL);
+	config.state.runtime_path = g_strdup (tmpdir);
+	config.optarg_container_id = "foo";
+
+	ctl_listen = listen_unix (tmpdir, CC_OCI_AGENT_CTL_SOCKET);
+	tty_listen = listen_unix (tmpdir, CC_OCI_AGENT_TTY_SOCKET);
+	ck_assert (ctl_listen >= 0 && tty_listen >= 0);
+
+	agent_pid = fork ();
+	ck_assert (agent_pid >= 0);
+	if (! agent_pid) {
+		fake_agent (ctl_listen, tty_listen);
+	}
+
+	close (ctl_listen);
+	close (tty_listen);
+
+	null_fd = open ("/dev/null", O_RDWR);
+	ck_assert (null_fd >= 0);
+	saved_stdin = dup (STDIN_FILENO);
+	ck_assert (dup2 (null_fd, STDIN_FILENO) == STDIN_FILENO);
+
+	/* the workload relay holds both agent channels */
+	relay = cc_oci_hyper_relay_listen (tmpdir);
+	ck_assert (relay);
+
+	relay_pid = fork ();
+	ck_assert (relay_pid >= 0);
+	if (! relay_pid) {
+		(void)dup2 (null_fd, STDOUT_FILENO);
+		if (! cc_oci_hyper_run_workload (&config, false, relay,
+					&exit_code)) {
+			_exit (EXIT_FAILURE);
+		}
+		_exit (exit_code);
+	}
+
+	g_object_unref (relay);
+
+	/* so exec must go through the relay */
+	SAVE_OUTPUT (outfile) {
+		ret = cc_oci_hyper_exec (&config, 2, argv, &exit_code);
+	}
+
+	ck_assert (dup2 (saved_stdin, STDIN_FILENO) == STDIN_FILENO);
+	close (saved_stdin);
+	close (null_fd);
+
+	ck_assert (ret);
+	ck_assert (exit_code == 3);
+
+	ck_assert (g_file_get_contents (outfile, &contents, NULL, NULL));
+	ck_assert (strstr (contents, "hello"));
+	ck_assert (! strstr (contents, "workload"));
+
+	/* the workload ran to completion and the VM was destroyed */
+	ck_assert (waitpid (relay_pid, &status, 0) == relay_pid);
+	ck_assert (WIFEXITED (status) && WEXITSTATUS (status) == 0);
+	ck_assert (waitpid (agent_pid, &status, 0) == agent_pid);
+	ck_assert (WIFEXITED (status) && WEXITSTATUS (status) == 0);
+
+	path = g_build_path ("/", tmpdir, CC_OCI_AGENT_RELAY_SOCKET, NULL);
+	ck_assert (! g_file_test (path, G_FILE_TEST_EXISTS));
+	g_free (path);
+
+	path = g_build_path ("/", tmpdir, CC_OCI_AGENT_CTL_SOCKET, NULL);
+	ck_assert (! g_remove (path));
+	g_free (path);
+	path = g_build_path ("/", tmpdir, CC_OCI_AGENT_TTY_SOCKET, NULL);
+	ck_assert (! g_remove (path));
+	g_free (path);
+	ck_assert (! g_remove (tmpdir));
+
+	ck_assert (! g_remove (outfile));
+	g_free (outfile);
+	g_free (contents);
+	g_free (tmpdir);
+	g_free (vm.workload_path);
+	g_free (config.state.runtime_path);
+} END_TEST
+
+Suite* make_hyperstart_suite(void) {
+	Suite* s = suite_create(__FILE__);
+
+	ADD_TEST(test_cc_oci_hyper_headers, s);
+	ADD_TEST(test_cc_oci_hyper_exec_cmd_new, s);
+	ADD_TEST(test_cc_oci_hyper_ps_cmd_new, s);
+	ADD_TEST(test_cc_oci_hyper_startpod_cmd_new, s);
+	ADD_TEST(test_cc_oci_hyper_ctl_cmd, s);
+	ADD_TEST(test_cc_oci_hyper_tty, s);
+	ADD_TEST(test_cc_oci_hyper_exec_relay, s);
+
+	return s;
+}
+
+int main (void) {
+	int number_failed;
+	Suite* s;
+	SRunner* sr;
+	struct cc_log_options options = { 0 };
+
+	options.enable_debug = true;
+	options.use_json = false;
+	options.filename = g_strdup ("hyperstart_test_debug.log");
+	(void)cc_oci_log_init(&options);
+
+	s = make_hyperstart_suite();
+	sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_VERBOSE);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	cc_oci_log_free (&options);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
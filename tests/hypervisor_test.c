@@ -29,10 +29,13 @@
 #include "../src/logging.h"
 #include "../src/hypervisor.h"
 #include "../src/oci.h"
+#include "../src/rootfs.h"
+#include "../src/mount.h"
 
 gchar *
 cc_oci_vm_args_file_path (const struct cc_oci_config *config);
 gboolean cc_oci_expand_cmdline (struct cc_oci_config *config, gchar **args);
+gchar *cc_oci_expand_kernel_params (const struct cc_oci_vm_cfg *vm);
 
 extern gchar *sysconfdir;
 extern gchar *defaultsdir;
@@ -233,6 +236,7 @@ START_TEST(test_cc_oci_expand_cmdline) {
 	gchar *shell;
 	g_autofree gchar *cc_stdin = NULL;
 	g_autofree gchar *cc_stdout = NULL;
+	struct cc_oci_mount *m;
 
 	struct cc_oci_config config = { { 0 } };
 
@@ -259,8 +263,7 @@ START_TEST(test_cc_oci_expand_cmdline) {
 
 	path = g_build_path ("/", tmpdir, "image", NULL);
 	ck_assert (path);
-	g_strlcpy (config.vm->image_path, path,
-			sizeof (config.vm->image_path));
+	config.vm->image_path = g_strdup (path);
 	g_free (path);
 
 	/* image_path is ENOENT */
@@ -276,8 +279,7 @@ START_TEST(test_cc_oci_expand_cmdline) {
 
 	path = g_build_path ("/", tmpdir, "vmlinux", NULL);
 	ck_assert (path);
-	g_strlcpy (config.vm->kernel_path, path,
-			sizeof (config.vm->kernel_path));
+	config.vm->kernel_path = g_strdup (path);
 	g_free (path);
 
 	/* kernel_path is ENOENT */
@@ -292,14 +294,12 @@ START_TEST(test_cc_oci_expand_cmdline) {
 
 	path = g_build_path ("/", tmpdir, "workload", NULL);
 	ck_assert (path);
-	g_strlcpy (config.oci.root.path, path,
-			sizeof (config.oci.root.path));
+	config.oci.root.path = g_strdup (path);
 	g_free (path);
 
 	ck_assert (! g_mkdir (config.oci.root.path, 0750));
 
-	g_strlcpy (config.state.comms_path, "comms-path",
-			sizeof (config.state.comms_path));
+	config.state.comms_path = g_strdup ("comms-path");
 
 	ck_assert (! config.console);
 	ck_assert (! config.bundle_path);
@@ -382,6 +382,230 @@ START_TEST(test_cc_oci_expand_cmdline) {
 	g_free (shell);
 	g_strfreev (args);
 
+	/* check expansion of the guest RAM backend */
+	args = g_new0 (gchar *, 7);
+	ck_assert (args);
+	args[0] = g_strdup ("-m");
+	args[1] = g_strdup ("512M");
+	args[2] = g_strdup ("@MEMORY_BACKEND@");
+	args[3] = g_strdup ("@MEMORY_BACKEND_PARAMS@");
+	args[4] = g_strdup ("@MEMORY_NUMA@");
+	args[5] = g_strdup ("@MEMORY_NUMA_PARAMS@");
+	args[6] = NULL;
+
+	/* default anonymous memory requires no options */
+	ck_assert (cc_oci_expand_cmdline (&config, args));
+	ck_assert (! g_strcmp0 (args[2], ""));
+	ck_assert (! g_strcmp0 (args[3], ""));
+	ck_assert (! g_strcmp0 (args[4], ""));
+	ck_assert (! g_strcmp0 (args[5], ""));
+	g_strfreev (args);
+
+	args = g_new0 (gchar *, 7);
+	ck_assert (args);
+	args[0] = g_strdup ("-m");
+	args[1] = g_strdup ("512M");
+	args[2] = g_strdup ("@MEMORY_BACKEND@");
+	args[3] = g_strdup ("@MEMORY_BACKEND_PARAMS@");
+	args[4] = g_strdup ("@MEMORY_NUMA@");
+	args[5] = g_strdup ("@MEMORY_NUMA_PARAMS@");
+	args[6] = NULL;
+
+	config.vm->memory_backend = CC_OCI_VM_MEMORY_SHARED;
+	config.vm->memory_path = g_strdup (tmpdir);
+
+	ck_assert (cc_oci_expand_cmdline (&config, args));
+
+	path = g_strdup_printf ("memory-backend-file,id=ram-node0,"
+			"size=536870912,mem-path=%s,share=on", tmpdir);
+	ck_assert (path);
+
+	ck_assert (! g_strcmp0 (args[2], "-object"));
+	ck_assert (! g_strcmp0 (args[3], path));
+	ck_assert (! g_strcmp0 (args[4], "-numa"));
+	ck_assert (! g_strcmp0 (args[5], "node,memdev=ram-node0"));
+	g_free (path);
+
+	config.vm->memory_backend = CC_OCI_VM_MEMORY_HUGEPAGES;
+	g_free (args[3]);
+	args[3] = g_strdup ("@MEMORY_BACKEND_PARAMS@");
+
+	ck_assert (cc_oci_expand_cmdline (&config, args));
+	ck_assert (g_str_has_suffix (args[3], ",prealloc=on"));
+	g_strfreev (args);
+
+	config.vm->memory_backend = CC_OCI_VM_MEMORY_ANONYMOUS;
+
+	/* check expansion of the rootfs transport */
+	args = g_new0 (gchar *, 6);
+	ck_assert (args);
+	args[0] = g_strdup ("@ROOTFS_DEVICE@");
+	args[1] = g_strdup ("@ROOTFS_DEVICE_PARAMS@");
+	args[2] = g_strdup ("@ROOTFS_BACKEND@");
+	args[3] = g_strdup ("@ROOTFS_BACKEND_PARAMS@");
+	args[4] = g_strdup ("@ROOTFS_MOUNT_PARAMS@");
+	args[5] = NULL;
+
+	/* 9p share by default */
+	ck_assert (cc_oci_expand_cmdline (&config, args));
+
+	path = g_strdup_printf ("local,id=workload9p,path=%s,"
+			"security_model=none", config.oci.root.path);
+	ck_assert (path);
+
+	ck_assert (! g_strcmp0 (args[0], "-device"));
+	ck_assert (! g_strcmp0 (args[1],
+				"virtio-9p-pci,fsdev=workload9p,mount_tag=rootfs"));
+	ck_assert (! g_strcmp0 (args[2], "-fsdev"));
+	ck_assert (! g_strcmp0 (args[3], path));
+	ck_assert (! g_strcmp0 (args[4], ""));
+	g_free (path);
+	g_strfreev (args);
+
+	/* 9p mount options of a profile */
+	args = g_new0 (gchar *, 2);
+	ck_assert (args);
+	args[0] = g_strdup ("@ROOTFS_MOUNT_PARAMS@");
+	args[1] = NULL;
+
+	config.vm->rootfs_profile = CC_OCI_VM_ROOTFS_PROFILE_BUILD;
+	ck_assert (cc_oci_expand_cmdline (&config, args));
+	ck_assert (g_str_has_prefix (args[0],
+				CC_OCI_VM_ROOTFS_OPTIONS_PARAM "=trans=virtio,"));
+	config.vm->rootfs_profile = CC_OCI_VM_ROOTFS_PROFILE_DEFAULT;
+	g_strfreev (args);
+
+	args = g_new0 (gchar *, 7);
+	ck_assert (args);
+	args[0] = g_strdup ("@ROOTFS_DEVICE@");
+	args[1] = g_strdup ("@ROOTFS_DEVICE_PARAMS@");
+	args[2] = g_strdup ("@ROOTFS_BACKEND@");
+	args[3] = g_strdup ("@ROOTFS_BACKEND_PARAMS@");
+	args[4] = g_strdup ("@ROOTFS_SHARE_DEVICE@");
+	args[5] = g_strdup ("@ROOTFS_MOUNT_PARAMS@");
+	args[6] = NULL;
+
+	/* block device requires an image */
+	config.vm->rootfs_backend = CC_OCI_VM_ROOTFS_BLOCK;
+	ck_assert (! cc_oci_expand_cmdline (&config, args));
+
+	config.vm->rootfs_image = g_strdup ("/tmp/rootfs.img");
+
+	ck_assert (cc_oci_expand_cmdline (&config, args));
+	ck_assert (! g_strcmp0 (args[0], "-device"));
+	ck_assert (! g_strcmp0 (args[1],
+				"virtio-blk-pci,drive=workloadblk,serial=rootfs"));
+	ck_assert (! g_strcmp0 (args[2], "-drive"));
+	ck_assert (! g_strcmp0 (args[3], "file=/tmp/rootfs.img,"
+				"id=workloadblk,if=none,format=raw,"
+				"snapshot=on"));
+
+	/* no volumes to share */
+	ck_assert (! g_strcmp0 (args[4], ""));
+	ck_assert (! g_strcmp0 (args[5],
+				CC_OCI_VM_ROOTFS_DEVICE_PARAM "="
+				CC_OCI_VM_ROOTFS_DEVICE));
+	g_strfreev (args);
+
+	/* volumes stay on the host, shared over 9p */
+	m = g_new0 (struct cc_oci_mount, 1);
+	m->mnt.mnt_dir = g_strdup ("/data");
+	m->dest = g_strdup_printf ("%s/data", config.oci.root.path);
+	config.oci.mounts = g_slist_append (config.oci.mounts, m);
+
+	args = g_new0 (gchar *, 6);
+	ck_assert (args);
+	args[0] = g_strdup ("@ROOTFS_SHARE_DEVICE@");
+	args[1] = g_strdup ("@ROOTFS_SHARE_DEVICE_PARAMS@");
+	args[2] = g_strdup ("@ROOTFS_SHARE_BACKEND@");
+	args[3] = g_strdup ("@ROOTFS_SHARE_BACKEND_PARAMS@");
+	args[4] = g_strdup ("@ROOTFS_MOUNT_PARAMS@");
+	args[5] = NULL;
+
+	ck_assert (cc_oci_expand_cmdline (&config, args));
+
+	path = g_strdup_printf ("local,id=workload9p,path=%s,"
+			"security_model=none", config.oci.root.path);
+	ck_assert (path);
+
+	ck_assert (! g_strcmp0 (args[0], "-device"));
+	ck_assert (! g_strcmp0 (args[1],
+				"virtio-9p-pci,fsdev=workload9p,mount_tag=rootfs"));
+	ck_assert (! g_strcmp0 (args[2], "-fsdev"));
+	ck_assert (! g_strcmp0 (args[3], path));
+	ck_assert (! g_strcmp0 (args[4],
+				CC_OCI_VM_ROOTFS_DEVICE_PARAM "="
+				CC_OCI_VM_ROOTFS_DEVICE " "
+				CC_OCI_VM_ROOTFS_VOLUMES_PARAM "=/data"));
+	g_free (path);
+	g_strfreev (args);
+
+	cc_oci_mounts_free_all (config.oci.mounts);
+	config.oci.mounts = NULL;
+
+	/* a read-only image is mounted read-only */
+	config.oci.root.read_only = true;
+
+	args = g_new0 (gchar *, 3);
+	ck_assert (args);
+	args[0] = g_strdup ("@ROOTFS_BACKEND_PARAMS@");
+	args[1] = g_strdup ("@ROOTFS_MOUNT_PARAMS@");
+	args[2] = NULL;
+
+	ck_assert (cc_oci_expand_cmdline (&config, args));
+	ck_assert (g_str_has_suffix (args[0], ",readonly=on"));
+	ck_assert (! g_strcmp0 (args[1],
+				CC_OCI_VM_ROOTFS_DEVICE_PARAM "="
+				CC_OCI_VM_ROOTFS_DEVICE " "
+				CC_OCI_VM_ROOTFS_OPTIONS_PARAM "=ro"));
+	g_strfreev (args);
+
+	config.oci.root.read_only = false;
+
+	config.vm->rootfs_backend = CC_OCI_VM_ROOTFS_9P;
+	g_free (config.vm->rootfs_image);
+	config.vm->rootfs_image = NULL;
+
+	/* check the sockets referred to by fd are created */
+	config.state.runtime_path = g_strdup (tmpdir);
+	path = g_build_path ("/", tmpdir, CC_OCI_PROCESS_SOCKET, NULL);
+	config.state.procsock_path = g_strdup (path);
+	g_free (path);
+
+	args = g_new0 (gchar *, 4);
+	ck_assert (args);
+	args[0] = g_strdup ("@PROCESS_SOCKET@");
+	args[1] = g_strdup ("socket,id=charch0,fd=@AGENT_CTL_SOCKET_FD@");
+	args[2] = g_strdup ("unix:@COMMS_SOCKET@,server,nowait");
+	args[3] = NULL;
+
+	ck_assert (cc_oci_expand_cmdline (&config, args));
+
+	ck_assert (config.vm_sockets[CC_OCI_VM_SOCKET_PROCESS] > 2);
+	ck_assert (config.vm_sockets[CC_OCI_VM_SOCKET_AGENT_CTL] > 2);
+	ck_assert (! config.vm_sockets[CC_OCI_VM_SOCKET_COMMS]);
+	ck_assert (! config.vm_sockets[CC_OCI_VM_SOCKET_CONSOLE]);
+
+	path = g_strdup_printf ("socket,id=procsock,fd=%d,server,nowait",
+			config.vm_sockets[CC_OCI_VM_SOCKET_PROCESS]);
+	ck_assert (! g_strcmp0 (args[0], path));
+	g_free (path);
+
+	path = g_strdup_printf ("socket,id=charch0,fd=%d",
+			config.vm_sockets[CC_OCI_VM_SOCKET_AGENT_CTL]);
+	ck_assert (! g_strcmp0 (args[1], path));
+	g_free (path);
+
+	ck_assert (! g_strcmp0 (args[2], "unix:comms-path,server,nowait"));
+	g_strfreev (args);
+
+	ck_assert (g_file_test (config.state.procsock_path,
+				G_FILE_TEST_EXISTS));
+	ck_assert (! g_remove (config.state.procsock_path));
+	path = g_build_path ("/", tmpdir, CC_OCI_AGENT_CTL_SOCKET, NULL);
+	ck_assert (! g_remove (path));
+	g_free (path);
+
 	/* clean up */
 	ck_assert (! g_remove (config.vm->image_path));
 	ck_assert (! g_remove (config.vm->kernel_path));
@@ -399,6 +623,52 @@ START_TEST(test_cc_oci_expand_cmdline) {
 	cc_oci_config_free (&config);
 } END_TEST
 
+START_TEST(test_cc_oci_vm_boot) {
+	ck_assert (cc_oci_str_to_vm_boot (NULL) == CC_OCI_VM_BOOT_INVALID);
+	ck_assert (cc_oci_str_to_vm_boot ("") == CC_OCI_VM_BOOT_INVALID);
+	ck_assert (cc_oci_str_to_vm_boot ("foo") == CC_OCI_VM_BOOT_INVALID);
+	ck_assert (cc_oci_str_to_vm_boot ("systemd") ==
+			CC_OCI_VM_BOOT_SYSTEMD);
+	ck_assert (cc_oci_str_to_vm_boot ("agent") ==
+			CC_OCI_VM_BOOT_AGENT);
+
+	ck_assert (! cc_oci_vm_boot_to_str (CC_OCI_VM_BOOT_INVALID));
+	ck_assert_str_eq (cc_oci_vm_boot_to_str (CC_OCI_VM_BOOT_SYSTEMD),
+			"systemd");
+	ck_assert_str_eq (cc_oci_vm_boot_to_str (CC_OCI_VM_BOOT_AGENT),
+			"agent");
+} END_TEST
+
+START_TEST(test_cc_oci_expand_kernel_params) {
+	struct cc_oci_vm_cfg  vm = { 0 };
+	gchar                *params;
+
+	ck_assert (! cc_oci_expand_kernel_params (NULL));
+
+	/* systemd boot leaves the parameters alone */
+	vm.boot = CC_OCI_VM_BOOT_SYSTEMD;
+	ck_assert (! cc_oci_expand_kernel_params (&vm));
+
+	vm.kernel_params = (gchar *)"quiet init=/usr/lib/systemd/systemd";
+	params = cc_oci_expand_kernel_params (&vm);
+	ck_assert_str_eq (params, "quiet init=/usr/lib/systemd/systemd");
+	g_free (params);
+
+	/* agent boot replaces init and drops the systemd options */
+	vm.boot = CC_OCI_VM_BOOT_AGENT;
+	vm.kernel_params = (gchar *)"root=/dev/pmem0p1 init=/usr/lib/systemd/systemd "
+		"systemd.unit=cc.target initcall_debug quiet";
+	params = cc_oci_expand_kernel_params (&vm);
+	ck_assert_str_eq (params,
+			"root=/dev/pmem0p1 quiet init=/bin/hyperstart");
+	g_free (params);
+
+	vm.kernel_params = NULL;
+	params = cc_oci_expand_kernel_params (&vm);
+	ck_assert_str_eq (params, "init=/bin/hyperstart");
+	g_free (params);
+} END_TEST
+
 START_TEST(test_cc_oci_vm_args_get) {
 	gboolean ret;
 	gchar *path;
@@ -453,13 +723,11 @@ START_TEST(test_cc_oci_vm_args_get) {
 	ck_assert (config.vm);
 
 	config.vm->kernel_params = g_strdup ("param1=foo param2=bar");
-	g_strlcpy (config.state.comms_path, "comms-path",
-			sizeof (config.state.comms_path));
+	config.state.comms_path = g_strdup ("comms-path");
 
 	path = g_build_path ("/", tmpdir, "image", NULL);
 	ck_assert (path);
-	g_strlcpy (config.vm->image_path, path,
-			sizeof (config.vm->image_path));
+	config.vm->image_path = g_strdup (path);
 	g_free (path);
 
 	/* create image_path */
@@ -472,8 +740,7 @@ START_TEST(test_cc_oci_vm_args_get) {
 
 	path = g_build_path ("/", tmpdir, "vmlinux", NULL);
 	ck_assert (path);
-	g_strlcpy (config.vm->kernel_path, path,
-			sizeof (config.vm->kernel_path));
+	config.vm->kernel_path = g_strdup (path);
 	g_free (path);
 
 	/* create kernel_path */
@@ -485,8 +752,7 @@ START_TEST(test_cc_oci_vm_args_get) {
 
 	path = g_build_path ("/", tmpdir, "workload", NULL);
 	ck_assert (path);
-	g_strlcpy (config.oci.root.path, path,
-			sizeof (config.oci.root.path));
+	config.oci.root.path = g_strdup (path);
 	g_free (path);
 
 	/* create root path */
@@ -656,12 +922,67 @@ START_TEST(test_cc_oci_vm_args_get) {
 	cc_oci_config_free (&config);
 } END_TEST
 
+START_TEST(test_cc_oci_vm_resources_get) {
+	struct cc_oci_vm_resources resources;
+	gchar *no_args[] = { "qemu", NULL };
+	gchar *args[] = {
+		"qemu",
+		"-m", "2G,slots=2,maxmem=3G",
+		"-smp", "2,maxcpus=8,sockets=4,cores=2,threads=1",
+		NULL
+	};
+	gchar *size_args[] = {
+		"qemu",
+		"-m", "size=512,maxmem=1024",
+		"-smp", "cpus=4",
+		NULL
+	};
+	gchar *bad_mem_args[] = { "qemu", "-m", "2X", NULL };
+	gchar *bad_smp_args[] = { "qemu", "-smp", "0", NULL };
+
+	ck_assert (! cc_oci_vm_resources_get (NULL, NULL));
+	ck_assert (! cc_oci_vm_resources_get (args, NULL));
+	ck_assert (! cc_oci_vm_resources_get (NULL, &resources));
+
+	ck_assert (! cc_oci_vm_resources_get (bad_mem_args, &resources));
+	ck_assert (! cc_oci_vm_resources_get (bad_smp_args, &resources));
+
+	/* hypervisor defaults */
+	ck_assert (cc_oci_vm_resources_get (no_args, &resources));
+	ck_assert (resources.boot_vcpus == 1);
+	ck_assert (resources.max_vcpus == 1);
+	ck_assert (resources.vcpus == 1);
+	ck_assert (resources.boot_memory == CC_OCI_DEFAULT_VM_MEMORY);
+	ck_assert (resources.max_memory == CC_OCI_DEFAULT_VM_MEMORY);
+	ck_assert (resources.memory_slots == 0);
+
+	ck_assert (cc_oci_vm_resources_get (args, &resources));
+	ck_assert (resources.boot_vcpus == 2);
+	ck_assert (resources.max_vcpus == 8);
+	ck_assert (resources.vcpus == 2);
+	ck_assert (resources.boot_memory == 2048 * CC_OCI_MiB);
+	ck_assert (resources.max_memory == 3072 * CC_OCI_MiB);
+	ck_assert (resources.memory_slots == 2);
+	ck_assert (resources.hotplugged_memory == 0);
+	ck_assert (resources.memory_limit == 0);
+
+	ck_assert (cc_oci_vm_resources_get (size_args, &resources));
+	ck_assert (resources.boot_vcpus == 4);
+	ck_assert (resources.max_vcpus == 4);
+	ck_assert (resources.boot_memory == 512 * CC_OCI_MiB);
+	ck_assert (resources.max_memory == 1024 * CC_OCI_MiB);
+	ck_assert (resources.memory_slots == 0);
+} END_TEST
+
 Suite* make_hypervisor_suite(void) {
 	Suite* s = suite_create(__FILE__);
 
 	ADD_TEST(test_cc_oci_vm_args_file_path, s);
 	ADD_TEST(test_cc_oci_expand_cmdline, s);
+	ADD_TEST(test_cc_oci_vm_boot, s);
+	ADD_TEST(test_cc_oci_expand_kernel_params, s);
 	ADD_TEST(test_cc_oci_vm_args_get, s);
+	ADD_TEST(test_cc_oci_vm_resources_get, s);
 
 	return s;
 }
@@ -19,6 +19,7 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 
 #include <check.h>
 #include <glib.h>
@@ -35,7 +36,12 @@ START_TEST(test_cc_oci_json_parse) {
 
 	ck_assert(cc_oci_json_parse(&node, TEST_DATA_DIR "/node.json"));
 	ck_assert(node);
+	ck_assert_str_eq(node->data, TEST_DATA_DIR "/node.json");
 	g_free_node(node);
+	ck_assert(! node);
+
+	/* no-op */
+	cc_oci_json_free(NULL);
 
 	ck_assert(! cc_oci_json_parse(&node, TEST_DATA_DIR "/empty.json"));
 	g_free_node(node);
@@ -56,10 +62,53 @@ START_TEST(test_cc_oci_json_parse) {
 	g_free_node(node);
 } END_TEST
 
+START_TEST(test_cc_oci_json_parse_data) {
+	GNode* node = NULL;
+	GNode* list;
+	GString* big;
+	int i;
+	const gchar *data = "{\"memory\": {\"limit\": 1024}}";
+
+	ck_assert(! cc_oci_json_parse_data(NULL, NULL, -1));
+	ck_assert(! cc_oci_json_parse_data(&node, NULL, -1));
+	ck_assert(! cc_oci_json_parse_data(&node, "", -1));
+	ck_assert(! cc_oci_json_parse_data(&node, "not json", -1));
+	ck_assert(! cc_oci_json_parse_data(&node, "{\"foo\":", -1));
+
+	ck_assert(cc_oci_json_parse_data(&node, data, -1));
+	ck_assert(node);
+	ck_assert(node_find_child(node, "memory"));
+	ck_assert(node_find_child(node_find_child(node, "memory"), "limit"));
+	g_free_node(node);
+
+	node = NULL;
+	ck_assert(cc_oci_json_parse_data(&node, data, (gssize)strlen(data)));
+	ck_assert(node);
+	g_free_node(node);
+
+	/* spans many arena blocks */
+	big = g_string_new("{\"list\": [");
+	for (i = 0; i < 10000; i++) {
+		g_string_append_printf(big, "%s\"value-%d\"",
+				i ? "," : "", i);
+	}
+	g_string_append(big, "]}");
+
+	ck_assert(cc_oci_json_parse_data(&node, big->str, -1));
+	ck_assert(node);
+	list = node_find_child(node, "list");
+	ck_assert(list);
+	ck_assert(g_node_n_children(list) == 10000);
+	ck_assert_str_eq(g_node_nth_child(list, 9999)->data, "value-9999");
+	g_free_node(node);
+	g_string_free(big, true);
+} END_TEST
+
 Suite* make_json_suite(void) {
 	Suite* s = suite_create(__FILE__);
 
 	ADD_TEST(test_cc_oci_json_parse, s);
+	ADD_TEST(test_cc_oci_json_parse_data, s);
 
 	return s;
 }
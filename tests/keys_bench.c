@@ -0,0 +1,124 @@
+/*
+ * This file is part of cc-oci-runtime.
+ *
+ * Copyright (C) 2016 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/**
+ * \file
+ *
+ * Compare cc_oci_key_lookup() on the generated perfect hash tables
+ * against comparing the same keys in turn, looking up every key of a
+ * section once.
+ *
+ * Build with "make keys_bench" and run "./keys_bench [rounds]".
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include "../src/keys.h"
+#include "src/spec-keys.h"
+#include "src/state-resources-keys.h"
+#include "src/spec_handlers/vm-keys.h"
+
+static volatile gint sink;
+
+/* Look up a key by comparing the keys in turn. */
+static gint
+linear_lookup (const struct cc_oci_key *keys, const gchar *name)
+{
+	const struct cc_oci_key *key;
+
+	for (key = keys; key->name; key++) {
+		if (! strcmp (key->name, name)) {
+			return key->id;
+		}
+	}
+
+	return CC_OCI_KEY_UNKNOWN;
+}
+
+static void
+run (const char *name, const struct cc_oci_key_table *table,
+		guint rounds)
+{
+	struct cc_oci_key  *keys;
+	gint64              start;
+	gint64              linear;
+	gint64              hash;
+	guint               count = 0;
+	guint               i;
+	guint               j;
+
+	/* the same keys, \c NULL-terminated, in id order */
+	keys = g_new0 (struct cc_oci_key, table->size + 1);
+	for (i = 0; i < table->size; i++) {
+		if (table->keys[i].name) {
+			keys[table->keys[i].id] = table->keys[i];
+			count++;
+		}
+	}
+
+	start = g_get_monotonic_time ();
+	for (i = 0; i < rounds; i++) {
+		for (j = 0; j < count; j++) {
+			sink += linear_lookup (keys, keys[j].name);
+		}
+	}
+	linear = g_get_monotonic_time () - start;
+
+	start = g_get_monotonic_time ();
+	for (i = 0; i < rounds; i++) {
+		for (j = 0; j < count; j++) {
+			sink += cc_oci_key_lookup (table, keys[j].name);
+		}
+	}
+	hash = g_get_monotonic_time () - start;
+
+	printf ("%-10s %2u keys: linear %7.1f ns, "
+			"perfect hash %7.1f ns per section\n",
+			name, count,
+			(double)linear * 1000 / rounds,
+			(double)hash * 1000 / rounds);
+
+	g_free (keys);
+}
+
+int
+main (int argc, char *argv[])
+{
+	guint rounds = 1000000;
+
+	if (argc > 1) {
+		rounds = (guint)strtoul (argv[1], NULL, 10);
+	}
+
+	if (! rounds) {
+		fprintf (stderr, "Usage: %s [rounds]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	run ("spec", &spec_section_keys, rounds);
+	run ("vm", &vm_keys, rounds);
+	run ("resources", &state_resources_keys, rounds);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,139 @@
+/*
+ * This file is part of cc-oci-runtime.
+ *
+ * Copyright (C) 2016 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include <check.h>
+#include <glib.h>
+
+#include "test_common.h"
+#include "../src/logging.h"
+#include "../src/keys.h"
+#include "src/spec-keys.h"
+#include "src/state-keys.h"
+#include "src/state-vm-keys.h"
+#include "src/state-resources-keys.h"
+#include "src/spec_handlers/hooks-keys.h"
+#include "src/spec_handlers/mounts-keys.h"
+#include "src/spec_handlers/vm-keys.h"
+#include "tests/keys_test-keys.h"
+
+/* Check every key of a generated table is found in its own slot. */
+static void
+check_key_table (const struct cc_oci_key_table *table, guint count)
+{
+	const struct cc_oci_key  *key;
+	guint                     found = 0;
+	guint                     i;
+
+	ck_assert (table->size >= count);
+
+	for (i = 0; i < table->size; i++) {
+		key = &table->keys[i];
+		if (! key->name) {
+			continue;
+		}
+
+		ck_assert (cc_oci_key_hash (table->seed, key->name)
+				% table->size == i);
+		ck_assert (cc_oci_key_lookup (table, key->name) == key->id);
+		found++;
+	}
+
+	ck_assert (found == count);
+}
+
+START_TEST(test_cc_oci_key_hash) {
+	ck_assert (cc_oci_key_hash (7, "") == 0);
+	ck_assert (cc_oci_key_hash (7, "a") == 'a');
+	ck_assert (cc_oci_key_hash (31, "ab") == 'a' * 31 + 'b');
+	ck_assert (cc_oci_key_hash (3, "foo") != cc_oci_key_hash (4, "foo"));
+
+	/* wraps modulo 2^32: 'a' * 44278014 == 2^32 + 62 */
+	ck_assert (cc_oci_key_hash (44278014, "aa") == 62 + 'a');
+} END_TEST
+
+START_TEST(test_cc_oci_key_lookup) {
+	ck_assert (cc_oci_key_lookup (NULL, "foo") == CC_OCI_KEY_UNKNOWN);
+	ck_assert (cc_oci_key_lookup (&test_keys, NULL) == CC_OCI_KEY_UNKNOWN);
+
+	/* id 0 is distinct from an unknown key */
+	ck_assert (cc_oci_key_lookup (&test_keys, "foo") == TEST_FOO);
+	ck_assert (cc_oci_key_lookup (&test_keys, "bar") == TEST_BAR);
+	ck_assert (cc_oci_key_lookup (&test_keys, "baz") == TEST_BAZ);
+
+	ck_assert (cc_oci_key_lookup (&test_keys, "") == CC_OCI_KEY_UNKNOWN);
+	ck_assert (cc_oci_key_lookup (&test_keys, "fo") == CC_OCI_KEY_UNKNOWN);
+	ck_assert (cc_oci_key_lookup (&test_keys, "FOO") == CC_OCI_KEY_UNKNOWN);
+	ck_assert (cc_oci_key_lookup (&test_keys, "foobar") == CC_OCI_KEY_UNKNOWN);
+	ck_assert (cc_oci_key_lookup (&test_keys, "path") == CC_OCI_KEY_UNKNOWN);
+} END_TEST
+
+START_TEST(test_cc_oci_key_tables) {
+	check_key_table (&test_keys, 3);
+	check_key_table (&spec_section_keys, SPEC_SECTIONS);
+	check_key_table (&state_section_keys, STATE_RESOURCES + 1);
+	check_key_table (&state_vm_keys, STATE_VM_ROOTFS_IMAGE + 1);
+	check_key_table (&state_resources_keys,
+			STATE_RESOURCES_MEMORY_LIMIT + 1);
+	check_key_table (&hook_keys, HOOK_TIMEOUT + 1);
+	check_key_table (&mount_keys, MOUNT_OPTIONS + 1);
+	check_key_table (&vm_keys, VM_BOOT + 1);
+
+	/* keys of one section are not found in another */
+	ck_assert (cc_oci_key_lookup (&vm_keys, "destination")
+			== CC_OCI_KEY_UNKNOWN);
+	ck_assert (cc_oci_key_lookup (&spec_section_keys, "path")
+			== CC_OCI_KEY_UNKNOWN);
+} END_TEST
+
+Suite* make_keys_suite(void) {
+	Suite* s = suite_create(__FILE__);
+
+	ADD_TEST(test_cc_oci_key_hash, s);
+	ADD_TEST(test_cc_oci_key_lookup, s);
+	ADD_TEST(test_cc_oci_key_tables, s);
+
+	return s;
+}
+
+int main (void) {
+	int number_failed;
+	Suite* s;
+	SRunner* sr;
+	struct cc_log_options options = { 0 };
+
+	options.enable_debug = true;
+	options.use_json = false;
+	options.filename = g_strdup ("keys_test_debug.log");
+	(void)cc_oci_log_init(&options);
+
+	s = make_keys_suite();
+	sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_VERBOSE);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	cc_oci_log_free (&options);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
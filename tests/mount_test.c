@@ -54,7 +54,7 @@ START_TEST(test_cc_oci_perform_mount) {
 
 	ck_assert(! cc_oci_perform_mount(NULL, false));
 
-	g_snprintf(m.dest, PATH_MAX, "/tmp");
+	m.dest = "/tmp";
 	m.mnt.mnt_fsname = "/tmp";
 	m.mnt.mnt_type = "tmpfs";
 
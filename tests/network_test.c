@@ -0,0 +1,137 @@
+/*
+ * This file is part of cc-oci-runtime.
+ *
+ * Copyright (C) 2016 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include <check.h>
+#include <glib.h>
+#include <gio/gio.h>
+
+#include "test_common.h"
+#include "../src/oci.h"
+#include "../src/network.h"
+
+gboolean cc_oci_qmp_msg_recv (GSocket *socket, GString **pending,
+		gsize expected_count, GSList **msgs, gsize *count);
+
+static void
+msg_free (GString *msg)
+{
+	g_string_free (msg, true);
+}
+
+static void
+send_str (int fd, const gchar *str)
+{
+	ck_assert (write (fd, str, strlen (str)) == (ssize_t)strlen (str));
+}
+
+START_TEST(test_cc_oci_qmp_msg_recv) {
+	GSocket  *socket;
+	GString  *pending = NULL;
+	GSList   *msgs = NULL;
+	GString  *msg;
+	gsize     count = 0;
+	int       fds[2];
+
+	ck_assert (! socketpair (AF_UNIX, SOCK_STREAM, 0, fds));
+
+	socket = g_socket_new_from_fd (fds[0], NULL);
+	ck_assert (socket);
+
+	/* a reply followed by the start of an asynchronous event */
+	send_str (fds[1], "{\"return\": {}}\r\n"
+			"{\"event\": \"BALLOON_CHANGE\", ");
+
+	ck_assert (cc_oci_qmp_msg_recv (socket, &pending, 1,
+				&msgs, &count));
+	ck_assert (count == 1);
+	ck_assert (g_slist_length (msgs) == 1);
+
+	msg = msgs->data;
+	ck_assert_str_eq (msg->str, "{\"return\": {}}");
+
+	/* the partial event is kept */
+	ck_assert (pending);
+	ck_assert_str_eq (pending->str, "{\"event\": \"BALLOON_CHANGE\", ");
+
+	g_slist_free_full (msgs, (GDestroyNotify)msg_free);
+	msgs = NULL;
+	count = 0;
+
+	/* the rest of the event, then the next reply */
+	send_str (fds[1], "\"data\": {\"actual\": 1}}\r\n"
+			"{\"return\": {}}\r\n");
+
+	ck_assert (cc_oci_qmp_msg_recv (socket, &pending, 2,
+				&msgs, &count));
+	ck_assert (count == 2);
+	ck_assert (! pending);
+
+	msg = g_slist_nth_data (msgs, 0);
+	ck_assert_str_eq (msg->str, "{\"event\": \"BALLOON_CHANGE\", "
+			"\"data\": {\"actual\": 1}}");
+
+	msg = g_slist_nth_data (msgs, 1);
+	ck_assert_str_eq (msg->str, "{\"return\": {}}");
+
+	g_slist_free_full (msgs, (GDestroyNotify)msg_free);
+	msgs = NULL;
+	count = 0;
+
+	/* connection closed part way through a message */
+	send_str (fds[1], "{\"return\"");
+	close (fds[1]);
+
+	ck_assert (! cc_oci_qmp_msg_recv (socket, &pending, 1,
+				&msgs, &count));
+	ck_assert (! count);
+	ck_assert (! msgs);
+	ck_assert (! pending);
+
+	g_object_unref (socket);
+} END_TEST
+
+Suite* make_network_suite(void) {
+	Suite* s = suite_create(__FILE__);
+
+	ADD_TEST(test_cc_oci_qmp_msg_recv, s);
+
+	return s;
+}
+
+int main (void) {
+	int number_failed;
+	Suite* s;
+	SRunner* sr;
+
+	s = make_network_suite();
+	sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_VERBOSE);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
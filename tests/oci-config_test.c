@@ -36,7 +36,7 @@ START_TEST(test_cc_oci_config_check) {
 	ck_assert (! cc_oci_config_check (&config));
 
 	config.oci.oci_version = "0.0.1";
-	g_strlcpy (config.oci.process.cwd, "/foo", sizeof (config.oci.process.cwd));
+	config.oci.process.cwd = "/foo";
 	config.oci.platform.os = "linux";
 	config.oci.platform.arch = "amd64";
 
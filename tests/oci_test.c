@@ -35,8 +35,8 @@
 #include "../src/runtime.h"
 #include "../src/state.h"
 #include "../src/oci.h"
+#include "../src/batch.h"
 
-gboolean cc_oci_vm_running (const struct oci_state *state);
 gboolean cc_oci_create_container_workload (struct cc_oci_config *config);
 gchar* get_user_home_dir(struct cc_oci_config *config, gchar *password_path);
 void set_env_home(struct cc_oci_config *config);
@@ -48,6 +48,8 @@ START_TEST(test_cc_oci_list) {
 	gchar *tmpdir;
 	gchar *vm1_dir;
 	struct cc_oci_config vm1_config = { { 0 } };
+	struct cc_oci_batch_selector selector = { 0 };
+	gchar *annotations[2] = { NULL };
 	gchar *outfile = NULL;
 	gchar *contents;
 	gchar **lines;
@@ -57,23 +59,23 @@ START_TEST(test_cc_oci_list) {
 	JsonNode *node = NULL;
 	const gchar *value;
 
-	ck_assert (! cc_oci_list (NULL, NULL, true));
-	ck_assert (! cc_oci_list (NULL, NULL, false));
+	ck_assert (! cc_oci_list (NULL, NULL, true, NULL, false));
+	ck_assert (! cc_oci_list (NULL, NULL, false, NULL, false));
 
-	ck_assert (! cc_oci_list (NULL, "", true));
-	ck_assert (! cc_oci_list (NULL, "", false));
+	ck_assert (! cc_oci_list (NULL, "", true, NULL, false));
+	ck_assert (! cc_oci_list (NULL, "", false, NULL, false));
 
-	ck_assert (! cc_oci_list (&config, NULL, true));
-	ck_assert (! cc_oci_list (&config, NULL, false));
+	ck_assert (! cc_oci_list (&config, NULL, true, NULL, false));
+	ck_assert (! cc_oci_list (&config, NULL, false, NULL, false));
 
-	ck_assert (! cc_oci_list (&config, "", true));
-	ck_assert (! cc_oci_list (&config, "", false));
+	ck_assert (! cc_oci_list (&config, "", true, NULL, false));
+	ck_assert (! cc_oci_list (&config, "", false, NULL, false));
 
-	ck_assert (! cc_oci_list (&config, "", true));
-	ck_assert (! cc_oci_list (&config, "", false));
+	ck_assert (! cc_oci_list (&config, "", true, NULL, false));
+	ck_assert (! cc_oci_list (&config, "", false, NULL, false));
 
-	ck_assert (! cc_oci_list (&config, "invalid format", true));
-	ck_assert (! cc_oci_list (&config, "invalid format", false));
+	ck_assert (! cc_oci_list (&config, "invalid format", true, NULL, false));
+	ck_assert (! cc_oci_list (&config, "invalid format", false, NULL, false));
 
 	tmpdir = g_dir_make_tmp (NULL, NULL);
 	ck_assert (tmpdir);
@@ -89,7 +91,7 @@ START_TEST(test_cc_oci_list) {
 	/* test default ASCII output - no VMs */
 
 	SAVE_OUTPUT (outfile) {
-		ret = cc_oci_list (&config, "table", false);
+		ret = cc_oci_list (&config, "table", false, NULL, false);
 	}
 	ck_assert (ret);
 
@@ -123,7 +125,7 @@ START_TEST(test_cc_oci_list) {
 	/* test ASCII output - no VMs, all mode */
 
 	SAVE_OUTPUT (outfile) {
-		ret = cc_oci_list (&config, "table", true);
+		ret = cc_oci_list (&config, "table", true, NULL, false);
 	}
 	ck_assert (ret);
 
@@ -160,7 +162,7 @@ START_TEST(test_cc_oci_list) {
 	/* test JSON output - no VMs */
 
 	SAVE_OUTPUT (outfile) {
-		ret = cc_oci_list (&config, "json", false);
+		ret = cc_oci_list (&config, "json", false, NULL, false);
 	}
 	ck_assert (ret);
 
@@ -186,7 +188,7 @@ START_TEST(test_cc_oci_list) {
 	/* test JSON output - no VMs, all mode */
 
 	SAVE_OUTPUT (outfile) {
-		ret = cc_oci_list (&config, "json", true);
+		ret = cc_oci_list (&config, "json", true, NULL, false);
 	}
 	ck_assert (ret);
 
@@ -218,7 +220,7 @@ START_TEST(test_cc_oci_list) {
 	/* test default ASCII output - no VMs */
 
 	SAVE_OUTPUT (outfile) {
-		ret = cc_oci_list (&config, "table", false);
+		ret = cc_oci_list (&config, "table", false, NULL, false);
 	}
 	ck_assert (ret);
 
@@ -252,7 +254,7 @@ START_TEST(test_cc_oci_list) {
 	/* test JSON output - no VMs */
 
 	SAVE_OUTPUT (outfile) {
-		ret = cc_oci_list (&config, "json", false);
+		ret = cc_oci_list (&config, "json", false, NULL, false);
 	}
 	ck_assert (ret);
 
@@ -285,7 +287,7 @@ START_TEST(test_cc_oci_list) {
 	/* test default ASCII output - 1 VM */
 
 	SAVE_OUTPUT (outfile) {
-		ret = cc_oci_list (&config, "table", false);
+		ret = cc_oci_list (&config, "table", false, NULL, false);
 	}
 	ck_assert (ret);
 
@@ -336,7 +338,7 @@ START_TEST(test_cc_oci_list) {
 	/* test default ASCII output - 1 VM, all mode */
 
 	SAVE_OUTPUT (outfile) {
-		ret = cc_oci_list (&config, "table", true);
+		ret = cc_oci_list (&config, "table", true, NULL, false);
 	}
 	ck_assert (ret);
 
@@ -396,7 +398,7 @@ START_TEST(test_cc_oci_list) {
 	/* test JSON output - 1 VM */
 
 	SAVE_OUTPUT (outfile) {
-		ret = cc_oci_list (&config, "json", false);
+		ret = cc_oci_list (&config, "json", false, NULL, false);
 	}
 	ck_assert (ret);
 
@@ -468,7 +470,7 @@ START_TEST(test_cc_oci_list) {
 	/* test JSON output - 1 VM, all mode */
 
 	SAVE_OUTPUT (outfile) {
-		ret = cc_oci_list (&config, "json", true);
+		ret = cc_oci_list (&config, "json", true, NULL, false);
 	}
 	ck_assert (ret);
 
@@ -559,6 +561,99 @@ START_TEST(test_cc_oci_list) {
 
 	ck_assert (! g_remove (outfile));
 	g_free (outfile);
+
+	/*****************************/
+	/* test quiet output - 1 VM */
+
+	SAVE_OUTPUT (outfile) {
+		ret = cc_oci_list (&config, "table", true, NULL, true);
+	}
+	ck_assert (ret);
+
+	ret = g_file_get_contents (outfile, &contents, NULL, NULL);
+	ck_assert (ret);
+	ck_assert (! g_strcmp0 (contents, "vm1\n"));
+
+	g_free (contents);
+	ck_assert (! g_remove (outfile));
+	g_free (outfile);
+
+	/*****************************/
+	/* test filters - 1 VM */
+
+	selector.status = OCI_STATUS_INVALID;
+	selector.id_prefix = "vm";
+
+	SAVE_OUTPUT (outfile) {
+		ret = cc_oci_list (&config, "json", false, &selector, true);
+	}
+	ck_assert (ret);
+
+	ret = g_file_get_contents (outfile, &contents, NULL, NULL);
+	ck_assert (ret);
+	ck_assert (! g_strcmp0 (contents, "vm1\n"));
+
+	g_free (contents);
+	ck_assert (! g_remove (outfile));
+	g_free (outfile);
+
+	/* no container has this prefix */
+	selector.id_prefix = "vm2";
+
+	SAVE_OUTPUT (outfile) {
+		ret = cc_oci_list (&config, "json", false, &selector, false);
+	}
+	ck_assert (ret);
+
+	ret = g_file_get_contents (outfile, &contents, NULL, NULL);
+	ck_assert (ret);
+	ck_assert (! g_strcmp0 (contents, "null"));
+
+	g_free (contents);
+	ck_assert (! g_remove (outfile));
+	g_free (outfile);
+
+	selector.id_prefix = NULL;
+	selector.status = OCI_STATUS_CREATED;
+
+	SAVE_OUTPUT (outfile) {
+		ret = cc_oci_list (&config, "table", false, &selector, true);
+	}
+	ck_assert (ret);
+
+	ret = g_file_get_contents (outfile, &contents, NULL, NULL);
+	ck_assert (ret);
+	ck_assert (! g_strcmp0 (contents, "vm1\n"));
+
+	g_free (contents);
+	ck_assert (! g_remove (outfile));
+	g_free (outfile);
+
+	/* the VM has no annotations */
+	selector.status = OCI_STATUS_INVALID;
+	selector.annotations = annotations;
+	annotations[0] = "role";
+
+	SAVE_OUTPUT (outfile) {
+		ret = cc_oci_list (&config, "table", false, &selector, false);
+	}
+	ck_assert (ret);
+
+	ret = g_file_get_contents (outfile, &contents, NULL, NULL);
+	ck_assert (ret);
+
+	/* only the header line */
+	lines = g_strsplit (contents, "\n", -1);
+	ck_assert (lines);
+	ck_assert (lines[0]);
+	ck_assert (g_str_has_prefix (lines[0], "ID"));
+	ck_assert (! *lines[1]);
+
+	g_free (contents);
+	g_strfreev (lines);
+	ck_assert (! g_remove (outfile));
+	g_free (outfile);
+
 	/* clean up */
 	ck_assert (! g_remove (vm1_config.state.state_file_path));
 	ck_assert (! g_remove (vm1_config.state.runtime_path));
@@ -643,10 +738,10 @@ START_TEST(test_cc_oci_config_update) {
 	/* create vm object */
 	vm = g_malloc0 (sizeof(struct cc_oci_vm_cfg));
 	ck_assert (vm);
-	g_strlcpy (vm->hypervisor_path, "hypervisor_path", sizeof (vm->hypervisor_path));
-	g_strlcpy (vm->image_path, "image_path", sizeof (vm->image_path));
-	g_strlcpy (vm->kernel_path, "kernel_path", sizeof (vm->kernel_path));
-	g_strlcpy (vm->workload_path, "workload_path", sizeof (vm->workload_path));
+	vm->hypervisor_path = g_strdup ("hypervisor_path");
+	vm->image_path = g_strdup ("image_path");
+	vm->kernel_path = g_strdup ("kernel_path");
+	vm->workload_path = g_strdup ("workload_path");
 	vm->kernel_params = g_strdup ("kernel params");
 
 	/* add vm object to state */
@@ -809,13 +904,9 @@ START_TEST(test_cc_oci_create_container_workload) {
 	ck_assert (! cc_oci_create_container_workload (NULL));
 	ck_assert (! cc_oci_create_container_workload (&config));
 
-	g_strlcpy (config.oci.root.path,
-			tmpdir,
-			sizeof (config.oci.root.path));
+	config.oci.root.path = g_strdup (tmpdir);
 
-	g_strlcpy (config.oci.process.cwd,
-			"/guest/side/directory",
-			sizeof (config.oci.process.cwd));
+	config.oci.process.cwd = g_strdup ("/guest/side/directory");
 
 	config.oci.process.args = g_new0 (gchar *, 4);
 	config.oci.process.args[0] = g_strdup ("echo");
@@ -833,17 +924,10 @@ START_TEST(test_cc_oci_create_container_workload) {
 	config.vm = g_malloc0 (sizeof(struct cc_oci_vm_cfg));
 	ck_assert (config.vm);
 
-	g_strlcpy (config.vm->hypervisor_path, "hypervisor-path",
-			sizeof (config.vm->hypervisor_path));
-
-	g_strlcpy (config.vm->image_path, "image-path",
-			sizeof (config.vm->image_path));
-
-	g_strlcpy (config.vm->kernel_path, "kernel-path",
-			sizeof (config.vm->kernel_path));
-
-	g_strlcpy (config.vm->workload_path, "workload-path",
-			sizeof (config.vm->workload_path));
+	config.vm->hypervisor_path = g_strdup ("hypervisor-path");
+	config.vm->image_path = g_strdup ("image-path");
+	config.vm->kernel_path = g_strdup ("kernel-path");
+	config.vm->workload_path = g_strdup ("workload-path");
 
 	config.vm->kernel_params = g_strdup ("kernel params");
 
@@ -925,9 +1009,7 @@ START_TEST(test_set_env_home) {
 	tmp_etc_dir = g_build_path ("/", tmpdir, "etc", NULL);
 	ck_assert (! g_mkdir (tmp_etc_dir, 0750));
 
-	g_strlcpy (config.oci.root.path,
-			tmpdir,
-			sizeof (config.oci.root.path));
+	config.oci.root.path = g_strdup (tmpdir);
 
 	passwd_path = g_strdup_printf("%s/%s", config.oci.root.path, "etc/passwd");
 	ret = g_file_set_contents (passwd_path, pw_contents, -1, NULL);
@@ -954,9 +1036,7 @@ START_TEST(test_set_env_home) {
 	cc_oci_config_free (&config);
 
 	/* Check if default is set if home dir could not be retrieved */
-	g_strlcpy (config.oci.root.path,
-                        tmpdir,
-                        sizeof (config.oci.root.path));
+	config.oci.root.path = g_strdup (tmpdir);
 
 	config.oci.process.env = g_new0 (gchar *, 2);
 	config.oci.process.env[0] = g_strdup ("foo=bar");
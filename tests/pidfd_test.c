@@ -0,0 +1,141 @@
+/*
+ * This file is part of cc-oci-runtime.
+ *
+ * Copyright (C) 2016 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include <check.h>
+#include <glib.h>
+
+#include "test_common.h"
+#include "../src/pidfd.h"
+
+START_TEST(test_cc_oci_pid_start_time) {
+	guint64 start_time;
+
+	ck_assert (! cc_oci_pid_start_time (0));
+	ck_assert (! cc_oci_pid_start_time (-1));
+
+	start_time = cc_oci_pid_start_time (getpid ());
+	ck_assert (start_time);
+	ck_assert (cc_oci_pid_start_time (getpid ()) == start_time);
+
+	/* pid 1 started before us */
+	ck_assert (cc_oci_pid_start_time (1) <= start_time);
+} END_TEST
+
+START_TEST(test_cc_oci_pidfd_open) {
+	guint64  start_time;
+	int      fd;
+
+	fd = cc_oci_pidfd_open (0, 0);
+	ck_assert (fd < 0);
+	ck_assert (errno == ESRCH);
+
+	start_time = cc_oci_pid_start_time (getpid ());
+
+	fd = cc_oci_pidfd_open (getpid (), start_time);
+	if (fd < 0 && errno == ENOSYS) {
+		/* kernel without pidfd support */
+		return;
+	}
+	ck_assert (fd >= 0);
+	close (fd);
+
+	/* pid reused by another process */
+	fd = cc_oci_pidfd_open (getpid (), start_time + 1);
+	ck_assert (fd < 0);
+	ck_assert (errno == ESRCH);
+} END_TEST
+
+START_TEST(test_cc_oci_pid_running) {
+	guint64    start_time;
+	siginfo_t  info;
+	pid_t      pid;
+	int        status;
+	int        fd;
+
+	ck_assert (! cc_oci_pid_running (0, 0));
+	ck_assert (! cc_oci_pid_running (-1, 0));
+
+	start_time = cc_oci_pid_start_time (getpid ());
+
+	ck_assert (cc_oci_pid_running (getpid (), 0));
+	ck_assert (cc_oci_pid_running (getpid (), start_time));
+	ck_assert (! cc_oci_pid_running (getpid (), start_time + 1));
+
+	pid = fork ();
+	ck_assert (pid != -1);
+
+	if (! pid) {
+		pause ();
+		_exit (0);
+	}
+
+	start_time = cc_oci_pid_start_time (pid);
+	ck_assert (start_time);
+	ck_assert (cc_oci_pid_running (pid, start_time));
+
+	ck_assert (kill (pid, SIGKILL) == 0);
+
+	/* an exited but not yet reaped process isn't running (this
+	 * needs pidfd support).
+	 */
+	ck_assert (waitid (P_PID, (id_t)pid, &info,
+				WEXITED | WNOWAIT) == 0);
+	fd = cc_oci_pidfd_open (pid, 0);
+	if (fd >= 0) {
+		close (fd);
+		ck_assert (! cc_oci_pid_running (pid, start_time));
+	}
+
+	ck_assert (waitpid (pid, &status, 0) == pid);
+	ck_assert (! cc_oci_pid_running (pid, start_time));
+} END_TEST
+
+Suite* make_pidfd_suite(void) {
+	Suite* s = suite_create(__FILE__);
+
+	ADD_TEST(test_cc_oci_pid_start_time, s);
+	ADD_TEST(test_cc_oci_pidfd_open, s);
+	ADD_TEST(test_cc_oci_pid_running, s);
+
+	return s;
+}
+
+int main (void) {
+	int number_failed;
+	Suite* s;
+	SRunner* sr;
+
+	s = make_pidfd_suite();
+	sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_VERBOSE);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
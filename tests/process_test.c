@@ -28,56 +28,12 @@
 #include "../src/logging.h"
 #include "../src/process.h"
 
-gboolean cc_oci_cmd_is_shell (const char *cmd);
 gboolean cc_run_hook (struct oci_cfg_hook* hook,
 		const gchar* state,
 		gsize state_length);
 
 extern GMainLoop *hook_loop;
 
-START_TEST(test_cc_oci_cmd_is_shell) {
-
-	ck_assert (! cc_oci_cmd_is_shell (""));
-	ck_assert (! cc_oci_cmd_is_shell (NULL));
-
-	ck_assert (cc_oci_cmd_is_shell ("sh"));
-	ck_assert (cc_oci_cmd_is_shell ("/sh"));
-	ck_assert (cc_oci_cmd_is_shell ("/bin/sh"));
-	ck_assert (cc_oci_cmd_is_shell ("/usr/bin/sh"));
-	ck_assert (cc_oci_cmd_is_shell ("/usr/local/bin/sh"));
-
-	ck_assert (cc_oci_cmd_is_shell ("bash"));
-	ck_assert (cc_oci_cmd_is_shell ("/bash"));
-	ck_assert (cc_oci_cmd_is_shell ("/bin/bash"));
-	ck_assert (cc_oci_cmd_is_shell ("/usr/bin/bash"));
-	ck_assert (cc_oci_cmd_is_shell ("/usr/local/bin/bash"));
-
-	ck_assert (cc_oci_cmd_is_shell ("zsh"));
-	ck_assert (cc_oci_cmd_is_shell ("/zsh"));
-	ck_assert (cc_oci_cmd_is_shell ("/bin/zsh"));
-	ck_assert (cc_oci_cmd_is_shell ("/usr/bin/zsh"));
-	ck_assert (cc_oci_cmd_is_shell ("/usr/local/bin/zsh"));
-
-	ck_assert (cc_oci_cmd_is_shell ("ksh"));
-	ck_assert (cc_oci_cmd_is_shell ("/ksh"));
-	ck_assert (cc_oci_cmd_is_shell ("/bin/ksh"));
-	ck_assert (cc_oci_cmd_is_shell ("/usr/bin/ksh"));
-	ck_assert (cc_oci_cmd_is_shell ("/usr/local/bin/ksh"));
-
-	ck_assert (cc_oci_cmd_is_shell ("csh"));
-	ck_assert (cc_oci_cmd_is_shell ("/csh"));
-	ck_assert (cc_oci_cmd_is_shell ("/bin/csh"));
-	ck_assert (cc_oci_cmd_is_shell ("/usr/bin/csh"));
-	ck_assert (cc_oci_cmd_is_shell ("/usr/local/bin/csh"));
-
-	ck_assert (! cc_oci_cmd_is_shell ("true"));
-	ck_assert (! cc_oci_cmd_is_shell ("/true"));
-	ck_assert (! cc_oci_cmd_is_shell ("/bin/true"));
-	ck_assert (! cc_oci_cmd_is_shell ("/usr/bin/true"));
-	ck_assert (! cc_oci_cmd_is_shell ("/usr/local/bin/true"));
-
-} END_TEST
-
 START_TEST(test_cc_run_hook) {
 
 	struct oci_cfg_hook *hook = NULL;
@@ -101,7 +57,7 @@ START_TEST(test_cc_run_hook) {
 	hook = g_new0 (struct oci_cfg_hook, 1);
 	ck_assert (hook);
 
-	g_strlcpy (hook->path, "dd", sizeof (hook->path));
+	hook->path = g_strdup ("dd");
 
 	/* fails since full path not specified */
 	ck_assert (! cc_run_hook (hook, "", 1));
@@ -118,7 +74,7 @@ START_TEST(test_cc_run_hook) {
 	hook = g_new0 (struct oci_cfg_hook, 1);
 	ck_assert (hook);
 
-	g_strlcpy (hook->path, cmd, sizeof (hook->path));
+	hook->path = g_strdup (cmd);
 
 	ck_assert (cc_run_hook (hook, "", 1));
 
@@ -134,7 +90,7 @@ START_TEST(test_cc_run_hook) {
 	hook = g_new0 (struct oci_cfg_hook, 1);
 	ck_assert (hook);
 
-	g_strlcpy (hook->path, cmd, sizeof (hook->path));
+	hook->path = g_strdup (cmd);
 
 	hook->args = g_new0 (gchar *, 2);
 	ck_assert (hook->args);
@@ -154,7 +110,7 @@ START_TEST(test_cc_run_hook) {
 	hook = g_new0 (struct oci_cfg_hook, 1);
 	ck_assert (hook);
 
-	g_strlcpy (hook->path, cmd, sizeof (hook->path));
+	hook->path = g_strdup (cmd);
 
 	hook->args = g_new0 (gchar *, 3);
 	ck_assert (hook->args);
@@ -175,7 +131,7 @@ START_TEST(test_cc_run_hook) {
 	hook = g_new0 (struct oci_cfg_hook, 1);
 	ck_assert (hook);
 
-	g_strlcpy (hook->path, cmd, sizeof (hook->path));
+	hook->path = g_strdup (cmd);
 
 	hook->args = g_new0 (gchar *, 4);
 	ck_assert (hook->args);
@@ -197,7 +153,7 @@ START_TEST(test_cc_run_hook) {
 	hook = g_new0 (struct oci_cfg_hook, 1);
 	ck_assert (hook);
 
-	g_strlcpy (hook->path, cmd, sizeof (hook->path));
+	hook->path = g_strdup (cmd);
 
 	hook->args = g_new0 (gchar *, 5);
 	ck_assert (hook->args);
@@ -218,7 +174,6 @@ START_TEST(test_cc_run_hook) {
 Suite* make_process_suite(void) {
 	Suite* s = suite_create(__FILE__);
 
-	ADD_TEST(test_cc_oci_cmd_is_shell, s);
 	ADD_TEST(test_cc_run_hook, s);
 
 	return s;
@@ -0,0 +1,396 @@
+/*
+ * This file is part of cc-oci-runtime.
+ *
+ * Copyright (C) 2016 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <utime.h>
+#include <sys/stat.h>
+
+#include <check.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "test_common.h"
+#include "../src/oci.h"
+#include "../src/oci-config.h"
+#include "../src/util.h"
+#include "../src/rootfs.h"
+#include "../src/mount.h"
+
+gchar *cc_oci_rootfs_image_path (const struct cc_oci_config *config);
+gchar *cc_oci_rootfs_fingerprint (const struct cc_oci_config *config);
+void cc_oci_rootfs_cache_prune (const gchar *dir);
+
+/* Remove the cached images left in dir. */
+static void
+remove_cached_images (const gchar *dir)
+{
+	GDir         *d;
+	const gchar  *name;
+
+	d = g_dir_open (dir, 0, NULL);
+	ck_assert (d);
+
+	while ((name = g_dir_read_name (d))) {
+		if (g_str_has_prefix (name, "cc-oci-rootfs-cache-")) {
+			gchar *path = g_build_path ("/", dir, name, NULL);
+			ck_assert (! g_remove (path));
+			g_free (path);
+		}
+	}
+
+	g_dir_close (d);
+}
+
+START_TEST(test_cc_oci_rootfs_image_path) {
+	struct cc_oci_config  config = { { 0 } };
+	g_autofree gchar     *path = NULL;
+
+	ck_assert (! cc_oci_rootfs_image_path (NULL));
+	ck_assert (! cc_oci_rootfs_image_path (&config));
+
+	config.vm = g_new0 (struct cc_oci_vm_cfg, 1);
+	ck_assert (! cc_oci_rootfs_image_path (&config));
+
+	config.optarg_container_id = "foo";
+	ck_assert (! cc_oci_rootfs_image_path (&config));
+
+	config.vm->rootfs_path = g_strdup ("/var/tmp");
+
+	path = cc_oci_rootfs_image_path (&config);
+	ck_assert (! g_strcmp0 (path, "/var/tmp/cc-oci-rootfs-foo.img"));
+
+	cc_oci_config_free (&config);
+} END_TEST
+
+START_TEST(test_cc_oci_rootfs_image_create) {
+	struct cc_oci_config  config = { { 0 } };
+	g_autofree gchar     *tmpdir = NULL;
+	g_autofree gchar     *rootfs = NULL;
+	g_autofree gchar     *file = NULL;
+	g_autofree gchar     *mkfs = NULL;
+	g_autofree gchar     *image = NULL;
+
+	ck_assert (! cc_oci_rootfs_image_create (NULL));
+	ck_assert (! cc_oci_rootfs_image_create (&config));
+	ck_assert (! cc_oci_rootfs_image_delete (NULL));
+	ck_assert (! cc_oci_rootfs_image_delete (&config));
+
+	tmpdir = g_dir_make_tmp (NULL, NULL);
+	ck_assert (tmpdir);
+
+	rootfs = g_build_path ("/", tmpdir, "rootfs", NULL);
+	ck_assert (! g_mkdir (rootfs, CC_OCI_DIR_MODE));
+
+	file = g_build_path ("/", rootfs, "hello", NULL);
+	ck_assert (g_file_set_contents (file, "world", -1, NULL));
+
+	config.optarg_container_id = "foo";
+	config.vm = g_new0 (struct cc_oci_vm_cfg, 1);
+	config.oci.root.path = g_strdup (rootfs);
+	config.vm->rootfs_path = g_strdup (tmpdir);
+
+	/* 9p requires no image */
+	ck_assert (cc_oci_rootfs_image_create (&config));
+	ck_assert (! config.vm->rootfs_image);
+	ck_assert (cc_oci_rootfs_image_delete (&config));
+
+	image = g_build_path ("/", tmpdir, "cc-oci-rootfs-foo.img", NULL);
+
+	config.vm->rootfs_backend = CC_OCI_VM_ROOTFS_BLOCK;
+	config.vm->rootfs_size = 8 * 1024 * 1024;
+
+	mkfs = g_find_program_in_path (CC_OCI_VM_ROOTFS_MKFS);
+	if (mkfs) {
+		/* mkfs might not support "-d", but must not leave
+		 * an image behind if it fails.
+		 */
+		if (cc_oci_rootfs_image_create (&config)) {
+			struct stat  st;
+			ino_t        ino;
+
+			ck_assert (! g_strcmp0 (config.vm->rootfs_image,
+						image));
+			ck_assert (g_file_test (image,
+						G_FILE_TEST_IS_REGULAR));
+
+			/* a link to the cached image */
+			ck_assert (! stat (image, &st));
+			ck_assert (st.st_nlink == 2);
+			ino = st.st_ino;
+
+			ck_assert (cc_oci_rootfs_image_delete (&config));
+			ck_assert (! config.vm->rootfs_image);
+
+			/* an unchanged rootfs reuses the cached image */
+			ck_assert (cc_oci_rootfs_image_create (&config));
+			ck_assert (! stat (image, &st));
+			ck_assert (st.st_ino == ino);
+
+			ck_assert (cc_oci_rootfs_image_delete (&config));
+			remove_cached_images (tmpdir);
+		} else {
+			ck_assert (! config.vm->rootfs_image);
+		}
+
+		ck_assert (! g_file_test (image, G_FILE_TEST_EXISTS));
+	}
+
+	/* an image that has already gone is not an error */
+	config.vm->rootfs_image = g_strdup (image);
+	ck_assert (cc_oci_rootfs_image_delete (&config));
+
+	/* the image directory must exist */
+	g_free (config.vm->rootfs_path);
+	config.vm->rootfs_path = g_strdup ("/does/not/exist");
+	ck_assert (! cc_oci_rootfs_image_create (&config));
+
+	ck_assert (! g_remove (file));
+	ck_assert (! g_remove (rootfs));
+	ck_assert (! g_remove (tmpdir));
+
+	cc_oci_config_free (&config);
+} END_TEST
+
+START_TEST(test_cc_oci_rootfs_profile_get) {
+	struct cc_oci_config           config = { { 0 } };
+	struct oci_cfg_annotation     *a;
+	enum cc_oci_vm_rootfs_profile  profile;
+
+	ck_assert (cc_oci_str_to_rootfs_profile (NULL)
+			== CC_OCI_VM_ROOTFS_PROFILE_INVALID);
+	ck_assert (cc_oci_str_to_rootfs_profile ("foo")
+			== CC_OCI_VM_ROOTFS_PROFILE_INVALID);
+	ck_assert (cc_oci_str_to_rootfs_profile ("default")
+			== CC_OCI_VM_ROOTFS_PROFILE_DEFAULT);
+	ck_assert (cc_oci_str_to_rootfs_profile ("readmostly")
+			== CC_OCI_VM_ROOTFS_PROFILE_READMOSTLY);
+	ck_assert (cc_oci_str_to_rootfs_profile ("build")
+			== CC_OCI_VM_ROOTFS_PROFILE_BUILD);
+
+	/* the default profile leaves the mount options to the guest */
+	ck_assert (! cc_oci_rootfs_profile_mount_options
+			(CC_OCI_VM_ROOTFS_PROFILE_DEFAULT));
+	ck_assert (! cc_oci_rootfs_profile_mount_options
+			(CC_OCI_VM_ROOTFS_PROFILE_INVALID));
+	ck_assert (g_strrstr (cc_oci_rootfs_profile_mount_options
+			(CC_OCI_VM_ROOTFS_PROFILE_READMOSTLY), "cache=loose"));
+	ck_assert (g_strrstr (cc_oci_rootfs_profile_mount_options
+			(CC_OCI_VM_ROOTFS_PROFILE_BUILD), "msize="));
+
+	ck_assert (! cc_oci_rootfs_profile_get (NULL, &profile));
+	ck_assert (! cc_oci_rootfs_profile_get (&config, &profile));
+
+	config.vm = g_new0 (struct cc_oci_vm_cfg, 1);
+	ck_assert (! cc_oci_rootfs_profile_get (&config, NULL));
+
+	/* vm.json profile */
+	config.vm->rootfs_profile = CC_OCI_VM_ROOTFS_PROFILE_BUILD;
+	ck_assert (cc_oci_rootfs_profile_get (&config, &profile));
+	ck_assert (profile == CC_OCI_VM_ROOTFS_PROFILE_BUILD);
+
+	/* overridden by the annotation */
+	a = g_new0 (struct oci_cfg_annotation, 1);
+	a->key = g_strdup (CC_OCI_ANNOTATION_ROOTFS_PROFILE);
+	a->value = g_strdup ("readmostly");
+	config.oci.annotations = g_slist_append (NULL, a);
+
+	ck_assert (cc_oci_rootfs_profile_get (&config, &profile));
+	ck_assert (profile == CC_OCI_VM_ROOTFS_PROFILE_READMOSTLY);
+
+	g_free (a->value);
+	a->value = g_strdup ("foo");
+	ck_assert (! cc_oci_rootfs_profile_get (&config, &profile));
+
+	cc_oci_config_free (&config);
+} END_TEST
+
+START_TEST(test_cc_oci_rootfs_fingerprint) {
+	struct cc_oci_config  config = { { 0 } };
+	g_autofree gchar     *tmpdir = NULL;
+	g_autofree gchar     *file = NULL;
+	g_autofree gchar     *workload = NULL;
+	gchar                *fingerprint;
+	gchar                *other;
+	struct utimbuf        times = { 1000, 1000 };
+
+	ck_assert (! cc_oci_rootfs_fingerprint (NULL));
+	ck_assert (! cc_oci_rootfs_fingerprint (&config));
+
+	tmpdir = g_dir_make_tmp (NULL, NULL);
+	ck_assert (tmpdir);
+
+	config.vm = g_new0 (struct cc_oci_vm_cfg, 1);
+	config.oci.root.path = g_strdup (tmpdir);
+
+	file = g_build_path ("/", tmpdir, "hello", NULL);
+	ck_assert (g_file_set_contents (file, "world", -1, NULL));
+	ck_assert (! utime (file, &times));
+
+	workload = g_build_path ("/", tmpdir, CC_OCI_WORKLOAD_FILE, NULL);
+	ck_assert (g_file_set_contents (workload, "true", -1, NULL));
+
+	fingerprint = cc_oci_rootfs_fingerprint (&config);
+	ck_assert (fingerprint);
+	ck_assert (strlen (fingerprint) == 64);
+
+	/* rewriting the workload is not a change */
+	ck_assert (g_file_set_contents (workload, "true", -1, NULL));
+	other = cc_oci_rootfs_fingerprint (&config);
+	ck_assert_str_eq (fingerprint, other);
+	g_free (other);
+
+	/* a different workload is */
+	ck_assert (g_file_set_contents (workload, "false", -1, NULL));
+	other = cc_oci_rootfs_fingerprint (&config);
+	ck_assert_str_ne (fingerprint, other);
+	g_free (other);
+	ck_assert (g_file_set_contents (workload, "true", -1, NULL));
+
+	/* so is a modified file */
+	times.modtime = 2000;
+	ck_assert (! utime (file, &times));
+	other = cc_oci_rootfs_fingerprint (&config);
+	ck_assert_str_ne (fingerprint, other);
+	g_free (other);
+
+	/* and the size of the image */
+	times.modtime = 1000;
+	ck_assert (! utime (file, &times));
+	config.vm->rootfs_size = 1024 * 1024;
+	other = cc_oci_rootfs_fingerprint (&config);
+	ck_assert_str_ne (fingerprint, other);
+	g_free (other);
+
+	g_free (fingerprint);
+
+	ck_assert (! g_remove (workload));
+	ck_assert (! g_remove (file));
+	ck_assert (! g_remove (tmpdir));
+
+	cc_oci_config_free (&config);
+} END_TEST
+
+START_TEST(test_cc_oci_rootfs_cache_prune) {
+	g_autofree gchar  *tmpdir = NULL;
+	g_autofree gchar  *used = NULL;
+	g_autofree gchar  *linked = NULL;
+	gchar             *path;
+	struct utimbuf     times;
+	gint               i;
+
+	tmpdir = g_dir_make_tmp (NULL, NULL);
+	ck_assert (tmpdir);
+
+	/* unused images, image 0 being the least recently used */
+	for (i = 0; i < 6; i++) {
+		path = g_strdup_printf ("%s/cc-oci-rootfs-cache-%d.img",
+				tmpdir, i);
+		ck_assert (g_file_set_contents (path, "", -1, NULL));
+		times.actime = times.modtime = 1000 + i;
+		ck_assert (! utime (path, &times));
+		g_free (path);
+	}
+
+	/* an image a container uses is kept, however old */
+	used = g_strdup_printf ("%s/cc-oci-rootfs-cache-used.img", tmpdir);
+	linked = g_strdup_printf ("%s/cc-oci-rootfs-foo.img", tmpdir);
+	ck_assert (g_file_set_contents (used, "", -1, NULL));
+	times.actime = times.modtime = 1;
+	ck_assert (! utime (used, &times));
+	ck_assert (! link (used, linked));
+
+	cc_oci_rootfs_cache_prune (tmpdir);
+
+	for (i = 0; i < 6; i++) {
+		path = g_strdup_printf ("%s/cc-oci-rootfs-cache-%d.img",
+				tmpdir, i);
+		ck_assert (g_file_test (path, G_FILE_TEST_EXISTS) == (i >= 2));
+		g_free (path);
+	}
+
+	ck_assert (g_file_test (used, G_FILE_TEST_EXISTS));
+	ck_assert (g_file_test (linked, G_FILE_TEST_EXISTS));
+
+	ck_assert (! g_remove (linked));
+	remove_cached_images (tmpdir);
+	ck_assert (! g_remove (tmpdir));
+} END_TEST
+
+START_TEST(test_cc_oci_rootfs_volumes) {
+	struct cc_oci_config   config = { { 0 } };
+	struct cc_oci_mount   *m;
+	const gchar           *dirs[] = { "/data", "/proc", "/a:b", "/etc/hosts" };
+	gchar                 *volumes;
+	gsize                  i;
+
+	volumes = cc_oci_rootfs_volumes (&config);
+	ck_assert_str_eq (volumes, "");
+	g_free (volumes);
+
+	for (i = 0; i < G_N_ELEMENTS (dirs); i++) {
+		m = g_new0 (struct cc_oci_mount, 1);
+		m->mnt.mnt_dir = g_strdup (dirs[i]);
+
+		/* ignored mounts are not applied below the rootfs */
+		if (g_strcmp0 (dirs[i], "/proc")) {
+			m->dest = g_strdup_printf ("/rootfs%s", dirs[i]);
+		}
+
+		config.oci.mounts = g_slist_append (config.oci.mounts, m);
+	}
+
+	/* paths that cannot be passed to the guest are skipped */
+	volumes = cc_oci_rootfs_volumes (&config);
+	ck_assert_str_eq (volumes, "/data:/etc/hosts");
+	g_free (volumes);
+
+	cc_oci_config_free (&config);
+} END_TEST
+
+Suite* make_rootfs_suite(void) {
+	Suite* s = suite_create(__FILE__);
+
+	ADD_TEST(test_cc_oci_rootfs_image_path, s);
+	ADD_TEST(test_cc_oci_rootfs_image_create, s);
+	ADD_TEST(test_cc_oci_rootfs_profile_get, s);
+	ADD_TEST(test_cc_oci_rootfs_fingerprint, s);
+	ADD_TEST(test_cc_oci_rootfs_cache_prune, s);
+	ADD_TEST(test_cc_oci_rootfs_volumes, s);
+
+	return s;
+}
+
+int main (void) {
+	int number_failed;
+	Suite* s;
+	SRunner* sr;
+
+	s = make_rootfs_suite();
+	sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_VERBOSE);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -49,6 +49,7 @@ START_TEST(test_cc_oci_runtime_path_get) {
 
 	ck_assert (! g_strcmp0 (config.state.runtime_path, expected));
 	g_free (expected);
+	g_free (config.state.runtime_path);
 
 } END_TEST
 
@@ -67,9 +68,7 @@ START_TEST(test_cc_oci_runtime_dir_setup) {
 	/* Set the runtimepath which subverts cc_oci_runtime_dir_setup()
 	 * setting it.
 	 */
-	g_snprintf (config.state.runtime_path,
-			(gulong)sizeof (config.state.runtime_path),
-			"%s/%s",
+	config.state.runtime_path = g_strdup_printf ("%s/%s",
 			tmpdir,
 			config.optarg_container_id);
 
@@ -86,6 +85,9 @@ START_TEST(test_cc_oci_runtime_dir_setup) {
 	ck_assert (! g_rmdir (tmpdir));
 
 	g_free (tmpdir);
+	g_free (config.state.runtime_path);
+	g_free (config.state.comms_path);
+	g_free (config.state.procsock_path);
 
 } END_TEST
 
@@ -99,24 +101,19 @@ START_TEST(test_cc_oci_runtime_dir_delete) {
 	/* No runtime_path set */
 	ck_assert (! cc_oci_runtime_dir_delete (&config));
 
-	g_snprintf (config.state.runtime_path,
-			(gulong)sizeof (config.state.runtime_path),
-			"hello");
+	config.state.runtime_path = g_strdup ("hello");
 
 	/* runtime_path is not absolute */
 	ck_assert (! cc_oci_runtime_dir_delete (&config));
 
-	g_snprintf (config.state.runtime_path,
-			(gulong)sizeof (config.state.runtime_path),
-			"../hello");
+	g_free (config.state.runtime_path);
+	config.state.runtime_path = g_strdup ("../hello");
 
 	/* runtime_path still not absolute */
 	ck_assert (! cc_oci_runtime_dir_delete (&config));
 
-	g_snprintf (config.state.runtime_path,
-			(gulong)sizeof (config.state.runtime_path),
-			"%s",
-			tmpdir);
+	g_free (config.state.runtime_path);
+	config.state.runtime_path = g_strdup (tmpdir);
 
 	ret = g_file_test (config.state.runtime_path, G_FILE_TEST_EXISTS);
 	ck_assert (ret);
@@ -128,6 +125,7 @@ START_TEST(test_cc_oci_runtime_dir_delete) {
 	ck_assert (! ret);
 
 	g_free (tmpdir);
+	g_free (config.state.runtime_path);
 } END_TEST
 
 Suite* make_runtime_suite(void) {
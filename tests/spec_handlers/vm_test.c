@@ -36,12 +36,27 @@ extern struct spec_handler vm_spec_handler;
 * - kernel path
 * vm json optional:
 * - kernel parameters
+* - memory
+* - rootfs
+* - boot
 */
 static struct spec_handler_test tests[] = {
 	{ TEST_DATA_DIR "/vm-no-path.json",              false },
 	{ TEST_DATA_DIR "/vm-no-image.json",             false },
 	{ TEST_DATA_DIR "/vm-no-kernel-path.json",       false },
 	{ TEST_DATA_DIR "/vm-no-kernel-parameters.json", true  },
+	{ TEST_DATA_DIR "/vm-memory-shared.json",        true  },
+	{ TEST_DATA_DIR "/vm-memory-invalid-backend.json", false },
+	{ TEST_DATA_DIR "/vm-memory-hugepages-not-hugetlbfs.json", false },
+	{ TEST_DATA_DIR "/vm-memory-invalid-hugepage-size.json", false },
+	{ TEST_DATA_DIR "/vm-rootfs-block.json",         true  },
+	{ TEST_DATA_DIR "/vm-rootfs-invalid-backend.json", false },
+	{ TEST_DATA_DIR "/vm-rootfs-invalid-size.json",  false },
+	{ TEST_DATA_DIR "/vm-rootfs-profile.json",       true  },
+	{ TEST_DATA_DIR "/vm-rootfs-invalid-profile.json", false },
+	{ TEST_DATA_DIR "/vm-boot-agent.json",           true  },
+	{ TEST_DATA_DIR "/vm-boot-invalid.json",         false },
+	{ TEST_DATA_DIR "/vm-boot-agent-block.json",     false },
 	{ TEST_DATA_DIR "/vm.json",                      true  },
 	{ NULL, false },
 };
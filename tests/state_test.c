@@ -20,6 +20,7 @@
 
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
 #include <unistd.h>
 #include <sys/stat.h>
 #include <fcntl.h>
@@ -38,11 +39,17 @@
 const gchar *
 cc_oci_status_get (const struct cc_oci_config *config);
 
+enum cc_oci_state_sync
+cc_oci_state_sync_resolve (enum cc_oci_state_sync sync, const gchar *dir);
+
 START_TEST(test_cc_oci_state_file_get) {
 	struct cc_oci_config config = { { 0 } };
 	ck_assert(!cc_oci_state_file_get(&config));
-	g_snprintf(config.state.runtime_path, PATH_MAX, "/tmp");
+	config.state.runtime_path = g_strdup ("/tmp");
 	ck_assert(cc_oci_state_file_get(&config));
+	ck_assert_str_eq (config.state.state_file_path,
+			"/tmp/" CC_OCI_STATE_FILE);
+	cc_oci_config_free (&config);
 } END_TEST
 
 
@@ -123,8 +130,24 @@ START_TEST(test_cc_oci_state_file_read) {
 	ck_assert(state->procsock_path);
 	ck_assert(state->status);
 	ck_assert(state->annotations);
+	ck_assert(state->vm_resources);
+	ck_assert(state->vm_resources->boot_vcpus == 2);
+	ck_assert(state->vm_resources->max_vcpus == 8);
+	ck_assert(state->vm_resources->vcpus == 4);
+	ck_assert(state->vm_resources->boot_memory == 2147483648ULL);
+	ck_assert(state->vm_resources->max_memory == 3221225472ULL);
+	ck_assert(state->vm_resources->memory_slots == 2);
+	ck_assert(state->vm_resources->hotplugged_memory == 536870912ULL);
+	ck_assert(state->vm_resources->memory_limit == 2147483648ULL);
 	cc_oci_state_free(state);
 
+	/* Resources are optional */
+	state = cc_oci_state_file_read(TEST_DATA_DIR
+	                "/state-no-annotations.json");
+	ck_assert (state);
+	ck_assert (! state->vm_resources);
+	cc_oci_state_free (state);
+
 } END_TEST
 
 START_TEST(test_cc_oci_state_free) {
@@ -148,8 +171,13 @@ START_TEST(test_cc_oci_state_file_create) {
 	const gchar *timestamp = "foo";
         struct oci_cfg_annotation* a = NULL;
 	struct cc_oci_mount *m = NULL;
+	struct oci_state *state = NULL;
 	g_autofree gchar *tmpdir = g_dir_make_tmp (NULL, NULL);
 	gboolean ret;
+	gchar *contents = NULL;
+	gchar *formatted = NULL;
+	gsize length = 0;
+	GDir *dir = NULL;
 
 	ck_assert(! cc_oci_state_file_create (NULL, NULL));
 
@@ -188,8 +216,10 @@ START_TEST(test_cc_oci_state_file_create) {
 	ck_assert(! cc_oci_state_file_create (&config, NULL));
 	ck_assert(! cc_oci_state_file_create (&config, timestamp));
 
-	g_snprintf(config.state.comms_path, PATH_MAX, "/tmp");
-	g_snprintf(config.state.procsock_path, PATH_MAX, "/tmp");
+	g_free (config.state.comms_path);
+	config.state.comms_path = g_strdup ("/tmp");
+	g_free (config.state.procsock_path);
+	config.state.procsock_path = g_strdup ("/tmp");
 
 	ck_assert(! cc_oci_state_file_create (&config, NULL));
 
@@ -205,23 +235,16 @@ START_TEST(test_cc_oci_state_file_create) {
 	config.vm = g_malloc0 (sizeof(struct cc_oci_vm_cfg));
 	ck_assert (config.vm);
 
-	g_strlcpy (config.vm->hypervisor_path, "hypervisor-path",
-			sizeof (config.vm->hypervisor_path));
-
-	g_strlcpy (config.vm->image_path, "image-path",
-			sizeof (config.vm->image_path));
-
-	g_strlcpy (config.vm->kernel_path, "kernel-path",
-			sizeof (config.vm->kernel_path));
-
-	g_strlcpy (config.vm->workload_path, "workload-path",
-			sizeof (config.vm->workload_path));
+	config.vm->hypervisor_path = g_strdup ("hypervisor-path");
+	config.vm->image_path = g_strdup ("image-path");
+	config.vm->kernel_path = g_strdup ("kernel-path");
+	config.vm->workload_path = g_strdup ("workload-path");
 
 	config.vm->kernel_params = g_strdup ("kernel params");
 
 	/* All required elements now set */
 	m = g_new0(struct cc_oci_mount, 1);
-	g_snprintf(m->dest, sizeof(m->dest), "/tmp/tmp/tmp");
+	m->dest = g_strdup("/tmp/tmp/tmp");
 	m->directory_created = g_strdup("/tmp/tmp/");
 	m->ignore_mount = true;
 	config.oci.mounts = g_slist_append(config.oci.mounts, m);
@@ -232,11 +255,68 @@ START_TEST(test_cc_oci_state_file_create) {
 			G_FILE_TEST_EXISTS);
 	ck_assert (ret);
 
+	/* resources are only recorded once known */
+	state = cc_oci_state_file_read (config.state.state_file_path);
+	ck_assert (state);
+	ck_assert (! state->vm_resources);
+	cc_oci_state_free (state);
+
+	/* an unknown start time is not taken from whichever process
+	 * has the pid now
+	 */
+	config.state.workload_pid = getpid ();
+	ck_assert (cc_oci_state_file_create (&config, timestamp));
+	ck_assert (! config.state.workload_start_time);
+
+	state = cc_oci_state_file_read (config.state.state_file_path);
+	ck_assert (state);
+	ck_assert (state->pid == getpid ());
+	ck_assert (! state->pid_start_time);
+	cc_oci_state_free (state);
+
+	config.vm_resources.boot_vcpus = 2;
+	config.vm_resources.max_vcpus = 8;
+	config.vm_resources.vcpus = 3;
+	config.vm_resources.boot_memory = 2147483648ULL;
+	config.vm_resources.max_memory = 3221225472ULL;
+	config.vm_resources.memory_slots = 2;
+	config.vm_resources.hotplugged_memory = 134217728ULL;
+	config.vm_resources.memory_limit = 1073741824ULL;
+
+	ck_assert (cc_oci_state_file_create (&config, timestamp));
+
+	state = cc_oci_state_file_read (config.state.state_file_path);
+	ck_assert (state);
+	ck_assert (state->vm_resources);
+	ck_assert (! memcmp (state->vm_resources, &config.vm_resources,
+				sizeof (config.vm_resources)));
+	cc_oci_state_free (state);
+
+	/* state files are written compactly, and atomically */
+	config.state.sync = CC_OCI_STATE_SYNC_FULL;
+	ck_assert (cc_oci_state_file_create (&config, timestamp));
+
+	ck_assert (g_file_get_contents (config.state.state_file_path,
+				&contents, &length, NULL));
+	ck_assert (! strchr (contents, '\n'));
+	formatted = cc_oci_state_file_format (contents, length, &length);
+	ck_assert (formatted);
+	ck_assert (strstr (formatted, "\"status\" : \"created\""));
+	g_free (formatted);
+	g_free (contents);
+
+	dir = g_dir_open (config.state.runtime_path, 0, NULL);
+	ck_assert (dir);
+	ck_assert_str_eq (g_dir_read_name (dir), CC_OCI_STATE_FILE);
+	ck_assert (! g_dir_read_name (dir));
+	g_dir_close (dir);
+
 	ck_assert (! g_remove (config.state.state_file_path));
 	ck_assert (! g_remove (config.state.runtime_path));
 	ck_assert (! g_remove (tmpdir));
 
-	g_snprintf(config.state.runtime_path, PATH_MAX, "/abc/xyz/123");
+	g_free (config.state.runtime_path);
+	config.state.runtime_path = g_strdup ("/abc/xyz/123");
 	ck_assert(!cc_oci_state_file_create (&config, timestamp));
 
 	/* clean up */
@@ -248,7 +328,7 @@ START_TEST(test_cc_oci_state_file_delete) {
 	struct cc_oci_config config = { { 0 } };
 	gint fd = 0;
 
-	g_snprintf(config.state.state_file_path, PATH_MAX, "/tmp/.fileXXXXXX");
+	config.state.state_file_path = g_strdup ("/tmp/.fileXXXXXX");
 
 	fd = g_mkstemp(config.state.state_file_path);
 	ck_assert(fd != -1);
@@ -258,6 +338,7 @@ START_TEST(test_cc_oci_state_file_delete) {
 
 	ck_assert(stat(config.state.state_file_path, &st));
 
+	g_free (config.state.state_file_path);
 } END_TEST
 
 START_TEST(test_cc_oci_state_file_exists) {
@@ -320,6 +401,54 @@ START_TEST(test_cc_oci_status_to_str) {
 
 } END_TEST
 
+START_TEST(test_cc_oci_state_file_format) {
+	gchar *str;
+	gsize length = 0;
+
+	ck_assert (! cc_oci_state_file_format (NULL, 0, &length));
+	ck_assert (! cc_oci_state_file_format ("{}", 2, NULL));
+	ck_assert (! cc_oci_state_file_format ("{", 1, &length));
+
+	str = cc_oci_state_file_format ("{\"id\":\"foo\"}", 12, &length);
+	ck_assert (str);
+	ck_assert (strstr (str, "\"id\" : \"foo\""));
+	ck_assert (length == strlen (str));
+	g_free (str);
+} END_TEST
+
+START_TEST(test_cc_oci_state_sync_resolve) {
+	enum cc_oci_state_sync sync;
+
+	ck_assert (cc_oci_state_sync_resolve (CC_OCI_STATE_SYNC_NONE, "/tmp")
+			== CC_OCI_STATE_SYNC_NONE);
+	ck_assert (cc_oci_state_sync_resolve (CC_OCI_STATE_SYNC_DATA, "/tmp")
+			== CC_OCI_STATE_SYNC_DATA);
+	ck_assert (cc_oci_state_sync_resolve (CC_OCI_STATE_SYNC_FULL, "/tmp")
+			== CC_OCI_STATE_SYNC_FULL);
+
+	/* depends on the file system */
+	sync = cc_oci_state_sync_resolve (CC_OCI_STATE_SYNC_AUTO, "/tmp");
+	ck_assert (sync == CC_OCI_STATE_SYNC_NONE
+			|| sync == CC_OCI_STATE_SYNC_DATA);
+
+	/* unknown, be safe */
+	ck_assert (cc_oci_state_sync_resolve (CC_OCI_STATE_SYNC_AUTO,
+				"/does/not/exist") == CC_OCI_STATE_SYNC_DATA);
+	ck_assert (cc_oci_state_sync_resolve (CC_OCI_STATE_SYNC_AUTO, NULL)
+			== CC_OCI_STATE_SYNC_DATA);
+} END_TEST
+
+START_TEST(test_cc_oci_str_to_state_sync) {
+	ck_assert (cc_oci_str_to_state_sync (NULL) == CC_OCI_STATE_SYNC_INVALID);
+	ck_assert (cc_oci_str_to_state_sync ("") == CC_OCI_STATE_SYNC_INVALID);
+	ck_assert (cc_oci_str_to_state_sync ("FULL") == CC_OCI_STATE_SYNC_INVALID);
+
+	ck_assert (cc_oci_str_to_state_sync ("auto") == CC_OCI_STATE_SYNC_AUTO);
+	ck_assert (cc_oci_str_to_state_sync ("none") == CC_OCI_STATE_SYNC_NONE);
+	ck_assert (cc_oci_str_to_state_sync ("data") == CC_OCI_STATE_SYNC_DATA);
+	ck_assert (cc_oci_str_to_state_sync ("full") == CC_OCI_STATE_SYNC_FULL);
+} END_TEST
+
 START_TEST(test_cc_oci_str_to_status) {
 
 	ck_assert (cc_oci_str_to_status (NULL) == OCI_STATUS_INVALID);
@@ -345,6 +474,9 @@ Suite* make_state_suite(void) {
 	ADD_TEST(test_cc_oci_status_get, s);
 	ADD_TEST(test_cc_oci_status_to_str, s);
 	ADD_TEST(test_cc_oci_str_to_status, s);
+	ADD_TEST(test_cc_oci_state_file_format, s);
+	ADD_TEST(test_cc_oci_state_sync_resolve, s);
+	ADD_TEST(test_cc_oci_str_to_state_sync, s);
 
 	return s;
 }
@@ -211,9 +211,7 @@ test_helper_create_state_file (const char *name,
 		config->state.workload_pid = getpid ();
 	}
 
-	g_strlcpy (config->state.procsock_path,
-			"procsock-path",
-		  sizeof (config->state.procsock_path));
+	config->state.procsock_path = g_strdup ("procsock-path");
 
 	if (! cc_oci_runtime_dir_setup (config)) {
 		fprintf (stderr, "ERROR: failed to setup runtime dir "
@@ -231,17 +229,10 @@ test_helper_create_state_file (const char *name,
 	config->vm = g_malloc0 (sizeof(struct cc_oci_vm_cfg));
 	assert (config->vm);
 
-	g_strlcpy (config->vm->hypervisor_path, "hypervisor-path",
-			sizeof (config->vm->hypervisor_path));
-
-	g_strlcpy (config->vm->image_path, "image-path",
-			sizeof (config->vm->image_path));
-
-	g_strlcpy (config->vm->kernel_path, "kernel-path",
-			sizeof (config->vm->kernel_path));
-
-	g_strlcpy (config->vm->workload_path, "workload-path",
-			sizeof (config->vm->workload_path));
+	config->vm->hypervisor_path = g_strdup ("hypervisor-path");
+	config->vm->image_path = g_strdup ("image-path");
+	config->vm->kernel_path = g_strdup ("kernel-path");
+	config->vm->workload_path = g_strdup ("workload-path");
 
 	config->vm->kernel_params = g_strdup_printf ("kernel params for %s", name);
 
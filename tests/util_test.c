@@ -517,6 +517,109 @@ START_TEST(test_cc_oci_enable_networking) {
 
 } END_TEST
 
+START_TEST(test_cc_oci_str_to_bytes) {
+	guint64 bytes = 0;
+
+	ck_assert (! cc_oci_str_to_bytes (NULL, 1, NULL));
+	ck_assert (! cc_oci_str_to_bytes (NULL, 1, &bytes));
+	ck_assert (! cc_oci_str_to_bytes ("", 1, &bytes));
+	ck_assert (! cc_oci_str_to_bytes ("1", 1, NULL));
+	ck_assert (! cc_oci_str_to_bytes ("foo", 1, &bytes));
+	ck_assert (! cc_oci_str_to_bytes ("-1", 1, &bytes));
+	ck_assert (! cc_oci_str_to_bytes ("1X", 1, &bytes));
+	ck_assert (! cc_oci_str_to_bytes ("1GB", 1, &bytes));
+	ck_assert (! cc_oci_str_to_bytes ("99999999999T", 1, &bytes));
+
+	ck_assert (cc_oci_str_to_bytes ("0", 1, &bytes));
+	ck_assert (bytes == 0);
+
+	ck_assert (cc_oci_str_to_bytes ("1024", 1, &bytes));
+	ck_assert (bytes == 1024);
+
+	ck_assert (cc_oci_str_to_bytes ("2048", 1024*1024, &bytes));
+	ck_assert (bytes == 2048ULL*1024*1024);
+
+	ck_assert (cc_oci_str_to_bytes ("4k", 1, &bytes));
+	ck_assert (bytes == 4096);
+
+	ck_assert (cc_oci_str_to_bytes ("512M", 1, &bytes));
+	ck_assert (bytes == 512ULL*1024*1024);
+
+	ck_assert (cc_oci_str_to_bytes ("3G", 1, &bytes));
+	ck_assert (bytes == 3ULL*1024*1024*1024);
+
+	ck_assert (cc_oci_str_to_bytes ("1T", 1, &bytes));
+	ck_assert (bytes == 1ULL*1024*1024*1024*1024);
+
+} END_TEST
+
+START_TEST(test_cc_oci_cpuset_count) {
+	ck_assert (! cc_oci_cpuset_count (NULL));
+	ck_assert (! cc_oci_cpuset_count (""));
+	ck_assert (! cc_oci_cpuset_count ("foo"));
+	ck_assert (! cc_oci_cpuset_count ("1-"));
+	ck_assert (! cc_oci_cpuset_count ("-1"));
+	ck_assert (! cc_oci_cpuset_count ("3-1"));
+	ck_assert (! cc_oci_cpuset_count ("1,,2"));
+	ck_assert (! cc_oci_cpuset_count ("1;2"));
+
+	ck_assert (cc_oci_cpuset_count ("0") == 1);
+	ck_assert (cc_oci_cpuset_count ("3") == 1);
+	ck_assert (cc_oci_cpuset_count ("0,1") == 2);
+	ck_assert (cc_oci_cpuset_count ("0-3") == 4);
+	ck_assert (cc_oci_cpuset_count ("0-3,6") == 5);
+	ck_assert (cc_oci_cpuset_count ("0-1,4-7") == 6);
+
+} END_TEST
+
+START_TEST(test_cc_oci_file_write_atomic) {
+	gchar  *tmpdir;
+	gchar  *path;
+	gchar  *contents = NULL;
+	GDir   *dir;
+
+	tmpdir = g_dir_make_tmp (NULL, NULL);
+	ck_assert (tmpdir);
+
+	path = g_build_path ("/", tmpdir, "file", NULL);
+
+	ck_assert (! cc_oci_file_write_atomic (NULL, "foo", 3, false, false));
+	ck_assert (! cc_oci_file_write_atomic (path, NULL, 3, false, false));
+	ck_assert (! cc_oci_file_write_atomic ("/does/not/exist/file",
+				"foo", 3, false, false));
+
+	/* new file */
+	ck_assert (cc_oci_file_write_atomic (path, "foo", 3, false, false));
+	ck_assert (g_file_get_contents (path, &contents, NULL, NULL));
+	ck_assert_str_eq (contents, "foo");
+	g_free (contents);
+
+	/* replaced file, flushed to storage */
+	ck_assert (cc_oci_file_write_atomic (path, "hello", 5, true, true));
+	ck_assert (g_file_get_contents (path, &contents, NULL, NULL));
+	ck_assert_str_eq (contents, "hello");
+	g_free (contents);
+
+	/* only part of the data */
+	ck_assert (cc_oci_file_write_atomic (path, "hello", 2, true, false));
+	ck_assert (g_file_get_contents (path, &contents, NULL, NULL));
+	ck_assert_str_eq (contents, "he");
+	g_free (contents);
+
+	/* no temporary file left behind */
+	dir = g_dir_open (tmpdir, 0, NULL);
+	ck_assert (dir);
+	ck_assert_str_eq (g_dir_read_name (dir), "file");
+	ck_assert (! g_dir_read_name (dir));
+	g_dir_close (dir);
+
+	ck_assert (! g_remove (path));
+	ck_assert (! g_remove (tmpdir));
+
+	g_free (path);
+	g_free (tmpdir);
+} END_TEST
+
 Suite* make_util_suite(void) {
 	Suite* s = suite_create(__FILE__);
 
@@ -531,6 +634,9 @@ Suite* make_util_suite(void) {
 	ADD_TEST(test_cc_oci_node_dump, s);
 	ADD_TEST(test_cc_oci_resolve_path, s);
 	ADD_TEST(test_cc_oci_enable_networking, s);
+	ADD_TEST(test_cc_oci_str_to_bytes, s);
+	ADD_TEST(test_cc_oci_cpuset_count, s);
+	ADD_TEST(test_cc_oci_file_write_atomic, s);
 
 	return s;
 }
@@ -0,0 +1,185 @@
+/*
+ * This file is part of cc-oci-runtime.
+ *
+ * Copyright (C) 2016 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <check.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "test_common.h"
+#include "../src/oci.h"
+#include "../src/vm_socket.h"
+
+gchar *cc_oci_vm_socket_path (const struct cc_oci_config *config,
+		enum cc_oci_vm_socket socket);
+
+static gboolean
+can_connect (const gchar *path)
+{
+	struct sockaddr_un  addr = { 0 };
+	gboolean            ret;
+	int                 fd;
+
+	fd = socket (AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0) {
+		return false;
+	}
+
+	addr.sun_family = AF_UNIX;
+	g_strlcpy (addr.sun_path, path, sizeof (addr.sun_path));
+
+	ret = connect (fd, (struct sockaddr *)&addr, sizeof (addr)) == 0;
+
+	close (fd);
+
+	return ret;
+}
+
+START_TEST(test_cc_oci_vm_socket_listen) {
+	g_autofree gchar *tmpdir = NULL;
+	g_autofree gchar *path = NULL;
+	gchar             long_path[PATH_MAX];
+	int               fd;
+
+	ck_assert (cc_oci_vm_socket_listen (NULL) < 0);
+	ck_assert (cc_oci_vm_socket_listen ("") < 0);
+
+	memset (long_path, 'x', sizeof (long_path) - 1);
+	long_path[sizeof (long_path) - 1] = '\0';
+	ck_assert (cc_oci_vm_socket_listen (long_path) < 0);
+
+	tmpdir = g_dir_make_tmp (NULL, NULL);
+	ck_assert (tmpdir);
+
+	path = g_build_path ("/", tmpdir, "test.sock", NULL);
+
+	/* a stale file is replaced */
+	ck_assert (g_file_set_contents (path, "", -1, NULL));
+
+	fd = cc_oci_vm_socket_listen (path);
+	ck_assert (fd > STDERR_FILENO);
+	ck_assert (can_connect (path));
+
+	close (fd);
+	ck_assert (! can_connect (path));
+
+	ck_assert (! g_remove (path));
+	ck_assert (! g_remove (tmpdir));
+} END_TEST
+
+START_TEST(test_cc_oci_vm_sockets_wanted) {
+	gchar *args_none[] = { "-qmp", "unix:@COMMS_SOCKET@,server,nowait", NULL };
+	gchar *args_fd[] = { "-chardev", "socket,id=qmp,fd=@COMMS_SOCKET_FD@", NULL };
+	gchar *args_comment[] = { "# fd=@AGENT_CTL_SOCKET_FD@", NULL };
+
+	ck_assert (! cc_oci_vm_sockets_wanted (NULL));
+	ck_assert (! cc_oci_vm_sockets_wanted (args_none));
+	ck_assert (cc_oci_vm_sockets_wanted (args_fd));
+	ck_assert (! cc_oci_vm_sockets_wanted (args_comment));
+} END_TEST
+
+START_TEST(test_cc_oci_vm_sockets_create) {
+	struct cc_oci_config config = { { 0 } };
+	g_autofree gchar *tmpdir = NULL;
+	gchar            *path;
+	gchar *args_none[] = { "unix:@COMMS_SOCKET@,server,nowait", NULL };
+	gchar *args_fd[] = { "fd=@COMMS_SOCKET_FD@", NULL };
+	int    i;
+
+	tmpdir = g_dir_make_tmp (NULL, NULL);
+	ck_assert (tmpdir);
+
+	config.state.runtime_path = g_strdup (tmpdir);
+	config.state.comms_path = g_strdup_printf ("%s/%s",
+			tmpdir, CC_OCI_HYPERVISOR_SOCKET);
+	config.state.procsock_path = g_strdup_printf ("%s/%s",
+			tmpdir, CC_OCI_PROCESS_SOCKET);
+
+	ck_assert (! cc_oci_vm_sockets_create (NULL, args_fd, false));
+	ck_assert (! cc_oci_vm_sockets_create (&config, NULL, false));
+
+	/* nothing to do */
+	ck_assert (cc_oci_vm_sockets_create (&config, args_none, true));
+	for (i = 0; i < CC_OCI_VM_SOCKET_MAX; i++) {
+		ck_assert (! config.vm_sockets[i]);
+	}
+
+	ck_assert (cc_oci_vm_sockets_create (&config, args_fd, true));
+
+	ck_assert (config.vm_sockets[CC_OCI_VM_SOCKET_COMMS]);
+	ck_assert (config.vm_sockets[CC_OCI_VM_SOCKET_PROCESS]);
+	ck_assert (config.vm_sockets[CC_OCI_VM_SOCKET_CONSOLE]);
+	ck_assert (! config.vm_sockets[CC_OCI_VM_SOCKET_AGENT_CTL]);
+	ck_assert (! config.vm_sockets[CC_OCI_VM_SOCKET_AGENT_TTY]);
+
+	ck_assert (can_connect (config.state.comms_path));
+	ck_assert (can_connect (config.state.procsock_path));
+
+	ck_assert (cc_oci_vm_socket_inherited (&config,
+				config.vm_sockets[CC_OCI_VM_SOCKET_COMMS]));
+	ck_assert (! cc_oci_vm_socket_inherited (&config, STDIN_FILENO));
+	ck_assert (! cc_oci_vm_socket_inherited (NULL,
+				config.vm_sockets[CC_OCI_VM_SOCKET_COMMS]));
+
+	cc_oci_vm_sockets_close (&config);
+	for (i = 0; i < CC_OCI_VM_SOCKET_MAX; i++) {
+		ck_assert (! config.vm_sockets[i]);
+	}
+
+	ck_assert (! g_remove (config.state.comms_path));
+	ck_assert (! g_remove (config.state.procsock_path));
+
+	path = cc_oci_vm_socket_path (&config, CC_OCI_VM_SOCKET_CONSOLE);
+	ck_assert (! g_remove (path));
+	g_free (path);
+
+	ck_assert (! g_remove (tmpdir));
+} END_TEST
+
+Suite* make_vm_socket_suite(void) {
+	Suite* s = suite_create(__FILE__);
+
+	ADD_TEST(test_cc_oci_vm_socket_listen, s);
+	ADD_TEST(test_cc_oci_vm_sockets_wanted, s);
+	ADD_TEST(test_cc_oci_vm_sockets_create, s);
+
+	return s;
+}
+
+int main (void) {
+	int number_failed;
+	Suite* s;
+	SRunner* sr;
+
+	s = make_vm_socket_suite();
+	sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_VERBOSE);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}